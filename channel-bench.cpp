@@ -0,0 +1,130 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "sync/channel.h"
+#include "sync/channelMetrics.h"
+#include "util/cxxopts.hpp"
+
+struct BenchResult {
+  double seconds_ = 0;
+  uint64_t wakeups_ = 0;
+  uint64_t futile_wakeups_ = 0;
+  uint64_t elements_ = 0;
+};
+
+BenchResult RunChannelBench(NonCoroWaitStrategy strategy, size_t producers, size_t consumers, size_t capacity,
+                            size_t elements_per_producer) {
+  NonCoroBufferedChannel<uint64_t> channel{capacity};
+  channel.SetWaitStrategy(strategy);
+  auto metrics = std::make_shared<ChannelMetrics>("bench");
+  channel.EnableMetrics(metrics);
+
+  std::vector<std::thread> producer_threads;
+  std::vector<std::thread> consumer_threads;
+  std::vector<uint64_t> consumed(consumers, 0);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t index = 0; index < consumers; index++) {
+    consumer_threads.emplace_back([&channel, &consumed, index]() {
+      for (std::optional<uint64_t> value = channel.Pop(); value.has_value(); value = channel.Pop()) {
+        ++consumed[index];
+      }
+    });
+  }
+  for (size_t index = 0; index < producers; index++) {
+    producer_threads.emplace_back([&channel, elements_per_producer]() {
+      for (uint64_t value = 0; value < elements_per_producer; value++) {
+        channel.Push(value);
+      }
+    });
+  }
+  for (auto &thread : producer_threads) {
+    thread.join();
+  }
+  channel.CloseChannel();
+  for (auto &thread : consumer_threads) {
+    thread.join();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  BenchResult result;
+  result.seconds_ = std::chrono::duration<double>(end - start).count();
+  result.wakeups_ = metrics->GetWakeups();
+  result.futile_wakeups_ = metrics->GetFutileWakeups();
+  for (const uint64_t amount : consumed) {
+    result.elements_ += amount;
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  cxxopts::Options options("channel-bench",
+                           "Microbenchmark counting wakeups per element of the non coroutine buffered channel");
+
+  options.add_options()("h,help", "Print usage")
+      ("producers", "Amount of producer threads", cxxopts::value<size_t>()->default_value("4"))
+      ("consumers", "Amount of consumer threads", cxxopts::value<size_t>()->default_value("4"))
+      ("capacity", "Capacity of the channel", cxxopts::value<size_t>()->default_value("64"))
+      ("elements", "Elements pushed per producer", cxxopts::value<size_t>()->default_value("1000000"));
+
+  cxxopts::ParseResult result;
+  try {
+    result = options.parse(argc, argv);
+  } catch (cxxopts::exceptions::exception &e) {
+    std::cerr << "Could not parse cli options: " << e.what() << '\n';
+    exit(EXIT_FAILURE);
+  }
+
+  if (result.count("help")) {
+    std::cout << options.help() << '\n';
+    exit(EXIT_SUCCESS);
+  }
+
+  const auto producers = result["producers"].as<size_t>();
+  const auto consumers = result["consumers"].as<size_t>();
+  const auto capacity = result["capacity"].as<size_t>();
+  const auto elements = result["elements"].as<size_t>();
+  if (producers == 0 or consumers == 0 or capacity == 0) {
+    std::cerr << "producers, consumers and capacity must be larger than 0" << '\n';
+    exit(EXIT_FAILURE);
+  }
+
+  for (const auto strategy : {NonCoroWaitStrategy::kBlock, NonCoroWaitStrategy::kSpinThenBlock}) {
+    const BenchResult bench = RunChannelBench(strategy, producers, consumers, capacity, elements);
+    const char *name = strategy == NonCoroWaitStrategy::kBlock ? "block" : "spin-then-block";
+    std::cout << name << ": elements=" << bench.elements_
+              << ", seconds=" << bench.seconds_
+              << ", wakeups=" << bench.wakeups_
+              << ", futile_wakeups=" << bench.futile_wakeups_
+              << ", wakeups_per_element=" << static_cast<double>(bench.wakeups_) / bench.elements_ << '\n';
+  }
+
+  exit(EXIT_SUCCESS);
+}
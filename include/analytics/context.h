@@ -24,6 +24,7 @@
 
 #include <iostream>
 #include <memory>
+#include <utility>
 
 #include "util/exception.h"
 #include "util/factory.h"
@@ -59,10 +60,15 @@ class Context {
   const uint64_t parent_id_;
   const bool has_parent_ = true;
   const uint64_t parent_start_ts_;
+  // keeps the events of the parent pinned while the context is in flight, the parent itself may
+  // already be exported and gone
+  const ResumePin parent_pin_;
 
  public:
-  explicit Context(uint64_t trace_id, expectation expectation, uint64_t parent_id, uint64_t parent_start_ts)
-      : trace_id_(trace_id), expectation_(expectation), parent_id_(parent_id), parent_start_ts_(parent_start_ts) {
+  explicit Context(uint64_t trace_id, expectation expectation, uint64_t parent_id, uint64_t parent_start_ts,
+                   ResumePin parent_pin = {})
+      : trace_id_(trace_id), expectation_(expectation), parent_id_(parent_id), parent_start_ts_(parent_start_ts),
+        parent_pin_(std::move(parent_pin)) {
     throw_on_false(TraceEnvironment::IsValidId(trace_id),
                    TraceException::kInvalidId, source_loc::current());
     throw_on_false(TraceEnvironment::IsValidId(parent_id),
@@ -85,6 +91,11 @@ class Context {
     return trace_id_;
   }
 
+  // kNoResumeTs if the parent was not pinned
+  inline uint64_t GetParentReplayTs() const {
+    return parent_pin_.GetTs();
+  }
+
   inline uint64_t GetParentId() const {
     return parent_id_;
   }
@@ -105,7 +116,8 @@ class Context {
                                           parent_span->GetValidTraceId(),
                                           Exp,
                                           parent_span->GetValidId(),
-                                          parent_span->GetStartingTs());
+                                          parent_span->GetStartingTs(),
+                                          parent_span->GetResumePin());
     assert(context);
     return context;
   }
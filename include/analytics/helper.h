@@ -59,6 +59,10 @@ class NodeDeviceToChannelMap {
     AddMapping(key, channel);
   }
 
+  bool HasMapping(int node, int device) const {
+    return mapping_.contains(std::make_pair(node, device));
+  }
+
   ChanT GetValidChannel(int node, int device) const {
     auto result = GetChannel(std::make_pair(node, device));
     throw_if_empty(result, TraceException::kChannelIsNull, source_loc::current());
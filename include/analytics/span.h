@@ -27,6 +27,7 @@
 
 #include <iostream>
 #include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <optional>
@@ -98,6 +99,8 @@ class EventSpan {
   std::shared_ptr<EventSpan> original_ = nullptr;
   std::shared_ptr<TraceContext> trace_context_ = nullptr;
   std::string &service_name_;
+  // only set when checkpoints are taken, see PinForResume
+  ResumePin resume_pin_;
 
 //  std::recursive_mutex span_mutex_;
 
@@ -188,6 +191,28 @@ class EventSpan {
 
   uint64_t GetCompletionTs();
 
+  // Keeps a checkpoint from skipping the events this span, and the spans it descends from, were
+  // built from as long as the span lives. The earliest of the given timestamps is pinned.
+  void PinForResume(uint64_t replay_ts) {
+    if (not trace_environment_.IsCheckpointingEnabled()) {
+      return;
+    }
+    if (resume_pin_.IsPinned()) {
+      resume_pin_.Lower(replay_ts);
+      return;
+    }
+    resume_pin_ = ResumePin{trace_environment_.GetCheckpoints().GetFrontier(), replay_ts};
+  }
+
+  [[nodiscard]] inline const ResumePin &GetResumePin() const {
+    return resume_pin_;
+  }
+
+  // kNoResumeTs if the span is not pinned
+  [[nodiscard]] inline uint64_t GetReplayTs() const {
+    return resume_pin_.GetTs();
+  }
+
   bool SetContext(const std::shared_ptr<TraceContext> &traceContext, bool override_existing);
 
   bool HasParent() {
@@ -243,7 +268,8 @@ class EventSpan {
         is_relevant_(other.is_relevant_),
         original_(other.original_),
         trace_context_(other.trace_context_),
-        service_name_(other.service_name_) {
+        service_name_(other.service_name_),
+        resume_pin_(other.resume_pin_) {
     // NOTE: we make only a shallow copy
   }
 
@@ -257,6 +283,17 @@ class EventSpan {
 };
 
 class HostCallSpan final : public EventSpan {
+ public:
+  // calls of one function that were counted instead of stored as events
+  struct CallSummary {
+    uint64_t count_ = 0;
+    uint64_t first_ts_ = 0;
+    uint64_t last_ts_ = 0;
+  };
+  // function -> summary, function names are internalized and hence compared by pointer
+  using CallSummaries = std::unordered_map<const std::string *, CallSummary>;
+
+ private:
   std::shared_ptr<Event> call_span_entry_ = nullptr;
   std::shared_ptr<Event> syscall_return_ = nullptr;
   bool kernel_transmit_ = false;
@@ -265,6 +302,15 @@ class HostCallSpan final : public EventSpan {
   bool driver_receive_ = false;
   bool is_fragmented_ = true;
 
+  // only set when summarising, in that case events_ only holds the syscall entry (or the first call
+  // of a fragmented span), the indicator calls and the latest call; copies are only made once a
+  // span is done and share the summaries
+  std::shared_ptr<CallSummaries> call_summaries_ = nullptr;
+  // the last event is an ordinary call that is replaced by the next call
+  bool last_is_summarised_ = false;
+
+  void AddCall(const std::shared_ptr<Event> &event_ptr, bool is_indicator);
+
  public:
   explicit HostCallSpan(TraceEnvironment &trace_environment,
                         std::shared_ptr<TraceContext> &trace_context,
@@ -273,6 +319,9 @@ class HostCallSpan final : public EventSpan {
                         bool fragmented)
       : EventSpan(trace_environment, trace_context, source_id, span_type::kHostCall, service_name),
         is_fragmented_(fragmented) {
+    if (trace_environment_.ShouldSummariseHostCalls()) {
+      call_summaries_ = create_shared<CallSummaries>("could not create call summaries");
+    }
   }
 
   // NOTE: we make only a shallow copy
@@ -312,6 +361,15 @@ class HostCallSpan final : public EventSpan {
     return is_fragmented_;
   }
 
+  [[nodiscard]] bool IsSummarised() const {
+    return call_summaries_ != nullptr;
+  }
+
+  // null if the span is not summarised
+  [[nodiscard]] std::shared_ptr<const CallSummaries> GetCallSummaries() const {
+    return call_summaries_;
+  }
+
   void MarkAsDone() override {
     is_fragmented_ = is_fragmented_ or call_span_entry_ == nullptr or syscall_return_ == nullptr;
     is_pending_ = false;
@@ -416,6 +474,12 @@ class HostMmioSpan final : public EventSpan {
     return is_posted_;
   }
 
+  // id of the issuing mmio operation, its completion carries the same id
+  [[nodiscard]] uint64_t GetIssueId() const {
+    throw_if_empty(host_mmio_issue_, TraceException::kEventIsNull, source_loc::current());
+    return std::static_pointer_cast<HostIdOp>(host_mmio_issue_)->GetId();
+  }
+
   bool AddToSpan(const std::shared_ptr<Event> &event_ptr) override;
 };
 
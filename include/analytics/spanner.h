@@ -22,11 +22,15 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <list>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
 #include <memory>
+#include <type_traits>
 #include <utility>
 
 #include "util/exception.h"
+#include "util/bucketMap.h"
 #include "env/traceEnvironment.h"
 #include "sync/corobelt.h"
 #include "events/events.h"
@@ -50,12 +54,30 @@ struct Spanner : public Consumer<std::shared_ptr<Event>> {
   using EventT = std::shared_ptr<Event>;
   using ChannelT = std::shared_ptr<CoroChannel<std::shared_ptr<Context>>>;
   using ResultT = concurrencpp::result<bool>;
-  using HandlerT = std::function<ResultT(ExecutorT, EventT &)>;
-  std::unordered_map<EventType, HandlerT> handler_;
+  // non owning handler, calls a member function of the concrete spanner, see RegisterHandlers
+  using HandlerT = ResultT (*)(Spanner &, ExecutorT, EventT &);
+  std::array<HandlerT, kEventTypeCount> handler_{};
+
+  // only set when metrics are exported
+  std::shared_ptr<MetricCounter> events_consumed_ = nullptr;
+  std::shared_ptr<MetricCounter> events_not_added_ = nullptr;
+  std::shared_ptr<MetricHistogram> consume_latency_ = nullptr;
+
+  // only set when checkpoints are taken
+  std::shared_ptr<ConsumerProgress> progress_ = nullptr;
+
+  // only set when the skew between spanners is bounded, joined on the first consumed event
+  bool joined_skew_window_ = false;
+  std::shared_ptr<WeakTimer> skew_window_ = nullptr;
+  size_t skew_key_ = 0;
+
+  concurrencpp::result<void> JoinSkewWindow(std::shared_ptr<concurrencpp::executor> executor);
 
   concurrencpp::result<void> consume(std::shared_ptr<concurrencpp::executor> executor,
                                      std::shared_ptr<Event> value) override;
 
+  concurrencpp::result<void> finish(std::shared_ptr<concurrencpp::executor> executor) override;
+
   explicit Spanner(TraceEnvironment &trace_environment,
                    std::string &&name,
                    Tracer &tra)
@@ -63,24 +85,41 @@ struct Spanner : public Consumer<std::shared_ptr<Event>> {
         id_(trace_environment_.GetNextSpannerId()),
         name_(name),
         tracer_(tra) {
+    RegisterMetrics();
+    if (trace_environment_.IsCheckpointingEnabled()) {
+      progress_ = trace_environment_.GetCheckpoints().RegisterConsumer();
+    }
   }
 
-  explicit Spanner(TraceEnvironment &trace_environment,
-                   std::string &&name,
-                   Tracer &tra,
-                   std::unordered_map<EventType, HandlerT> &&handler)
-      : trace_environment_(trace_environment),
-        id_(trace_environment_.GetNextSpannerId()),
-        name_(name),
-        tracer_(tra),
-        handler_(handler) {
+  void RegisterMetrics() {
+    if (not trace_environment_.IsMetricsEnabled()) {
+      return;
+    }
+    MetricsRegistry &registry = trace_environment_.GetMetrics();
+    const MetricLabels labels{{"spanner", name_}};
+    events_consumed_ = registry.GetCounter("columbo_spanner_events_total", "Events consumed by a spanner.", labels);
+    events_not_added_ = registry.GetCounter("columbo_spanner_events_not_added_total",
+                                            "Events a spanner could not add to any span.", labels);
+    consume_latency_ = registry.GetHistogram("columbo_spanner_consume_seconds",
+                                             "Time a spanner took to consume an event.", labels);
   }
 
-  void RegisterHandler(EventType type, HandlerT &&handler) {
-    auto it_suc = handler_.insert({type, handler});
-    throw_on(not it_suc.second,
+  void RegisterHandler(EventType type, HandlerT handler) {
+    throw_on(handler == nullptr, TraceException::kHandlerIsNull, source_loc::current());
+    HandlerT &slot = handler_[static_cast<size_t>(type)];
+    throw_on(slot != nullptr,
              "Spanner::RegisterHandler Could not insert new handler",
              source_loc::current());
+    slot = handler;
+  }
+
+  // Registers the member function Handel of SpannerT for all given event types. The handler is
+  // bound at compile time, dispatching an event is an array access and a direct call.
+  template<class SpannerT, ResultT (SpannerT::*Handel)(ExecutorT, EventT &), EventType... Types>
+  void RegisterHandlers() {
+    static_assert(std::is_base_of_v<Spanner, SpannerT>, "handlers must be members of a spanner");
+    static_assert(((static_cast<size_t>(Types) < kEventTypeCount) and ...), "unknown event type");
+    (RegisterHandler(Types, &Dispatch<SpannerT, Handel>), ...);
   }
 
   inline uint64_t GetId() const {
@@ -88,23 +127,41 @@ struct Spanner : public Consumer<std::shared_ptr<Event>> {
   }
 
  protected:
+  template<class SpannerT, ResultT (SpannerT::*Handel)(ExecutorT, EventT &)>
+  static ResultT Dispatch(Spanner &spanner, ExecutorT executor, EventT &event_ptr) {
+    return (static_cast<SpannerT &>(spanner).*Handel)(std::move(executor), event_ptr);
+  }
+
+  // Pending spans are bucketed by a key derived from the event fields their AddToSpan matches on,
+  // e.g. the id of a dma. The key only narrows down the candidates while AddToSpan still decides,
+  // hence the fields may be folded into one value as long as matching events yield the same key.
+  static uint64_t PendingKey(std::initializer_list<uint64_t> fields) {
+    uint64_t key = 0xcbf29ce484222325ULL;
+    for (const uint64_t field : fields) {
+      key ^= field + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+    }
+    return key;
+  }
+
+  // tries the pending spans stored under key in the order they were added, just like a scan over
+  // all pending spans would, since spans under other keys cannot accept the event anyway
   template<class St>
   std::shared_ptr<St>
-  iterate_add_erase(std::list<std::shared_ptr<St>> &pending,
-                    std::shared_ptr<Event> event_ptr) {
-    std::shared_ptr<St> pending_span = nullptr;
-
-    for (auto it = pending.begin(); it != pending.end(); it++) {
-      pending_span = *it;
-      if (pending_span and pending_span->AddToSpan(event_ptr)) {
-        if (pending_span->IsComplete()) {
-          pending.erase(it);
-        }
-        return pending_span;
-      }
+  iterate_add_erase(BucketMap<uint64_t, std::shared_ptr<St>> &pending,
+                    uint64_t key,
+                    const std::shared_ptr<Event> &event_ptr) {
+    std::shared_ptr<St> *found = pending.FindIf(key, [&event_ptr](std::shared_ptr<St> &pending_span) {
+      return pending_span and pending_span->AddToSpan(event_ptr);
+    });
+    if (not found) {
+      return nullptr;
     }
 
-    return nullptr;
+    std::shared_ptr<St> pending_span = *found;
+    if (pending_span->IsComplete()) {
+      pending.Remove(key, pending_span);
+    }
+    return pending_span;
   }
 
   concurrencpp::result<std::shared_ptr<Context>> PopPropagateContext(
@@ -176,8 +233,12 @@ struct HostSpanner : public Spanner {
   std::shared_ptr<HostCallSpan> pending_host_call_span_ = nullptr;
   std::shared_ptr<HostIntSpan> pending_host_int_span_ = nullptr;
   std::shared_ptr<HostMsixSpan> pending_host_msix_span_ = nullptr;
-  std::list<std::shared_ptr<HostDmaSpan>> pending_host_dma_spans_;
-  std::list<std::shared_ptr<HostMmioSpan>> pending_host_mmio_spans_;
+  // keyed by the id of the dma
+  BucketMap<uint64_t, std::shared_ptr<HostDmaSpan>> pending_host_dma_spans_;
+  // keyed by the id of the mmio, posted writes are in addition kept by the timestamp of their issue
+  // until their immediate response arrived
+  BucketMap<uint64_t, std::shared_ptr<HostMmioSpan>> pending_host_mmio_spans_;
+  BucketMap<uint64_t, std::shared_ptr<HostMmioSpan>> pending_host_posted_mmio_spans_;
   std::shared_ptr<HostPciSpan> pending_pci_span_;
 };
 
@@ -215,7 +276,8 @@ struct NicSpanner : public Spanner {
   std::shared_ptr<Context> last_host_context_ = nullptr;
   std::shared_ptr<EventSpan> last_causing_ = nullptr;
 
-  std::list<std::shared_ptr<NicDmaSpan>> pending_nic_dma_spans_;
+  // keyed by the id and address of the dma
+  BucketMap<uint64_t, std::shared_ptr<NicDmaSpan>> pending_nic_dma_spans_;
 };
 
 struct NetworkSpanner : public Spanner {
@@ -234,7 +296,8 @@ struct NetworkSpanner : public Spanner {
 
   // TODO: may need this to be a vector as well
   std::shared_ptr<NetDeviceSpan> last_finished_device_span_ = nullptr;
-  std::list<std::shared_ptr<NetDeviceSpan>> current_active_device_spans_;
+  // keyed by the packet uid, node and device of the enqueue
+  BucketMap<uint64_t, std::shared_ptr<NetDeviceSpan>> current_active_device_spans_;
   //std::shared_ptr<NetDeviceSpan> current_device_span_ = nullptr;
 
   const NodeDeviceToChannelMap &from_host_channels_;
@@ -22,13 +22,24 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <functional>
 #include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/spdlog.h"
 
 #include "sync/corobelt.h"
 #include "events/events.h"
+#include "util/exception.h"
 
 #ifndef SIMBRICKS_TRACE_TIMER_H_
 #define SIMBRICKS_TRACE_TIMER_H_
@@ -87,132 +98,267 @@ class Timer {
   }
 };
 
+// Keeps the minimum over a fixed amount of slots without taking a lock. Values of a slot only
+// grow, hence every node of the tree only grows too and is raised with a compare and swap loop.
+// Once Update returned, the minimum reflects the update: out of two updates racing on the same
+// node at least one reads both raised children.
+class MinTournamentTree {
+  size_t leaves_ = 2;
+  // heap layout, node 1 is the root and the leaves start at index leaves_
+  std::vector<std::atomic<uint64_t>> nodes_;
+
+  void Raise(size_t node, uint64_t value) {
+    uint64_t current = nodes_[node].load();
+    while (current < value and not nodes_[node].compare_exchange_weak(current, value)) {
+    }
+  }
+
+ public:
+  explicit MinTournamentTree(size_t slots, uint64_t initial = 0) {
+    while (leaves_ < slots) {
+      leaves_ *= 2;
+    }
+    nodes_ = std::vector<std::atomic<uint64_t>>(2 * leaves_);
+    for (size_t slot = 0; slot < leaves_; slot++) {
+      // leaves without slot never hold back the minimum
+      nodes_[leaves_ + slot].store(slot < slots ? initial : UINT64_MAX);
+    }
+    for (size_t node = leaves_ - 1; node > 0; node--) {
+      nodes_[node].store(std::min(nodes_[2 * node].load(), nodes_[2 * node + 1].load()));
+    }
+  }
+
+  // NOTE: values lower than the current value of the slot are ignored
+  void Update(size_t slot, uint64_t value) {
+    size_t node = leaves_ + slot;
+    Raise(node, value);
+    for (node /= 2; node > 0; node /= 2) {
+      Raise(node, std::min(nodes_[2 * node].load(), nodes_[2 * node + 1].load()));
+    }
+  }
+
+  uint64_t GetMin() const {
+    return nodes_[1].load();
+  }
+
+  uint64_t Get(size_t slot) const {
+    return nodes_[leaves_ + slot].load();
+  }
+
+  // calls func for every slot whose value is at most bound, only subtrees whose minimum is at
+  // most bound are visited
+  template<typename FuncT>
+  void ForEachAtMost(uint64_t bound, FuncT &&func) const {
+    std::vector<size_t> to_visit{1};
+    while (not to_visit.empty()) {
+      const size_t node = to_visit.back();
+      to_visit.pop_back();
+      if (nodes_[node].load() > bound) {
+        continue;
+      }
+      if (node >= leaves_) {
+        func(node - leaves_);
+        continue;
+      }
+      to_visit.push_back(2 * node + 1);
+      to_visit.push_back(2 * node);
+    }
+  }
+};
+
+// Lets a fixed amount of waiters advance in timestamp order: a waiter moving forward to a
+// timestamp continues once every other waiter announced a timestamp of at least timestamp - window
+// or is done. With a window of 0 waiters advance in lockstep, a larger window bounds how far the
+// fastest waiter may run ahead of the slowest one. Waiters that did not move forward yet hold
+// everyone else back at timestamp 0.
 class WeakTimer {
   using ExecutorT = std::shared_ptr<concurrencpp::executor>;
   using KeyResT = concurrencpp::result<size_t>;
   using VoidResT = concurrencpp::result<void>;
 
+  struct Slot {
+    concurrencpp::async_lock lock_;
+    concurrencpp::async_condition_variable cv_;
+    std::atomic<bool> parked_ = false;
+    // steady clock time in ns since which the waiter is parked, only valid while parked
+    std::atomic<int64_t> parked_since_ns_ = 0;
+    std::string name_;
+  };
+
  private:
-  concurrencpp::async_lock timer_lock_;
-  concurrencpp::async_condition_variable timer_cv_;
-  size_t amount_waiters_;
-  size_t next_key_ = 0;
-  std::vector<uint64_t> waiters_;
-  uint64_t cur_minimum_ = UINT64_MAX;
-  size_t registered_ = 0;
-  size_t waiters_that_reached_min_ = 0;
-  size_t still_needed_waiters_;
-  std::set<size_t> active_waiters_;
-
-  void ComputeMin() {
-    // NOTE: lock must be held when calling this method
-    cur_minimum_ = UINT64_MAX;
-    // O(n)... however probably much more efficient for small
-    // amount of waiters than "fancy" data structures
-    for (size_t index = 0; index < amount_waiters_; index++) {
-      if (waiters_[index] < cur_minimum_) {
-        cur_minimum_ = waiters_[index];
+  const size_t amount_waiters_;
+  const uint64_t window_;
+  std::atomic<size_t> next_key_ = 0;
+  MinTournamentTree timestamps_;
+  std::vector<Slot> slots_;
+  // largest bound the parked waiters were already woken up to
+  std::atomic<uint64_t> woken_up_to_ = 0;
+  std::atomic<uint64_t> wakeups_ = 0;
+
+  uint64_t GetBound() const {
+    const uint64_t minimum = timestamps_.GetMin();
+    return minimum > UINT64_MAX - window_ ? UINT64_MAX : minimum + window_;
+  }
+
+  // wakes the parked waiters whose timestamp is not larger than the current bound
+  VoidResT WakeEligible(ExecutorT resume_executor, size_t own_key) {
+    const uint64_t bound = GetBound();
+    // whoever raised woken_up_to_ walks the tree after the bound was reached
+    uint64_t previous = woken_up_to_.load();
+    while (previous < bound and not woken_up_to_.compare_exchange_weak(previous, bound)) {
+    }
+    if (previous >= bound) {
+      co_return;
+    }
+
+    std::vector<size_t> eligible;
+    timestamps_.ForEachAtMost(bound, [&eligible, own_key](size_t key) {
+      if (key != own_key) {
+        eligible.push_back(key);
+      }
+    });
+
+    for (const size_t key : eligible) {
+      Slot &slot = slots_[key];
+      if (not slot.parked_.load()) {
+        continue;
+      }
+      {
+        // taking the lock ensures the waiter either sees the new minimum or is already suspended
+        concurrencpp::scoped_async_lock guard = co_await slot.lock_.lock(resume_executor);
       }
+      ++wakeups_;
+      slot.cv_.notify_one();
     }
+    co_return;
   }
 
  public:
-  explicit WeakTimer(size_t amount_waiters) : amount_waiters_(amount_waiters),
-                                              still_needed_waiters_(amount_waiters) {
+  explicit WeakTimer(size_t amount_waiters, uint64_t window = 0) : amount_waiters_(amount_waiters),
+                                                                   window_(window),
+                                                                   timestamps_(amount_waiters),
+                                                                   slots_(amount_waiters) {
     throw_on(amount_waiters < 2,
              "WeakTimer: must use more than one waiter, otherwise the timer is useless",
              source_loc::current());
-    waiters_.resize(amount_waiters);
   };
 
-  KeyResT Register(ExecutorT resume_executor) {
-    size_t key;
-    bool last_to_register;
-    {
-      concurrencpp::scoped_async_lock guard = co_await timer_lock_.lock(resume_executor);
-      throw_on(registered_ >= amount_waiters_,
-               "Timer::Register: already AmountWaiters many waiters registered",
-               source_loc::current());
-      ++registered_;
-      key = next_key_++;
-      waiters_[key] = UINT64_MAX;
-      last_to_register = registered_ == amount_waiters_;
-    }
-
-    if (last_to_register) {
-      std::cout << "WeakTimer::Register: all waiters registered!!" << std::endl;
-      timer_cv_.notify_all();
-    }
-
+  KeyResT Register(ExecutorT resume_executor, std::string name = "") {
+    const size_t key = next_key_.fetch_add(1);
+    throw_on(key >= amount_waiters_,
+             "Timer::Register: already AmountWaiters many waiters registered",
+             source_loc::current());
+    slots_[key].name_ = std::move(name);
     co_return key;
   }
 
   VoidResT Done(ExecutorT resume_executor, size_t key) {
-    {
-      concurrencpp::scoped_async_lock guard = co_await timer_lock_.lock(resume_executor);
-      --still_needed_waiters_;
-      waiters_[key] = UINT64_MAX;
-      ComputeMin();
-      std::cout << "WeakTimer::Done: only " << still_needed_waiters_ << " waiters left" << std::endl;
+    throw_on(key >= amount_waiters_,
+             "WeakTimer::Done: illegal key",
+             source_loc::current());
+    timestamps_.Update(key, UINT64_MAX);
+    co_await WakeEligible(resume_executor, key);
+  }
+
+  VoidResT MoveForward(ExecutorT resume_executor, size_t key, uint64_t timestamp) {
+    throw_on(key >= amount_waiters_,
+             "Timer::Register: try moving forward with illegal key",
+             source_loc::current());
+
+    // the waiter already was allowed to advance further than timestamp
+    if (timestamp <= timestamps_.Get(key)) {
+      co_return;
     }
 
-    timer_cv_.notify_all();
+    timestamps_.Update(key, timestamp);
+    co_await WakeEligible(resume_executor, key);
+    if (GetBound() >= timestamp) {
+      co_return;
+    }
+
+    Slot &slot = slots_[key];
+    concurrencpp::scoped_async_lock guard = co_await slot.lock_.lock(resume_executor);
+    slot.parked_since_ns_.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    slot.parked_.store(true);
+    co_await slot.cv_.await(resume_executor, guard, [this, timestamp]() {
+      return GetBound() >= timestamp;
+    });
+    slot.parked_.store(false);
+    co_return;
   }
 
-  VoidResT MoveForward(ExecutorT resume_executor, size_t key, uint64_t timestamp) {
-    {
-      concurrencpp::scoped_async_lock guard = co_await timer_lock_.lock(resume_executor);
-      throw_on(key >= amount_waiters_,
-               "Timer::Register: try moving forward with illegal key",
-               source_loc::current());
-
-      // wait for all waiters to at least register
-      //co_await timer_cv_.await(resume_executor, guard, [this]() {
-      //  return registered_ == amount_waiters_;
-      //});
-      if (not active_waiters_.contains(key)) {
-        const auto marked_active = active_waiters_.insert(key);
-        throw_on(not marked_active.second,
-                 "WeakTimer::MoveForward: could not mark waiter as active",
-                 source_loc::current());
+  uint64_t GetWakeups() const {
+    return wakeups_.load();
+  }
+
+  // calls func(name, parked_for, timestamp) for every waiter parked for at least limit
+  template<typename FuncT>
+  void ForEachParkedLongerThan(std::chrono::nanoseconds limit, FuncT &&func) const {
+    const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    for (size_t key = 0; key < std::min(next_key_.load(), amount_waiters_); ++key) {
+      const Slot &slot = slots_[key];
+      if (not slot.parked_.load()) {
+        continue;
       }
-      waiters_[key] = timestamp;
-      // move forward if smaller than the current minimum/when being in the past
-      if (timestamp < cur_minimum_) {
-        guard.unlock();
-        timer_cv_.notify_all();
-        co_return;
+      const std::chrono::nanoseconds parked_for{now - slot.parked_since_ns_.load()};
+      if (parked_for >= limit) {
+        func(slot.name_, parked_for, timestamps_.Get(key));
       }
-
-      ++waiters_that_reached_min_;
-      // find the minimum when all are waiting currently
-      ComputeMin();
-      //if (waiters_that_reached_min_ == still_needed_waiters_) {
-      //  ComputeMin();
-      //  if (timestamp <= cur_minimum_) {
-      //    // if minimum return
-      //    --waiters_that_reached_min_;
-      //    guard.unlock();
-      //    timer_cv_.notify_all();
-      //    co_return;
-      //  }
-      //}
     }
+  }
 
-    timer_cv_.notify_all();
+  uint64_t GetSlowest() const {
+    return timestamps_.GetMin();
+  }
 
-    {
-      concurrencpp::scoped_async_lock guard = co_await timer_lock_.lock(resume_executor);
-      // await being the minimum and notify others
-      co_await timer_cv_.await(resume_executor, guard, [this, timestamp]() {
-        return cur_minimum_ >= timestamp and waiters_that_reached_min_ == active_waiters_.size();
+  uint64_t GetWindow() const {
+    return window_;
+  }
+};
+
+// Warns periodically from a background thread about waiters of a WeakTimer that are parked for
+// longer than a limit. A window smaller than the latency between the components lets spanners
+// wait for each other forever, which otherwise goes unnoticed.
+class WeakTimerWatchdog {
+  const WeakTimer &timer_;
+  const std::chrono::seconds limit_;
+  std::mutex watchdog_mutex_;
+  std::condition_variable watchdog_cv_;
+  bool stop_ = false;
+  std::thread watchdog_;
+
+  void Watch() {
+    std::unique_lock lock{watchdog_mutex_};
+    while (not watchdog_cv_.wait_for(lock, limit_, [this] { return stop_; })) {
+      timer_.ForEachParkedLongerThan(limit_, [this](const std::string &name,
+                                                     std::chrono::nanoseconds parked_for,
+                                                     uint64_t timestamp) {
+        spdlog::warn("'{}' is blocked for {}s at {}ps, the slowest waiter is at {}ps; the window of {}ps "
+                     "may be smaller than the latency between the components",
+                     name, std::chrono::duration_cast<std::chrono::seconds>(parked_for).count(), timestamp,
+                     timer_.GetSlowest(), timer_.GetWindow());
       });
-      --waiters_that_reached_min_;
     }
-    timer_cv_.notify_all();
-    co_return;
   }
 
+ public:
+  WeakTimerWatchdog(const WeakTimer &timer, std::chrono::seconds limit) : timer_(timer), limit_(limit) {
+    throw_on(limit_.count() == 0, "weak timer watchdog limit is 0", source_loc::current());
+    watchdog_ = std::thread{&WeakTimerWatchdog::Watch, this};
+  }
+
+  WeakTimerWatchdog(const WeakTimerWatchdog &) = delete;
+
+  WeakTimerWatchdog &operator=(const WeakTimerWatchdog &) = delete;
+
+  ~WeakTimerWatchdog() {
+    {
+      const std::lock_guard<std::mutex> guard{watchdog_mutex_};
+      stop_ = true;
+    }
+    watchdog_cv_.notify_all();
+    watchdog_.join();
+  }
 };
 
 #endif // SIMBRICKS_TRACE_TIMER_H_
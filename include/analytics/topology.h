@@ -0,0 +1,114 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "config/config.h"
+#include "env/traceEnvironment.h"
+#include "events/eventTimeBoundary.h"
+#include "analytics/helper.h"
+#include "analytics/spanner.h"
+#include "analytics/tracer.h"
+#include "sync/corobelt.h"
+#include "util/componenttable.h"
+
+#ifndef SIMBRICKS_TRACE_INCLUDE_ANALYTICS_TOPOLOGY_H_
+#define SIMBRICKS_TRACE_INCLUDE_ANALYTICS_TOPOLOGY_H_
+
+// Creates the parsers, providers, spanners, context channels and pipelines of an experiment
+// with an arbitrary amount of hosts as described by the topology section of the trace
+// environment configuration. Every host contributes a gem5 and a nicbm pipeline, the ns3
+// pipeline connects the NICs of all hosts.
+//
+// NOTE: filters and spanners keep references into the builder, it must therefore outlive
+// the execution of the built pipelines
+class TopologyBuilder {
+ public:
+  using PipelineT = Pipeline<std::shared_ptr<Event>>;
+  using PipelinesT = std::shared_ptr<std::vector<std::shared_ptr<PipelineT>>>;
+
+  explicit TopologyBuilder(TraceEnvironment &trace_environment,
+                           const TraceEnvConfig &trace_env_config,
+                           Tracer &tracer,
+                           std::vector<EventTimeBoundary> timestamp_bounds);
+
+  TopologyBuilder(const TopologyBuilder &) = delete;
+
+  TopologyBuilder &operator=(const TopologyBuilder &) = delete;
+
+  // may only be called once
+  PipelinesT Build();
+
+  [[nodiscard]] inline const NodeDeviceToChannelMap &GetToHostMap() const {
+    return to_host_map_;
+  }
+
+  [[nodiscard]] inline const NodeDeviceToChannelMap &GetFromHostMap() const {
+    return from_host_map_;
+  }
+
+  [[nodiscard]] inline const NodeDeviceFilter &GetNodeDeviceFilter() const {
+    return node_device_filter_;
+  }
+
+  // channel the packets of sink devices end in
+  [[nodiscard]] inline const std::shared_ptr<CoroChannel<std::shared_ptr<Context>>> &GetSink() const {
+    return sink_;
+  }
+
+ private:
+  using ContextQueueT = std::shared_ptr<CoroChannel<std::shared_ptr<Context>>>;
+  using HandlerT = std::shared_ptr<std::vector<std::shared_ptr<Handler<std::shared_ptr<Event>>>>>;
+
+  ContextQueueT CreateContextQueue(const std::string &name);
+
+  std::shared_ptr<Producer<std::shared_ptr<Event>>> CreateProvider(const std::string &name,
+                                                                     const std::string &path,
+                                                                     std::shared_ptr<LogParser> parser);
+
+  HandlerT CreateHandler(const TraceEnvConfig::LogSourceConf &source);
+
+  void BuildHost(const TraceEnvConfig::HostTopologyConf &host);
+
+  void BuildNetwork();
+
+  TraceEnvironment &trace_environment_;
+  const TraceEnvConfig &trace_env_config_;
+  Tracer &tracer_;
+  std::vector<EventTimeBoundary> timestamp_bounds_;
+  const std::set<EventType> types_to_filter_;
+  const std::set<std::string> blacklist_functions_;
+  std::vector<std::unique_ptr<ComponentFilter>> component_filters_;
+  NodeDeviceToChannelMap to_host_map_;
+  NodeDeviceToChannelMap from_host_map_;
+  NodeDeviceFilter node_device_filter_;
+  ContextQueueT sink_;
+  PipelinesT pipelines_;
+  bool built_ = false;
+};
+
+#endif // SIMBRICKS_TRACE_INCLUDE_ANALYTICS_TOPOLOGY_H_
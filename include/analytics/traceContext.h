@@ -108,6 +108,14 @@ class TraceContext {
     parent_start_ts_ = parent_start_ts;
   }
 
+  // makes the context a trace starting one, used when the parent will never be exported
+  void DetachParent() {
+    const std::lock_guard<std::mutex> guard(trace_context_mutex_);
+    parent_id_ = TraceEnvironment::GetDefaultId();
+    has_parent_ = false;
+    parent_start_ts_ = UINT64_MAX;
+  }
+
 };
 
 inline std::shared_ptr<TraceContext> clone_shared(const std::shared_ptr<TraceContext> &other) {
@@ -25,11 +25,19 @@
 #ifndef SIMBRICKS_TRACE_TRACER_H_
 #define SIMBRICKS_TRACE_TRACER_H_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iterator>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
-#include <set>
 #include <utility>
+#include <vector>
 
 #include "sync/corobelt.h"
 #include "sync/channel.h"
@@ -37,64 +45,279 @@
 #include "analytics/span.h"
 #include "analytics/trace.h"
 #include "env/traceEnvironment.h"
+#include "config/config.h"
 #include "exporter/exporter.h"
 #include "util/factory.h"
 #include "analytics/context.h"
 #include "util/exception.h"
+#include "util/metrics.h"
+#include "util/slidingIdSet.h"
+#include "util/ttlMap.h"
+
+// default amount of shards the tracer state is split into
+inline constexpr size_t kTracerShards = 16;
 
 class Tracer {
-  // std::mutex tracer_mutex_;
-  concurrencpp::async_lock async_lock_;
+  // The traces are sharded by trace id. Re-parenting a trace (AddParentLazily) touches two shards,
+  // these are locked in ascending order.
+  struct Shard {
+    concurrencpp::async_lock lock_;
+
+    // trace_id -> trace, traces not accessed within the trace ttl are forgotten
+    TtlLruMap<uint64_t, std::shared_ptr<Trace>> traces_;
+  };
 
   TraceEnvironment &trace_environment_;
 
-  // trace_id -> trace
-  std::unordered_map<uint64_t, std::shared_ptr<Trace>> traces_;
+  std::vector<Shard> shards_;
+
+  // Done spans waiting for their parent are kept for all shards and keyed by the parent span id:
+  // a child may be started from a context naming the trace its parent had before being re-parented,
+  // the child then lives in another shard than its parent.
+  // NOTE: taken while the lock of a shard is held, never the other way round
+  std::mutex waiting_mutex_;
 
-  // span ids that were already exported
-  std::set<uint64_t> exported_spans_;
   // parent_span_id -> list/vector of spans that wait for the parent to be exported
   std::unordered_map<uint64_t, std::vector<std::shared_ptr<EventSpan>>> waiting_list_;
 
+  struct WaitingSpan {
+    std::shared_ptr<EventSpan> span_;
+    // point in time the span was done, only taken when metrics are exported
+    std::chrono::steady_clock::time_point since_;
+  };
+  // span id -> done span that waits for its parent to be exported
+  std::unordered_map<uint64_t, WaitingSpan> waiting_spans_;
+
+  // waiting spans in the order they were done, only filled when an orphan timeout is configured;
+  // entries of spans released in the meantime are skipped lazily
+  std::deque<std::shared_ptr<EventSpan>> waiting_order_;
+
+  // span ids that were already exported, span ids are handed out by one counter for all shards,
+  // hence a single set is kept such that its watermark can move forward; spans dropped as orphans
+  // are inserted flagged, spans that are done after their parent was dropped are dropped as well
+  std::mutex exported_spans_mutex_;
+  SlidingIdSet exported_spans_;
+
+  struct ExportItem {
+    std::shared_ptr<EventSpan> span_;
+    // point in time the span was done if it waited for its parent, only taken when metrics are exported
+    std::optional<std::chrono::steady_clock::time_point> waiting_since_;
+  };
+  // spans found ready while holding waiting_mutex_, they are queued before it is released
+  std::vector<ExportItem> ready_spans_;
+
+  // spans ready to be exported, queued while holding waiting_mutex_ such that a parent is always
+  // queued before its children; the queue is drained without holding any other lock
+  std::mutex export_queue_mutex_;
+  std::deque<ExportItem> export_queue_;
+  // the exporter is not thread safe, only the caller that set this flag drains the queue
+  std::atomic<bool> draining_{false};
   std::shared_ptr<simbricks::trace::SpanExporter> exporter_;
 
-  void InsertExportedSpan(uint64_t span_id) {
+  // spans waiting longer than this for their parent are released according to the orphan policy,
+  // 0 if they wait indefinitely
+  const uint64_t orphan_timeout_ps_;
+  const OrphanSpanPolicy orphan_policy_;
+  // traces not accessed for this long are forgotten even though not all their spans were exported,
+  // 0 if traces are kept until complete
+  const uint64_t trace_ttl_ps_;
+  // latest starting timestamp of all spans marked as done, the age of waiting spans is measured against it
+  std::atomic<uint64_t> latest_done_ts_{0};
+
+  // only created when metrics are exported
+  struct Metrics {
+    std::shared_ptr<MetricCounter> spans_started_;
+    std::shared_ptr<MetricCounter> spans_exported_;
+    std::shared_ptr<MetricGauge> active_traces_;
+    std::shared_ptr<MetricGauge> spans_waiting_;
+    std::shared_ptr<MetricGauge> waiting_parents_;
+    std::shared_ptr<MetricCounter> orphans_exported_;
+    std::shared_ptr<MetricCounter> spans_dropped_;
+    std::shared_ptr<MetricHistogram> export_lag_;
+    std::shared_ptr<MetricHistogram> export_duration_;
+  };
+  std::unique_ptr<Metrics> metrics_ = nullptr;
+
+  void RegisterMetrics() {
+    MetricsRegistry &registry = trace_environment_.GetMetrics();
+    metrics_ = create_unique<Metrics>("could not create tracer metrics");
+    metrics_->spans_started_ = registry.GetCounter("columbo_tracer_spans_started_total", "Spans created.");
+    metrics_->spans_exported_ = registry.GetCounter("columbo_tracer_spans_exported_total",
+                                                    "Spans handed to the exporter.");
+    metrics_->active_traces_ = registry.GetGauge("columbo_tracer_active_traces",
+                                                 "Traces that still contain spans not exported yet.");
+    metrics_->spans_waiting_ = registry.GetGauge("columbo_tracer_spans_waiting_for_parent",
+                                                 "Done spans waiting for their parent to be exported.");
+    metrics_->waiting_parents_ = registry.GetGauge("columbo_tracer_waiting_list_parents",
+                                                   "Parents that done spans wait for.");
+    metrics_->orphans_exported_ = registry.GetCounter("columbo_tracer_orphans_exported_total",
+                                                      "Spans exported without their parent after the timeout.");
+    metrics_->spans_dropped_ = registry.GetCounter("columbo_tracer_spans_dropped_total",
+                                                   "Spans dropped because they or an ancestor timed out.");
+    metrics_->export_lag_ = registry.GetHistogram("columbo_tracer_export_lag_seconds",
+                                                  "Time from a span being done till it is exported.");
+    metrics_->export_duration_ = registry.GetHistogram("columbo_exporter_export_seconds",
+                                                       "Time the exporter took to export a span.");
+  }
+
+  void OnSpanStarted() {
+    if (metrics_) {
+      metrics_->spans_started_->Increment();
+    }
+  }
+
+  size_t GetShardIndex(uint64_t trace_id) const {
+    return trace_id % shards_.size();
+  }
+
+  Shard &GetShard(uint64_t trace_id) {
+    return shards_[GetShardIndex(trace_id)];
+  }
+
+  // locks the shard the span currently belongs to, as the trace of a span may change while
+  // waiting for the lock the trace id is checked again once the lock is held
+  concurrencpp::result<std::pair<Shard *, concurrencpp::scoped_async_lock>>
+  LockShardOf(std::shared_ptr<concurrencpp::executor> executor, const std::shared_ptr<EventSpan> &span) {
+    auto context = span->GetContext();
+    throw_if_empty(context, TraceException::kContextIsNull, source_loc::current());
+    while (true) {
+      Shard &shard = GetShard(context->GetTraceId());
+      concurrencpp::scoped_async_lock guard = co_await shard.lock_.lock(executor);
+      if (&GetShard(context->GetTraceId()) == &shard) {
+        co_return std::make_pair(&shard, std::move(guard));
+      }
+    }
+  }
+
+  void QueueExport(const std::shared_ptr<EventSpan> &span) {
+    // NOTE: waiting_mutex_ must be held when calling this method
+    ready_spans_.push_back({span, StopWaiting(span->GetId())});
+  }
+
+  void QueueReadySpans() {
+    // NOTE: waiting_mutex_ must be held when calling this method
+    if (ready_spans_.empty()) {
+      return;
+    }
+    const std::lock_guard<std::mutex> queue_guard(export_queue_mutex_);
+    std::ranges::move(ready_spans_, std::back_inserter(export_queue_));
+    ready_spans_.clear();
+  }
+
+  void ExportSpan(const ExportItem &item) {
+    // NOTE: must only be called by the caller draining the export queue
+    if (not metrics_) {
+      exporter_->ExportSpan(item.span_);
+      return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    exporter_->ExportSpan(item.span_);
+    metrics_->export_duration_->Observe(std::chrono::steady_clock::now() - start);
+    metrics_->spans_exported_->Increment();
+    if (not item.waiting_since_) {
+      metrics_->export_lag_->Observe(0.0);
+      return;
+    }
+    metrics_->export_lag_->Observe(start - *item.waiting_since_);
+  }
+
+  // exports the queued spans unless another caller already drains the queue, the spans queued by
+  // this caller are then exported by the other one
+  void DrainExports() {
+    while (not draining_.exchange(true)) {
+      std::deque<ExportItem> batch;
+      while (true) {
+        {
+          const std::lock_guard<std::mutex> queue_guard(export_queue_mutex_);
+          if (export_queue_.empty()) {
+            break;
+          }
+          batch.swap(export_queue_);
+        }
+        for (const ExportItem &item : batch) {
+          ExportSpan(item);
+        }
+        batch.clear();
+      }
+      draining_.store(false);
+
+      // spans queued after the queue was found empty but before the flag was cleared are left to this caller
+      const std::lock_guard<std::mutex> queue_guard(export_queue_mutex_);
+      if (export_queue_.empty()) {
+        return;
+      }
+    }
+  }
+
+  // removes the span from the waiting spans, returns the point in time it was done if it waited
+  std::optional<std::chrono::steady_clock::time_point> StopWaiting(uint64_t span_id) {
+    // NOTE: waiting_mutex_ must be held when calling this method
+    auto waiting_it = waiting_spans_.find(span_id);
+    if (waiting_it == waiting_spans_.end()) {
+      return std::nullopt;
+    }
+    const auto since = waiting_it->second.since_;
+    waiting_spans_.erase(waiting_it);
+    if (metrics_) {
+      metrics_->spans_waiting_->Add(-1);
+    }
+    return since;
+  }
+
+  void InsertExportedSpan(uint64_t span_id, bool dropped = false) {
     throw_on_false(TraceEnvironment::IsValidId(span_id),
                    TraceException::kInvalidId, source_loc::current());
-    auto iter = exported_spans_.insert(span_id);
-    throw_on_false(iter.second, "could not insert non exported span into set",
+    const std::lock_guard<std::mutex> exported_guard(exported_spans_mutex_);
+    const bool inserted = exported_spans_.Insert(span_id, dropped);
+    throw_on_false(inserted, "could not insert non exported span into set",
                    source_loc::current());
   }
 
-  void InsertTrace(std::shared_ptr<Trace> &new_trace) {
-    // NOTE: the lock must be held when calling this method
+  // gives up on a span ever being exported, it can still be exported later on
+  void SettleSpan(uint64_t span_id) {
+    const std::lock_guard<std::mutex> exported_guard(exported_spans_mutex_);
+    exported_spans_.Settle(span_id);
+  }
+
+  bool WasExported(uint64_t span_id) {
+    const std::lock_guard<std::mutex> exported_guard(exported_spans_mutex_);
+    return exported_spans_.Contains(span_id);
+  }
+
+  void InsertTrace(Shard &shard, std::shared_ptr<Trace> &new_trace) {
+    // NOTE: the lock of the shard must be held when calling this method
     assert(new_trace);
-    auto iter = traces_.insert({new_trace->GetId(), new_trace});
-    throw_on(not iter.second, "could not insert trace into traces map",
+    // the trace is stamped with the time of the map, which must not lag behind the other shards
+    ExpireTraces(shard);
+    const bool inserted = shard.traces_.Insert(new_trace->GetId(), new_trace);
+    throw_on(not inserted, "could not insert trace into traces map",
              source_loc::current());
+    if (metrics_) {
+      metrics_->active_traces_->Add(1);
+    }
   }
 
-  std::shared_ptr<Trace> GetTrace(uint64_t trace_id) {
-    // NOTE: the lock must be held when calling this method
-    auto iter = traces_.find(trace_id);
-    if (iter == traces_.end()) {
-      return {};
-    }
-    std::shared_ptr<Trace> target_trace = iter->second;
-    return target_trace;
+  std::shared_ptr<Trace> GetTrace(Shard &shard, uint64_t trace_id) {
+    // NOTE: the lock of the shard must be held when calling this method
+    ExpireTraces(shard);
+    return shard.traces_.Find(trace_id).value_or(nullptr);
   }
 
-  void RemoveTrace(uint64_t trace_id) {
-    // NOTE: lock must be held when calling this method
-    const size_t amount_removed = traces_.erase(trace_id);
-    throw_on(amount_removed == 0, "RemoveTrace: nothing was removed",
+  void RemoveTrace(Shard &shard, uint64_t trace_id) {
+    // NOTE: lock of the shard must be held when calling this method
+    const bool removed = shard.traces_.Remove(trace_id);
+    throw_on(not removed, "RemoveTrace: nothing was removed",
              source_loc::current());
+    if (metrics_) {
+      metrics_->active_traces_->Add(-1);
+    }
   }
 
-  void AddSpanToTraceIfTraceExists(uint64_t trace_id, const std::shared_ptr<EventSpan> &span_ptr) {
-    // NOTE: lock must be held when calling this method
+  void AddSpanToTraceIfTraceExists(Shard &shard, uint64_t trace_id, const std::shared_ptr<EventSpan> &span_ptr) {
+    // NOTE: lock of the shard must be held when calling this method
     assert(span_ptr);
-    auto target_trace = GetTrace(trace_id);
+    auto target_trace = GetTrace(shard, trace_id);
     if (nullptr == target_trace) {
       return;
     }
@@ -102,22 +325,21 @@ class Tracer {
     target_trace->AddSpan(span_ptr);
   }
 
-  bool SafeToDeleteTrace(uint64_t trace_id) {
-    // NOTE: lock must be held when calling this method
-    auto trace = GetTrace(trace_id);
+  bool SafeToDeleteTrace(Shard &shard, uint64_t trace_id) {
+    // NOTE: lock of the shard must be held when calling this method
+    auto trace = GetTrace(shard, trace_id);
     if (nullptr == trace) {
       return false;
     }
     auto span_ids = trace->GetSpanIds();
     const bool all_exported = std::ranges::all_of(span_ids, [&](uint64_t span_id) -> bool {
-      return exported_spans_.contains(span_id);
+      return WasExported(span_id);
     });
     return all_exported;
   }
 
   std::shared_ptr<TraceContext>
   RegisterCreateContextParent(uint64_t trace_id, uint64_t parent_id, uint64_t parent_starting_ts) {
-    // NOTE: lock must be held when calling this method
     throw_on_false(TraceEnvironment::IsValidId(trace_id),
                    TraceException::kInvalidId, source_loc::current());
     throw_on_false(TraceEnvironment::IsValidId(parent_id),
@@ -131,7 +353,6 @@ class Tracer {
 
   std::shared_ptr<TraceContext>
   RegisterCreateContext(uint64_t trace_id) {
-    // NOTE: lock must be held when calling this method
     const uint64_t context_id = trace_environment_.GetNextTraceContextId();
     auto trace_context = create_shared<TraceContext>(
         "RegisterCreateContext couldnt create context",
@@ -140,30 +361,42 @@ class Tracer {
   }
 
   bool WasParentExported(const std::shared_ptr<EventSpan> &child) {
-    // NOTE: lock must be held when calling this method
+    // NOTE: waiting_mutex_ must be held when calling this method
     assert(child and "span is null");
     if (not child->HasParent()) {
       // no parent means trace starting span
       return true;
     }
     const uint64_t parent_id = child->GetValidParentId();
-    return exported_spans_.contains(parent_id);
+    return WasExported(parent_id);
   }
 
   void MarkSpanAsExported(std::shared_ptr<EventSpan> &span) {
-    // NOTE: lock must be held when calling this method
+    // NOTE: waiting_mutex_ must be held when calling this method
     assert(span and "span is null");
     const uint64_t ident = span->GetId();
     InsertExportedSpan(ident);
   }
 
   void MarkSpanAsWaitingForParent(std::shared_ptr<EventSpan> &span) {
-    // NOTE: lock must be held when calling this method
+    // NOTE: waiting_mutex_ must be held when calling this method
     assert(span);
     if (not span->HasParent()) {
       // we cannot wait for a non-existing parent...
       return;
     }
+    WaitingSpan waiting{span, {}};
+    if (metrics_) {
+      waiting.since_ = std::chrono::steady_clock::now();
+      metrics_->spans_waiting_->Add(1);
+    }
+    auto res_w = waiting_spans_.insert({span->GetId(), std::move(waiting)});
+    throw_on(not res_w.second, "MarkSpanAsWaitingForParent: span is already waiting",
+             source_loc::current());
+    if (orphan_timeout_ps_ > 0) {
+      waiting_order_.push_back(span);
+    }
+
     const uint64_t parent_id = span->GetValidParentId();
     auto iter = waiting_list_.find(parent_id);
     if (iter != waiting_list_.end()) {
@@ -173,45 +406,162 @@ class Tracer {
       auto res_p = waiting_list_.insert({parent_id, {span}});
       throw_on(not res_p.second, "MarkSpanAsWaitingForParent: could not insert value",
                source_loc::current());
+      if (metrics_) {
+        metrics_->waiting_parents_->Add(1);
+      }
     }
   }
 
-  concurrencpp::result<void>
-  ExportWaitingForParentVec(std::shared_ptr<concurrencpp::executor> executor,
-                            std::shared_ptr<EventSpan> parent) {
-    throw_if_empty(executor, TraceException::kResumeExecutorNull, source_loc::current());
+  void RemoveFromWaitingList(const std::shared_ptr<EventSpan> &span) {
+    // NOTE: waiting_mutex_ must be held when calling this method
+    auto iter = waiting_list_.find(span->GetValidParentId());
+    throw_on(iter == waiting_list_.end(), "RemoveFromWaitingList: span is not waiting",
+             source_loc::current());
+    std::erase(iter->second, span);
+    if (iter->second.empty()) {
+      waiting_list_.erase(iter);
+      if (metrics_) {
+        metrics_->waiting_parents_->Add(-1);
+      }
+    }
+  }
 
-    // NOTE: lock MUST be held when calling this method
+  void DropSpan(const std::shared_ptr<EventSpan> &span) {
+    // NOTE: waiting_mutex_ must be held when calling this method
+    // counts as exported such that the watermark moves on and the trace can be removed
+    InsertExportedSpan(span->GetId(), true);
+    StopWaiting(span->GetId());
+    if (metrics_) {
+      metrics_->spans_dropped_->Increment();
+    }
+  }
 
-    assert(parent and "span is null");
-    const uint64_t parent_id = parent->GetId();
-    auto iter = waiting_list_.find(parent_id);
-    if (iter == waiting_list_.end()) {
-      co_return;
+  bool WasDropped(uint64_t span_id) {
+    const std::lock_guard<std::mutex> exported_guard(exported_spans_mutex_);
+    return exported_spans_.IsFlagged(span_id);
+  }
+
+  // exports, or drops, all spans that transitively wait for the given span, a worklist is used
+  // instead of recursion such that long chains of waiting spans cannot exhaust the stack
+  void ReleaseWaitingSpans(const std::shared_ptr<EventSpan> &span, bool drop) {
+    // NOTE: waiting_mutex_ MUST be held when calling this method
+    assert(span and "span is null");
+    std::vector<std::shared_ptr<EventSpan>> worklist{span};
+    while (not worklist.empty()) {
+      const std::shared_ptr<EventSpan> parent = std::move(worklist.back());
+      worklist.pop_back();
+
+      auto node = waiting_list_.extract(parent->GetId());
+      if (node.empty()) {
+        continue;
+      }
+      if (metrics_) {
+        metrics_->waiting_parents_->Add(-1);
+      }
+      for (auto &waiter : node.mapped()) {
+        if (drop) {
+          DropSpan(waiter);
+        } else {
+          throw_on_false(WasExported(waiter->GetValidParentId()),
+                         "try to export span whos parent was not exported yet",
+                         source_loc::current());
+          MarkSpanAsExported(waiter);
+          QueueExport(waiter);
+        }
+        worklist.push_back(std::move(waiter));
+      }
     }
-    auto waiters = iter->second;
-    for (auto &waiter : waiters) {
-      throw_on_false(exported_spans_.contains(waiter->GetValidParentId()),
-                     "try to export span whos parent was not exported yet",
-                     source_loc::current());
-      MarkSpanAsExported(waiter);
-      assert(not waiter->HasParent() or exported_spans_.contains(waiter->GetParentId()));
+  }
 
-      exporter_->ExportSpan(waiter);
-      ExportWaitingForParentVec(executor, waiter);
+  // releases a span that waited too long for its parent according to the orphan policy
+  void ReleaseOrphan(std::shared_ptr<EventSpan> orphan) {
+    // NOTE: waiting_mutex_ must be held when calling this method
+    // the topmost waiting span of a chain is released such that the spans below keep their parent
+    auto parent_it = waiting_spans_.find(orphan->GetValidParentId());
+    while (parent_it != waiting_spans_.end()) {
+      orphan = parent_it->second.span_;
+      parent_it = waiting_spans_.find(orphan->GetValidParentId());
+    }
+    RemoveFromWaitingList(orphan);
+    // the parent did not show up within the timeout and is likely never done
+    SettleSpan(orphan->GetValidParentId());
+
+    if (orphan_policy_ == OrphanSpanPolicy::kDrop) {
+      DropSpan(orphan);
+      ReleaseWaitingSpans(orphan, true);
+      return;
+    }
 
+    auto context = orphan->GetContext();
+    throw_if_empty(context, TraceException::kContextIsNull, source_loc::current());
+    context->DetachParent();
+    MarkSpanAsExported(orphan);
+    QueueExport(orphan);
+    if (metrics_) {
+      metrics_->orphans_exported_->Increment();
+    }
+    ReleaseWaitingSpans(orphan, false);
+  }
+
+  // releases the waiting spans that are older than the orphan timeout, or all of them if no parent
+  // can be exported anymore; as spans are done roughly in timestamp order only the oldest entries
+  // are looked at
+  void ReleaseOrphans(bool all) {
+    // NOTE: waiting_mutex_ must be held when calling this method
+    const uint64_t latest_done_ts = latest_done_ts_.load(std::memory_order_relaxed);
+    while (not waiting_order_.empty()) {
+      std::shared_ptr<EventSpan> oldest = waiting_order_.front();
+      if (not waiting_spans_.contains(oldest->GetId())) {
+        // released in the meantime
+        waiting_order_.pop_front();
+        continue;
+      }
+      const uint64_t starting_ts = oldest->GetStartingTs();
+      if (not all and (latest_done_ts < starting_ts or latest_done_ts - starting_ts <= orphan_timeout_ps_)) {
+        break;
+      }
+      waiting_order_.pop_front();
+      ReleaseOrphan(std::move(oldest));
+    }
+  }
+
+  // the time of a shard only moves when its traces are accessed, it is therefore brought up to the
+  // latest done timestamp of all shards before every access
+  void ExpireTraces(Shard &shard) {
+    // NOTE: lock of the shard must be held when calling this method
+    if (trace_ttl_ps_ == 0) {
+      return;
+    }
+    // the spans of a forgotten trace that were not exported yet must not hold back the watermark
+    const size_t expired = shard.traces_.AdvanceTo(
+        latest_done_ts_.load(std::memory_order_relaxed),
+        [this](uint64_t, const std::shared_ptr<Trace> &trace) {
+          for (const uint64_t span_id : trace->GetSpanIds()) {
+            SettleSpan(span_id);
+          }
+        });
+    if (metrics_ and expired > 0) {
+      metrics_->active_traces_->Add(-static_cast<int64_t>(expired));
+    }
+  }
+
+  void UpdateLatestDoneTs(uint64_t timestamp) {
+    uint64_t latest = latest_done_ts_.load(std::memory_order_relaxed);
+    while (latest < timestamp
+        and not latest_done_ts_.compare_exchange_weak(latest, timestamp, std::memory_order_relaxed)) {
     }
-    waiting_list_.erase(parent_id);
   }
 
   template<class SpanType, class... Args>
   std::shared_ptr<SpanType>
-  StartSpanByParentInternal(uint64_t trace_id,
+  StartSpanByParentInternal(Shard &shard,
+                            uint64_t trace_id,
                             uint64_t parent_id,
                             uint64_t parent_starting_ts,
+                            uint64_t parent_replay_ts,
                             std::shared_ptr<Event> starting_event,
                             Args &&... args) {
-    // NOTE: lock must be held when calling this method
+    // NOTE: lock of the shard must be held when calling this method
     assert(starting_event);
     throw_on_false(TraceEnvironment::IsValidId(trace_id), "invalid id",
                    source_loc::current());
@@ -226,20 +576,22 @@ class Tracer {
     const bool was_added = new_span->AddToSpan(starting_event);
     throw_on(not was_added, "StartSpanByParentInternal(...) could not add first event",
              source_loc::current());
+    // resuming must rebuild the parent as well
+    new_span->PinForResume(std::min(new_span->GetStartingTs(), parent_replay_ts));
 
     // must add span to trace manually
-    AddSpanToTraceIfTraceExists(trace_id, new_span);
+    AddSpanToTraceIfTraceExists(shard, trace_id, new_span);
+    OnSpanStarted();
 
     return new_span;
   }
 
   template<class SpanType, class... Args>
   std::shared_ptr<SpanType>
-  StartSpanInternal(std::shared_ptr<Event> starting_event, Args &&... args) {
-    // NOTE: lock must be held when calling this method
+  StartSpanInternal(Shard &shard, uint64_t trace_id, std::shared_ptr<Event> starting_event, Args &&... args) {
+    // NOTE: lock of the shard must be held when calling this method
     assert(starting_event);
 
-    uint64_t trace_id = trace_environment_.GetNextTraceId();
     auto trace_context = RegisterCreateContext(trace_id);
 
     auto new_span = create_shared<SpanType>(
@@ -248,10 +600,12 @@ class Tracer {
     const bool was_added = new_span->AddToSpan(starting_event);
     throw_on(not was_added, "StartSpanInternal(...) could not add first event",
              source_loc::current());
+    new_span->PinForResume(new_span->GetStartingTs());
 
     auto new_trace = create_shared<Trace>(
         "StartSpanInternal(...) could not create a new trace", trace_id, new_span);
-    InsertTrace(new_trace);
+    InsertTrace(shard, new_trace);
+    OnSpanStarted();
 
     return new_span;
   }
@@ -260,32 +614,59 @@ class Tracer {
   concurrencpp::result<void>
   MarkSpanAsDone(std::shared_ptr<concurrencpp::executor> executor, std::shared_ptr<EventSpan> span) {
     throw_if_empty(executor, TraceException::kResumeExecutorNull, source_loc::current());
+    throw_if_empty(span, "MarkSpanAsDone, span is null", source_loc::current());
 
-    // guard potential access using a lock guard
-    concurrencpp::scoped_async_lock guard = co_await async_lock_.lock(executor);
+    {
+      // guard potential access using a lock guard
+      auto [shard_ptr, guard] = co_await LockShardOf(executor, span);
+      Shard &shard = *shard_ptr;
 
-    throw_if_empty(span, "MarkSpanAsDone, span is null", source_loc::current());
-    auto context = span->GetContext();
-    throw_if_empty(context, "MarkSpanAsDone context is null", source_loc::current());
-    const uint64_t trace_id = context->GetTraceId();
+      auto context = span->GetContext();
+      throw_if_empty(context, "MarkSpanAsDone context is null", source_loc::current());
+      const uint64_t trace_id = context->GetTraceId();
 
-    if (WasParentExported(span)) {
-      MarkSpanAsExported(span);
-      assert(not span->HasParent() or exported_spans_.contains(span->GetParentId()));
+      if (orphan_timeout_ps_ > 0 or trace_ttl_ps_ > 0) {
+        UpdateLatestDoneTs(span->GetStartingTs());
+      }
 
-      exporter_->ExportSpan(span);
-      co_await ExportWaitingForParentVec(executor, span);
+      bool waits_for_parent;
+      {
+        // a parent is marked as exported and releases its waiting children while holding this lock,
+        // hence checking for the parent and waiting for it must happen while holding it too; the spans
+        // found ready are only queued here, they are exported once all locks are released
+        const std::lock_guard<std::mutex> waiting_guard(waiting_mutex_);
+        waits_for_parent = not WasParentExported(span);
+        if (waits_for_parent) {
+          assert(span->HasParent());
+          MarkSpanAsWaitingForParent(span);
+        } else if (span->HasParent() and WasDropped(span->GetValidParentId())) {
+          DropSpan(span);
+          ReleaseWaitingSpans(span, true);
+        } else {
+          MarkSpanAsExported(span);
+          assert(not span->HasParent() or WasExported(span->GetParentId()));
+
+          QueueExport(span);
+          ReleaseWaitingSpans(span, false);
+        }
+
+        if (orphan_timeout_ps_ > 0) {
+          ReleaseOrphans(false);
+        }
+        QueueReadySpans();
+      }
 
-      auto trace = GetTrace(trace_id);
-      if (nullptr != trace and SafeToDeleteTrace(trace_id)) {
-        RemoveTrace(trace_id);
+      if (not waits_for_parent) {
+        auto trace = GetTrace(shard, trace_id);
+        if (nullptr != trace and SafeToDeleteTrace(shard, trace_id)) {
+          RemoveTrace(shard, trace_id);
+        }
       }
 
-      co_return;
+      ExpireTraces(shard);
     }
 
-    assert(span->HasParent());
-    MarkSpanAsWaitingForParent(span);
+    DrainExports();
   }
 
   concurrencpp::result<void>
@@ -296,23 +677,49 @@ class Tracer {
     throw_if_empty(span, TraceException::kSpanIsNull, source_loc::current());
     throw_if_empty(parent_context, TraceException::kContextIsNull, source_loc::current());
 
-    // guard potential access using a lock guard
-    concurrencpp::scoped_async_lock guard = co_await async_lock_.lock(executor);
-
     auto new_trace_id = parent_context->GetTraceId();
     auto old_context = span->GetContext();
     throw_if_empty(old_context, TraceException::kContextIsNull, source_loc::current());
 
+    // lock both shards in ascending order such that concurrent re-parenting cannot deadlock,
+    // retry in case the trace of the span changed while waiting for the locks
+    uint64_t old_trace_id;
+    std::optional<concurrencpp::scoped_async_lock> first_guard;
+    std::optional<concurrencpp::scoped_async_lock> second_guard;
+    while (true) {
+      old_trace_id = old_context->GetTraceId();
+      const size_t old_index = GetShardIndex(old_trace_id);
+      const size_t new_index = GetShardIndex(new_trace_id);
+      first_guard.emplace(co_await shards_[std::min(old_index, new_index)].lock_.lock(executor));
+      if (old_index != new_index) {
+        second_guard.emplace(co_await shards_[std::max(old_index, new_index)].lock_.lock(executor));
+      }
+      if (old_context->GetTraceId() == old_trace_id) {
+        break;
+      }
+      second_guard.reset();
+      first_guard.reset();
+    }
+    Shard &old_shard = GetShard(old_trace_id);
+    Shard &new_shard = GetShard(new_trace_id);
+
     // NOTE: as this case shall only happen when this span is the trace root, we expect the old trace
-    //       definitely to exist
-    auto old_trace = GetTrace(old_context->GetTraceId());
-    throw_if_empty(old_trace, TraceException::kTraceIsNull, source_loc::current());
+    //       definitely to exist unless it was forgotten after the trace ttl
+    auto old_trace = GetTrace(old_shard, old_trace_id);
+    throw_on(nullptr == old_trace and trace_ttl_ps_ == 0, TraceException::kTraceIsNull, source_loc::current());
 
     old_context->SetTraceId(new_trace_id);
     const uint64_t parent_id = parent_context->GetParentId();
     const uint64_t parent_start_ts = parent_context->GetParentStartingTs();
     old_context->SetParentIdAndTs(parent_id, parent_start_ts);
-    AddSpanToTraceIfTraceExists(new_trace_id, span);
+    // the span and the spans of its old trace can only be rebuilt together with the new parent
+    const uint64_t parent_replay_ts = parent_context->GetParentReplayTs();
+    span->PinForResume(parent_replay_ts);
+    AddSpanToTraceIfTraceExists(new_shard, new_trace_id, span);
+    if (nullptr == old_trace) {
+      // the other spans of the forgotten trace are not known anymore and keep their trace id
+      co_return;
+    }
 
     auto children = old_trace->GetSpansAndRemoveSpans();
     for (const auto &iter : children) {
@@ -320,10 +727,11 @@ class Tracer {
         continue;
       }
       iter->GetContext()->SetTraceId(new_trace_id);
-      AddSpanToTraceIfTraceExists(new_trace_id, iter);
+      iter->PinForResume(parent_replay_ts);
+      AddSpanToTraceIfTraceExists(new_shard, new_trace_id, iter);
     }
 
-    RemoveTrace(old_trace->GetId());
+    RemoveTrace(old_shard, old_trace->GetId());
   }
 
   // will create and add a new span to a trace using the context
@@ -338,16 +746,18 @@ class Tracer {
     throw_if_empty(starting_event, TraceException::kEventIsNull, source_loc::current());
     throw_if_empty(parent_span, TraceException::kSpanIsNull, source_loc::current());
 
+    // guard potential access using a lock guard
+    auto [shard_ptr, guard] = co_await LockShardOf(executor, parent_span);
+
     const uint64_t trace_id = parent_span->GetValidTraceId();
     const uint64_t parent_id = parent_span->GetValidId();
     const uint64_t parent_starting_ts = parent_span->GetStartingTs();
-
-    // guard potential access using a lock guard
-    concurrencpp::scoped_async_lock guard = co_await async_lock_.lock(executor);
+    const uint64_t parent_replay_ts = parent_span->GetReplayTs();
 
     std::shared_ptr<SpanType> new_span;
     new_span = StartSpanByParentInternal<SpanType, Args...>(
-        trace_id, parent_id, parent_starting_ts, starting_event, std::forward<Args>(args)...);
+        *shard_ptr, trace_id, parent_id, parent_starting_ts, parent_replay_ts, starting_event,
+        std::forward<Args>(args)...);
 
     assert(new_span);
     co_return new_span;
@@ -366,15 +776,19 @@ class Tracer {
     throw_on_false(parent_context->HasParent(), "Context has no parent",
                    source_loc::current());
 
-    // guard potential access using a lock guard
-    concurrencpp::scoped_async_lock guard = co_await async_lock_.lock(executor);
-
     const uint64_t trace_id = parent_context->GetTraceId();
     const uint64_t parent_id = parent_context->GetParentId();
     const uint64_t parent_starting_ts = parent_context->GetParentStartingTs();
+    const uint64_t parent_replay_ts = parent_context->GetParentReplayTs();
+
+    // guard potential access using a lock guard
+    Shard &shard = GetShard(trace_id);
+    concurrencpp::scoped_async_lock guard = co_await shard.lock_.lock(executor);
+
     std::shared_ptr<SpanType> new_span;
     new_span = StartSpanByParentInternal<SpanType, Args...>(
-        trace_id, parent_id, parent_starting_ts, starting_event, std::forward<Args>(args)...);
+        shard, trace_id, parent_id, parent_starting_ts, parent_replay_ts, starting_event,
+        std::forward<Args>(args)...);
 
     assert(new_span);
     co_return new_span;
@@ -387,14 +801,16 @@ class Tracer {
             std::shared_ptr<Event> starting_event,
             Args &&... args) {
     throw_if_empty(executor, TraceException::kResumeExecutorNull, source_loc::current());
+    throw_if_empty(starting_event, "StartSpan(...) starting_event is null",
+                   source_loc::current());
 
     // guard potential access using a lock guard
-    concurrencpp::scoped_async_lock guard = co_await async_lock_.lock(executor);
+    const uint64_t trace_id = trace_environment_.GetNextTraceId();
+    Shard &shard = GetShard(trace_id);
+    concurrencpp::scoped_async_lock guard = co_await shard.lock_.lock(executor);
 
-    throw_if_empty(starting_event, "StartSpan(...) starting_event is null",
-                   source_loc::current());
     std::shared_ptr<SpanType> new_span = nullptr;
-    new_span = StartSpanInternal<SpanType, Args...>(starting_event, std::forward<Args>(args)...);
+    new_span = StartSpanInternal<SpanType, Args...>(shard, trace_id, starting_event, std::forward<Args>(args)...);
     assert(new_span);
     co_return new_span;
   }
@@ -407,19 +823,23 @@ class Tracer {
                             const std::shared_ptr<ContextType> &parent_context) {
     throw_if_empty(executor, TraceException::kResumeExecutorNull, source_loc::current());
     throw_if_empty(parent_context, TraceException::kContextIsNull, source_loc::current());
-    // guard potential access using a lock guard
-    concurrencpp::scoped_async_lock guard = co_await async_lock_.lock(executor);
 
     const uint64_t trace_id = parent_context->GetTraceId();
     const uint64_t parent_id = parent_context->GetParentId();
     const uint64_t parent_starting_ts = parent_context->GetParentStartingTs();
+
+    // guard potential access using a lock guard
+    Shard &shard = GetShard(trace_id);
+    concurrencpp::scoped_async_lock guard = co_await shard.lock_.lock(executor);
+
     auto trace_context = RegisterCreateContextParent(trace_id, parent_id, parent_starting_ts);
     const bool could_set = span_to_register->SetContext(trace_context, true);
     throw_on_false(could_set, "StartSpanSetParentContext could not set context",
                    source_loc::current());
+    span_to_register->PinForResume(parent_context->GetParentReplayTs());
 
     // must add span to trace manually
-    AddSpanToTraceIfTraceExists(trace_id, span_to_register);
+    AddSpanToTraceIfTraceExists(shard, trace_id, span_to_register);
   }
 
   // will create a new span not belonging to any trace, must be made manually by using one of the methods above
@@ -440,20 +860,59 @@ class Tracer {
     const bool was_added = new_span->AddToSpan(starting_event);
     throw_on(not was_added, "StartOrphanSpan(...) could not add first event",
              source_loc::current());
+    new_span->PinForResume(new_span->GetStartingTs());
 
     // NOTE: span is not added to any trace!!!
     assert(new_span);
+    OnSpanStarted();
     return new_span;
   }
 
   explicit Tracer(TraceEnvironment &trace_environment,
-                  std::shared_ptr<simbricks::trace::SpanExporter> exporter)
-      : trace_environment_(trace_environment), exporter_(std::move(exporter)) {
-
+                  std::shared_ptr<simbricks::trace::SpanExporter> exporter,
+                  size_t amount_shards = kTracerShards)
+      : trace_environment_(trace_environment),
+        shards_(amount_shards),
+        exported_spans_(trace_environment.PeekNextSpanId()),
+        exporter_(std::move(exporter)),
+        orphan_timeout_ps_(trace_environment.GetConfig().GetOrphanSpanTimeoutPs()),
+        orphan_policy_(trace_environment.GetConfig().GetOrphanSpanPolicy()),
+        trace_ttl_ps_(trace_environment.GetConfig().GetTraceTtlPs()) {
+
+    throw_on(amount_shards == 0, "Tracer: amount of shards is 0", source_loc::current());
     throw_if_empty(exporter_, TraceException::kSpanExporterNull, source_loc::current());
+    for (Shard &shard : shards_) {
+      shard.traces_.SetTtl(trace_ttl_ps_);
+    }
+    if (trace_environment_.IsMetricsEnabled()) {
+      RegisterMetrics();
+    }
   };
 
+  // every span id below it was exported, dropped or given up on
+  uint64_t GetExportedLowWatermark() {
+    const std::lock_guard<std::mutex> exported_guard(exported_spans_mutex_);
+    return exported_spans_.GetLowWatermark();
+  }
+
+  // NOTE: must only be called once all spanners finished, the shards are accessed without their locks
   void FinishExport() {
+    {
+      // no parent can be exported anymore, hence all spans still waiting are orphans
+      const std::lock_guard<std::mutex> waiting_guard(waiting_mutex_);
+      if (orphan_timeout_ps_ == 0) {
+        // the order is only kept when spans can time out
+        for (const auto &[span_id, waiting] : waiting_spans_) {
+          waiting_order_.push_back(waiting.span_);
+        }
+        std::ranges::sort(waiting_order_, std::less<>{}, [](const std::shared_ptr<EventSpan> &span) {
+          return span->GetStartingTs();
+        });
+      }
+      ReleaseOrphans(true);
+      QueueReadySpans();
+    }
+    DrainExports();
     exporter_->ForceFlush();
   }
 
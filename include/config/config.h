@@ -22,9 +22,11 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <set>
+#include <unordered_map>
 
 #include "spdlog/spdlog.h"
 #include "concurrencpp/runtime/runtime.h"
@@ -37,6 +39,19 @@
 #ifndef SIMBRICKS_TRACE_CONFIG_H_
 #define SIMBRICKS_TRACE_CONFIG_H_
 
+// what happens to a done span whose parent was not exported within the orphan timeout
+enum class OrphanSpanPolicy { kExport, kDrop };
+
+inline OrphanSpanPolicy OrphanSpanPolicyFromString(const std::string &policy_str) {
+  static const std::unordered_map<std::string, OrphanSpanPolicy> kLookup{
+      {"Export", OrphanSpanPolicy::kExport},
+      {"Drop", OrphanSpanPolicy::kDrop}
+  };
+  auto iter = kLookup.find(policy_str);
+  throw_on(iter == kLookup.end(), "unknown orphan span policy", source_loc::current());
+  return iter->second;
+}
+
 class TraceEnvConfig {
  public:
   using IndicatorType = std::string;
@@ -154,17 +169,165 @@ class TraceEnvConfig {
              source_loc::current());
   }
 
+  // the output of a single simulator instance, either its raw log or an already preprocessed
+  // event stream which takes precedence if both are given
+  class LogSourceConf {
+   public:
+    inline bool IsEventStream() const {
+      return not event_stream_.empty();
+    }
+
+    inline const std::string &GetPath() const {
+      return IsEventStream() ? event_stream_ : log_;
+    }
+
+    static LogSourceConf CreateLogSourceConf(const YAML::Node &node, const char *log_key, const char *event_stream_key) {
+      LogSourceConf source_conf;
+      if (node[log_key]) {
+        source_conf.log_ = node[log_key].as<std::string>();
+      }
+      if (node[event_stream_key]) {
+        source_conf.event_stream_ = node[event_stream_key].as<std::string>();
+      }
+      throw_on(source_conf.log_.empty() and source_conf.event_stream_.empty(),
+               "TraceEnvConfig::LogSourceConf neither a log nor an event stream given",
+               source_loc::current());
+      return source_conf;
+    }
+
+   private:
+    std::string log_;
+    std::string event_stream_;
+  };
+
+  // a simulated host consisting of a gem5 instance and its nicbm NIC which is attached to
+  // the ns3 network at the given node and device
+  class HostTopologyConf {
+   public:
+    inline const std::string &GetName() const {
+      return name_;
+    }
+
+    inline const LogSourceConf &GetGem5() const {
+      return gem5_;
+    }
+
+    inline const LogSourceConf &GetNicbm() const {
+      return nicbm_;
+    }
+
+    inline int GetNs3NodeId() const {
+      return ns3_node_id_;
+    }
+
+    inline int GetNs3DeviceId() const {
+      return ns3_device_id_;
+    }
+
+    // devices of the node whose packets are not forwarded to any NIC
+    inline const std::vector<int> &GetNs3SinkDeviceIds() const {
+      return ns3_sink_device_ids_;
+    }
+
+    // devices of the node whose events are traced
+    inline const std::vector<int> &GetNs3FilterDeviceIds() const {
+      return ns3_filter_device_ids_;
+    }
+
+    static HostTopologyConf CreateHostTopologyConf(const YAML::Node &node) {
+      HostTopologyConf host_conf;
+      CheckKey(kNameKey, node);
+      host_conf.name_ = node[kNameKey].as<std::string>();
+      CheckEmptiness(host_conf.name_);
+
+      host_conf.gem5_ = LogSourceConf::CreateLogSourceConf(node, kGem5LogKey, kGem5EventStreamKey);
+      host_conf.nicbm_ = LogSourceConf::CreateLogSourceConf(node, kNicbmLogKey, kNicbmEventStreamKey);
+
+      CheckKeyAndType<YAML::NodeType::Scalar>(kNs3NodeIdKey, node);
+      host_conf.ns3_node_id_ = node[kNs3NodeIdKey].as<int>();
+      CheckKeyAndType<YAML::NodeType::Scalar>(kNs3DeviceIdKey, node);
+      host_conf.ns3_device_id_ = node[kNs3DeviceIdKey].as<int>();
+
+      if (node[kNs3SinkDeviceIdsKey]) {
+        CheckKeyAndType<YAML::NodeType::Sequence>(kNs3SinkDeviceIdsKey, node);
+        for (const auto &device : node[kNs3SinkDeviceIdsKey]) {
+          host_conf.ns3_sink_device_ids_.push_back(device.as<int>());
+        }
+      }
+
+      if (node[kNs3FilterDeviceIdsKey]) {
+        CheckKeyAndType<YAML::NodeType::Sequence>(kNs3FilterDeviceIdsKey, node);
+        for (const auto &device : node[kNs3FilterDeviceIdsKey]) {
+          host_conf.ns3_filter_device_ids_.push_back(device.as<int>());
+        }
+      } else {
+        // like the hard coded two host experiment, trace the link side of the node by default
+        host_conf.ns3_filter_device_ids_.push_back(kDefaultNs3LinkDeviceId);
+      }
+      // the device the NIC is attached to is always traced, otherwise no packet would ever
+      // be handed over to or from the NIC
+      if (std::ranges::find(host_conf.ns3_filter_device_ids_, host_conf.ns3_device_id_)
+          == host_conf.ns3_filter_device_ids_.end()) {
+        host_conf.ns3_filter_device_ids_.push_back(host_conf.ns3_device_id_);
+      }
+
+      return host_conf;
+    }
+
+   private:
+    explicit HostTopologyConf() = default;
+    constexpr static const char *kNameKey{"Name"};
+    std::string name_;
+    constexpr static const char *kGem5LogKey{"Gem5Log"};
+    constexpr static const char *kGem5EventStreamKey{"Gem5EventStream"};
+    LogSourceConf gem5_;
+    constexpr static const char *kNicbmLogKey{"NicbmLog"};
+    constexpr static const char *kNicbmEventStreamKey{"NicbmEventStream"};
+    LogSourceConf nicbm_;
+    constexpr static const char *kNs3NodeIdKey{"Ns3NodeId"};
+    int ns3_node_id_ = 0;
+    constexpr static const char *kNs3DeviceIdKey{"Ns3DeviceId"};
+    int ns3_device_id_ = 0;
+    constexpr static const char *kNs3SinkDeviceIdsKey{"Ns3SinkDeviceIds"};
+    std::vector<int> ns3_sink_device_ids_;
+    constexpr static const char *kNs3FilterDeviceIdsKey{"Ns3FilterDeviceIds"};
+    constexpr static int kDefaultNs3LinkDeviceId = 1;
+    std::vector<int> ns3_filter_device_ids_;
+  };
+
+  using HostTopologyContainer = std::vector<HostTopologyConf>;
+
+  // checks that names as well as the ns3 node device pairs of the hosts are unique
+  inline static void CheckTopology(const HostTopologyContainer &hosts) {
+    std::set<std::string> names;
+    std::set<std::pair<int, int>> node_devices;
+    for (const HostTopologyConf &host : hosts) {
+      throw_on(not names.insert(host.GetName()).second,
+               "TraceEnvConfig::CheckTopology host name is not unique",
+               source_loc::current());
+      throw_on(not node_devices.insert({host.GetNs3NodeId(), host.GetNs3DeviceId()}).second,
+               "TraceEnvConfig::CheckTopology ns3 node device pair is not unique",
+               source_loc::current());
+      for (const int device : host.GetNs3SinkDeviceIds()) {
+        throw_on(not node_devices.insert({host.GetNs3NodeId(), device}).second,
+                 "TraceEnvConfig::CheckTopology ns3 node device pair is not unique",
+                 source_loc::current());
+      }
+    }
+  }
+
   explicit TraceEnvConfig() = default;
 
   ~TraceEnvConfig() = default;
 
   inline static TraceEnvConfig CreateFromYaml(const std::string &config_path) {
     spdlog::debug("TraceEnvConfig start CreateFromYaml");
+    return CreateFromYaml(YAML::LoadFile(config_path));
+  }
 
+  inline static TraceEnvConfig CreateFromYaml(const YAML::Node &config_root) {
     TraceEnvConfig trace_config;
 
-    YAML::Node config_root = YAML::LoadFile(config_path);
-
     CheckKeyAndType<YAML::NodeType::Sequence>(kLinuxNetFuncIndicatorKey, config_root);
     const YAML::Node net_func_ind = config_root[kLinuxNetFuncIndicatorKey];
     IterateAddValue(net_func_ind, trace_config.linux_net_func_indicator_);
@@ -241,6 +404,157 @@ class TraceEnvConfig {
     CheckKey(kLogLevelKey, config_root);
     trace_config.log_level_ = ResolveLogLevel(config_root[kLogLevelKey].as<std::string>());
 
+    // optional, capacity of the channels connecting pipeline stages
+    if (config_root[kPipelineChannelCapacityKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kPipelineChannelCapacityKey, config_root);
+      trace_config.pipeline_channel_capacity_ = config_root[kPipelineChannelCapacityKey].as<size_t>();
+      throw_on(trace_config.pipeline_channel_capacity_ == 0, "pipeline channel capacity 0", source_loc::current());
+    }
+
+    // optional, capacities of individual channels by name, e.g. 'pipeline-0.edge-2' or the name
+    // of a buffered event provider
+    if (config_root[kChannelCapacitiesKey]) {
+      CheckKeyAndType<YAML::NodeType::Map>(kChannelCapacitiesKey, config_root);
+      for (const auto &entry : config_root[kChannelCapacitiesKey]) {
+        const auto capacity = entry.second.as<size_t>();
+        throw_on(capacity == 0, "channel capacity 0", source_loc::current());
+        trace_config.channel_capacities_[entry.first.as<std::string>()] = capacity;
+      }
+    }
+
+    // optional, amount of additional buffer slots adaptive pipeline channels may grow into
+    if (config_root[kAdaptiveChannelBudgetKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kAdaptiveChannelBudgetKey, config_root);
+      trace_config.adaptive_channel_budget_ = config_root[kAdaptiveChannelBudgetKey].as<size_t>();
+    }
+
+    // optional, channel metrics are only collected when an interval is given
+    if (config_root[kChannelMetricsIntervalKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kChannelMetricsIntervalKey, config_root);
+      trace_config.channel_metrics_interval_ = config_root[kChannelMetricsIntervalKey].as<size_t>();
+    }
+
+    // optional, upper bound of dedicated worker threads pipeline stages are mapped onto,
+    // defaults to the amount of cpu threads
+    trace_config.worker_threads_ = trace_config.max_cpu_threads_;
+    if (config_root[kWorkerThreadsKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kWorkerThreadsKey, config_root);
+      trace_config.worker_threads_ = config_root[kWorkerThreadsKey].as<size_t>();
+      throw_on(trace_config.worker_threads_ == 0, "worker threads 0", source_loc::current());
+    }
+
+    // optional, cores the worker threads are pinned to in round robin order
+    if (config_root[kWorkerThreadAffinityKey]) {
+      CheckKeyAndType<YAML::NodeType::Sequence>(kWorkerThreadAffinityKey, config_root);
+      for (const auto &cpu : config_root[kWorkerThreadAffinityKey]) {
+        trace_config.worker_thread_affinity_.push_back(cpu.as<int>());
+      }
+      for (const int cpu : trace_config.worker_thread_affinity_) {
+        throw_on(cpu < 0, "negative cpu in worker thread affinity", source_loc::current());
+      }
+    }
+
+    // optional, run pipeline stages on a work stealing executor with the given amount of
+    // threads instead of the worker thread pool, 0 disables it
+    if (config_root[kWorkStealingThreadsKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kWorkStealingThreadsKey, config_root);
+      trace_config.work_stealing_threads_ = config_root[kWorkStealingThreadsKey].as<size_t>();
+    }
+
+    // optional, metrics are served via HTTP on the given port and/or written to the given
+    // file every interval seconds, without either of them no metrics are collected
+    if (config_root[kMetricsPortKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kMetricsPortKey, config_root);
+      trace_config.metrics_port_ = config_root[kMetricsPortKey].as<uint16_t>();
+    }
+    if (config_root[kMetricsFileKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kMetricsFileKey, config_root);
+      trace_config.metrics_file_ = config_root[kMetricsFileKey].as<std::string>();
+    }
+    if (config_root[kMetricsIntervalKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kMetricsIntervalKey, config_root);
+      trace_config.metrics_interval_ = config_root[kMetricsIntervalKey].as<size_t>();
+      throw_on(trace_config.metrics_interval_ == 0, "metrics interval 0", source_loc::current());
+    }
+
+    // optional, the progress of a run is persisted to the given file every interval seconds
+    // such that the run can be resumed after a crash
+    if (config_root[kCheckpointFileKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kCheckpointFileKey, config_root);
+      trace_config.checkpoint_file_ = config_root[kCheckpointFileKey].as<std::string>();
+    }
+    if (config_root[kCheckpointIntervalKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kCheckpointIntervalKey, config_root);
+      trace_config.checkpoint_interval_ = config_root[kCheckpointIntervalKey].as<size_t>();
+      throw_on(trace_config.checkpoint_interval_ == 0, "checkpoint interval 0", source_loc::current());
+    }
+
+    // optional, bounds how far in simulated picoseconds the fastest spanner may run ahead of the
+    // slowest one, such that pending contexts and spans stay proportional to the window; a
+    // spanner waiting for a context of a held back spanner deadlocks if the window is smaller
+    // than the latency between the components
+    if (config_root[kSkewWindowPsKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kSkewWindowPsKey, config_root);
+      trace_config.skew_window_ps_ = config_root[kSkewWindowPsKey].as<uint64_t>();
+      throw_on(trace_config.skew_window_ps_ < kMinSkewWindowPs,
+               "SkewWindowPs is smaller than the latency between components", source_loc::current());
+    }
+
+    // optional, done spans still waiting for their parent after the timeout in simulated
+    // picoseconds are either exported without their parent or dropped
+    if (config_root[kOrphanSpanTimeoutPsKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kOrphanSpanTimeoutPsKey, config_root);
+      trace_config.orphan_span_timeout_ps_ = config_root[kOrphanSpanTimeoutPsKey].as<uint64_t>();
+    }
+    if (config_root[kOrphanSpanPolicyKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kOrphanSpanPolicyKey, config_root);
+      trace_config.orphan_span_policy_ =
+          OrphanSpanPolicyFromString(config_root[kOrphanSpanPolicyKey].as<std::string>());
+    }
+
+    // optional, traces and exporter contexts not accessed for the given simulated picoseconds are
+    // forgotten such that traces that never complete do not accumulate during a run
+    if (config_root[kTraceTtlPsKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kTraceTtlPsKey, config_root);
+      trace_config.trace_ttl_ps_ = config_root[kTraceTtlPsKey].as<uint64_t>();
+    }
+    if (config_root[kExporterTtlPsKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kExporterTtlPsKey, config_root);
+      trace_config.exporter_ttl_ps_ = config_root[kExporterTtlPsKey].as<uint64_t>();
+    }
+
+    // optional, host call spans only keep their boundary and indicator events and count the
+    // remaining calls per function instead of storing every call event
+    if (config_root[kSummariseHostCallsKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kSummariseHostCallsKey, config_root);
+      trace_config.summarise_host_calls_ = config_root[kSummariseHostCallsKey].as<bool>();
+    }
+
+    // optional, opt in to run handlers declaring themselves cheap inline in the preceding stage
+    if (config_root[kFuseCheapHandlersKey]) {
+      CheckKeyAndType<YAML::NodeType::Scalar>(kFuseCheapHandlersKey, config_root);
+      trace_config.fuse_cheap_handlers_ = config_root[kFuseCheapHandlersKey].as<bool>();
+    }
+
+    // optional, describes the simulated hosts and the network such that all pipelines can be
+    // created from the configuration instead of being wired by hand
+    if (config_root[kTopologyKey]) {
+      CheckKeyAndType<YAML::NodeType::Map>(kTopologyKey, config_root);
+      const YAML::Node topology = config_root[kTopologyKey];
+
+      CheckKeyAndType<YAML::NodeType::Map>(kTopologyNs3Key, topology);
+      trace_config.topology_ns3_ = LogSourceConf::CreateLogSourceConf(topology[kTopologyNs3Key],
+                                                                       kTopologyNs3LogKey,
+                                                                       kTopologyNs3EventStreamKey);
+
+      CheckKeyAndType<YAML::NodeType::Sequence>(kTopologyHostsKey, topology);
+      for (const auto &host : topology[kTopologyHostsKey]) {
+        trace_config.topology_hosts_.push_back(HostTopologyConf::CreateHostTopologyConf(host));
+      }
+      throw_on(trace_config.topology_hosts_.empty(), "topology without hosts", source_loc::current());
+      CheckTopology(trace_config.topology_hosts_);
+    }
+
     spdlog::debug("TraceEnvConfig finished CreateFromYaml");
 
     return trace_config;
@@ -354,6 +668,131 @@ class TraceEnvConfig {
     return event_buffer_size_;
   }
 
+  [[nodiscard]] inline size_t GetPipelineChannelCapacity() const {
+    return pipeline_channel_capacity_;
+  }
+
+  // returns the configured capacity of the named channel or the given default
+  [[nodiscard]] inline size_t GetChannelCapacity(const std::string &channel_name, size_t default_capacity) const {
+    auto iter = channel_capacities_.find(channel_name);
+    return iter != channel_capacities_.end() ? iter->second : default_capacity;
+  }
+
+  // amount of additional slots adaptive channels may acquire in total, 0 disables adaptive channels
+  [[nodiscard]] inline size_t GetAdaptiveChannelBudget() const {
+    return adaptive_channel_budget_;
+  }
+
+  // interval in seconds in which channel metrics are reported, 0 disables them
+  [[nodiscard]] inline size_t GetChannelMetricsInterval() const {
+    return channel_metrics_interval_;
+  }
+
+  // channel metrics are also collected when metrics are exported, they provide the queue depths
+  [[nodiscard]] inline bool IsChannelMetricsEnabled() const {
+    return channel_metrics_interval_ > 0 or IsMetricsEnabled();
+  }
+
+  [[nodiscard]] inline size_t GetWorkerThreads() const {
+    return worker_threads_;
+  }
+
+  // cores to pin worker threads to, empty if threads shall not be pinned
+  [[nodiscard]] inline const std::vector<int> &GetWorkerThreadAffinity() const {
+    return worker_thread_affinity_;
+  }
+
+  [[nodiscard]] inline size_t GetWorkStealingThreads() const {
+    return work_stealing_threads_;
+  }
+
+  [[nodiscard]] inline bool IsWorkStealingEnabled() const {
+    return work_stealing_threads_ > 0;
+  }
+
+  // port the metrics are served on, 0 if they shall not be served
+  [[nodiscard]] inline uint16_t GetMetricsPort() const {
+    return metrics_port_;
+  }
+
+  // file the metrics are written to, empty if they shall not be written
+  [[nodiscard]] inline const std::string &GetMetricsFile() const {
+    return metrics_file_;
+  }
+
+  [[nodiscard]] inline size_t GetMetricsInterval() const {
+    return metrics_interval_;
+  }
+
+  [[nodiscard]] inline bool IsMetricsEnabled() const {
+    return metrics_port_ > 0 or not metrics_file_.empty();
+  }
+
+  // file checkpoints are written to and resumed from, empty if no checkpoints shall be taken
+  [[nodiscard]] inline const std::string &GetCheckpointFile() const {
+    return checkpoint_file_;
+  }
+
+  [[nodiscard]] inline size_t GetCheckpointInterval() const {
+    return checkpoint_interval_;
+  }
+
+  [[nodiscard]] inline bool IsCheckpointingEnabled() const {
+    return not checkpoint_file_.empty();
+  }
+
+  // window in simulated picoseconds, 0 if the skew is not bounded
+  [[nodiscard]] inline uint64_t GetSkewWindowPs() const {
+    return skew_window_ps_;
+  }
+
+  [[nodiscard]] inline bool IsSkewWindowEnabled() const {
+    return skew_window_ps_ > 0;
+  }
+
+  // timeout in simulated picoseconds, 0 if spans wait for their parent indefinitely
+  [[nodiscard]] inline uint64_t GetOrphanSpanTimeoutPs() const {
+    return orphan_span_timeout_ps_;
+  }
+
+  [[nodiscard]] inline OrphanSpanPolicy GetOrphanSpanPolicy() const {
+    return orphan_span_policy_;
+  }
+
+  [[nodiscard]] inline bool IsOrphanSpanTimeoutEnabled() const {
+    return orphan_span_timeout_ps_ > 0;
+  }
+
+  // ttl in simulated picoseconds of the tracers traces, 0 if they are kept until complete
+  [[nodiscard]] inline uint64_t GetTraceTtlPs() const {
+    return trace_ttl_ps_;
+  }
+
+  // ttl in simulated picoseconds of the exporters span contexts, 0 if they are kept for the whole run
+  [[nodiscard]] inline uint64_t GetExporterTtlPs() const {
+    return exporter_ttl_ps_;
+  }
+
+  [[nodiscard]] inline bool ShouldSummariseHostCalls() const {
+    return summarise_host_calls_;
+  }
+
+  [[nodiscard]] inline bool ShouldFuseCheapHandlers() const {
+    return fuse_cheap_handlers_;
+  }
+
+  [[nodiscard]] inline bool HasTopology() const {
+    return not topology_hosts_.empty();
+  }
+
+  [[nodiscard]] inline const HostTopologyContainer &GetTopologyHosts() const {
+    return topology_hosts_;
+  }
+
+  [[nodiscard]] inline const LogSourceConf &GetTopologyNs3() const {
+    return topology_ns3_;
+  }
+
   [[nodiscard]] inline spdlog::level::level_enum GetLogLevel() const {
     return log_level_;
   };
@@ -402,6 +841,53 @@ class TraceEnvConfig {
   size_t event_buffer_size_ = 0;
   constexpr static const char *kLogLevelKey{"LogLevel"};
   spdlog::level::level_enum log_level_ = spdlog::level::info;
+  constexpr static const char *kChannelMetricsIntervalKey{"ChannelMetricsInterval"};
+  size_t channel_metrics_interval_ = 0;
+  constexpr static const char *kPipelineChannelCapacityKey{"PipelineChannelCapacity"};
+  size_t pipeline_channel_capacity_ = 1'000;
+  constexpr static const char *kChannelCapacitiesKey{"ChannelCapacities"};
+  std::unordered_map<std::string, size_t> channel_capacities_;
+  constexpr static const char *kAdaptiveChannelBudgetKey{"AdaptiveChannelBudget"};
+  size_t adaptive_channel_budget_ = 0;
+  constexpr static const char *kWorkerThreadsKey{"WorkerThreads"};
+  size_t worker_threads_ = 1;
+  constexpr static const char *kWorkerThreadAffinityKey{"WorkerThreadAffinity"};
+  std::vector<int> worker_thread_affinity_;
+  constexpr static const char *kWorkStealingThreadsKey{"WorkStealingThreads"};
+  size_t work_stealing_threads_ = 0;
+  constexpr static const char *kMetricsPortKey{"MetricsPort"};
+  uint16_t metrics_port_ = 0;
+  constexpr static const char *kMetricsFileKey{"MetricsFile"};
+  std::string metrics_file_;
+  constexpr static const char *kMetricsIntervalKey{"MetricsInterval"};
+  size_t metrics_interval_ = 15;
+  constexpr static const char *kCheckpointFileKey{"CheckpointFile"};
+  std::string checkpoint_file_;
+  constexpr static const char *kCheckpointIntervalKey{"CheckpointInterval"};
+  size_t checkpoint_interval_ = 60;
+  constexpr static const char *kSkewWindowPsKey{"SkewWindowPs"};
+  // 1us, the default PCIe and ethernet link latency of SimBricks is 500ns
+  constexpr static uint64_t kMinSkewWindowPs = 1'000'000;
+  uint64_t skew_window_ps_ = 0;
+  constexpr static const char *kOrphanSpanTimeoutPsKey{"OrphanSpanTimeoutPs"};
+  uint64_t orphan_span_timeout_ps_ = 0;
+  constexpr static const char *kOrphanSpanPolicyKey{"OrphanSpanPolicy"};
+  OrphanSpanPolicy orphan_span_policy_ = OrphanSpanPolicy::kExport;
+  constexpr static const char *kTraceTtlPsKey{"TraceTtlPs"};
+  uint64_t trace_ttl_ps_ = 0;
+  constexpr static const char *kExporterTtlPsKey{"ExporterTtlPs"};
+  uint64_t exporter_ttl_ps_ = 0;
+  constexpr static const char *kSummariseHostCallsKey{"SummariseHostCalls"};
+  bool summarise_host_calls_ = false;
+  constexpr static const char *kFuseCheapHandlersKey{"FuseCheapHandlers"};
+  bool fuse_cheap_handlers_ = false;
+  constexpr static const char *kTopologyKey{"Topology"};
+  constexpr static const char *kTopologyHostsKey{"Hosts"};
+  HostTopologyContainer topology_hosts_;
+  constexpr static const char *kTopologyNs3Key{"Ns3"};
+  constexpr static const char *kTopologyNs3LogKey{"Log"};
+  constexpr static const char *kTopologyNs3EventStreamKey{"EventStream"};
+  LogSourceConf topology_ns3_;
 };
 
 #endif // SIMBRICKS_TRACE_CONFIG_H_
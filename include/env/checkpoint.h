@@ -0,0 +1,410 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util/exception.h"
+#include "util/factory.h"
+
+#ifndef SIMBRICKS_TRACE_INCLUDE_ENV_CHECKPOINT_H_
+#define SIMBRICKS_TRACE_INCLUDE_ENV_CHECKPOINT_H_
+
+// every n-th event read from an input its byte offset is remembered as potential resume point
+inline constexpr uint64_t kCheckpointSampleInterval = 1024;
+
+inline constexpr uint64_t kNoResumeTs = std::numeric_limits<uint64_t>::max();
+
+// Timestamps of the earliest events the spans still open, and the contexts still in flight, were
+// built from. Reading all inputs again from before the lowest of them rebuilds every span that was
+// not exported yet, together with the spans it references.
+class ResumeFrontier {
+  std::mutex frontier_mutex_;
+  std::multiset<uint64_t> pinned_;
+
+ public:
+  using PinT = std::multiset<uint64_t>::iterator;
+
+  PinT Pin(uint64_t timestamp) {
+    const std::lock_guard<std::mutex> guard{frontier_mutex_};
+    return pinned_.insert(timestamp);
+  }
+
+  PinT Repin(PinT pin, uint64_t timestamp) {
+    const std::lock_guard<std::mutex> guard{frontier_mutex_};
+    pinned_.erase(pin);
+    return pinned_.insert(timestamp);
+  }
+
+  void Unpin(PinT pin) {
+    const std::lock_guard<std::mutex> guard{frontier_mutex_};
+    pinned_.erase(pin);
+  }
+
+  // kNoResumeTs if nothing is pinned
+  uint64_t GetLowest() {
+    const std::lock_guard<std::mutex> guard{frontier_mutex_};
+    return pinned_.empty() ? kNoResumeTs : *pinned_.begin();
+  }
+
+  size_t GetAmountPinned() {
+    const std::lock_guard<std::mutex> guard{frontier_mutex_};
+    return pinned_.size();
+  }
+};
+
+// Keeps a timestamp pinned in a frontier for as long as it lives, a copy pins the timestamp again.
+// NOTE: a pin is not synchronized, it is owned by a span or context just like their other fields
+class ResumePin {
+  ResumeFrontier *frontier_ = nullptr;
+  ResumeFrontier::PinT pin_;
+  uint64_t timestamp_ = kNoResumeTs;
+
+ public:
+  ResumePin() = default;
+
+  ResumePin(ResumeFrontier &frontier, uint64_t timestamp)
+      : frontier_(&frontier), pin_(frontier.Pin(timestamp)), timestamp_(timestamp) {
+  }
+
+  ResumePin(const ResumePin &other) : frontier_(other.frontier_), timestamp_(other.timestamp_) {
+    if (frontier_) {
+      pin_ = frontier_->Pin(timestamp_);
+    }
+  }
+
+  ResumePin(ResumePin &&other) noexcept
+      : frontier_(std::exchange(other.frontier_, nullptr)),
+        pin_(other.pin_),
+        timestamp_(std::exchange(other.timestamp_, kNoResumeTs)) {
+  }
+
+  ResumePin &operator=(const ResumePin &other) {
+    if (this != &other) {
+      *this = ResumePin{other};
+    }
+    return *this;
+  }
+
+  ResumePin &operator=(ResumePin &&other) noexcept {
+    if (this != &other) {
+      Release();
+      frontier_ = std::exchange(other.frontier_, nullptr);
+      pin_ = other.pin_;
+      timestamp_ = std::exchange(other.timestamp_, kNoResumeTs);
+    }
+    return *this;
+  }
+
+  ~ResumePin() {
+    Release();
+  }
+
+  bool IsPinned() const {
+    return frontier_ != nullptr;
+  }
+
+  // kNoResumeTs if nothing is pinned
+  uint64_t GetTs() const {
+    return timestamp_;
+  }
+
+  // moves the pin to an earlier timestamp, later ones are ignored
+  void Lower(uint64_t timestamp) {
+    if (frontier_ and timestamp < timestamp_) {
+      pin_ = frontier_->Repin(pin_, timestamp);
+      timestamp_ = timestamp;
+    }
+  }
+
+  void Release() {
+    if (frontier_) {
+      frontier_->Unpin(pin_);
+      frontier_ = nullptr;
+      timestamp_ = kNoResumeTs;
+    }
+  }
+};
+
+// How far a consumer of events, i.e. a spanner, got: events from the given timestamp on may not
+// be handled yet, hence their spans may be missing from the frontier.
+class ConsumerProgress {
+  std::atomic<uint64_t> handling_ts_{0};
+
+ public:
+  inline void OnEventHandling(uint64_t timestamp) {
+    handling_ts_.store(timestamp, std::memory_order_relaxed);
+  }
+
+  void OnDone() {
+    handling_ts_.store(kNoResumeTs, std::memory_order_relaxed);
+  }
+
+  uint64_t GetHandlingTs() const {
+    return handling_ts_.load(std::memory_order_relaxed);
+  }
+};
+
+// Tracks how far an input was read and how many of the read events the pipeline already took,
+// such that a checkpoint can name a byte offset from which the input can be resumed without
+// skipping an event of a span that was not exported yet. The reading task and the pipeline only
+// touch an atomic counter or, for every kCheckpointSampleInterval-th event, a short critical section.
+class InputProgress {
+  struct Sample {
+    uint64_t events_read_;
+    // latest timestamp of the events read so far
+    uint64_t max_ts_;
+    // byte offset behind the line of the last of these events
+    uint64_t offset_;
+  };
+
+  const std::string name_;
+  const uint64_t start_offset_;
+  std::atomic<uint64_t> events_consumed_{0};
+  // only touched by the reading task
+  uint64_t max_ts_read_ = 0;
+
+  std::mutex samples_mutex_;
+  std::deque<Sample> samples_;
+  uint64_t resume_offset_;
+
+ public:
+  explicit InputProgress(std::string name, uint64_t start_offset)
+      : name_(std::move(name)), start_offset_(start_offset), resume_offset_(start_offset) {
+  }
+
+  const std::string &GetName() const {
+    return name_;
+  }
+
+  // offset the input shall be read from, non zero when resuming from a checkpoint
+  uint64_t GetStartOffset() const {
+    return start_offset_;
+  }
+
+  // called by the reading task after the events_read-th event, with the given timestamp, was
+  // parsed from the line ending right before offset
+  inline void OnEventRead(uint64_t events_read, uint64_t timestamp, uint64_t offset) {
+    max_ts_read_ = std::max(max_ts_read_, timestamp);
+    if (events_read % kCheckpointSampleInterval != 0) {
+      return;
+    }
+    const std::lock_guard<std::mutex> guard{samples_mutex_};
+    samples_.push_back({events_read, max_ts_read_, offset});
+  }
+
+  // called by the reading task once the input is exhausted
+  void OnInputDone(uint64_t events_read, uint64_t offset) {
+    const std::lock_guard<std::mutex> guard{samples_mutex_};
+    samples_.push_back({events_read, max_ts_read_, offset});
+  }
+
+  // called whenever the pipeline took an event read from the input
+  inline void OnEventConsumed() {
+    events_consumed_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // byte offset behind the last sampled event the pipeline already took and that is older than
+  // the frontier, i.e. all spans of the events up to it were exported
+  uint64_t GetResumeOffset(uint64_t frontier_ts) {
+    const uint64_t consumed = events_consumed_.load(std::memory_order_relaxed);
+    const std::lock_guard<std::mutex> guard{samples_mutex_};
+    while (not samples_.empty() and samples_.front().events_read_ <= consumed
+        and samples_.front().max_ts_ < frontier_ts) {
+      resume_offset_ = samples_.front().offset_;
+      samples_.pop_front();
+    }
+    return resume_offset_;
+  }
+};
+
+// Snapshot of a tracing run from which it can be resumed: the byte offsets the inputs can be
+// read from again and the id counters, such that resumed ids do not collide with exported ones.
+// The spans open when the snapshot was taken are not stored, the offsets lie before their events
+// such that resuming rebuilds them; spans exported after the frontier may be exported again.
+struct Checkpoint {
+  uint64_t sequence_ = 0;
+  uint64_t next_span_id_ = 1;
+  uint64_t next_trace_id_ = 1;
+  uint64_t next_trace_context_id_ = 1;
+  // timestamp from which on events were read again when resuming, kNoResumeTs if none
+  uint64_t frontier_ts_ = kNoResumeTs;
+  // amount of spans and contexts in flight that held back the frontier
+  uint64_t open_spans_ = 0;
+  // input name -> byte offset
+  std::map<std::string, uint64_t> input_offsets_;
+
+  bool operator==(const Checkpoint &other) const = default;
+
+  // compact binary encoding using variable length integers, terminated by a checksum
+  void Serialize(std::ostream &out) const;
+
+  // returns nothing if the data is no valid checkpoint
+  static std::optional<Checkpoint> Deserialize(std::istream &in);
+
+  // replaces the file atomically such that a crash while writing keeps the previous checkpoint
+  bool WriteToFile(const std::string &path) const;
+
+  static std::optional<Checkpoint> LoadFromFile(const std::string &path);
+};
+
+// Knows the progress of all inputs of a run and the checkpoint the run was resumed from.
+class CheckpointRegistry {
+  std::mutex registry_mutex_;
+  std::vector<std::shared_ptr<InputProgress>> inputs_;
+  std::vector<std::shared_ptr<ConsumerProgress>> consumers_;
+  ResumeFrontier frontier_;
+  std::optional<Checkpoint> resumed_from_;
+  uint64_t sequence_ = 0;
+
+ public:
+  // NOTE: must be called before any input is registered
+  void ResumeFrom(Checkpoint checkpoint) {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    throw_on(not inputs_.empty(), "cannot resume after inputs were registered", source_loc::current());
+    sequence_ = checkpoint.sequence_;
+    resumed_from_ = std::move(checkpoint);
+  }
+
+  const std::optional<Checkpoint> &GetResumedFrom() const {
+    return resumed_from_;
+  }
+
+  std::shared_ptr<InputProgress> RegisterInput(const std::string &name) {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    for (const std::shared_ptr<InputProgress> &input : inputs_) {
+      throw_on(input->GetName() == name, "input registered twice for checkpointing", source_loc::current());
+    }
+    uint64_t start_offset = 0;
+    if (resumed_from_) {
+      auto offset_it = resumed_from_->input_offsets_.find(name);
+      if (offset_it != resumed_from_->input_offsets_.end()) {
+        start_offset = offset_it->second;
+      }
+    }
+    auto input = create_shared<InputProgress>("could not create input progress", name, start_offset);
+    inputs_.push_back(input);
+    return input;
+  }
+
+  std::shared_ptr<ConsumerProgress> RegisterConsumer() {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    auto consumer = create_shared<ConsumerProgress>("could not create consumer progress");
+    consumers_.push_back(consumer);
+    return consumer;
+  }
+
+  inline ResumeFrontier &GetFrontier() {
+    return frontier_;
+  }
+
+  // the id counters are filled in by the caller
+  Checkpoint Snapshot() {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    Checkpoint checkpoint;
+    checkpoint.sequence_ = ++sequence_;
+    // the consumers are read before the frontier: a span is pinned at a timestamp no earlier than
+    // the event its consumer handles, or than a pin that is still alive
+    uint64_t frontier_ts = kNoResumeTs;
+    for (const std::shared_ptr<ConsumerProgress> &consumer : consumers_) {
+      frontier_ts = std::min(frontier_ts, consumer->GetHandlingTs());
+    }
+    checkpoint.open_spans_ = frontier_.GetAmountPinned();
+    checkpoint.frontier_ts_ = std::min(frontier_ts, frontier_.GetLowest());
+    // inputs not read in this run keep their offset
+    if (resumed_from_) {
+      checkpoint.input_offsets_ = resumed_from_->input_offsets_;
+    }
+    for (const std::shared_ptr<InputProgress> &input : inputs_) {
+      checkpoint.input_offsets_[input->GetName()] = input->GetResumeOffset(checkpoint.frontier_ts_);
+    }
+    return checkpoint;
+  }
+};
+
+// Writes a checkpoint periodically from a background thread till it is destroyed, at which
+// point a final checkpoint is written. Taking a checkpoint does not pause the pipelines, and a
+// checkpoint is only written when the inputs progressed since the last one.
+class CheckpointWriter {
+  std::function<Checkpoint()> take_checkpoint_;
+  const std::string path_;
+  const std::chrono::seconds interval_;
+  std::map<std::string, uint64_t> last_written_;
+  std::mutex writer_mutex_;
+  std::condition_variable writer_cv_;
+  bool stop_ = false;
+  std::thread writer_;
+
+  void WriteCheckpoint();
+
+  void Write() {
+    std::unique_lock lock{writer_mutex_};
+    while (not writer_cv_.wait_for(lock, interval_, [this] { return stop_; })) {
+      lock.unlock();
+      WriteCheckpoint();
+      lock.lock();
+    }
+  }
+
+ public:
+  CheckpointWriter(std::function<Checkpoint()> take_checkpoint, std::string path, std::chrono::seconds interval)
+      : take_checkpoint_(std::move(take_checkpoint)), path_(std::move(path)), interval_(interval) {
+    throw_on(not take_checkpoint_, "checkpoint function is empty", source_loc::current());
+    throw_on(path_.empty(), "checkpoint file path is empty", source_loc::current());
+    throw_on(interval_.count() == 0, "checkpoint interval is 0", source_loc::current());
+    writer_ = std::thread{&CheckpointWriter::Write, this};
+  }
+
+  CheckpointWriter(const CheckpointWriter &) = delete;
+
+  CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+  ~CheckpointWriter() {
+    {
+      const std::lock_guard<std::mutex> guard{writer_mutex_};
+      stop_ = true;
+    }
+    writer_cv_.notify_all();
+    writer_.join();
+    WriteCheckpoint();
+  }
+};
+
+#endif // SIMBRICKS_TRACE_INCLUDE_ENV_CHECKPOINT_H_
@@ -25,16 +25,23 @@
 #ifndef SIM_TRACE_CONFIG_VARS_H_
 #define SIM_TRACE_CONFIG_VARS_H_
 
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
 #include <vector>
 #include <shared_mutex>
 
+#include "analytics/timer.h"
 #include "config/config.h"
 #include "events/events.h"
+#include "env/checkpoint.h"
 #include "env/stringInternalizer.h"
 #include "env/symtable.h"
+#include "env/workerPool.h"
+#include "sync/channelMetrics.h"
+#include "sync/workStealingExecutor.h"
+#include "util/metrics.h"
 
 class TraceEnvironment {
   std::shared_mutex trace_env_reader_writer_mutex_;
@@ -67,6 +74,38 @@ class TraceEnvironment {
 
   concurrencpp::runtime runtime_;
 
+  ChannelMetricsRegistry channel_metrics_;
+
+  MetricsRegistry metrics_;
+
+  CheckpointRegistry checkpoints_;
+
+  std::shared_ptr<WeakTimer> skew_window_ = nullptr;
+
+  static constexpr size_t kCacheLineSize = 64;
+
+  // the id counters are handed out without the environment mutex such that creating spans does not
+  // stall the symbol lookups of the parsers, each one lives in its own cache line
+  alignas(kCacheLineSize) std::atomic<uint64_t> next_parser_id_{1};
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> next_span_id_{1};
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> next_spanner_id_{1};
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> next_trace_id_{1};
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> next_trace_context_id_{1};
+
+  WorkerThreadPool worker_pool_;
+
+  std::shared_ptr<WorkStealingExecutor> work_stealing_executor_ = nullptr;
+
+  static void RaiseCounter(std::atomic<uint64_t> &counter, uint64_t value) {
+    uint64_t current = counter.load(std::memory_order_relaxed);
+    while (current < value and not counter.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
+
   void InternalizeStrings(TraceEnvConfig::IndicatorContainer::const_iterator begin,
                           TraceEnvConfig::IndicatorContainer::const_iterator end,
                           std::set<const std::string *> &into) {
@@ -83,6 +122,7 @@ class TraceEnvironment {
                               std::set<std::string> symbol_filter);
 
  protected:
+  using ExecutorPtr = std::shared_ptr<concurrencpp::executor>;
   using PoolExecutor = concurrencpp::thread_pool_executor;
   using ThreadExecutor = concurrencpp::thread_executor;
   using PoolExecutorPtr = std::shared_ptr<PoolExecutor>;
@@ -95,15 +135,22 @@ class TraceEnvironment {
   explicit TraceEnvironment(const TraceEnvConfig &trace_env_config);
 
   ~TraceEnvironment() {
+    if (work_stealing_executor_) {
+      work_stealing_executor_->shutdown();
+    }
     runtime_.thread_executor()->shutdown();
     runtime_.thread_pool_executor()->shutdown();
     runtime_.inline_executor()->shutdown();
     runtime_.background_executor()->shutdown();
   }
 
-  PoolExecutorPtr GetPoolExecutor() {
+  // returns the work stealing executor if enabled, the runtimes thread pool otherwise
+  ExecutorPtr GetPoolExecutor() {
     const std::shared_lock reader_lock(trace_env_reader_writer_mutex_);
-    auto executor = runtime_.thread_pool_executor();
+    if (work_stealing_executor_) {
+      return work_stealing_executor_;
+    }
+    ExecutorPtr executor = runtime_.thread_pool_executor();
     throw_if_empty(executor,
                    TraceException::kResumeExecutorNull,
                    source_loc::current());
@@ -124,13 +171,30 @@ class TraceEnvironment {
     return executor;
   }
 
-  WorkerThreadExecutorPtr GetWorkerThreadExecutor() {
-    const std::shared_lock reader_lock(trace_env_reader_writer_mutex_);
-    auto executor = runtime_.make_worker_thread_executor();
+  // returns a worker thread of the bounded pool the given stage shares with other stages
+  WorkerThreadExecutorPtr GetWorkerThreadExecutor(const std::string &stage) {
+    auto executor = worker_pool_.Acquire(stage);
+    throw_if_empty(executor, TraceException::kResumeExecutorNull, source_loc::current());
+    return executor;
+  }
+
+  // returns a worker thread exclusively used by the given stage, use for stages that may block
+  WorkerThreadExecutorPtr GetDedicatedWorkerThreadExecutor(const std::string &stage) {
+    auto executor = worker_pool_.AcquireDedicated(stage);
     throw_if_empty(executor, TraceException::kResumeExecutorNull, source_loc::current());
     return executor;
   }
 
+  // returns the executor a pipeline stage shall run on, either the shared work stealing
+  // executor or a worker thread of the bounded pool
+  ExecutorPtr GetStageExecutor(const std::string &stage) {
+    if (work_stealing_executor_) {
+      spdlog::debug("stage {} runs on {}", stage, work_stealing_executor_->name);
+      return work_stealing_executor_;
+    }
+    return GetWorkerThreadExecutor(stage);
+  }
+
   TraceEnvConfig GetConfig() {
     const std::shared_lock reader_lock(trace_env_reader_writer_mutex_);
     return trace_env_config_;
@@ -140,6 +204,72 @@ class TraceEnvironment {
     return internalizer_;
   }
 
+  inline ChannelMetricsRegistry &GetChannelMetrics() {
+    return channel_metrics_;
+  }
+
+  inline MetricsRegistry &GetMetrics() {
+    return metrics_;
+  }
+
+  // components only register metrics when they are exported
+  inline bool IsMetricsEnabled() const {
+    return trace_env_config_.IsMetricsEnabled();
+  }
+
+  inline bool ShouldSummariseHostCalls() const {
+    return trace_env_config_.ShouldSummariseHostCalls();
+  }
+
+  // spans only pin the events they were built from when checkpoints are taken
+  inline bool IsCheckpointingEnabled() const {
+    return trace_env_config_.IsCheckpointingEnabled();
+  }
+
+  inline CheckpointRegistry &GetCheckpoints() {
+    return checkpoints_;
+  }
+
+  // snapshot of the input progress and the id counters, does not pause the pipelines
+  Checkpoint TakeCheckpoint() {
+    Checkpoint checkpoint = checkpoints_.Snapshot();
+    checkpoint.next_span_id_ = next_span_id_.load(std::memory_order_relaxed);
+    checkpoint.next_trace_id_ = next_trace_id_.load(std::memory_order_relaxed);
+    checkpoint.next_trace_context_id_ = next_trace_context_id_.load(std::memory_order_relaxed);
+    return checkpoint;
+  }
+
+  // loads the configured checkpoint file, inputs created afterwards continue reading where the
+  // checkpoint left off; returns false if there is no valid checkpoint to resume from
+  // NOTE: must be called before any pipeline is created
+  bool ResumeFromCheckpoint();
+
+  // creates the timer bounding the skew between the given amount of spanners if a skew window
+  // is configured
+  // NOTE: must be called after all spanners were created and before any of them consumes
+  void CreateSkewWindow(size_t amount_spanners) {
+    if (not trace_env_config_.IsSkewWindowEnabled()) {
+      return;
+    }
+    if (amount_spanners < 2) {
+      spdlog::warn("skew window ignored, there is only {} spanner", amount_spanners);
+      return;
+    }
+    const std::unique_lock writer_lock(trace_env_reader_writer_mutex_);
+    skew_window_ = create_shared<WeakTimer>("skew window is null", amount_spanners,
+                                            trace_env_config_.GetSkewWindowPs());
+  }
+
+  // returns the timer bounding the skew between spanners, null if the skew is not bounded
+  std::shared_ptr<WeakTimer> GetSkewWindow() {
+    const std::shared_lock reader_lock(trace_env_reader_writer_mutex_);
+    return skew_window_;
+  }
+
+  inline WorkerThreadPool &GetWorkerPool() {
+    return worker_pool_;
+  }
+
   inline std::vector<std::shared_ptr<SymsFilter>> &GetSymtables() {
     return symbol_tables_;
   }
@@ -154,34 +284,30 @@ class TraceEnvironment {
     return ident != kInvalidId;
   }
 
+  // NOTE: ids only need to be unique, hence relaxed ordering suffices
   inline uint64_t GetNextParserId() {
-    const std::unique_lock writer_lock(trace_env_reader_writer_mutex_);
-    static uint64_t next_id = 1;
-    return next_id++;
+    return next_parser_id_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // returns the id the next span will get without handing it out
+  inline uint64_t PeekNextSpanId() {
+    return next_span_id_.load(std::memory_order_relaxed);
   }
 
   inline uint64_t GetNextSpanId() {
-    const std::unique_lock writer_lock(trace_env_reader_writer_mutex_);
-    static uint64_t next_id = 1;
-    return next_id++;
+    return next_span_id_.fetch_add(1, std::memory_order_relaxed);
   }
 
   inline uint64_t GetNextSpannerId() {
-    const std::unique_lock writer_lock(trace_env_reader_writer_mutex_);
-    static uint64_t next_id = 1;
-    return next_id++;
+    return next_spanner_id_.fetch_add(1, std::memory_order_relaxed);
   }
 
   inline uint64_t GetNextTraceId() {
-    const std::unique_lock writer_lock(trace_env_reader_writer_mutex_);
-    static uint64_t next_id = 1;
-    return next_id++;
+    return next_trace_id_.fetch_add(1, std::memory_order_relaxed);
   }
 
   inline uint64_t GetNextTraceContextId() {
-    const std::unique_lock writer_lock(trace_env_reader_writer_mutex_);
-    static uint64_t next_id = 1;
-    return next_id++;
+    return next_trace_context_id_.fetch_add(1, std::memory_order_relaxed);
   }
 
   inline const std::string *InternalizeAdditional(const std::string &symbol) {
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "spdlog/spdlog.h"
+#include "concurrencpp/concurrencpp.h"
+
+#include "util/exception.h"
+
+#ifndef SIMBRICKS_TRACE_INCLUDE_ENV_WORKER_POOL_H_
+#define SIMBRICKS_TRACE_INCLUDE_ENV_WORKER_POOL_H_
+
+// Maps pipeline stages onto a bounded set of worker threads. Stages are coroutines that
+// suspend on their channels, hence several of them can share one worker thread. Stages that
+// may block their thread (e.g. reading a named pipe) should be given a dedicated thread.
+class WorkerThreadPool {
+ public:
+  using WorkerPtr = std::shared_ptr<concurrencpp::worker_thread_executor>;
+  using WorkerFactory = std::function<WorkerPtr()>;
+
+ private:
+  struct Worker {
+    WorkerPtr executor_ = nullptr;
+    int cpu_ = -1;
+    bool dedicated_ = false;
+    std::vector<std::string> stages_;
+  };
+
+  std::mutex workers_mutex_;
+  WorkerFactory factory_;
+  const size_t max_shared_workers_;
+  const std::vector<int> cpu_affinity_;
+  std::vector<Worker> workers_;
+  size_t amount_shared_workers_ = 0;
+
+  // NOTE: the lock must be held when calling this method
+  Worker &CreateWorker(bool dedicated) {
+    WorkerPtr executor = factory_();
+    throw_if_empty(executor, TraceException::kResumeExecutorNull, source_loc::current());
+
+    Worker &worker = workers_.emplace_back();
+    worker.executor_ = std::move(executor);
+    worker.dedicated_ = dedicated;
+    if (not cpu_affinity_.empty()) {
+      worker.cpu_ = cpu_affinity_[(workers_.size() - 1) % cpu_affinity_.size()];
+      Pin(worker.executor_, worker.cpu_);
+    }
+    if (not dedicated) {
+      ++amount_shared_workers_;
+    }
+    return worker;
+  }
+
+  static void Pin(const WorkerPtr &executor, int cpu) {
+#ifdef __linux__
+    executor->post([cpu]() {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(cpu, &cpu_set);
+      if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+        spdlog::warn("WorkerThreadPool: could not pin worker thread to cpu {}", cpu);
+      }
+    });
+#else
+    spdlog::warn("WorkerThreadPool: pinning worker threads is not supported on this platform");
+#endif
+  }
+
+ public:
+  explicit WorkerThreadPool(WorkerFactory factory, size_t max_shared_workers, std::vector<int> cpu_affinity = {})
+      : factory_(std::move(factory)), max_shared_workers_(max_shared_workers), cpu_affinity_(std::move(cpu_affinity)) {
+    throw_on(not factory_, "WorkerThreadPool: no worker factory given", source_loc::current());
+    throw_on(max_shared_workers_ == 0, "WorkerThreadPool: max_shared_workers is 0", source_loc::current());
+  }
+
+  // Returns the worker the given stage shall run on. New workers are created until the bound
+  // is reached, afterwards the worker running the least stages is chosen.
+  WorkerPtr Acquire(const std::string &stage) {
+    const std::lock_guard<std::mutex> guard(workers_mutex_);
+
+    Worker *chosen = nullptr;
+    if (amount_shared_workers_ < max_shared_workers_) {
+      chosen = &CreateWorker(false);
+    } else {
+      for (Worker &worker : workers_) {
+        if (worker.dedicated_) {
+          continue;
+        }
+        if (chosen == nullptr or worker.stages_.size() < chosen->stages_.size()) {
+          chosen = &worker;
+        }
+      }
+    }
+    assert(chosen);
+
+    chosen->stages_.push_back(stage);
+    spdlog::debug("WorkerThreadPool: stage {} runs on worker-{} (cpu {})", stage, chosen - workers_.data(), chosen->cpu_);
+    return chosen->executor_;
+  }
+
+  // Returns a worker thread exclusively used by the given stage, it does not count towards the bound.
+  WorkerPtr AcquireDedicated(const std::string &stage) {
+    const std::lock_guard<std::mutex> guard(workers_mutex_);
+
+    Worker &worker = CreateWorker(true);
+    worker.stages_.push_back(stage);
+    spdlog::debug("WorkerThreadPool: stage {} runs on dedicated worker-{} (cpu {})", stage, workers_.size() - 1,
+                 worker.cpu_);
+    return worker.executor_;
+  }
+
+  size_t GetAmountWorkers() {
+    const std::lock_guard<std::mutex> guard(workers_mutex_);
+    return workers_.size();
+  }
+
+  size_t GetAmountSharedWorkers() {
+    const std::lock_guard<std::mutex> guard(workers_mutex_);
+    return amount_shared_workers_;
+  }
+
+  std::ostream &Display(std::ostream &out) {
+    const std::lock_guard<std::mutex> guard(workers_mutex_);
+    for (size_t index = 0; index < workers_.size(); index++) {
+      const Worker &worker = workers_[index];
+      out << "worker-" << index;
+      if (worker.dedicated_) {
+        out << " (dedicated)";
+      }
+      if (worker.cpu_ >= 0) {
+        out << " cpu=" << worker.cpu_;
+      }
+      out << ":";
+      for (const std::string &stage : worker.stages_) {
+        out << " " << stage;
+      }
+      out << '\n';
+    }
+    return out;
+  }
+};
+
+#endif // SIMBRICKS_TRACE_INCLUDE_ENV_WORKER_POOL_H_
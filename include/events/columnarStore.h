@@ -0,0 +1,230 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "events/events.h"
+#include "sync/corobelt.h"
+#include "util/exception.h"
+
+#ifndef SIMBRICKS_TRACE_COLUMNAR_STORE_H_
+#define SIMBRICKS_TRACE_COLUMNAR_STORE_H_
+
+inline constexpr size_t kColumnFieldCount = 5;
+inline constexpr size_t kColumnChunkRows = 64 * 1024;
+inline constexpr size_t kColumnScanBatch = 1024;
+
+// The type specific fields that are stored per event type. Fields are always a prefix of
+// the array, an empty name marks the end of the used fields for that type.
+using ColumnFieldNames = std::array<std::string_view, kColumnFieldCount>;
+
+const ColumnFieldNames &GetColumnFieldNames(EventType type);
+
+size_t GetColumnFieldCount(EventType type);
+
+// returns -1 in case the given type has no field with the given name
+int GetColumnFieldIndex(EventType type, std::string_view name);
+
+void ExtractColumnFields(const Event &event, std::array<uint64_t, kColumnFieldCount> &fields);
+
+// Non owning view onto a chunk of rows of a single event type. The columns either point
+// into an in memory chunk or into a mmap'd store file.
+struct ColumnChunkView {
+  EventType type_;
+  size_t rows_ = 0;
+  uint64_t min_ts_ = UINT64_MAX;
+  uint64_t max_ts_ = 0;
+  const uint64_t *ts_ = nullptr;
+  const uint64_t *parser_id_ = nullptr;
+  std::array<const uint64_t *, kColumnFieldCount> fields_{};
+};
+
+// Inclusive range predicate on a type specific field column.
+struct ColumnPredicate {
+  size_t field_;
+  uint64_t lower_;
+  uint64_t upper_;
+};
+
+class ColumnQuery {
+  EventType type_;
+  uint64_t ts_lower_ = 0;
+  uint64_t ts_upper_ = UINT64_MAX;
+  std::vector<ColumnPredicate> predicates_;
+
+ public:
+  explicit ColumnQuery(EventType type) : type_(type) {
+  }
+
+  ColumnQuery &Between(uint64_t ts_lower, uint64_t ts_upper) {
+    throw_on(ts_lower > ts_upper, "ColumnQuery::Between invalid timestamp range", source_loc::current());
+    ts_lower_ = ts_lower;
+    ts_upper_ = ts_upper;
+    return *this;
+  }
+
+  ColumnQuery &Where(std::string_view field, uint64_t lower, uint64_t upper) {
+    const int index = GetColumnFieldIndex(type_, field);
+    throw_on(index < 0, "ColumnQuery::Where unknown field for event type", source_loc::current());
+    throw_on(lower > upper, "ColumnQuery::Where invalid range", source_loc::current());
+    predicates_.push_back({static_cast<size_t>(index), lower, upper});
+    return *this;
+  }
+
+  ColumnQuery &Equals(std::string_view field, uint64_t value) {
+    return Where(field, value, value);
+  }
+
+  ColumnQuery &AtLeast(std::string_view field, uint64_t value) {
+    return Where(field, value, UINT64_MAX);
+  }
+
+  ColumnQuery &AtMost(std::string_view field, uint64_t value) {
+    return Where(field, 0, value);
+  }
+
+  [[nodiscard]] inline EventType GetType() const {
+    return type_;
+  }
+
+  [[nodiscard]] inline uint64_t GetTsLower() const {
+    return ts_lower_;
+  }
+
+  [[nodiscard]] inline uint64_t GetTsUpper() const {
+    return ts_upper_;
+  }
+
+  [[nodiscard]] inline const std::vector<ColumnPredicate> &GetPredicates() const {
+    return predicates_;
+  }
+};
+
+// Invoked once per batch with the row indices (within the chunk) that matched the query.
+using ColumnSelectionCallback = std::function<void(const ColumnChunkView &chunk,
+                                                   const uint32_t *selection,
+                                                   size_t count)>;
+
+// Evaluates the query batch wise over the given chunks. Chunks whose timestamp zone map
+// does not overlap with the query are skipped entirely. Returns the number of matching rows.
+size_t ScanColumnChunks(const std::vector<ColumnChunkView> &chunks,
+                        const ColumnQuery &query,
+                        const ColumnSelectionCallback &callback);
+
+class ColumnChunk {
+  const EventType type_;
+  const size_t field_count_;
+  size_t rows_ = 0;
+  uint64_t min_ts_ = UINT64_MAX;
+  uint64_t max_ts_ = 0;
+  std::vector<uint64_t> ts_;
+  std::vector<uint64_t> parser_id_;
+  std::array<std::vector<uint64_t>, kColumnFieldCount> fields_;
+
+ public:
+  explicit ColumnChunk(EventType type);
+
+  [[nodiscard]] inline bool IsFull() const {
+    return rows_ >= kColumnChunkRows;
+  }
+
+  [[nodiscard]] inline size_t GetRows() const {
+    return rows_;
+  }
+
+  void Append(uint64_t timestamp, uint64_t parser_id, const std::array<uint64_t, kColumnFieldCount> &fields);
+
+  [[nodiscard]] ColumnChunkView View() const;
+};
+
+// Optional sink that appends all consumed events into per type column chunks that can be
+// queried afterwards or written to a file that can be mapped back via MappedColumnarStore.
+class ColumnarEventStore : public Consumer<std::shared_ptr<Event>> {
+  std::mutex store_mutex_;
+  std::array<std::vector<std::unique_ptr<ColumnChunk>>, kEventTypeCount> chunks_;
+  size_t size_ = 0;
+
+  // NOTE: the lock must be held when calling this method
+  std::vector<ColumnChunkView> GetViews(EventType type);
+
+ public:
+  explicit ColumnarEventStore() = default;
+
+  void Append(const std::shared_ptr<Event> &event);
+
+  concurrencpp::result<void> consume(std::shared_ptr<concurrencpp::executor> executor,
+                                     std::shared_ptr<Event> value) override;
+
+  size_t GetSize();
+
+  size_t Scan(const ColumnQuery &query, const ColumnSelectionCallback &callback);
+
+  size_t Count(const ColumnQuery &query) {
+    return Scan(query, nullptr);
+  }
+
+  void WriteToFile(const std::string &file_path);
+};
+
+// Read only store backed by a file written through ColumnarEventStore::WriteToFile. The
+// columns are not copied, all chunk views point directly into the mapping.
+class MappedColumnarStore {
+  void *mapping_ = nullptr;
+  size_t length_ = 0;
+  size_t size_ = 0;
+  std::array<std::vector<ColumnChunkView>, kEventTypeCount> chunks_;
+
+  void Unmap();
+
+  // unmaps the file before bailing out, used while validating the mapped file
+  void ThrowOnInvalid(bool invalid, const char *message, const source_loc &location);
+
+ public:
+  explicit MappedColumnarStore(const std::string &file_path);
+
+  MappedColumnarStore(const MappedColumnarStore &other) = delete;
+
+  MappedColumnarStore &operator=(const MappedColumnarStore &other) = delete;
+
+  ~MappedColumnarStore();
+
+  [[nodiscard]] inline size_t GetSize() const {
+    return size_;
+  }
+
+  size_t Scan(const ColumnQuery &query, const ColumnSelectionCallback &callback) const;
+
+  size_t Count(const ColumnQuery &query) const {
+    return Scan(query, nullptr);
+  }
+};
+
+#endif // SIMBRICKS_TRACE_COLUMNAR_STORE_H_
@@ -84,6 +84,10 @@ class EventTypeFilter : public EventStreamActor {
         types_to_filter_(types_to_filter),
         inverted_(invert_filter) {
   }
+
+  bool IsCheap() const override {
+    return true;
+  }
 };
 
 class EventTimestampFilter : public EventStreamActor {
@@ -111,6 +115,10 @@ class EventTimestampFilter : public EventStreamActor {
       : EventStreamActor(trace_environment),
         event_time_boundaries_(event_time_boundaries) {
   }
+
+  bool IsCheap() const override {
+    return true;
+  }
 };
 
 class HostCallFuncFilter : public EventStreamActor {
@@ -146,6 +154,10 @@ class HostCallFuncFilter : public EventStreamActor {
       list_.insert(sym);
     }
   }
+
+  bool IsCheap() const override {
+    return true;
+  }
 };
 
 class NS3EventFilter : public EventStreamActor {
@@ -183,6 +195,10 @@ class NS3EventFilter : public EventStreamActor {
   explicit NS3EventFilter(TraceEnvironment &trace_environment,
                           const NodeDeviceFilter &node_device_filter)
       : EventStreamActor(trace_environment), node_device_filter_(node_device_filter) {}
+
+  bool IsCheap() const override {
+    return true;
+  }
 };
 
 #endif // SIMBRICKS_TRACE_EVENT_FILTER_H_
\ No newline at end of file
@@ -22,6 +22,7 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <cstddef>
 #include <iostream>
 #include <unordered_map>
 
@@ -70,6 +71,9 @@ enum EventType {
   kNetworkDropT,
 };
 
+// amount of event types, allows indexing arrays by type; kNetworkDropT must stay the last type
+inline constexpr size_t kEventTypeCount = static_cast<size_t>(EventType::kNetworkDropT) + 1;
+
 inline std::ostream &operator<<(std::ostream &into, EventType type) {
   switch (type) {
     case EventType::kEventT:into << "kEventT";
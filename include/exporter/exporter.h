@@ -27,6 +27,7 @@
 #include <mutex>
 #include <unordered_map>
 #include <map>
+#include <optional>
 #include <cassert>
 
 #include "opentelemetry/sdk/version/version.h"
@@ -101,14 +102,15 @@ class OtlpSpanExporter : public SpanExporter {
   bool batch_mode_ = false;
   std::string lib_name_;
 
+  // both maps forget entries not accessed within the exporter ttl, measured in simulated time by
+  // the starting timestamps of the spans started so far
   using context_t = opentelemetry::trace::SpanContext;
   // mapping old_span_id -> opentelemetry_span_context
-  //LazyTtLMap<uint64_t, context_t, 900> context_map_;
-  std::unordered_map<uint64_t, context_t> context_map_;
+  TtlLruMap<uint64_t, context_t> context_map_;
 
   // mapping: own_span_id -> opentelemetry_span
   using span_t = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>;
-  std::unordered_map<uint64_t, span_t> span_map_;
+  TtlLruMap<uint64_t, span_t> span_map_;
 
   // service/simulator/spanner name -> otlp_exporter
   using tracer_t = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer>;
@@ -124,24 +126,17 @@ class OtlpSpanExporter : public SpanExporter {
                         context_t &context) {
     throw_on_false(TraceEnvironment::IsValidId(span_id),
                    "invalid id", source_loc::current());
-    //const bool suc = context_map_.Insert(span_id, context);
-    const bool suc = context_map_.insert({span_id, context}).second;
+    const bool suc = context_map_.Insert(span_id, context);
     throw_on_false(suc, "InsertNewContext could not insert context into map",
                    source_loc::current());
   }
 
-  opentelemetry::trace::SpanContext
+  // returns an empty optional if the context was forgotten after the exporter ttl
+  std::optional<opentelemetry::trace::SpanContext>
   GetContext(uint64_t span_id) {
     throw_on_false(TraceEnvironment::IsValidId(span_id),
                    "GetContext context_to_get is null", source_loc::current());
-    //auto con_opt = context_map_.Find(span_id);
-    auto con_opt = context_map_.find(span_id);
-    throw_on(con_opt == context_map_.end(), "could not find context for key",
-             source_loc::current());
-    //auto con = OrElseThrow(con_opt, "could not find context for key",
-    //                       source_loc::current());
-    //return con;
-    return con_opt->second;
+    return context_map_.Find(span_id);
   }
 
   void InsertNewSpan(std::shared_ptr<EventSpan> &old_span,
@@ -150,14 +145,14 @@ class OtlpSpanExporter : public SpanExporter {
     throw_on(not new_span, "InsertNewSpan new_span is null", source_loc::current());
 
     const uint64_t span_id = old_span->GetId();
-    auto iter = span_map_.insert({span_id, new_span});
-    throw_on_false(iter.second, "InsertNewSpan could not insert into span map",
+    const bool inserted = span_map_.Insert(span_id, new_span);
+    throw_on_false(inserted, "InsertNewSpan could not insert into span map",
                    source_loc::current());
   }
 
   void RemoveSpan(const std::shared_ptr<EventSpan> &old_span) {
-    const size_t erased = span_map_.erase(old_span->GetId());
-    throw_on(erased != 1, "RemoveSpan did not remove a single span", source_loc::current());
+    const bool erased = span_map_.Remove(old_span->GetId());
+    throw_on(not erased, "RemoveSpan did not remove a single span", source_loc::current());
   }
 
   tracer_t CreateTracer(std::string &service_name) {
@@ -214,12 +209,13 @@ class OtlpSpanExporter : public SpanExporter {
     return tracer;
   }
 
-  span_t GetSpan(std::shared_ptr<EventSpan> &span_to_get) {
+  // returns an empty optional if the span was forgotten after the exporter ttl
+  std::optional<span_t> GetSpan(std::shared_ptr<EventSpan> &span_to_get) {
     throw_if_empty(span_to_get, "GetSpan span_to_get is null", source_loc::current());
 
     const uint64_t span_id = span_to_get->GetId();
-    auto span = span_map_.find(span_id)->second;
-    throw_on(not span, "InsertNewSpan span is null", source_loc::current());
+    auto span = span_map_.Find(span_id);
+    throw_on(span and not *span, "GetSpan span is null", source_loc::current());
     return span;
   }
 
@@ -488,7 +484,11 @@ class OtlpSpanExporter : public SpanExporter {
       const uint64_t parent_id = span->GetValidParentId();
       // Note: lock bust be free
       auto open_context = GetContext(parent_id);
-      span_options.parent = open_context;
+      if (open_context) {
+        span_options.parent = *open_context;
+      } else {
+        spdlog::debug("context of parent {} was forgotten, export span {} without it", parent_id, span->GetId());
+      }
     }
     // Note: lock bust be free
     span_options.start_system_time = ToSystemNanoseconds(span->GetStartingTs());
@@ -538,6 +538,7 @@ class OtlpSpanExporter : public SpanExporter {
     new_span->SetAttribute("driver-receive", BoolToString(old_span->DoesDriverReceive()));
     new_span->SetAttribute("overall-transmit", BoolToString(old_span->IsOverallTx()));
     new_span->SetAttribute("overall-receive", BoolToString(old_span->IsOverallRx()));
+    new_span->SetAttribute("summarised", BoolToString(old_span->IsSummarised()));
     new_span->SetAttribute("fragmented", BoolToString(old_span->IsFragmented()));
     const bool is_copy = old_span->IsCopy();
     new_span->SetAttribute("is-copy", BoolToString(is_copy));
@@ -772,6 +773,25 @@ class OtlpSpanExporter : public SpanExporter {
     }
   }
 
+  // summarised host call spans carry one event per called function next to their kept events
+  void add_CallSummaries(span_t &span, std::shared_ptr<EventSpan> &to_end) {
+    if (to_end->GetType() != kHostCall) {
+      return;
+    }
+    auto summaries = std::static_pointer_cast<HostCallSpan>(to_end)->GetCallSummaries();
+    if (not summaries) {
+      return;
+    }
+    for (const auto &[func, summary] : *summaries) {
+      std::map<std::string, std::string> attributes;
+      attributes.insert({"func", *func});
+      attributes.insert({"count", std::to_string(summary.count_)});
+      attributes.insert({"first-ts", std::to_string(summary.first_ts_)});
+      attributes.insert({"last-ts", std::to_string(summary.last_ts_)});
+      span->AddEvent("HostCallSummary", ToSystemNanoseconds(summary.first_ts_), attributes);
+    }
+  }
+
  public:
   explicit OtlpSpanExporter(TraceEnvironment &trace_environment,
                             const std::string &&url,
@@ -781,7 +801,9 @@ class OtlpSpanExporter : public SpanExporter {
         time_offset_nanosec_(GetNowOffsetNanoseconds()),
         url_(url),
         batch_mode_(batch_mode),
-        lib_name_(lib_name) {
+        lib_name_(lib_name),
+        context_map_(trace_environment.GetConfig().GetExporterTtlPs()),
+        span_map_(trace_environment.GetConfig().GetExporterTtlPs()) {
   }
 
   explicit OtlpSpanExporter(TraceEnvironment &trace_environment,
@@ -792,7 +814,9 @@ class OtlpSpanExporter : public SpanExporter {
         time_offset_nanosec_(GetNowOffsetNanoseconds()),
         url_(url),
         batch_mode_(batch_mode),
-        lib_name_(lib_name) {
+        lib_name_(lib_name),
+        context_map_(trace_environment.GetConfig().GetExporterTtlPs()),
+        span_map_(trace_environment.GetConfig().GetExporterTtlPs()) {
   }
 
   ~OtlpSpanExporter() {
@@ -811,6 +835,10 @@ class OtlpSpanExporter : public SpanExporter {
   }
 
   void StartSpan(std::shared_ptr<EventSpan> to_start) override {
+    const uint64_t starting_ts = to_start->GetStartingTs();
+    context_map_.AdvanceTo(starting_ts);
+    span_map_.AdvanceTo(starting_ts);
+
     auto span_opts = GetSpanStartOpts(to_start);
     auto span_name = GetTypeStr(to_start);
 
@@ -834,10 +862,16 @@ class OtlpSpanExporter : public SpanExporter {
 
   void EndSpan(std::shared_ptr<EventSpan> to_end) override {
     // Note: lock bust be free
-    span_t span = GetSpan(to_end);
+    auto span_opt = GetSpan(to_end);
+    if (not span_opt) {
+      spdlog::debug("span {} was forgotten before it ended", to_end->GetId());
+      return;
+    }
+    span_t span = *span_opt;
     set_Attr(span, to_end);
     // Note: lock bust be free
     add_Events(span, to_end);
+    add_CallSummaries(span, to_end);
     end_span(to_end, span);
     spdlog::debug("ended span");
   }
@@ -25,6 +25,7 @@
 #ifndef SIMBRICKS_TRACE_PARSER_H_
 #define SIMBRICKS_TRACE_PARSER_H_
 
+#include <filesystem>
 #include <functional>
 #include <memory>
 #include <string>
@@ -38,9 +39,11 @@
 #include "sync/corobelt.h"
 #include "events/events.h"
 #include "reader/cReader.h"
+#include "env/checkpoint.h"
 #include "env/traceEnvironment.h"
 #include "analytics/timer.h"
 #include "util/utils.h"
+#include "util/metrics.h"
 #include "events/printer.h"
 
 bool ParseMacAddress(LineHandler &line_handler, NetworkEvent::MacAddress &addr);
@@ -167,7 +170,8 @@ ResetFillBufferTask(//concurrencpp::executor_tag,
     std::shared_ptr<LogParser> log_parser,
     std::shared_ptr<concurrencpp::executor> executor,
     std::shared_ptr<concurrencpp::executor> back,
-    std::shared_ptr<CoroBoundedChannel<std::shared_ptr<Event>>> event_buffer_channel) {
+    std::shared_ptr<CoroSpscChannel<std::shared_ptr<Event>>> event_buffer_channel,
+    std::shared_ptr<InputProgress> progress = nullptr) {
   throw_if_empty(log_parser, "parser is null", source_loc::current());
   throw_if_empty(executor, TraceException::kResumeExecutorNull, source_loc::current());
   throw_if_empty(back, TraceException::kResumeExecutorNull, source_loc::current());
@@ -176,9 +180,10 @@ ResetFillBufferTask(//concurrencpp::executor_tag,
   ReaderBuffer<MultiplePagesBytes(LineBufferSizePages)> line_handler_buffer{name};
 
   if (not line_handler_buffer.IsOpen()) {
-    line_handler_buffer.OpenFile(log_file_path, NamedPipe);
+    line_handler_buffer.OpenFile(log_file_path, NamedPipe, progress ? progress->GetStartOffset() : 0);
   }
 
+  uint64_t events_read = 0;
   std::pair<bool, LineHandler *> bh_p;
 //  for (bh_p = co_await back->submit([&] { return line_handler_buffer.NextHandler(); });
 //       bh_p.first and bh_p.second;
@@ -198,11 +203,17 @@ ResetFillBufferTask(//concurrencpp::executor_tag,
     spdlog::trace("{} parsed another event: {}", name, *event);
 
     throw_if_empty(event, TraceException::kEventIsNull, source_loc::current());
+    if (progress) {
+      progress->OnEventRead(++events_read, event->GetTs(), line_handler_buffer.GetConsumedOffset());
+    }
 //    event_buffer_channel->PokeAwaiters();
     co_await event_buffer_channel->Push(executor, std::move(event));
 //    event_buffer_channel->PokeAwaiters();
   }
 
+  if (progress) {
+    progress->OnInputDone(events_read, line_handler_buffer.GetConsumedOffset());
+  }
   co_await event_buffer_channel->CloseChannel(executor);
   co_return;
 }
@@ -217,8 +228,10 @@ class BufferedEventProvider : public Producer<std::shared_ptr<Event>> {
   std::shared_ptr<concurrencpp::executor> background_exec_;
   concurrencpp::result<void> fill_buffer_task_;
   bool started_fill_task_ = false;
-  std::shared_ptr<CoroBoundedChannel<std::shared_ptr<Event>>> event_buffer_channel_;
+  std::shared_ptr<CoroSpscChannel<std::shared_ptr<Event>>> event_buffer_channel_;
   ReaderBuffer<MultiplePagesBytes(LineBufferSizePages)> line_handler_buffer_;
+  std::shared_ptr<MetricCounter> events_produced_ = nullptr;
+  std::shared_ptr<InputProgress> progress_ = nullptr;
 
  public:
   explicit BufferedEventProvider(TraceEnvironment &trace_environment,
@@ -232,9 +245,24 @@ class BufferedEventProvider : public Producer<std::shared_ptr<Event>> {
         log_parser_(std::move(log_parser)),
         background_exec_(trace_environment_.GetBackgroundPoolExecutor()),
         line_handler_buffer_(name) {
-    event_buffer_channel_ = create_shared<CoroBoundedChannel<std::shared_ptr<Event>>>(
+    const TraceEnvConfig config = trace_environment_.GetConfig();
+    event_buffer_channel_ = create_shared<CoroSpscChannel<std::shared_ptr<Event>>>(
         TraceException::kChannelIsNull,
-        trace_environment_.GetConfig().GetEventBufferSize());
+        config.GetChannelCapacity(name_, config.GetEventBufferSize()));
+    if (config.IsMetricsEnabled()) {
+      events_produced_ = trace_environment_.GetMetrics().GetCounter(
+          "columbo_provider_events_total", "Events parsed and handed to the pipeline.", {{"provider", name_}});
+    }
+    if (config.IsCheckpointingEnabled()) {
+      if constexpr (NamedPipe) {
+        // a pipe cannot be read again from an offset, its progress is therefore not checkpointed
+        throw_on(trace_environment_.GetCheckpoints().GetResumedFrom().has_value(),
+                 "BufferedEventProvider: cannot resume reading a named pipe from a checkpoint",
+                 source_loc::current());
+      } else {
+        progress_ = trace_environment_.GetCheckpoints().RegisterInput(name_);
+      }
+    }
   };
 
   ~BufferedEventProvider() = default;
@@ -242,22 +270,43 @@ class BufferedEventProvider : public Producer<std::shared_ptr<Event>> {
   concurrencpp::result<std::optional<std::shared_ptr<Event>>>
   produce(std::shared_ptr<concurrencpp::executor> executor) override {
     if (not started_fill_task_) {
-      auto te = trace_environment_.GetWorkerThreadExecutor();
+      // NOTE: reading a named pipe blocks the thread until the simulator writes, such a
+      // reader must therefore not share its thread with other stages
+      auto te = NamedPipe ? trace_environment_.GetDedicatedWorkerThreadExecutor(name_ + ".fill")
+                          : trace_environment_.GetStageExecutor(name_ + ".fill");
       te->post(std::bind(ResetFillBufferTask<NamedPipe, LineBufferSizePages>,
                          name_,
                          log_file_path_,
                          log_parser_,
                          te,
                          te,
-                         event_buffer_channel_));
+                         event_buffer_channel_,
+                         progress_));
       started_fill_task_ = true;
     }
 
     std::optional<std::shared_ptr<Event>> event = co_await event_buffer_channel_->Pop(executor);
+    if (event.has_value()) {
+      if (events_produced_) {
+        events_produced_->Increment();
+      }
+      if (progress_) {
+        progress_->OnEventConsumed();
+      }
+    }
 //    event_buffer_channel_->PokeAwaiters();
     co_return event;
   }
 
+  // only a named pipe waits for the simulator, a regular file is read on by the fill task
+  // without outside help, hence holding back a partial batch cannot stall the pipeline
+  bool WouldBlock() override {
+    if constexpr (NamedPipe) {
+      return started_fill_task_ and event_buffer_channel_->WouldPopSuspend();
+    }
+    return false;
+  }
+
 //  concurrencpp::result<std::optional<std::shared_ptr<Event>>>
 //  produce(std::shared_ptr<concurrencpp::executor> executor) override {
 //
@@ -287,4 +336,22 @@ class BufferedEventProvider : public Producer<std::shared_ptr<Event>> {
 //  }
 };
 
+// creates a provider for the given log, named pipes are read as such while regular files can
+// be resumed from a checkpoint
+template<size_t LineBufferSizePages = 16>
+inline std::shared_ptr<Producer<std::shared_ptr<Event>>> CreateBufferedEventProvider(
+    TraceEnvironment &trace_environment,
+    const std::string &name,
+    const std::string &log_file_path,
+    std::shared_ptr<LogParser> log_parser) {
+  if (std::filesystem::is_fifo(log_file_path)) {
+    return create_shared<BufferedEventProvider<true, LineBufferSizePages>>(
+        TraceException::kBufferedEventProviderIsNull, trace_environment, name, log_file_path,
+        std::move(log_parser));
+  }
+  return create_shared<BufferedEventProvider<false, LineBufferSizePages>>(
+      TraceException::kBufferedEventProviderIsNull, trace_environment, name, log_file_path,
+      std::move(log_parser));
+}
+
 #endif  // SIMBRICKS_TRACE_PARSER_H_
\ No newline at end of file
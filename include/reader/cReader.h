@@ -26,12 +26,14 @@
 #include "util/exception.h"
 #include "util/string_util.h"
 
+#include <algorithm>
 #include <string>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <utility>
 #include <fcntl.h>
+#include <unistd.h>
 
 #ifndef SIMBRICKS_TRACE_CREADER_H_
 #define SIMBRICKS_TRACE_CREADER_H_
@@ -126,6 +128,8 @@ class ReaderBuffer {
   size_t cur_reading_pos_ = 0;
   size_t size_ = 0;
   size_t next_line_end_ = 0;
+  // byte offset within the file of the first byte in the buffer
+  uint64_t buffer_offset_ = 0;
   int reached_eof_ = 2;
   LineHandler line_handler_{buffer_, 0};
 
@@ -153,6 +157,7 @@ class ReaderBuffer {
     if (cur_reading_pos_ != size_) {
       memmove(buffer_, buffer_ + cur_reading_pos_, size_ - cur_reading_pos_);
     }
+    buffer_offset_ += cur_reading_pos_;
 
     size_ = size_ - cur_reading_pos_;
     size_t amount_to_read = BlockSize - size_;
@@ -279,7 +284,15 @@ class ReaderBuffer {
     return {true, &line_handler_};
   }
 
-  void OpenFile(const std::string &file_path, bool is_named_pipe = false) {
+  // byte offset within the file behind the last line handed out, reading the file from this
+  // offset on yields the lines not handed out yet
+  [[nodiscard]] inline uint64_t GetConsumedOffset() const {
+    return buffer_offset_ + std::min(cur_reading_pos_, size_);
+  }
+
+  // opens the file and starts reading at the given byte offset, which must be the start of a
+  // line; named pipes cannot be positioned and are always read from their current position
+  void OpenFile(const std::string &file_path, bool is_named_pipe = false, uint64_t offset = 0) {
     cur_file_path_ = file_path;
     if (!std::filesystem::exists(file_path)) {
       throw_just(source_loc::current(),
@@ -305,6 +318,14 @@ class ReaderBuffer {
       } else {
         spdlog::debug("ReaderBuffer: changed size successfully");
       }
+      if (offset > 0) {
+        spdlog::warn("ReaderBuffer: cannot start reading named pipe '{}' at offset {}", file_path, offset);
+      }
+    } else if (offset > 0) {
+      const int file_descriptor = GetValidFileDescriptorCurFile();
+      throw_on(lseek(file_descriptor, static_cast<off_t>(offset), SEEK_SET) < 0,
+               "ReaderBuffer: could not seek to offset", source_loc::current());
+      buffer_offset_ = offset;
     }
     spdlog::debug("successfully opened file path: {}", file_path);
   }
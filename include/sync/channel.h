@@ -27,31 +27,213 @@
 #include <concurrencpp/threads/async_lock.h>
 #include <concurrencpp/concurrencpp.h>
 
-#include <list>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <functional>
+#include <limits>
+#include <span>
+#include <thread>
+#include <type_traits>
 
+#include "sync/channelMetrics.h"
 #include "util/exception.h"
+#include "util/factory.h"
+#include "util/hazardPointers.h"
+#include "util/segmentedDeque.h"
 #include "util/utils.h"
 #include "util/concepts.h"
 
 #ifndef SIMBRICKS_TRACE_INCLUDE_SYNC_CHANNEL_H_
 #define SIMBRICKS_TRACE_INCLUDE_SYNC_CHANNEL_H_
 
+// how a non coroutine channel waits for free slots or values
+enum class NonCoroWaitStrategy {
+  // block on the condition variable (i.e. a futex) right away
+  kBlock,
+  // spin for a short while without holding the lock before blocking, trades cpu time for
+  // latency when the other side is expected to make progress soon
+  kSpinThenBlock
+};
+
+inline constexpr size_t kNonCoroSpinIterations = 2048;
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
 template<typename ValueType>
 class NonCoroChannel {
  protected:
   std::mutex chan_numtex_;
-  std::condition_variable chan_cond_var_;
+
+  // threads blocked on one side of the channel, notified_ counts those that were already
+  // notified but did not run yet and hence must not be notified a second time
+  struct WaitQueue {
+    std::condition_variable cond_var_;
+    size_t waiting_ = 0;
+    size_t notified_ = 0;
+  };
+
+  // producers wait for free slots and consumers for values, each side has its own queue
+  // such that an operation only wakes threads that can make progress afterwards
+  WaitQueue producers_;
+  WaitQueue consumers_;
 
   bool closed_ = false;
   bool poisened_ = false;
   size_t size_ = 0;
 
+  NonCoroWaitStrategy wait_strategy_ = NonCoroWaitStrategy::kBlock;
+  // bumped on every state change when spinning is enabled, spinning waiters watch it
+  // instead of the lock protected state
+  std::atomic<uint64_t> version_{0};
+
+  std::shared_ptr<ChannelMetrics> metrics_ = nullptr;
+
+  struct Wakeups {
+    bool producer_ = false;
+    bool consumer_ = false;
+  };
+
+  inline void RecordPush(size_t amount, size_t occupancy) {
+    MarkChanged();
+    if (metrics_) [[unlikely]] {
+      metrics_->OnPush(amount, occupancy);
+    }
+  }
+
+  inline void RecordPop(size_t amount) {
+    MarkChanged();
+    if (metrics_) [[unlikely]] {
+      metrics_->OnPop(amount);
+    }
+  }
+
+  // NOTE: the lock must be held when calling this method
+  inline void MarkChanged() {
+    if (wait_strategy_ == NonCoroWaitStrategy::kSpinThenBlock) {
+      version_.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  // NOTE: the lock must be held when calling this method
+  static inline bool Claim(WaitQueue &queue, bool wake) {
+    if (not wake or queue.waiting_ <= queue.notified_) {
+      return false;
+    }
+    ++queue.notified_;
+    return true;
+  }
+
+  // Decides which side to wake after an operation. Consumers shall only be woken when values
+  // became available (empty -> non-empty) or are still available after a consumer took some,
+  // which passes the baton on to the next waiting consumer; producers likewise for free slots.
+  // NOTE: the lock must be held when calling this method
+  inline Wakeups DecideWakeups(bool wake_consumer, bool wake_producer) {
+    return Wakeups{Claim(producers_, wake_producer), Claim(consumers_, wake_consumer)};
+  }
+
+  // NOTE: the lock should be released before calling this method
+  inline void Notify(Wakeups wakeups) {
+    if (wakeups.producer_) {
+      producers_.cond_var_.notify_one();
+    }
+    if (wakeups.consumer_) {
+      consumers_.cond_var_.notify_one();
+    }
+  }
+
+  inline void NotifyAll() {
+    producers_.cond_var_.notify_all();
+    consumers_.cond_var_.notify_all();
+  }
+
+  // spins without holding the lock until the channel changed and the predicate holds or
+  // until the spin budget is used up; returns whether the predicate holds
+  // NOTE: the lock must be held when calling this method, it is held again on return
+  template<typename PredicateT>
+  bool SpinWait(std::unique_lock<std::mutex> &lock, PredicateT &predicate) {
+    size_t budget = kNonCoroSpinIterations;
+    while (budget > 0) {
+      const uint64_t seen = version_.load(std::memory_order_acquire);
+      lock.unlock();
+      while (budget > 0 and version_.load(std::memory_order_acquire) == seen) {
+        CpuRelax();
+        --budget;
+      }
+      lock.lock();
+      if (predicate()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // waits till the predicate holds on the condition variable of the given side, if metrics
+  // are enabled the time spent blocked is accounted to that side
+  // NOTE: the lock must be held when calling this method
+  template<typename PredicateT>
+  void WaitCondition(std::unique_lock<std::mutex> &lock, PredicateT predicate, ChannelSide side) {
+    if (predicate()) {
+      return;
+    }
+    const auto start = metrics_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+    if (wait_strategy_ != NonCoroWaitStrategy::kSpinThenBlock or not SpinWait(lock, predicate)) {
+      WaitQueue &queue = side == ChannelSide::kProducer ? producers_ : consumers_;
+      ++queue.waiting_;
+      for (bool ready = false; not ready;) {
+        queue.cond_var_.wait(lock);
+        if (queue.notified_ > 0) {
+          --queue.notified_;
+        }
+        ready = predicate();
+        if (metrics_) [[unlikely]] {
+          metrics_->OnWakeup(not ready);
+        }
+      }
+      --queue.waiting_;
+      queue.notified_ = std::min(queue.notified_, queue.waiting_);
+    }
+
+    if (metrics_) [[unlikely]] {
+      metrics_->OnBlocked(side, std::chrono::steady_clock::now() - start);
+    }
+  }
+
  public:
   explicit NonCoroChannel() = default;
 
+  // NOTE: metrics must be enabled before the channel is used by multiple threads
+  void EnableMetrics(std::shared_ptr<ChannelMetrics> metrics) {
+    throw_if_empty(metrics, "channel metrics are null", source_loc::current());
+    metrics_ = std::move(metrics);
+  }
+
+  const std::shared_ptr<ChannelMetrics> &GetMetrics() const {
+    return metrics_;
+  }
+
+  // NOTE: the wait strategy must be set before the channel is used by multiple threads
+  void SetWaitStrategy(NonCoroWaitStrategy strategy) {
+    // spinning only pays off if the other side can make progress on another core meanwhile
+    const bool single_core = std::thread::hardware_concurrency() < 2;
+    wait_strategy_ = single_core ? NonCoroWaitStrategy::kBlock : strategy;
+  }
+
   NonCoroChannel(const NonCoroChannel<ValueType> &) = delete;
 
   NonCoroChannel(NonCoroChannel<ValueType>
@@ -75,16 +257,18 @@ class NonCoroChannel {
     {
       std::lock_guard<std::mutex> guard{chan_numtex_};
       closed_ = true;
+      MarkChanged();
     }
-    chan_cond_var_.notify_all();
+    NotifyAll();
   }
 
   void PoisenChannel() {
     {
       std::lock_guard<std::mutex> guard{chan_numtex_};
       poisened_ = true;
+      MarkChanged();
     }
-    chan_cond_var_.notify_all();
+    NotifyAll();
   }
 
   virtual bool Push(ValueType value) {
@@ -106,6 +290,45 @@ class NonCoroChannel {
   virtual std::optional<ValueType> TryPopOnTrue(std::function<bool(ValueType &)> &predicate) {
     return std::nullopt;
   }
+
+  // Batch operations, the defaults fall back to the single element operations. Channels
+  // override them to move a whole batch under one lock acquisition and with one wakeup.
+
+  // moves the values into the channel, blocks until all were pushed; returns the amount
+  // of pushed values which is only smaller than values.size() if the channel was closed
+  virtual size_t PushBatch(std::span<ValueType> values) {
+    size_t pushed = 0;
+    for (ValueType &value : values) {
+      if (not Push(std::move(value))) {
+        break;
+      }
+      ++pushed;
+    }
+    return pushed;
+  }
+
+  // blocks till at least one value is available and appends up to max values to out;
+  // returns 0 in case the channel is poisened or closed and empty
+  virtual size_t PopBatch(std::vector<ValueType> &out, size_t max) {
+    size_t popped = 0;
+    for (std::optional<ValueType> value = max > 0 ? Pop() : std::nullopt; value.has_value();
+         value = popped < max ? TryPop() : std::nullopt) {
+      out.push_back(std::move(*value));
+      ++popped;
+    }
+    return popped;
+  }
+
+  // appends up to max values to out without blocking
+  virtual size_t TryPopBatch(std::vector<ValueType> &out, size_t max) {
+    size_t popped = 0;
+    for (std::optional<ValueType> value = max > 0 ? TryPop() : std::nullopt; value.has_value();
+         value = popped < max ? TryPop() : std::nullopt) {
+      out.push_back(std::move(*value));
+      ++popped;
+    }
+    return popped;
+  }
 };
 
 template<typename ValueType>
@@ -134,6 +357,7 @@ class NonCoroChannelSink : public NonCoroChannel<ValueType> {
 
 template<typename ValueType>
 class NonCoroBufferedChannel : public NonCoroChannel<ValueType> {
+  using Wakeups = typename NonCoroChannel<ValueType>::Wakeups;
 
   const size_t capacity_;
   std::vector<ValueType> buffer_;
@@ -148,6 +372,7 @@ class NonCoroBufferedChannel : public NonCoroChannel<ValueType> {
     buffer_[write_index_] = std::move(value);
     write_index_ = (write_index_ + 1) % capacity_;
     ++(this->size_);
+    this->RecordPush(1, this->size_);
   }
 
   // NOTE: the lock must be held when calling this method
@@ -158,12 +383,13 @@ class NonCoroBufferedChannel : public NonCoroChannel<ValueType> {
     auto result = std::move(buffer_[read_index_]);
     read_index_ = (read_index_ + 1) % capacity_;
     --(this->size_);
+    this->RecordPop(1);
     return std::move(result);
   }
 
  public:
   explicit NonCoroBufferedChannel(size_t capacity) : NonCoroChannel<ValueType>(), capacity_(capacity) {
-    buffer_.reserve(capacity);
+    buffer_.resize(capacity);
   };
 
   NonCoroBufferedChannel(const NonCoroBufferedChannel<ValueType> &) = delete;
@@ -178,28 +404,30 @@ class NonCoroBufferedChannel : public NonCoroChannel<ValueType> {
 
   // returns false if channel is closed or poisened
   bool Push(ValueType value) {
+    Wakeups wakeups;
     {
       std::unique_lock lock{this->chan_numtex_};
-      this->chan_cond_var_.wait(lock, [this] {
+      this->WaitCondition(lock, [this] {
         return this->closed_ or this->poisened_ or this->size_ < this->capacity_;
-      });
+      }, ChannelSide::kProducer);
       if (this->closed_ or this->poisened_) {
-        lock.unlock();
-        this->chan_cond_var_.notify_all();
         return false;
       }
       assert(not this->closed_ and "channel should not be closed here");
       assert(not this->poisened_ and "channel should not be poisened here");
 
+      const bool was_empty = this->size_ == 0;
       perform_write(std::move(value));
+      wakeups = this->DecideWakeups(was_empty, this->size_ < capacity_);
     }
 
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
     return true;
   }
 
   // returns false if channel is closed or poisened
   bool TryPush(ValueType value) {
+    Wakeups wakeups;
     {
       std::unique_lock lock{this->chan_numtex_};
       if (this->closed_ or this->poisened_ or this->size_ >= this->capacity_) {
@@ -207,44 +435,118 @@ class NonCoroBufferedChannel : public NonCoroChannel<ValueType> {
       }
       assert(not this->closed_ and "channel should not be closed here");
       assert(not this->poisened_ and "channel should not be poisened here");
+      const bool was_empty = this->size_ == 0;
       perform_write(std::move(value));
+      wakeups = this->DecideWakeups(was_empty, this->size_ < capacity_);
     }
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
     return true;
   }
 
   // returns empty optional in case channel is poisened or empty
   std::optional<ValueType> Pop() {
     std::unique_lock lock{this->chan_numtex_};
-    this->chan_cond_var_.wait(lock, [this] {
+    this->WaitCondition(lock, [this] {
       return this->poisened_ || this->closed_ || this->size_ > 0;
-    });
+    }, ChannelSide::kConsumer);
     if (this->poisened_) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return std::nullopt;
     }
     assert(not this->poisened_ and "channel should not be poisened here");
     if (this->size_ == 0) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return std::nullopt;
     }
     assert(this->size_ > 0 and "trying to read from empty channel");
+    const bool was_full = this->size_ == capacity_;
     auto result = std::move(perform_read());
+    const Wakeups wakeups = this->DecideWakeups(this->size_ > 0, was_full);
     lock.unlock();
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
     return std::move(result);
   }
 
+  // returns the amount of pushed values, less than values.size() if the channel was closed
+  size_t PushBatch(std::span<ValueType> values) override {
+    size_t pushed = 0;
+    std::unique_lock lock{this->chan_numtex_};
+    while (pushed < values.size()) {
+      this->WaitCondition(lock, [this] {
+        return this->closed_ or this->poisened_ or this->size_ < this->capacity_;
+      }, ChannelSide::kProducer);
+      if (this->closed_ or this->poisened_) {
+        break;
+      }
+      const bool was_empty = this->size_ == 0;
+      while (pushed < values.size() and this->size_ < capacity_) {
+        perform_write(std::move(values[pushed]));
+        ++pushed;
+      }
+      if (pushed < values.size()) {
+        // the buffer is full again, wake the readers before waiting for free slots
+        const Wakeups wakeups = this->DecideWakeups(was_empty, false);
+        lock.unlock();
+        this->Notify(wakeups);
+        lock.lock();
+      } else {
+        const Wakeups wakeups = this->DecideWakeups(was_empty, this->size_ < capacity_);
+        lock.unlock();
+        this->Notify(wakeups);
+        return pushed;
+      }
+    }
+    return pushed;
+  }
+
+  // returns 0 in case channel is poisened or closed and empty
+  size_t PopBatch(std::vector<ValueType> &out, size_t max) override {
+    std::unique_lock lock{this->chan_numtex_};
+    this->WaitCondition(lock, [this] {
+      return this->poisened_ || this->closed_ || this->size_ > 0;
+    }, ChannelSide::kConsumer);
+    if (this->poisened_) {
+      return 0;
+    }
+    const bool was_full = this->size_ == capacity_;
+    size_t popped = 0;
+    while (popped < max and this->size_ > 0) {
+      out.push_back(perform_read());
+      ++popped;
+    }
+    if (popped == 0) {
+      return 0;
+    }
+    const Wakeups wakeups = this->DecideWakeups(this->size_ > 0, was_full);
+    lock.unlock();
+    this->Notify(wakeups);
+    return popped;
+  }
+
+  size_t TryPopBatch(std::vector<ValueType> &out, size_t max) override {
+    std::unique_lock lock{this->chan_numtex_};
+    if (this->poisened_) {
+      return 0;
+    }
+    const bool was_full = this->size_ == capacity_;
+    size_t popped = 0;
+    while (popped < max and this->size_ > 0) {
+      out.push_back(perform_read());
+      ++popped;
+    }
+    if (popped == 0) {
+      return 0;
+    }
+    const Wakeups wakeups = this->DecideWakeups(this->size_ > 0, was_full);
+    lock.unlock();
+    this->Notify(wakeups);
+    return popped;
+  }
+
   bool WaitTillValue() {
     std::unique_lock lock{this->chan_numtex_};
-    this->chan_cond_var_.wait(lock, [this] {
+    this->WaitCondition(lock, [this] {
       return this->poisened_ || this->closed_ || this->size_ > 0;
-    });
+    }, ChannelSide::kConsumer);
     if (this->poisened_) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return false; // when poisoned we do not want to read anymore...
     }
     assert(not this->poisened_ and "channel should not be poisened here");
@@ -254,21 +556,19 @@ class NonCoroBufferedChannel : public NonCoroChannel<ValueType> {
   std::optional<ValueType> TryPop() {
     std::unique_lock lock{this->chan_numtex_};
     if (this->poisened_ or this->size_ == 0) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return std::nullopt;
     }
+    const bool was_full = this->size_ == capacity_;
     auto result = std::move(perform_read());
+    const Wakeups wakeups = this->DecideWakeups(this->size_ > 0, was_full);
     lock.unlock();
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
     return std::move(result);
   }
 
   std::optional<ValueType> TryPopOnTrue(std::function<bool(ValueType &)> &predicate) {
     std::unique_lock lock{this->chan_numtex_};
     if (this->poisened_ or this->size_ == 0) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return std::nullopt;
     }
     assert(read_index_ < capacity_ and "cannot read out of bound");
@@ -277,17 +577,20 @@ class NonCoroBufferedChannel : public NonCoroChannel<ValueType> {
     if (not predicate(value)) {
       return std::nullopt;
     }
+    const bool was_full = this->size_ == capacity_;
     auto result = std::move(perform_read());
+    const Wakeups wakeups = this->DecideWakeups(this->size_ > 0, was_full);
     lock.unlock();
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
     return std::move(result);
   }
 };
 
 template<typename ValueType>
 class NonCoroUnBufferedChannel : public NonCoroChannel<ValueType> {
+  using Wakeups = typename NonCoroChannel<ValueType>::Wakeups;
 
-  std::list<ValueType> buffer_;
+  SegmentedDeque<ValueType> buffer_;
 
  public:
 
@@ -305,21 +608,23 @@ class NonCoroUnBufferedChannel : public NonCoroChannel<ValueType> {
 
   // returns false if channel is closed or poisened
   bool Push(ValueType value) {
+    Wakeups wakeups;
     {
       std::unique_lock lock{this->chan_numtex_};
       if (this->closed_ or this->poisened_) {
-        lock.unlock();
-        this->chan_cond_var_.notify_all();
         return false;
       }
       assert(not this->closed_ and "channel should not be closed here");
       assert(not this->poisened_ and "channel should not be poisened here");
 
-      buffer_.push_back(std::move(value));
+      const bool was_empty = this->size_ == 0;
+      buffer_.PushBack(std::move(value));
       ++(this->size_);
+      this->RecordPush(1, this->size_);
+      wakeups = this->DecideWakeups(was_empty, false);
     }
 
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
     return true;
   }
 
@@ -332,30 +637,28 @@ class NonCoroUnBufferedChannel : public NonCoroChannel<ValueType> {
   std::optional<ValueType> Pop() {
     std::unique_lock lock{this->chan_numtex_};
 
-    this->chan_cond_var_.wait(lock, [this] {
+    this->WaitCondition(lock, [this] {
       return this->poisened_ || this->closed_ || this->size_ > 0;
-    });
+    }, ChannelSide::kConsumer);
 
     if (this->poisened_) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return std::nullopt;
     }
 
     assert(not this->poisened_ and "channel should not be poisened here");
     if (this->size_ == 0) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return std::nullopt;
     }
 
     assert(this->size_ > 0 and "trying to read from empty channel");
-    auto result = std::move(buffer_.front());
-    buffer_.pop_front();
+    auto result = std::move(buffer_.Front());
+    buffer_.PopFront();
     --(this->size_);
+    this->RecordPop(1);
+    const Wakeups wakeups = this->DecideWakeups(this->size_ > 0, false);
 
     lock.unlock();
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
 
     return std::move(result);
   }
@@ -364,17 +667,17 @@ class NonCoroUnBufferedChannel : public NonCoroChannel<ValueType> {
     std::unique_lock lock{this->chan_numtex_};
 
     if (this->poisened_ or this->size_ == 0) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return std::nullopt;
     }
 
-    auto result = std::move(buffer_.front());
-    buffer_.pop_front();
+    auto result = std::move(buffer_.Front());
+    buffer_.PopFront();
     --(this->size_);
+    this->RecordPop(1);
+    const Wakeups wakeups = this->DecideWakeups(this->size_ > 0, false);
 
     lock.unlock();
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
 
     return std::move(result);
   }
@@ -383,22 +686,22 @@ class NonCoroUnBufferedChannel : public NonCoroChannel<ValueType> {
     std::unique_lock lock{this->chan_numtex_};
 
     if (this->poisened_ or this->size_ == 0) {
-      lock.unlock();
-      this->chan_cond_var_.notify_all();
       return std::nullopt;
     }
 
-    ValueType &value = buffer_.front();
+    ValueType &value = buffer_.Front();
     if (not predicate(value)) {
       return std::nullopt;
     }
 
-    auto result = std::move(buffer_.front());
-    buffer_.pop_front();
+    auto result = std::move(buffer_.Front());
+    buffer_.PopFront();
     --(this->size_);
+    this->RecordPop(1);
+    const Wakeups wakeups = this->DecideWakeups(this->size_ > 0, false);
 
     lock.unlock();
-    this->chan_cond_var_.notify_all();
+    this->Notify(wakeups);
 
     return std::move(result);
   }
@@ -414,9 +717,57 @@ class CoroChannel {
   bool closed_ = false;
   bool poisened_ = false;
 
+  std::shared_ptr<ChannelMetrics> metrics_ = nullptr;
+
+  inline void RecordPush(size_t amount, size_t occupancy) {
+    if (metrics_) [[unlikely]] {
+      metrics_->OnPush(amount, occupancy);
+    }
+  }
+
+  inline void RecordPop(size_t amount) {
+    if (metrics_) [[unlikely]] {
+      metrics_->OnPop(amount);
+    }
+  }
+
+  template<typename PredicateT>
+  concurrencpp::lazy_result<void> TimedAwait(std::shared_ptr<concurrencpp::executor> resume_executor,
+                                             concurrencpp::scoped_async_lock &guard,
+                                             PredicateT predicate,
+                                             ChannelSide side) {
+    const auto start = std::chrono::steady_clock::now();
+    co_await channel_cv_.await(resume_executor, guard, std::move(predicate));
+    metrics_->OnBlocked(side, std::chrono::steady_clock::now() - start);
+  }
+
+  // suspends on channel_cv_ till the predicate holds, if metrics are enabled the time
+  // spent suspended is accounted to the given side of the channel
+  // NOTE: the lock must be held when calling this method
+  template<typename PredicateT>
+  concurrencpp::lazy_result<void> AwaitCondition(std::shared_ptr<concurrencpp::executor> resume_executor,
+                                                 concurrencpp::scoped_async_lock &guard,
+                                                 PredicateT predicate,
+                                                 ChannelSide side) {
+    if (not metrics_ or predicate()) {
+      return channel_cv_.await(std::move(resume_executor), guard, std::move(predicate));
+    }
+    return TimedAwait(std::move(resume_executor), guard, std::move(predicate), side);
+  }
+
  public:
   explicit CoroChannel() = default;
 
+  // NOTE: metrics must be enabled before the channel is used by multiple tasks
+  void EnableMetrics(std::shared_ptr<ChannelMetrics> metrics) {
+    throw_if_empty(metrics, "channel metrics are null", source_loc::current());
+    metrics_ = std::move(metrics);
+  }
+
+  const std::shared_ptr<ChannelMetrics> &GetMetrics() const {
+    return metrics_;
+  }
+
   CoroChannel(const CoroChannel<ValueType> &) = delete;
 
   CoroChannel(CoroChannel<ValueType> &&) = delete;
@@ -425,14 +776,14 @@ class CoroChannel {
 
   CoroChannel<ValueType> &operator=(CoroChannel<ValueType> &&) noexcept = delete;
 
-  concurrencpp::result<bool> Empty(
+  virtual concurrencpp::result<bool> Empty(
       std::shared_ptr<concurrencpp::executor> resume_executor) {
     concurrencpp::scoped_async_lock guard =
         co_await channel_lock_.lock(resume_executor);
     co_return size_ == 0;
   }
 
-  concurrencpp::result<size_t> GetSize(
+  virtual concurrencpp::result<size_t> GetSize(
       std::shared_ptr<concurrencpp::executor> resume_executor) {
     concurrencpp::scoped_async_lock guard =
         co_await channel_lock_.lock(resume_executor);
@@ -447,7 +798,7 @@ class CoroChannel {
     co_return;
   }
 
-  concurrencpp::result<void> CloseChannel(
+  virtual concurrencpp::result<void> CloseChannel(
       std::shared_ptr<concurrencpp::executor> resume_executor) {
     throw_if_empty<concurrencpp::executor>(resume_executor,
                                            TraceException::kResumeExecutorNull,
@@ -461,7 +812,7 @@ class CoroChannel {
     channel_cv_.notify_all();
   }
 
-  concurrencpp::result<void> PoisenChannel(
+  virtual concurrencpp::result<void> PoisenChannel(
       std::shared_ptr<concurrencpp::executor> resume_executor) {
     throw_if_empty<concurrencpp::executor>(resume_executor,
                                            TraceException::kResumeExecutorNull,
@@ -502,6 +853,58 @@ class CoroChannel {
       std::function<bool(ValueType &)> &predicate) {
     co_return std::nullopt;
   }
+
+  // Batch operations, the defaults fall back to the single element operations. Channels
+  // override them to move a whole batch under one lock acquisition and with one wakeup.
+
+  // moves the values into the channel, suspends until all were pushed; returns the amount
+  // of pushed values which is only smaller than values.size() if the channel was closed
+  virtual concurrencpp::lazy_result<size_t> PushBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::span<ValueType> values) {
+    size_t pushed = 0;
+    for (ValueType &value : values) {
+      if (not co_await Push(resume_executor, std::move(value))) {
+        break;
+      }
+      ++pushed;
+    }
+    co_return pushed;
+  }
+
+  // suspends till at least one value is available and appends up to max values to out;
+  // returns 0 in case the channel is poisened or closed and empty
+  virtual concurrencpp::lazy_result<size_t> PopBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::vector<ValueType> &out,
+      size_t max) {
+    if (max == 0) {
+      co_return 0;
+    }
+    std::optional<ValueType> value = co_await Pop(resume_executor);
+    if (not value.has_value()) {
+      co_return 0;
+    }
+    out.push_back(std::move(*value));
+    co_return 1 + co_await TryPopBatch(resume_executor, out, max - 1);
+  }
+
+  // appends up to max values to out without suspending for new values
+  virtual concurrencpp::lazy_result<size_t> TryPopBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::vector<ValueType> &out,
+      size_t max) {
+    size_t popped = 0;
+    while (popped < max) {
+      std::optional<ValueType> value = co_await TryPop(resume_executor);
+      if (not value.has_value()) {
+        break;
+      }
+      out.push_back(std::move(*value));
+      ++popped;
+    }
+    co_return popped;
+  }
 };
 
 template<typename ValueType>
@@ -531,15 +934,125 @@ class CoroChannelSink : public CoroChannel<ValueType> {
   }
 };
 
+// Pool of buffer slots shared by adaptive channels. A channel acquires slots from the budget
+// when it grows beyond its initial capacity and hands them back when shrinking again.
+class ChannelCapacityBudget {
+  std::atomic<size_t> available_;
+
+ public:
+  explicit ChannelCapacityBudget(size_t slots) : available_(slots) {
+  }
+
+  bool TryAcquire(size_t slots) {
+    size_t available = available_.load(std::memory_order_relaxed);
+    do {
+      if (available < slots) {
+        return false;
+      }
+    } while (not available_.compare_exchange_weak(available, available - slots, std::memory_order_relaxed));
+    return true;
+  }
+
+  void Release(size_t slots) {
+    available_.fetch_add(slots, std::memory_order_relaxed);
+  }
+
+  size_t GetAvailable() const {
+    return available_.load(std::memory_order_relaxed);
+  }
+};
+
+// a full adaptive channel only grows once its producer was blocked at least this long
+inline constexpr std::chrono::microseconds kAdaptiveGrowBlockedTime{500};
+// an adaptive channel evaluates shrinking after capacity * kAdaptiveWindowFactor pushes
+inline constexpr size_t kAdaptiveWindowFactor = 4;
+
 template<typename ValueType>
 class CoroBoundedChannel : public CoroChannel<ValueType> {
 
  private:
-  const size_t capacity_;
+  size_t capacity_;
   std::vector<ValueType> buffer_;
   size_t read_index_ = 0;
   size_t write_index_ = 0;
 
+  // adaptive sizing, only active in case a budget was given
+  std::shared_ptr<ChannelCapacityBudget> budget_ = nullptr;
+  const size_t min_capacity_;
+  const size_t max_capacity_;
+  std::chrono::nanoseconds window_blocked_{0};
+  size_t window_pushes_ = 0;
+  size_t window_high_water_mark_ = 0;
+
+  // NOTE: the lock must be held when calling this method
+  void Resize(size_t new_capacity) {
+    assert(new_capacity >= this->size_ and "resizing would drop values");
+    std::vector<ValueType> resized(new_capacity);
+    for (size_t index = 0; index < this->size_; ++index) {
+      resized[index] = std::move(buffer_[(read_index_ + index) % capacity_]);
+    }
+    buffer_ = std::move(resized);
+    capacity_ = new_capacity;
+    read_index_ = 0;
+    write_index_ = this->size_ % capacity_;
+  }
+
+  // NOTE: the lock must be held when calling this method
+  void ResetWindow() {
+    window_blocked_ = std::chrono::nanoseconds{0};
+    window_pushes_ = 0;
+    window_high_water_mark_ = this->size_;
+  }
+
+  // grows a full channel in case the producer was blocked for long enough within the
+  // current window and the budget allows it
+  // NOTE: the lock must be held when calling this method
+  bool TryGrow() {
+    if (not budget_ or capacity_ >= max_capacity_ or window_blocked_ < kAdaptiveGrowBlockedTime) {
+      return false;
+    }
+    const size_t new_capacity = std::min(capacity_ * 2, max_capacity_);
+    if (not budget_->TryAcquire(new_capacity - capacity_)) {
+      return false;
+    }
+    spdlog::debug("adaptive channel grows from {} to {}", capacity_, new_capacity);
+    Resize(new_capacity);
+    ResetWindow();
+    return true;
+  }
+
+  // shrinks the channel in case it was neither blocked nor used beyond a quarter of its
+  // capacity throughout the last window
+  // NOTE: the lock must be held when calling this method
+  void AdaptAfterPush() {
+    if (not budget_) {
+      return;
+    }
+    ++window_pushes_;
+    window_high_water_mark_ = std::max(window_high_water_mark_, this->size_);
+    if (window_pushes_ < capacity_ * kAdaptiveWindowFactor) {
+      return;
+    }
+    if (window_blocked_.count() == 0 and window_high_water_mark_ <= capacity_ / 4
+        and capacity_ > min_capacity_) {
+      const size_t new_capacity = std::max(capacity_ / 2, min_capacity_);
+      spdlog::debug("adaptive channel shrinks from {} to {}", capacity_, new_capacity);
+      budget_->Release(capacity_ - new_capacity);
+      Resize(new_capacity);
+    }
+    ResetWindow();
+  }
+
+  // NOTE: the lock must be held when calling this method
+  concurrencpp::lazy_result<void> AwaitFreeSlot(std::shared_ptr<concurrencpp::executor> resume_executor,
+                                                concurrencpp::scoped_async_lock &guard) {
+    const auto start = std::chrono::steady_clock::now();
+    co_await this->AwaitCondition(resume_executor, guard, [this] {
+      return this->closed_ or this->poisened_ or this->size_ < this->capacity_;
+    }, ChannelSide::kProducer);
+    window_blocked_ += std::chrono::steady_clock::now() - start;
+  }
+
   // NOTE: the lock must be held when calling this method
   void perform_write(ValueType value) {
     assert(this->size_ < capacity_ and "the channel should not be full here");
@@ -548,6 +1061,8 @@ class CoroBoundedChannel : public CoroChannel<ValueType> {
     buffer_[write_index_] = std::move(value);
     write_index_ = (write_index_ + 1) % capacity_;
     ++(this->size_);
+    this->RecordPush(1, this->size_);
+    AdaptAfterPush();
   }
 
   // NOTE: the lock must be held when calling this method
@@ -558,14 +1073,44 @@ class CoroBoundedChannel : public CoroChannel<ValueType> {
     auto result = std::move(buffer_[read_index_]);
     read_index_ = (read_index_ + 1) % capacity_;
     --(this->size_);
+    this->RecordPop(1);
     return std::move(result);
   }
 
  public:
-  explicit CoroBoundedChannel(size_t capacity = 1'000) : CoroChannel<ValueType>(), capacity_(capacity) {
-    buffer_.reserve(capacity_);
+  explicit CoroBoundedChannel(size_t capacity = 1'000)
+      : CoroChannel<ValueType>(), capacity_(capacity), min_capacity_(capacity), max_capacity_(capacity) {
+    throw_on(capacity_ == 0, "channel capacity 0", source_loc::current());
+    buffer_.resize(capacity_);
   };
 
+  // adaptive channel, starts with the given capacity and grows up to max_capacity using
+  // slots from the budget while its producer is blocked on a full channel
+  CoroBoundedChannel(size_t capacity,
+                     std::shared_ptr<ChannelCapacityBudget> budget,
+                     size_t max_capacity = std::numeric_limits<size_t>::max())
+      : CoroChannel<ValueType>(),
+        capacity_(capacity),
+        budget_(std::move(budget)),
+        min_capacity_(capacity),
+        max_capacity_(std::max(capacity, max_capacity)) {
+    throw_on(capacity_ == 0, "channel capacity 0", source_loc::current());
+    throw_if_empty(budget_, "channel capacity budget is null", source_loc::current());
+    buffer_.resize(capacity_);
+  }
+
+  ~CoroBoundedChannel() {
+    if (budget_) {
+      budget_->Release(capacity_ - min_capacity_);
+    }
+  }
+
+  concurrencpp::result<size_t> GetCapacity(std::shared_ptr<concurrencpp::executor> resume_executor) {
+    concurrencpp::scoped_async_lock guard =
+        co_await this->channel_lock_.lock(resume_executor);
+    co_return capacity_;
+  }
+
   CoroBoundedChannel(const CoroBoundedChannel<ValueType> &) = delete;
 
   CoroBoundedChannel(CoroBoundedChannel<ValueType> &&) = delete;
@@ -611,9 +1156,9 @@ class CoroBoundedChannel : public CoroChannel<ValueType> {
     {
       concurrencpp::scoped_async_lock guard =
           co_await this->channel_lock_.lock(resume_executor);
-      co_await this->channel_cv_.await(resume_executor, guard, [this] {
-        return this->closed_ or this->poisened_ or this->size_ < this->capacity_;
-      });
+      while (not this->closed_ and not this->poisened_ and this->size_ >= capacity_ and not TryGrow()) {
+        co_await AwaitFreeSlot(resume_executor, guard);
+      }
       if (this->closed_ or this->poisened_) {
         guard.unlock();
         this->channel_cv_.notify_all();
@@ -665,9 +1210,9 @@ class CoroBoundedChannel : public CoroChannel<ValueType> {
     concurrencpp::scoped_async_lock guard =
         co_await this->channel_lock_.lock(resume_executor);
 
-    co_await this->channel_cv_.await(resume_executor, guard, [this] {
+    co_await this->AwaitCondition(resume_executor, guard, [this] {
       return this->poisened_ || this->closed_ || this->size_ > 0;
-    });
+    }, ChannelSide::kConsumer);
     if (this->poisened_) {
       guard.unlock();
       this->channel_cv_.notify_all();
@@ -745,94 +1290,558 @@ class CoroBoundedChannel : public CoroChannel<ValueType> {
 
     co_return result;
   }
-};
-
-template<typename ValueType>
-class CoroUnBoundedChannel : public CoroChannel<ValueType> {
-  std::list<ValueType> buffer_;
-
- public:
-  CoroUnBoundedChannel() : CoroChannel<ValueType>() {};
-
-  CoroUnBoundedChannel(const CoroChannel<ValueType> &) = delete;
-
-  CoroUnBoundedChannel(CoroChannel<ValueType> &&) = delete;
-
-  CoroUnBoundedChannel<ValueType> &operator=(
-      const CoroUnBoundedChannel<ValueType> &) noexcept = delete;
-
-  CoroUnBoundedChannel<ValueType> &operator=(
-      CoroUnBoundedChannel<ValueType> &&) noexcept = delete;
-
-  concurrencpp::result<void> Display(
-      std::shared_ptr<concurrencpp::executor> resume_executor,
-      std::ostream &out,
-      std::function<std::ostream &(std::ostream &, ValueType &)> &value_printer)
-  override {
-    concurrencpp::scoped_async_lock guard =
-        co_await this->channel_lock_.lock(resume_executor);
-
-    out << "Channel:" << '\n';
-    out << "size=" << this->size_ << '\n';
-    out << "closed=" << this->closed_ << '\n';
-    out << "poisened=" << this->poisened_ << '\n';
-    out << "Buffer={" << '\n';
-    for (auto &val : buffer_) {
-      value_printer(out, val);
-    }
-    out << "}" << '\n';
-  }
 
-  // returns false if channel is closed or poisened
-  concurrencpp::lazy_result<bool> Push(
+  // returns the amount of pushed values, less than values.size() if the channel was closed
+  concurrencpp::lazy_result<size_t> PushBatch(
       std::shared_ptr<concurrencpp::executor> resume_executor,
-      ValueType value) override {
+      std::span<ValueType> values) override {
     throw_if_empty<concurrencpp::executor>(resume_executor,
                                            TraceException::kResumeExecutorNull,
                                            source_loc::current());
+    size_t pushed = 0;
     {
       concurrencpp::scoped_async_lock guard =
           co_await this->channel_lock_.lock(resume_executor);
-      if (this->closed_ or this->poisened_) {
-        guard.unlock();
-        this->channel_cv_.notify_all();
-        co_return false;
+      while (pushed < values.size()) {
+        while (not this->closed_ and not this->poisened_ and this->size_ >= capacity_ and not TryGrow()) {
+          co_await AwaitFreeSlot(resume_executor, guard);
+        }
+        if (this->closed_ or this->poisened_) {
+          break;
+        }
+        while (pushed < values.size() and this->size_ < capacity_) {
+          perform_write(std::move(values[pushed]));
+          ++pushed;
+        }
+        if (pushed < values.size()) {
+          // the buffer is full again, wake the readers before waiting for free slots
+          this->channel_cv_.notify_all();
+        }
       }
-      assert(not this->closed_ and "channel should not be closed here");
-      assert(not this->poisened_ and "channel should not be poisened here");
-
-      buffer_.push_back(std::move(value));
-      ++(this->size_);
     }
 
     this->channel_cv_.notify_all();
-    co_return true;
+    co_return pushed;
   }
 
-  // returns false if channel is closed or poisened
-  concurrencpp::lazy_result<bool> TryPush(
+  // returns 0 in case channel is poisened or closed and empty
+  concurrencpp::lazy_result<size_t> PopBatch(
       std::shared_ptr<concurrencpp::executor> resume_executor,
-      ValueType value) override {
+      std::vector<ValueType> &out,
+      size_t max) override {
     throw_if_empty<concurrencpp::executor>(resume_executor,
                                            TraceException::kResumeExecutorNull,
                                            source_loc::current());
-    this->channel_cv_.notify_all();
-    co_return co_await Push(resume_executor, std::move(value));
+    size_t popped = 0;
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      co_await this->AwaitCondition(resume_executor, guard, [this] {
+        return this->poisened_ || this->closed_ || this->size_ > 0;
+      }, ChannelSide::kConsumer);
+      if (this->poisened_) {
+        co_return 0;
+      }
+      while (popped < max and this->size_ > 0) {
+        out.push_back(perform_read());
+        ++popped;
+      }
+    }
+
+    if (popped > 0) {
+      this->channel_cv_.notify_all();
+    }
+    co_return popped;
   }
 
-  // returns empty optional in case channel is poisened or empty
-  concurrencpp::lazy_result<std::optional<ValueType>> Pop(
-      std::shared_ptr<concurrencpp::executor> resume_executor) override {
-    throw_if_empty<concurrencpp::executor>(resume_executor,
-                                           TraceException::kResumeExecutorNull,
+  concurrencpp::lazy_result<size_t> TryPopBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::vector<ValueType> &out,
+      size_t max) override {
+    throw_if_empty(resume_executor, TraceException::kResumeExecutorNull, source_loc::current());
+    size_t popped = 0;
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      if (this->poisened_) {
+        co_return 0;
+      }
+      while (popped < max and this->size_ > 0) {
+        out.push_back(perform_read());
+        ++popped;
+      }
+    }
+
+    if (popped > 0) {
+      this->channel_cv_.notify_all();
+    }
+    co_return popped;
+  }
+};
+
+// Wait-free single producer single consumer ring buffer. Push and Pop only touch the
+// head/tail indices, the channel lock and condition variable are solely used to suspend
+// when the buffer is observed full (producer) or empty (consumer). The side that makes
+// progress only takes the lock when the other side announced that it is waiting.
+// NOTE: at most one coroutine may push and at most one coroutine may pop concurrently
+template<typename ValueType>
+class CoroSpscChannel : public CoroChannel<ValueType> {
+  static constexpr size_t kCacheLineSize = 64;
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::vector<ValueType> buffer_;
+
+  // consumer side
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+  std::atomic<bool> consumer_waiting_{false};
+
+  // producer side
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+  std::atomic<bool> producer_waiting_{false};
+
+  alignas(kCacheLineSize) std::atomic<bool> spsc_closed_{false};
+  std::atomic<bool> spsc_poisened_{false};
+
+  // returns true if the buffer has a free slot, the caller must be the producer
+  inline bool HasFreeSlot(size_t tail) {
+    if (tail - cached_head_ < capacity_) {
+      return true;
+    }
+    cached_head_ = head_.load(std::memory_order_acquire);
+    return tail - cached_head_ < capacity_;
+  }
+
+  // returns true if the buffer has a value to read, the caller must be the consumer
+  inline bool HasValue(size_t head) {
+    if (head != cached_tail_) {
+      return true;
+    }
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+    return head != cached_tail_;
+  }
+
+  // NOTE: the fence pairs with the seq_cst store of the waiting flag, either the waiter
+  // observes our index update when evaluating its predicate or we observe its flag
+  static inline bool ShouldWake(const std::atomic<bool> &waiting) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return waiting.load(std::memory_order_relaxed);
+  }
+
+  // acquiring the lock before notifying guarantees that a waiter that announced itself is
+  // already registered at the condition variable
+  concurrencpp::lazy_result<void> Wake(std::shared_ptr<concurrencpp::executor> resume_executor) {
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+    }
+    this->channel_cv_.notify_all();
+  }
+
+  // NOTE: must only be called by the producer after HasFreeSlot returned true
+  inline void perform_write(size_t tail, ValueType value) {
+    buffer_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    this->RecordPush(1, tail + 1 - head_.load(std::memory_order_relaxed));
+  }
+
+  // NOTE: must only be called by the consumer after HasValue returned true
+  inline ValueType perform_read(size_t head) {
+    auto result = std::move(buffer_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    this->RecordPop(1);
+    return result;
+  }
+
+  inline bool IsClosedOrPoisened() const {
+    return spsc_closed_.load(std::memory_order_acquire) or spsc_poisened_.load(std::memory_order_acquire);
+  }
+
+ public:
+  explicit CoroSpscChannel(size_t capacity = 1'000)
+      : CoroChannel<ValueType>(),
+        capacity_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+        mask_(capacity_ - 1) {
+    buffer_.resize(capacity_);
+  };
+
+  CoroSpscChannel(const CoroSpscChannel<ValueType> &) = delete;
+
+  CoroSpscChannel(CoroSpscChannel<ValueType> &&) = delete;
+
+  CoroSpscChannel<ValueType> &operator=(const CoroSpscChannel<ValueType> &) noexcept = delete;
+
+  CoroSpscChannel<ValueType> &operator=(CoroSpscChannel<ValueType> &&) noexcept = delete;
+
+  concurrencpp::result<bool> Empty(std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    co_return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+  }
+
+  concurrencpp::result<size_t> GetSize(std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    const size_t head = head_.load(std::memory_order_acquire);
+    co_return tail_.load(std::memory_order_acquire) - head;
+  }
+
+  // true if a Pop issued right now would suspend, i.e. the channel is empty and still open;
+  // does neither lock nor suspend and is exact for the consumer as it is the only one popping
+  // NOTE: must only be called by the consumer
+  bool WouldPopSuspend() const {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire)
+        and not IsClosedOrPoisened();
+  }
+
+  concurrencpp::result<void> CloseChannel(std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      spsc_closed_.store(true, std::memory_order_seq_cst);
+      this->closed_ = true;
+    }
+
+    this->channel_cv_.notify_all();
+  }
+
+  concurrencpp::result<void> PoisenChannel(std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      spsc_poisened_.store(true, std::memory_order_seq_cst);
+      this->poisened_ = true;
+    }
+
+    this->channel_cv_.notify_all();
+  }
+
+  concurrencpp::result<void> Display(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::ostream &out,
+      std::function<std::ostream &(std::ostream &, ValueType &)> &value_printer)
+  override {
+    const size_t head = head_.load(std::memory_order_acquire);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    out << "Channel:" << '\n';
+    out << "capacity=" << capacity_ << '\n';
+    out << "size=" << tail - head << '\n';
+    out << "head=" << head << '\n';
+    out << "tail=" << tail << '\n';
+    out << "closed=" << spsc_closed_.load() << '\n';
+    out << "poisened=" << spsc_poisened_.load() << '\n';
+    co_return;
+  }
+
+  // returns false if channel is closed or poisoned
+  concurrencpp::lazy_result<bool> Push(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      ValueType value) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    if (IsClosedOrPoisened()) {
+      co_return false;
+    }
+
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (not HasFreeSlot(tail)) {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      producer_waiting_.store(true, std::memory_order_seq_cst);
+      co_await this->AwaitCondition(resume_executor, guard, [this, tail] {
+        return IsClosedOrPoisened() or tail - head_.load(std::memory_order_seq_cst) < capacity_;
+      }, ChannelSide::kProducer);
+      producer_waiting_.store(false, std::memory_order_relaxed);
+      guard.unlock();
+
+      if (IsClosedOrPoisened()) {
+        co_return false;
+      }
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+
+    perform_write(tail, std::move(value));
+    if (ShouldWake(consumer_waiting_)) {
+      co_await Wake(resume_executor);
+    }
+    co_return true;
+  }
+
+  // returns false if channel is closed, poisened or full
+  concurrencpp::lazy_result<bool> TryPush(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      ValueType value) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (IsClosedOrPoisened() or not HasFreeSlot(tail)) {
+      co_return false;
+    }
+
+    perform_write(tail, std::move(value));
+    if (ShouldWake(consumer_waiting_)) {
+      co_await Wake(resume_executor);
+    }
+    co_return true;
+  }
+
+  // returns empty optional in case channel is poisened or closed and empty
+  concurrencpp::lazy_result<std::optional<ValueType>> Pop(
+      std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    if (spsc_poisened_.load(std::memory_order_acquire)) {
+      co_return std::nullopt;
+    }
+
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (not HasValue(head)) {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      consumer_waiting_.store(true, std::memory_order_seq_cst);
+      co_await this->AwaitCondition(resume_executor, guard, [this, head] {
+        return IsClosedOrPoisened() or tail_.load(std::memory_order_seq_cst) != head;
+      }, ChannelSide::kConsumer);
+      consumer_waiting_.store(false, std::memory_order_relaxed);
+      guard.unlock();
+
+      // a closed channel is still drained, only poisoning drops the remaining values
+      if (spsc_poisened_.load(std::memory_order_acquire) or not HasValue(head)) {
+        co_return std::nullopt;
+      }
+    }
+
+    auto result = perform_read(head);
+    if (ShouldWake(producer_waiting_)) {
+      co_await Wake(resume_executor);
+    }
+    co_return result;
+  }
+
+  concurrencpp::lazy_result<std::optional<ValueType>> TryPop(
+      std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty(resume_executor, TraceException::kResumeExecutorNull, source_loc::current());
+
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (spsc_poisened_.load(std::memory_order_acquire) or not HasValue(head)) {
+      co_return std::nullopt;
+    }
+
+    auto result = perform_read(head);
+    if (ShouldWake(producer_waiting_)) {
+      co_await Wake(resume_executor);
+    }
+    co_return result;
+  }
+
+  concurrencpp::lazy_result<std::optional<ValueType>> TryPopOnTrue(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::function<bool(ValueType &)> &predicate) override {
+    throw_if_empty(resume_executor, TraceException::kResumeExecutorNull, source_loc::current());
+
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (spsc_poisened_.load(std::memory_order_acquire) or not HasValue(head)) {
+      co_return std::nullopt;
+    }
+
+    // the producer never touches slots between head and tail, hence peeking is safe
+    if (not predicate(buffer_[head & mask_])) {
+      co_return std::nullopt;
+    }
+
+    auto result = perform_read(head);
+    if (ShouldWake(producer_waiting_)) {
+      co_await Wake(resume_executor);
+    }
+    co_return result;
+  }
+
+  // publishes all values that fit into the buffer with a single tail update, only suspends
+  // in case the buffer runs full; returns less than values.size() if the channel was closed
+  concurrencpp::lazy_result<size_t> PushBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::span<ValueType> values) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    size_t pushed = 0;
+    while (pushed < values.size()) {
+      if (IsClosedOrPoisened()) {
+        co_return pushed;
+      }
+
+      const size_t tail = tail_.load(std::memory_order_relaxed);
+      if (not HasFreeSlot(tail)) {
+        concurrencpp::scoped_async_lock guard =
+            co_await this->channel_lock_.lock(resume_executor);
+        producer_waiting_.store(true, std::memory_order_seq_cst);
+        co_await this->AwaitCondition(resume_executor, guard, [this, tail] {
+          return IsClosedOrPoisened() or tail - head_.load(std::memory_order_seq_cst) < capacity_;
+        }, ChannelSide::kProducer);
+        producer_waiting_.store(false, std::memory_order_relaxed);
+        continue;
+      }
+
+      const size_t amount = std::min(values.size() - pushed, capacity_ - (tail - cached_head_));
+      for (size_t index = 0; index < amount; ++index) {
+        buffer_[(tail + index) & mask_] = std::move(values[pushed + index]);
+      }
+      tail_.store(tail + amount, std::memory_order_release);
+      this->RecordPush(amount, tail + amount - head_.load(std::memory_order_relaxed));
+      pushed += amount;
+
+      if (ShouldWake(consumer_waiting_)) {
+        co_await Wake(resume_executor);
+      }
+    }
+    co_return pushed;
+  }
+
+  // returns 0 in case channel is poisened or closed and empty
+  concurrencpp::lazy_result<size_t> PopBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::vector<ValueType> &out,
+      size_t max) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    if (spsc_poisened_.load(std::memory_order_acquire) or max == 0) {
+      co_return 0;
+    }
+
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (not HasValue(head)) {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      consumer_waiting_.store(true, std::memory_order_seq_cst);
+      co_await this->AwaitCondition(resume_executor, guard, [this, head] {
+        return IsClosedOrPoisened() or tail_.load(std::memory_order_seq_cst) != head;
+      }, ChannelSide::kConsumer);
+      consumer_waiting_.store(false, std::memory_order_relaxed);
+    }
+
+    co_return co_await TryPopBatch(resume_executor, out, max);
+  }
+
+  concurrencpp::lazy_result<size_t> TryPopBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::vector<ValueType> &out,
+      size_t max) override {
+    throw_if_empty(resume_executor, TraceException::kResumeExecutorNull, source_loc::current());
+
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (spsc_poisened_.load(std::memory_order_acquire) or max == 0 or not HasValue(head)) {
+      co_return 0;
+    }
+
+    const size_t amount = std::min(max, cached_tail_ - head);
+    for (size_t index = 0; index < amount; ++index) {
+      out.push_back(std::move(buffer_[(head + index) & mask_]));
+    }
+    head_.store(head + amount, std::memory_order_release);
+    this->RecordPop(amount);
+
+    if (ShouldWake(producer_waiting_)) {
+      co_await Wake(resume_executor);
+    }
+    co_return amount;
+  }
+};
+
+template<typename ValueType>
+class CoroUnBoundedChannel : public CoroChannel<ValueType> {
+  SegmentedDeque<ValueType> buffer_;
+
+ public:
+  CoroUnBoundedChannel() : CoroChannel<ValueType>() {};
+
+  CoroUnBoundedChannel(const CoroChannel<ValueType> &) = delete;
+
+  CoroUnBoundedChannel(CoroChannel<ValueType> &&) = delete;
+
+  CoroUnBoundedChannel<ValueType> &operator=(
+      const CoroUnBoundedChannel<ValueType> &) noexcept = delete;
+
+  CoroUnBoundedChannel<ValueType> &operator=(
+      CoroUnBoundedChannel<ValueType> &&) noexcept = delete;
+
+  concurrencpp::result<void> Display(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::ostream &out,
+      std::function<std::ostream &(std::ostream &, ValueType &)> &value_printer)
+  override {
+    concurrencpp::scoped_async_lock guard =
+        co_await this->channel_lock_.lock(resume_executor);
+
+    out << "Channel:" << '\n';
+    out << "size=" << this->size_ << '\n';
+    out << "closed=" << this->closed_ << '\n';
+    out << "poisened=" << this->poisened_ << '\n';
+    out << "Buffer={" << '\n';
+    for (auto &val : buffer_) {
+      value_printer(out, val);
+    }
+    out << "}" << '\n';
+  }
+
+  // returns false if channel is closed or poisened
+  concurrencpp::lazy_result<bool> Push(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      ValueType value) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      if (this->closed_ or this->poisened_) {
+        guard.unlock();
+        this->channel_cv_.notify_all();
+        co_return false;
+      }
+      assert(not this->closed_ and "channel should not be closed here");
+      assert(not this->poisened_ and "channel should not be poisened here");
+
+      buffer_.PushBack(std::move(value));
+      ++(this->size_);
+      this->RecordPush(1, this->size_);
+    }
+
+    this->channel_cv_.notify_all();
+    co_return true;
+  }
+
+  // returns false if channel is closed or poisened
+  concurrencpp::lazy_result<bool> TryPush(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      ValueType value) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    this->channel_cv_.notify_all();
+    co_return co_await Push(resume_executor, std::move(value));
+  }
+
+  // returns empty optional in case channel is poisened or empty
+  concurrencpp::lazy_result<std::optional<ValueType>> Pop(
+      std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
                                            source_loc::current());
 
     concurrencpp::scoped_async_lock guard =
         co_await this->channel_lock_.lock(resume_executor);
 
-    co_await this->channel_cv_.await(resume_executor, guard, [this] {
+    co_await this->AwaitCondition(resume_executor, guard, [this] {
       return this->poisened_ || this->closed_ || this->size_ > 0;
-    });
+    }, ChannelSide::kConsumer);
     if (this->poisened_) {
       guard.unlock();
       this->channel_cv_.notify_all();
@@ -847,9 +1856,10 @@ class CoroUnBoundedChannel : public CoroChannel<ValueType> {
     }
     assert(this->size_ > 0 and "trying to read from empty channel");
 
-    auto result = std::move(buffer_.front());
-    buffer_.pop_front();
+    auto result = std::move(buffer_.Front());
+    buffer_.PopFront();
     --(this->size_);
+    this->RecordPop(1);
 
     guard.unlock();
     this->channel_cv_.notify_all();
@@ -870,9 +1880,10 @@ class CoroUnBoundedChannel : public CoroChannel<ValueType> {
       co_return std::nullopt;
     }
 
-    auto result = std::move(buffer_.front());
-    buffer_.pop_front();
+    auto result = std::move(buffer_.Front());
+    buffer_.PopFront();
     --(this->size_);
+    this->RecordPop(1);
 
     guard.unlock();
     this->channel_cv_.notify_all();
@@ -895,18 +1906,460 @@ class CoroUnBoundedChannel : public CoroChannel<ValueType> {
     }
 
     // no move here, we may want to keep the value!
-    auto result = buffer_.front();
+    auto result = buffer_.Front();
     if (not predicate(result)) {
       co_return std::nullopt;
     }
-    buffer_.pop_front();
+    buffer_.PopFront();
     --(this->size_);
+    this->RecordPop(1);
 
     guard.unlock();
     this->channel_cv_.notify_all();
 
     co_return result;
   }
+
+  // returns the amount of pushed values, 0 if the channel was closed or poisened
+  concurrencpp::lazy_result<size_t> PushBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::span<ValueType> values) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      if (this->closed_ or this->poisened_) {
+        co_return 0;
+      }
+      for (ValueType &value : values) {
+        buffer_.PushBack(std::move(value));
+      }
+      this->size_ += values.size();
+      this->RecordPush(values.size(), this->size_);
+    }
+
+    this->channel_cv_.notify_all();
+    co_return values.size();
+  }
+
+  // returns 0 in case channel is poisened or closed and empty
+  concurrencpp::lazy_result<size_t> PopBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::vector<ValueType> &out,
+      size_t max) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    size_t popped = 0;
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      co_await this->AwaitCondition(resume_executor, guard, [this] {
+        return this->poisened_ || this->closed_ || this->size_ > 0;
+      }, ChannelSide::kConsumer);
+      if (this->poisened_) {
+        co_return 0;
+      }
+      while (popped < max and this->size_ > 0) {
+        out.push_back(std::move(buffer_.Front()));
+        buffer_.PopFront();
+        --(this->size_);
+        ++popped;
+      }
+      this->RecordPop(popped);
+    }
+
+    if (popped > 0) {
+      this->channel_cv_.notify_all();
+    }
+    co_return popped;
+  }
+
+  concurrencpp::lazy_result<size_t> TryPopBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::vector<ValueType> &out,
+      size_t max) override {
+    throw_if_empty(resume_executor, TraceException::kResumeExecutorNull, source_loc::current());
+    size_t popped = 0;
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      if (this->poisened_) {
+        co_return 0;
+      }
+      while (popped < max and this->size_ > 0) {
+        out.push_back(std::move(buffer_.Front()));
+        buffer_.PopFront();
+        --(this->size_);
+        ++popped;
+      }
+      this->RecordPop(popped);
+    }
+
+    if (popped > 0) {
+      this->channel_cv_.notify_all();
+    }
+    co_return popped;
+  }
+};
+
+// Unbounded lock-free multi producer multi consumer channel. Values are stored in a linked list
+// of fixed size segments. Following Vyukov's bounded queue, every cell carries a sequence number
+// derived from its position p in the channel: p while free, p + 1 once a producer published its
+// value and p + 2 once a consumer gave up on it. Producers and consumers claim cells through a
+// fetch_add on the segment's enqueue and dequeue index (as in LCRQ). A consumer that claims a
+// cell whose producer did not publish yet abandons the cell instead of waiting, the producer
+// then retries with a fresh cell. Segments are linked through plain pointers and reclaimed with
+// hazard pointers once all their cells were claimed.
+//
+// Published values are never moved out of their cell but copied, they are destroyed together
+// with their segment. This allows TryPopOnTrue to inspect the head value without claiming it
+// and to only take it by advancing the dequeue index from the inspected position with a CAS.
+// The channel lock and condition variable are only used to suspend consumers on an empty channel.
+template<typename ValueType>
+class CoroMpmcChannel : public CoroChannel<ValueType> {
+  static_assert(std::is_copy_constructible_v<ValueType>, "mpmc channel values are copied out of their cells");
+
+  static constexpr size_t kCacheLineSize = 64;
+  static constexpr size_t kSegmentSize = 512;
+
+  struct Cell {
+    std::atomic<uint64_t> sequence_;
+    ValueType value_;
+  };
+
+  struct Segment {
+    alignas(kCacheLineSize) std::atomic<size_t> enqueue_index_{0};
+    alignas(kCacheLineSize) std::atomic<size_t> dequeue_index_{0};
+    std::atomic<Segment *> next_{nullptr};
+    Segment *retired_next_ = nullptr;
+    // position of the first cell within the channel
+    const uint64_t base_;
+    std::array<Cell, kSegmentSize> cells_;
+
+    explicit Segment(uint64_t base) : base_(base) {
+      for (size_t index = 0; index < kSegmentSize; ++index) {
+        cells_[index].sequence_.store(base + index, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  HazardPointerDomain<Segment> segment_domain_;
+  alignas(kCacheLineSize) std::atomic<Segment *> head_segment_;
+  alignas(kCacheLineSize) std::atomic<Segment *> tail_segment_;
+  // NOTE: signed since a consumer may take a value before its producer accounted for it
+  alignas(kCacheLineSize) std::atomic<int64_t> mpmc_size_{0};
+  std::atomic<size_t> waiting_consumers_{0};
+  std::atomic<bool> mpmc_closed_{false};
+  std::atomic<bool> mpmc_poisened_{false};
+
+  inline bool IsClosedOrPoisened() const {
+    return mpmc_closed_.load(std::memory_order_acquire) or mpmc_poisened_.load(std::memory_order_acquire);
+  }
+
+  static Segment *GetOrInstallNext(Segment *segment) {
+    Segment *next = segment->next_.load(std::memory_order_acquire);
+    if (next) {
+      return next;
+    }
+    auto *fresh = new Segment(segment->base_ + kSegmentSize);
+    if (segment->next_.compare_exchange_strong(next, fresh, std::memory_order_acq_rel)) {
+      return fresh;
+    }
+    delete fresh;
+    return next;
+  }
+
+  // moves the head past a segment all whose cells were claimed; the tail is moved first such
+  // that the segment is unreachable from both ends once it is retired
+  void AdvanceHead(Segment *segment, Segment *next) {
+    Segment *expected = segment;
+    tail_segment_.compare_exchange_strong(expected, next, std::memory_order_seq_cst);
+    expected = segment;
+    if (head_segment_.compare_exchange_strong(expected, next, std::memory_order_seq_cst)) {
+      segment_domain_.Retire(segment);
+    }
+  }
+
+  void Enqueue(ValueType value) {
+    typename HazardPointerDomain<Segment>::Guard guard{segment_domain_};
+    while (true) {
+      Segment *segment = guard.Protect(tail_segment_);
+      const size_t index = segment->enqueue_index_.fetch_add(1, std::memory_order_acq_rel);
+      if (index < kSegmentSize) {
+        Cell &cell = segment->cells_[index];
+        const uint64_t position = segment->base_ + index;
+        cell.value_ = std::move(value);
+        uint64_t expected = position;
+        if (cell.sequence_.compare_exchange_strong(expected, position + 1, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+          return;
+        }
+        // a consumer abandoned the cell, it will never look at it again
+        value = std::move(cell.value_);
+        continue;
+      }
+
+      Segment *next = GetOrInstallNext(segment);
+      Segment *expected = segment;
+      tail_segment_.compare_exchange_strong(expected, next, std::memory_order_seq_cst);
+    }
+  }
+
+  std::optional<ValueType> Dequeue() {
+    typename HazardPointerDomain<Segment>::Guard guard{segment_domain_};
+    while (true) {
+      Segment *segment = guard.Protect(head_segment_);
+      const size_t dequeue_index = segment->dequeue_index_.load(std::memory_order_acquire);
+      if (dequeue_index >= kSegmentSize) {
+        Segment *next = segment->next_.load(std::memory_order_acquire);
+        if (not next) {
+          return std::nullopt;
+        }
+        AdvanceHead(segment, next);
+        continue;
+      }
+      if (dequeue_index >= segment->enqueue_index_.load(std::memory_order_acquire)) {
+        return std::nullopt;
+      }
+
+      const size_t index = segment->dequeue_index_.fetch_add(1, std::memory_order_acq_rel);
+      if (index >= kSegmentSize) {
+        continue;
+      }
+      Cell &cell = segment->cells_[index];
+      const uint64_t position = segment->base_ + index;
+      uint64_t sequence = position;
+      if (cell.sequence_.compare_exchange_strong(sequence, position + 2, std::memory_order_acquire,
+                                                 std::memory_order_acquire)) {
+        // the producer did not publish yet, it retries with another cell
+        continue;
+      }
+      assert(sequence == position + 1 and "claimed cell was neither free nor published");
+      ValueType result = cell.value_;
+      mpmc_size_.fetch_sub(1, std::memory_order_seq_cst);
+      this->RecordPop(1);
+      return result;
+    }
+  }
+
+  std::optional<ValueType> DequeueOnTrue(std::function<bool(ValueType &)> &predicate) {
+    typename HazardPointerDomain<Segment>::Guard guard{segment_domain_};
+    while (true) {
+      Segment *segment = guard.Protect(head_segment_);
+      size_t dequeue_index = segment->dequeue_index_.load(std::memory_order_acquire);
+      if (dequeue_index >= kSegmentSize) {
+        Segment *next = segment->next_.load(std::memory_order_acquire);
+        if (not next) {
+          return std::nullopt;
+        }
+        AdvanceHead(segment, next);
+        continue;
+      }
+
+      // the head cell is unclaimed, a published value stays untouched till its segment is freed
+      Cell &cell = segment->cells_[dequeue_index];
+      const uint64_t position = segment->base_ + dequeue_index;
+      if (cell.sequence_.load(std::memory_order_acquire) != position + 1) {
+        return std::nullopt;
+      }
+      ValueType result = cell.value_;
+      if (not predicate(result)) {
+        return std::nullopt;
+      }
+      if (segment->dequeue_index_.compare_exchange_strong(dequeue_index, dequeue_index + 1,
+                                                          std::memory_order_acq_rel)) {
+        mpmc_size_.fetch_sub(1, std::memory_order_seq_cst);
+        this->RecordPop(1);
+        return result;
+      }
+      // another consumer took the head in the meantime, look at the new one
+    }
+  }
+
+  // NOTE: the seq_cst increment of the size pairs with the seq_cst increment of the waiting
+  // consumers, either the consumer observes the new size or we observe the waiter
+  concurrencpp::lazy_result<void> WakeConsumers(std::shared_ptr<concurrencpp::executor> resume_executor) {
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+    }
+    this->channel_cv_.notify_all();
+  }
+
+ public:
+  explicit CoroMpmcChannel() : CoroChannel<ValueType>() {
+    auto *segment = new Segment(0);
+    head_segment_.store(segment);
+    tail_segment_.store(segment);
+  };
+
+  ~CoroMpmcChannel() {
+    Segment *segment = head_segment_.load();
+    while (segment) {
+      Segment *next = segment->next_.load();
+      delete segment;
+      segment = next;
+    }
+  }
+
+  CoroMpmcChannel(const CoroMpmcChannel<ValueType> &) = delete;
+
+  CoroMpmcChannel(CoroMpmcChannel<ValueType> &&) = delete;
+
+  CoroMpmcChannel<ValueType> &operator=(const CoroMpmcChannel<ValueType> &) noexcept = delete;
+
+  CoroMpmcChannel<ValueType> &operator=(CoroMpmcChannel<ValueType> &&) noexcept = delete;
+
+  concurrencpp::result<bool> Empty(std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    co_return mpmc_size_.load(std::memory_order_acquire) <= 0;
+  }
+
+  concurrencpp::result<size_t> GetSize(std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    co_return static_cast<size_t>(std::max<int64_t>(mpmc_size_.load(std::memory_order_acquire), 0));
+  }
+
+  concurrencpp::result<void> CloseChannel(std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      mpmc_closed_.store(true, std::memory_order_seq_cst);
+      this->closed_ = true;
+    }
+
+    this->channel_cv_.notify_all();
+  }
+
+  concurrencpp::result<void> PoisenChannel(std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    {
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      mpmc_poisened_.store(true, std::memory_order_seq_cst);
+      this->poisened_ = true;
+    }
+
+    this->channel_cv_.notify_all();
+  }
+
+  concurrencpp::result<void> Display(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::ostream &out,
+      std::function<std::ostream &(std::ostream &, ValueType &)> &value_printer)
+  override {
+    out << "Channel:" << '\n';
+    out << "size=" << mpmc_size_.load() << '\n';
+    out << "waiting_consumers=" << waiting_consumers_.load() << '\n';
+    out << "closed=" << mpmc_closed_.load() << '\n';
+    out << "poisened=" << mpmc_poisened_.load() << '\n';
+    co_return;
+  }
+
+  // returns false if channel is closed or poisened
+  concurrencpp::lazy_result<bool> Push(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      ValueType value) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    if (IsClosedOrPoisened()) {
+      co_return false;
+    }
+
+    Enqueue(std::move(value));
+    const int64_t occupancy = mpmc_size_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    this->RecordPush(1, static_cast<size_t>(std::max<int64_t>(occupancy, 0)));
+    if (waiting_consumers_.load(std::memory_order_seq_cst) > 0) {
+      co_await WakeConsumers(resume_executor);
+    }
+    co_return true;
+  }
+
+  // returns false if channel is closed or poisened
+  concurrencpp::lazy_result<bool> TryPush(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      ValueType value) override {
+    co_return co_await Push(resume_executor, std::move(value));
+  }
+
+  // returns empty optional in case channel is poisened or closed and empty
+  concurrencpp::lazy_result<std::optional<ValueType>> Pop(
+      std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    while (true) {
+      if (mpmc_poisened_.load(std::memory_order_acquire)) {
+        co_return std::nullopt;
+      }
+
+      std::optional<ValueType> result = Dequeue();
+      if (result.has_value()) {
+        co_return result;
+      }
+      if (mpmc_closed_.load(std::memory_order_acquire)) {
+        // values pushed before closing are still handed out
+        co_return Dequeue();
+      }
+
+      concurrencpp::scoped_async_lock guard =
+          co_await this->channel_lock_.lock(resume_executor);
+      waiting_consumers_.fetch_add(1, std::memory_order_seq_cst);
+      co_await this->AwaitCondition(resume_executor, guard, [this] {
+        return IsClosedOrPoisened() or mpmc_size_.load(std::memory_order_seq_cst) > 0;
+      }, ChannelSide::kConsumer);
+      waiting_consumers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  // returns the amount of pushed values, 0 if the channel was closed or poisened
+  concurrencpp::lazy_result<size_t> PushBatch(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::span<ValueType> values) override {
+    throw_if_empty<concurrencpp::executor>(resume_executor,
+                                           TraceException::kResumeExecutorNull,
+                                           source_loc::current());
+    if (IsClosedOrPoisened()) {
+      co_return 0;
+    }
+
+    for (ValueType &value : values) {
+      Enqueue(std::move(value));
+    }
+    const int64_t occupancy =
+        mpmc_size_.fetch_add(static_cast<int64_t>(values.size()), std::memory_order_seq_cst) + values.size();
+    this->RecordPush(values.size(), static_cast<size_t>(std::max<int64_t>(occupancy, 0)));
+    if (waiting_consumers_.load(std::memory_order_seq_cst) > 0) {
+      co_await WakeConsumers(resume_executor);
+    }
+    co_return values.size();
+  }
+
+  concurrencpp::lazy_result<std::optional<ValueType>> TryPop(
+      std::shared_ptr<concurrencpp::executor> resume_executor) override {
+    throw_if_empty(resume_executor, TraceException::kResumeExecutorNull, source_loc::current());
+    if (mpmc_poisened_.load(std::memory_order_acquire)) {
+      co_return std::nullopt;
+    }
+    co_return Dequeue();
+  }
+
+  concurrencpp::lazy_result<std::optional<ValueType>> TryPopOnTrue(
+      std::shared_ptr<concurrencpp::executor> resume_executor,
+      std::function<bool(ValueType &)> &predicate) override {
+    throw_if_empty(resume_executor, TraceException::kResumeExecutorNull, source_loc::current());
+    if (mpmc_poisened_.load(std::memory_order_acquire)) {
+      co_return std::nullopt;
+    }
+    co_return DequeueOnTrue(predicate);
+  }
 };
 
 #endif //SIMBRICKS_TRACE_INCLUDE_SYNC_CHANNEL_H_
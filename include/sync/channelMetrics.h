@@ -0,0 +1,289 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+#include "util/exception.h"
+#include "util/factory.h"
+#include "util/metrics.h"
+
+#ifndef SIMBRICKS_TRACE_INCLUDE_SYNC_CHANNEL_METRICS_H_
+#define SIMBRICKS_TRACE_INCLUDE_SYNC_CHANNEL_METRICS_H_
+
+// bucket i counts pushes after which the channel held [2^(i-1), 2^i) values, the last
+// bucket collects everything above
+inline constexpr size_t kChannelOccupancyBuckets = 16;
+
+enum class ChannelSide {
+  kProducer,
+  kConsumer
+};
+
+// Counters of a single channel. All counters are updated with relaxed atomics, a snapshot
+// taken while the channel is in use is therefore not necessarily consistent across counters.
+class ChannelMetrics {
+  const std::string name_;
+
+  std::atomic<uint64_t> pushes_{0};
+  std::atomic<uint64_t> pops_{0};
+  std::atomic<uint64_t> producer_blocked_ns_{0};
+  std::atomic<uint64_t> consumer_blocked_ns_{0};
+  std::atomic<uint64_t> wakeups_{0};
+  std::atomic<uint64_t> futile_wakeups_{0};
+  std::atomic<uint64_t> high_water_mark_{0};
+  std::array<std::atomic<uint64_t>, kChannelOccupancyBuckets> occupancy_histogram_{};
+
+ public:
+  explicit ChannelMetrics(std::string name) : name_(std::move(name)) {
+  }
+
+  static inline size_t GetOccupancyBucket(size_t occupancy) {
+    return std::min<size_t>(std::bit_width(occupancy), kChannelOccupancyBuckets - 1);
+  }
+
+  inline void OnPush(size_t amount, size_t occupancy) {
+    pushes_.fetch_add(amount, std::memory_order_relaxed);
+    occupancy_histogram_[GetOccupancyBucket(occupancy)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t high_water_mark = high_water_mark_.load(std::memory_order_relaxed);
+    while (occupancy > high_water_mark and not high_water_mark_.compare_exchange_weak(
+        high_water_mark, occupancy, std::memory_order_relaxed)) {
+    }
+  }
+
+  inline void OnPop(size_t amount) {
+    pops_.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  inline void OnBlocked(ChannelSide side, std::chrono::nanoseconds duration) {
+    auto &counter = side == ChannelSide::kProducer ? producer_blocked_ns_ : consumer_blocked_ns_;
+    counter.fetch_add(duration.count(), std::memory_order_relaxed);
+  }
+
+  // a blocked thread returned from waiting, futile if it could not make progress and has to
+  // wait again; only counted by the non coroutine channels
+  inline void OnWakeup(bool futile) {
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    if (futile) {
+      futile_wakeups_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  const std::string &GetName() const {
+    return name_;
+  }
+
+  uint64_t GetPushes() const {
+    return pushes_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetPops() const {
+    return pops_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetProducerBlockedNs() const {
+    return producer_blocked_ns_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetConsumerBlockedNs() const {
+    return consumer_blocked_ns_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetWakeups() const {
+    return wakeups_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetFutileWakeups() const {
+    return futile_wakeups_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetHighWaterMark() const {
+    return high_water_mark_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetOccupancyCount(size_t bucket) const {
+    throw_on(bucket >= kChannelOccupancyBuckets, "occupancy bucket out of range", source_loc::current());
+    return occupancy_histogram_[bucket].load(std::memory_order_relaxed);
+  }
+
+  void Display(std::ostream &out) const {
+    const uint64_t pushes = GetPushes();
+    const uint64_t pops = GetPops();
+    out << name_;
+    out << ": pushes=" << pushes;
+    out << ", pops=" << pops;
+    out << ", backlog=" << (pushes > pops ? pushes - pops : 0);
+    out << ", high_water_mark=" << GetHighWaterMark();
+    out << ", producer_blocked_ms=" << GetProducerBlockedNs() / 1'000'000;
+    out << ", consumer_blocked_ms=" << GetConsumerBlockedNs() / 1'000'000;
+    out << ", wakeups=" << GetWakeups();
+    out << ", futile_wakeups=" << GetFutileWakeups();
+    out << ", occupancy={";
+    const char *separator = "";
+    for (size_t bucket = 0; bucket < kChannelOccupancyBuckets; ++bucket) {
+      const uint64_t count = occupancy_histogram_[bucket].load(std::memory_order_relaxed);
+      if (count == 0) {
+        continue;
+      }
+      const uint64_t lower = bucket == 0 ? 0 : uint64_t{1} << (bucket - 1);
+      out << separator << ">=" << lower << ":" << count;
+      separator = ", ";
+    }
+    out << "}";
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &out, const ChannelMetrics &metrics) {
+  metrics.Display(out);
+  return out;
+}
+
+// Owns the metrics of all instrumented channels so that they outlive the channels and can
+// be reported after a pipeline finished.
+class ChannelMetricsRegistry {
+  std::mutex registry_mutex_;
+  std::vector<std::shared_ptr<ChannelMetrics>> metrics_;
+
+ public:
+  std::shared_ptr<ChannelMetrics> Register(std::string name) {
+    auto metrics = create_shared<ChannelMetrics>("could not create channel metrics", std::move(name));
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    metrics_.push_back(metrics);
+    return metrics;
+  }
+
+  bool Empty() {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    return metrics_.empty();
+  }
+
+  void Display(std::ostream &out) {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    for (const std::shared_ptr<ChannelMetrics> &metrics : metrics_) {
+      metrics->Display(out);
+      out << '\n';
+    }
+  }
+
+  // writes the channel counters in the prometheus text exposition format, the depth being
+  // the amount of values currently buffered by a channel
+  void WritePrometheus(std::ostream &out) {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    if (metrics_.empty()) {
+      return;
+    }
+    auto write_family = [&](const std::string &name, const std::string &help, const char *type, auto value_of) {
+      WriteMetricHeader(out, name, help, type);
+      for (const std::shared_ptr<ChannelMetrics> &metrics : metrics_) {
+        WriteMetricSample(out, name, {{"channel", metrics->GetName()}}, value_of(*metrics));
+      }
+    };
+    write_family("columbo_channel_pushes_total", "Values pushed into the channel.", "counter",
+                 [](const ChannelMetrics &metrics) { return metrics.GetPushes(); });
+    write_family("columbo_channel_pops_total", "Values popped from the channel.", "counter",
+                 [](const ChannelMetrics &metrics) { return metrics.GetPops(); });
+    write_family("columbo_channel_depth", "Values currently buffered by the channel.", "gauge",
+                 [](const ChannelMetrics &metrics) {
+                   const uint64_t pushes = metrics.GetPushes();
+                   const uint64_t pops = metrics.GetPops();
+                   return pushes > pops ? pushes - pops : 0;
+                 });
+    write_family("columbo_channel_high_water_mark", "Maximum amount of values buffered at once.", "gauge",
+                 [](const ChannelMetrics &metrics) { return metrics.GetHighWaterMark(); });
+    write_family("columbo_channel_producer_blocked_seconds_total", "Time producers waited for free space.",
+                 "counter", [](const ChannelMetrics &metrics) {
+          return static_cast<double>(metrics.GetProducerBlockedNs()) / 1e9;
+        });
+    write_family("columbo_channel_consumer_blocked_seconds_total", "Time consumers waited for values.",
+                 "counter", [](const ChannelMetrics &metrics) {
+          return static_cast<double>(metrics.GetConsumerBlockedNs()) / 1e9;
+        });
+  }
+
+  void Log() {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    for (const std::shared_ptr<ChannelMetrics> &metrics : metrics_) {
+      std::stringstream line;
+      metrics->Display(line);
+      spdlog::info("channel metrics {}", line.str());
+    }
+  }
+};
+
+// Logs the registry periodically from a background thread till it is destroyed, at which
+// point a final report is logged.
+class ChannelMetricsReporter {
+  ChannelMetricsRegistry &registry_;
+  const std::chrono::seconds interval_;
+  std::mutex reporter_mutex_;
+  std::condition_variable reporter_cv_;
+  bool stop_ = false;
+  std::thread reporter_;
+
+  void Report() {
+    std::unique_lock lock{reporter_mutex_};
+    while (not reporter_cv_.wait_for(lock, interval_, [this] { return stop_; })) {
+      lock.unlock();
+      registry_.Log();
+      lock.lock();
+    }
+  }
+
+ public:
+  ChannelMetricsReporter(ChannelMetricsRegistry &registry, std::chrono::seconds interval)
+      : registry_(registry), interval_(interval) {
+    throw_on(interval_.count() == 0, "channel metrics interval is 0", source_loc::current());
+    reporter_ = std::thread{&ChannelMetricsReporter::Report, this};
+  }
+
+  ChannelMetricsReporter(const ChannelMetricsReporter &) = delete;
+
+  ChannelMetricsReporter &operator=(const ChannelMetricsReporter &) = delete;
+
+  ~ChannelMetricsReporter() {
+    {
+      const std::lock_guard<std::mutex> guard{reporter_mutex_};
+      stop_ = true;
+    }
+    reporter_cv_.notify_all();
+    reporter_.join();
+    registry_.Log();
+  }
+};
+
+#endif // SIMBRICKS_TRACE_INCLUDE_SYNC_CHANNEL_METRICS_H_
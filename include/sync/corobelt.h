@@ -46,6 +46,13 @@ class Producer {
   virtual concurrencpp::result<std::optional<ValueType>> produce(std::shared_ptr<concurrencpp::executor> executor) {
     return {};
   };
+
+  // true if the next call to produce would have to wait for its input, e.g. a simulator that
+  // did not yet write to a named pipe; lets stages hand on a partial batch instead of holding it
+  // NOTE: it is asked after every produced value and must therefore neither lock nor suspend
+  virtual bool WouldBlock() {
+    return false;
+  }
 };
 
 template<typename ValueType>
@@ -56,6 +63,11 @@ class Consumer {
   virtual concurrencpp::result<void> consume(std::shared_ptr<concurrencpp::executor> executor, ValueType value) {
     co_return;
   };
+
+  // called once after the last value was consumed
+  virtual concurrencpp::result<void> finish(std::shared_ptr<concurrencpp::executor> executor) {
+    co_return;
+  };
 };
 
 template<typename ValueType>
@@ -66,6 +78,23 @@ class Handler {
   virtual concurrencpp::result<bool> handel(std::shared_ptr<concurrencpp::executor> executor, ValueType &value) {
     co_return false;
   };
+
+  // handlers that are cheap and never suspend, e.g. filters, return true and may then be
+  // applied inline by the preceding pipeline stage instead of running as own task
+  virtual bool IsCheap() const {
+    return false;
+  }
+};
+
+// Determines how the handlers of a pipeline are mapped onto tasks. A fused handler is
+// applied inline by the preceding stage, saving a task and a channel hand-off per event.
+enum class PipelineFusion {
+  // every handler runs as own task behind an own channel
+  kNone,
+  // handlers declaring themselves cheap are fused into the preceding stage
+  kAuto,
+  // all handlers are applied inline by the producer task
+  kAll
 };
 
 template<typename ValueType>
@@ -74,11 +103,13 @@ class Pipeline {
   std::shared_ptr<Producer<ValueType>> prod_;
   std::shared_ptr<std::vector<std::shared_ptr<Handler<ValueType>>>> handler_;
   std::shared_ptr<Consumer<ValueType>> cons_;
+  PipelineFusion fusion_;
 
   explicit Pipeline(const std::shared_ptr<Producer<ValueType>> &prod,
                     const std::shared_ptr<std::vector<std::shared_ptr<Handler<ValueType>>>> &handler,
-                    const std::shared_ptr<Consumer<ValueType>> &cons)
-      : prod_(prod), handler_(handler), cons_(cons) {
+                    const std::shared_ptr<Consumer<ValueType>> &cons,
+                    PipelineFusion fusion = PipelineFusion::kNone)
+      : prod_(prod), handler_(handler), cons_(cons), fusion_(fusion) {
     throw_if_empty(prod_, TraceException::kProducerIsNull, source_loc::current());
     throw_if_empty(handler_, TraceException::kHandlerIsNull, source_loc::current());
     for (std::shared_ptr<Handler<ValueType>> &han : *handler_) {
@@ -88,6 +119,35 @@ class Pipeline {
   }
 };
 
+template<typename ValueType>
+using HandlerChain = std::vector<std::shared_ptr<Handler<ValueType>>>;
+
+// A task of a running pipeline, either the producer (handler_ is null) or a handler. Each
+// stage applies its fused handlers inline to every value it would pass on.
+template<typename ValueType>
+struct PipelineStage {
+  std::shared_ptr<Handler<ValueType>> handler_ = nullptr;
+  HandlerChain<ValueType> fused_;
+};
+
+template<typename ValueType>
+inline std::vector<PipelineStage<ValueType>> SplitIntoStages(const Pipeline<ValueType> &pipeline) {
+  throw_if_empty(pipeline.handler_, TraceException::kHandlerIsNull, source_loc::current());
+
+  std::vector<PipelineStage<ValueType>> stages(1);
+  for (const std::shared_ptr<Handler<ValueType>> &handler : *pipeline.handler_) {
+    throw_if_empty(handler, TraceException::kHandlerIsNull, source_loc::current());
+    const bool fuse = pipeline.fusion_ == PipelineFusion::kAll
+        or (pipeline.fusion_ == PipelineFusion::kAuto and handler->IsCheap());
+    if (fuse) {
+      stages.back().fused_.push_back(handler);
+    } else {
+      stages.push_back(PipelineStage<ValueType>{handler, {}});
+    }
+  }
+  return stages;
+}
+
 template<typename ValueType>
 inline concurrencpp::result<std::optional<ValueType>>
 ProduceTask(concurrencpp::executor_tag,
@@ -100,7 +160,8 @@ template<typename ValueType>
 inline concurrencpp::result<void> Produce(concurrencpp::executor_tag,
                                           std::shared_ptr<concurrencpp::executor> tpe,
                                           std::shared_ptr<Producer<ValueType>> producer,
-                                          std::shared_ptr<CoroChannel<ValueType>> tar_chan) {
+                                          std::shared_ptr<CoroChannel<ValueType>> tar_chan,
+                                          HandlerChain<ValueType> fused = {}) {
   throw_if_empty(tpe, TraceException::kResumeExecutorNull, source_loc::current());
   throw_if_empty(tar_chan, TraceException::kChannelIsNull, source_loc::current());
   throw_if_empty(producer, TraceException::kProducerIsNull, source_loc::current());
@@ -111,6 +172,13 @@ inline concurrencpp::result<void> Produce(concurrencpp::executor_tag,
     if (not value.has_value()) {
       break;
     }
+    bool pass_on = true;
+    for (auto iter = fused.begin(); pass_on and iter != fused.end(); ++iter) {
+      pass_on = co_await (*iter)->handel(tpe, *value);
+    }
+    if (not pass_on) {
+      continue;
+    }
     const bool could_push = co_await tar_chan->Push(tpe, *value);
 //    tar_chan->PokeAwaiters();
     throw_on(not could_push,
@@ -148,6 +216,7 @@ inline concurrencpp::result<void> Consume(concurrencpp::executor_tag,
     spdlog::trace("consumer consume next event");
     co_await ConsumeTask<ValueType>({}, tpe, consumer, value);
   }
+  co_await consumer->finish(tpe);
 
   co_return;
 }
@@ -166,7 +235,8 @@ inline concurrencpp::result<void> Handel(concurrencpp::executor_tag,
                                          std::shared_ptr<concurrencpp::executor> tpe,
                                          std::shared_ptr<Handler<ValueType>> handler,
                                          std::shared_ptr<CoroChannel<ValueType>> src_chan,
-                                         std::shared_ptr<CoroChannel<ValueType>> tar_chan) {
+                                         std::shared_ptr<CoroChannel<ValueType>> tar_chan,
+                                         HandlerChain<ValueType> fused = {}) {
   throw_if_empty(tpe, TraceException::kResumeExecutorNull, source_loc::current());
   throw_if_empty(src_chan, TraceException::kChannelIsNull, source_loc::current());
   throw_if_empty(tar_chan, TraceException::kChannelIsNull, source_loc::current());
@@ -178,7 +248,10 @@ inline concurrencpp::result<void> Handel(concurrencpp::executor_tag,
     ValueType value = *opt_val;
 
     spdlog::trace("handler handel next event");
-    const bool pass_on = co_await HandelTask<ValueType>({}, tpe, handler, value);
+    bool pass_on = co_await HandelTask<ValueType>({}, tpe, handler, value);
+    for (auto iter = fused.begin(); pass_on and iter != fused.end(); ++iter) {
+      pass_on = co_await (*iter)->handel(tpe, value);
+    }
 
     if (pass_on) {
       spdlog::trace("handler pass on next event");
@@ -201,23 +274,23 @@ inline concurrencpp::result<void> RunPipelineImpl(std::shared_ptr<concurrencpp::
   throw_if_empty(tpe, TraceException::kResumeExecutorNull, source_loc::current());
   throw_if_empty(pipeline, TraceException::kPipelineNull, source_loc::current());
 
-  const size_t amount_channels = pipeline->handler_->size() + 1;
+  const std::vector<PipelineStage<ValueType>> stages = SplitIntoStages(*pipeline);
+  const size_t amount_channels = stages.size();
   std::vector<std::shared_ptr<CoroChannel<ValueType>>> channels{amount_channels};
   std::vector<concurrencpp::result<void>> tasks{amount_channels + 1};
 
+  // NOTE: every internal edge has exactly one pushing and one popping task, hence the
+  // wait-free single producer single consumer channel can be used
   // start producer
-  channels[0] = create_shared<CoroBoundedChannel<ValueType>>(TraceException::kChannelIsNull);
+  channels[0] = create_shared<CoroSpscChannel<ValueType>>(TraceException::kChannelIsNull);
   throw_if_empty(pipeline->prod_, TraceException::kProducerIsNull, source_loc::current());
-  tasks[0] = Produce({}, tpe, pipeline->prod_, channels[0]);
+  tasks[0] = Produce({}, tpe, pipeline->prod_, channels[0], stages[0].fused_);
   // start handler
-  for (int index = 0; index < pipeline->handler_->size(); index++) {
-    auto &handl = *(pipeline->handler_);
-    auto &handler = handl[index];
-    throw_if_empty(handler, TraceException::kHandlerIsNull, source_loc::current());
-
-    channels[index + 1] = create_shared<CoroBoundedChannel<ValueType>>(TraceException::kChannelIsNull);
+  for (size_t index = 1; index < stages.size(); index++) {
+    channels[index] = create_shared<CoroSpscChannel<ValueType>>(TraceException::kChannelIsNull);
 
-    tasks[index + 1] = Handel({}, tpe, handler, channels[index], channels[index + 1]);
+    tasks[index] = Handel({}, tpe, stages[index].handler_, channels[index - 1], channels[index],
+                          stages[index].fused_);
   }
   // start consumer
   throw_if_empty(pipeline->cons_, TraceException::kConsumerIsNull, source_loc::current());
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "sync/corobelt.h"
+#include "events/events.h"
+#include "util/exception.h"
+
+#ifndef SIMBRICKS_TRACE_INCLUDE_SYNC_MERGING_PRODUCER_H_
+#define SIMBRICKS_TRACE_INCLUDE_SYNC_MERGING_PRODUCER_H_
+
+// default amount of values buffered per source
+inline constexpr size_t kMergingProducerLookahead = 64;
+
+// Merges several sources, each producing values in order, into a single ordered stream using a
+// loser tree: every value costs log2(#sources) comparisons. Per source at most lookahead values
+// are buffered, so memory stays constant no matter how long the sources are. Values comparing
+// equal are emitted in the order of their sources.
+template<typename ValueType, typename Less = std::less<ValueType>>
+class MergingProducer : public Producer<ValueType> {
+  struct Source {
+    std::shared_ptr<Producer<ValueType>> producer_;
+    std::vector<ValueType> batch_;
+    size_t pos_ = 0;
+    bool exhausted_ = false;
+  };
+
+  std::vector<Source> sources_;
+  const size_t lookahead_;
+  Less less_;
+  // amount of leaves of the tree, a power of two, leaves without source count as exhausted
+  size_t leaves_ = 1;
+  // losers_[0] is the overall winner, losers_[node] the loser of the match at internal node
+  std::vector<size_t> losers_;
+  bool initialized_ = false;
+
+  bool IsDone(size_t source) const {
+    return source >= sources_.size() or sources_[source].pos_ >= sources_[source].batch_.size();
+  }
+
+  // returns true if the head of source first is emitted before the head of source second
+  bool Beats(size_t first, size_t second) const {
+    if (IsDone(first)) {
+      return false;
+    }
+    if (IsDone(second)) {
+      return true;
+    }
+    const ValueType &first_head = sources_[first].batch_[sources_[first].pos_];
+    const ValueType &second_head = sources_[second].batch_[sources_[second].pos_];
+    if (less_(first_head, second_head)) {
+      return true;
+    }
+    return not less_(second_head, first_head) and first < second;
+  }
+
+  // plays the matches of the subtree rooted at node, returns the winner
+  size_t Build(size_t node) {
+    if (node >= leaves_) {
+      return node - leaves_;
+    }
+    const size_t left = Build(2 * node);
+    const size_t right = Build(2 * node + 1);
+    if (Beats(right, left)) {
+      losers_[node] = left;
+      return right;
+    }
+    losers_[node] = right;
+    return left;
+  }
+
+  // replays the matches from the leaf of source up to the root after its head changed
+  void Replay(size_t source) {
+    size_t winner = source;
+    for (size_t node = (source + leaves_) / 2; node > 0; node /= 2) {
+      if (Beats(losers_[node], winner)) {
+        std::swap(losers_[node], winner);
+      }
+    }
+    losers_[0] = winner;
+  }
+
+  concurrencpp::lazy_result<void> Refill(std::shared_ptr<concurrencpp::executor> executor, Source &source) {
+    source.batch_.clear();
+    source.pos_ = 0;
+    while (not source.exhausted_ and source.batch_.size() < lookahead_) {
+      std::optional<ValueType> value = co_await source.producer_->produce(executor);
+      if (not value.has_value()) {
+        source.exhausted_ = true;
+        break;
+      }
+      source.batch_.push_back(std::move(*value));
+    }
+    co_return;
+  }
+
+ public:
+  explicit MergingProducer(std::vector<std::shared_ptr<Producer<ValueType>>> producers,
+                           size_t lookahead = kMergingProducerLookahead,
+                           Less less = Less{})
+      : Producer<ValueType>(), lookahead_(lookahead), less_(std::move(less)) {
+    throw_on(producers.empty(), "MergingProducer: no sources given", source_loc::current());
+    throw_on(lookahead_ == 0, "MergingProducer: lookahead is 0", source_loc::current());
+    sources_.resize(producers.size());
+    for (size_t index = 0; index < producers.size(); ++index) {
+      throw_if_empty(producers[index], TraceException::kProducerIsNull, source_loc::current());
+      sources_[index].producer_ = std::move(producers[index]);
+      sources_[index].batch_.reserve(lookahead_);
+    }
+    while (leaves_ < sources_.size()) {
+      leaves_ *= 2;
+    }
+    losers_.resize(leaves_, 0);
+  }
+
+  concurrencpp::result<std::optional<ValueType>> produce(std::shared_ptr<concurrencpp::executor> executor) override {
+    if (not initialized_) {
+      for (Source &source : sources_) {
+        co_await Refill(executor, source);
+      }
+      losers_[0] = Build(1);
+      initialized_ = true;
+    }
+
+    const size_t winner = losers_[0];
+    if (IsDone(winner)) {
+      co_return std::nullopt;
+    }
+
+    Source &source = sources_[winner];
+    ValueType value = std::move(source.batch_[source.pos_++]);
+    if (source.pos_ >= source.batch_.size()) {
+      co_await Refill(executor, source);
+    }
+    Replay(winner);
+    co_return value;
+  }
+
+  // conservative, any source that would block may be the one refilled next
+  bool WouldBlock() override {
+    return std::ranges::any_of(sources_, [](Source &source) {
+      return not source.exhausted_ and source.producer_->WouldBlock();
+    });
+  }
+};
+
+struct EventTimestampLess {
+  bool operator()(const std::shared_ptr<Event> &ev1, const std::shared_ptr<Event> &ev2) const {
+    return ev1->GetTs() < ev2->GetTs();
+  }
+};
+
+// merges the events of several providers into a single stream ordered by timestamp
+using EventMergingProducer = MergingProducer<std::shared_ptr<Event>, EventTimestampLess>;
+
+#endif // SIMBRICKS_TRACE_INCLUDE_SYNC_MERGING_PRODUCER_H_
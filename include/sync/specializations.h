@@ -22,16 +22,25 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <chrono>
+#include <string>
 #include <utility>
 
 #include "channel.h"
 #include "corobelt.h"
 #include "events/events.h"
 #include "env/traceEnvironment.h"
+#include "util/metrics.h"
 
 #ifndef SIMBRICKS_TRACE_CORO_SYNC_SPECIALIZATIONS_H_
 #define SIMBRICKS_TRACE_CORO_SYNC_SPECIALIZATIONS_H_
 
+// amount of events that are moved through a pipeline edge at once
+inline constexpr size_t kPipelineBatchSize = 64;
+
+// spanners held back by the skew window for longer than this are reported
+inline constexpr std::chrono::seconds kSkewWindowStallLimit{30};
+
 inline concurrencpp::result<std::optional<std::shared_ptr<Event>>>
 ProduceTask(concurrencpp::executor_tag,
             std::shared_ptr<concurrencpp::executor> tpe,
@@ -39,27 +48,104 @@ ProduceTask(concurrencpp::executor_tag,
   co_return co_await prod->produce(tpe);
 }
 
+// applies the fused handlers of a stage in order, each handler acts on its own copy of
+// the event pointer just like a handler running as own task
+inline concurrencpp::lazy_result<bool> ApplyFused(std::shared_ptr<concurrencpp::executor> tpe,
+                                                  const HandlerChain<std::shared_ptr<Event>> &fused,
+                                                  const std::shared_ptr<Event> &value) {
+  for (const std::shared_ptr<Handler<std::shared_ptr<Event>>> &handler : fused) {
+    std::shared_ptr<Event> to_handel = value;
+    if (not co_await handler->handel(tpe, to_handel)) {
+      co_return false;
+    }
+  }
+  co_return true;
+}
+
+// counts the events a handler passed on and the ones it dropped
+class MeteredHandler : public Handler<std::shared_ptr<Event>> {
+  std::shared_ptr<Handler<std::shared_ptr<Event>>> handler_;
+  std::shared_ptr<MetricCounter> passed_;
+  std::shared_ptr<MetricCounter> dropped_;
+
+ public:
+  explicit MeteredHandler(std::shared_ptr<Handler<std::shared_ptr<Event>>> handler,
+                          MetricsRegistry &registry,
+                          const std::string &pipeline_name,
+                          size_t index)
+      : handler_(std::move(handler)) {
+    throw_if_empty(handler_, TraceException::kHandlerIsNull, source_loc::current());
+    const MetricLabels passed_labels{{"pipeline", pipeline_name}, {"handler", std::to_string(index)},
+                                     {"result", "passed"}};
+    const MetricLabels dropped_labels{{"pipeline", pipeline_name}, {"handler", std::to_string(index)},
+                                      {"result", "dropped"}};
+    passed_ = registry.GetCounter("columbo_handler_events_total", "Events handled by a pipeline handler.",
+                                  passed_labels);
+    dropped_ = registry.GetCounter("columbo_handler_events_total", "Events handled by a pipeline handler.",
+                                   dropped_labels);
+  }
+
+  concurrencpp::result<bool> handel(std::shared_ptr<concurrencpp::executor> executor,
+                                    std::shared_ptr<Event> &value) override {
+    const bool pass_on = co_await handler_->handel(std::move(executor), value);
+    (pass_on ? passed_ : dropped_)->Increment();
+    co_return pass_on;
+  }
+
+  bool IsCheap() const override {
+    return handler_->IsCheap();
+  }
+};
+
+// returns a copy of the pipeline whose handlers are wrapped into metered ones
+inline std::shared_ptr<Pipeline<std::shared_ptr<Event>>>
+MeterPipeline(TraceEnvironment &trace_env,
+              const std::shared_ptr<Pipeline<std::shared_ptr<Event>>> &pipeline,
+              const std::string &pipeline_name) {
+  auto handler = create_shared<std::vector<std::shared_ptr<Handler<std::shared_ptr<Event>>>>>("vector null");
+  handler->reserve(pipeline->handler_->size());
+  for (size_t index = 0; index < pipeline->handler_->size(); index++) {
+    handler->emplace_back(create_shared<MeteredHandler>(TraceException::kHandlerIsNull,
+                                                        (*pipeline->handler_)[index],
+                                                        trace_env.GetMetrics(),
+                                                        pipeline_name,
+                                                        index));
+  }
+  return create_shared<Pipeline<std::shared_ptr<Event>>>(TraceException::kPipelineNull, pipeline->prod_, handler,
+                                                         pipeline->cons_, pipeline->fusion_);
+}
+
 // specialization of corobelt methods
 inline concurrencpp::result<void> Produce(concurrencpp::executor_tag,
                                           std::shared_ptr<concurrencpp::executor> tpe,
                                           std::shared_ptr<Producer<std::shared_ptr<Event>>> producer,
-                                          std::shared_ptr<CoroBoundedChannel<std::shared_ptr<Event>>> tar_chan) {
+                                          std::shared_ptr<CoroChannel<std::shared_ptr<Event>>> tar_chan,
+                                          HandlerChain<std::shared_ptr<Event>> fused = {}) {
   throw_if_empty(tpe, TraceException::kResumeExecutorNull, source_loc::current());
   throw_if_empty(tar_chan, TraceException::kChannelIsNull, source_loc::current());
   throw_if_empty(producer, TraceException::kProducerIsNull, source_loc::current());
 
+  // events are handed on in batches, an incomplete batch is flushed once the producer is exhausted
+  // or would block, live inputs hence do not hold back events until the simulator writes again
+  std::vector<std::shared_ptr<Event>> batch;
+  batch.reserve(kPipelineBatchSize);
   std::optional<std::shared_ptr<Event>> value;
   do {
     value = co_await ProduceTask({}, tpe, producer);
-    if (not value.has_value()) {
-      break;
+    if (value.has_value() and (fused.empty() or co_await ApplyFused(tpe, fused, *value))) {
+      batch.push_back(std::move(*value));
+    }
+    if (batch.empty()) {
+      continue;
+    }
+    if (batch.size() >= kPipelineBatchSize or not value.has_value() or producer->WouldBlock()) {
+      const size_t pushed = co_await tar_chan->PushBatch(tpe, batch);
+      throw_on(pushed != batch.size(),
+               "unable to push next event to target channel",
+               source_loc::current());
+      batch.clear();
     }
-    const bool could_push = co_await tar_chan->Push(tpe, std::move(*value));
-//    tar_chan->PokeAwaiters();
-    throw_on(not could_push,
-             "unable to push next event to target channel",
-             source_loc::current());
-  } while (true);
+  } while (value.has_value());
 
   co_await tar_chan->CloseChannel(tpe);
 
@@ -77,18 +163,21 @@ inline concurrencpp::result<void> ConsumeTask(concurrencpp::executor_tag,
 inline concurrencpp::result<void> Consume(concurrencpp::executor_tag,
                                           std::shared_ptr<concurrencpp::executor> tpe,
                                           std::shared_ptr<Consumer<std::shared_ptr<Event>>> consumer,
-                                          std::shared_ptr<CoroBoundedChannel<std::shared_ptr<Event>>> src_chan) {
+                                          std::shared_ptr<CoroChannel<std::shared_ptr<Event>>> src_chan) {
   throw_if_empty(tpe, TraceException::kResumeExecutorNull, source_loc::current());
   throw_if_empty(src_chan, TraceException::kChannelIsNull, source_loc::current());
   throw_if_empty(consumer, TraceException::kConsumerIsNull, source_loc::current());
 
-  std::optional<std::shared_ptr<Event>> opt_val;
-  for (opt_val = co_await src_chan->Pop(tpe); opt_val.has_value(); opt_val = co_await src_chan->Pop(tpe)) {
-//    src_chan->PokeAwaiters();
-    std::shared_ptr<Event> value = std::move(*opt_val);
-    spdlog::trace("consumer consume next event");
-    co_await ConsumeTask({}, tpe, consumer, std::move(value));
+  std::vector<std::shared_ptr<Event>> batch;
+  batch.reserve(kPipelineBatchSize);
+  while (co_await src_chan->PopBatch(tpe, batch, kPipelineBatchSize) > 0) {
+    for (std::shared_ptr<Event> &value : batch) {
+      spdlog::trace("consumer consume next event");
+      co_await ConsumeTask({}, tpe, consumer, std::move(value));
+    }
+    batch.clear();
   }
+  co_await consumer->finish(tpe);
 
   co_return;
 }
@@ -104,28 +193,36 @@ inline concurrencpp::result<bool> HandelTask(concurrencpp::executor_tag,
 inline concurrencpp::result<void> Handel(concurrencpp::executor_tag,
                                          std::shared_ptr<concurrencpp::executor> tpe,
                                          std::shared_ptr<Handler<std::shared_ptr<Event>>> handler,
-                                         std::shared_ptr<CoroBoundedChannel<std::shared_ptr<Event>>> src_chan,
-                                         std::shared_ptr<CoroBoundedChannel<std::shared_ptr<Event>>> tar_chan) {
+                                         std::shared_ptr<CoroChannel<std::shared_ptr<Event>>> src_chan,
+                                         std::shared_ptr<CoroChannel<std::shared_ptr<Event>>> tar_chan,
+                                         HandlerChain<std::shared_ptr<Event>> fused = {}) {
   throw_if_empty(tpe, TraceException::kResumeExecutorNull, source_loc::current());
   throw_if_empty(src_chan, TraceException::kChannelIsNull, source_loc::current());
   throw_if_empty(tar_chan, TraceException::kChannelIsNull, source_loc::current());
   throw_if_empty(handler, TraceException::kHandlerIsNull, source_loc::current());
 
-  std::optional<std::shared_ptr<Event>> opt_val;
-  for (opt_val = co_await src_chan->Pop(tpe); opt_val.has_value(); opt_val = co_await src_chan->Pop(tpe)) {
-//    src_chan->PokeAwaiters();
-    std::shared_ptr<Event> value = std::move(*opt_val);
-
-    spdlog::trace("handler handel next event");
-    const bool pass_on = co_await HandelTask({}, tpe, handler, value);
+  std::vector<std::shared_ptr<Event>> batch;
+  batch.reserve(kPipelineBatchSize);
+  std::vector<std::shared_ptr<Event>> to_pass_on;
+  to_pass_on.reserve(kPipelineBatchSize);
+  while (co_await src_chan->PopBatch(tpe, batch, kPipelineBatchSize) > 0) {
+    for (std::shared_ptr<Event> &value : batch) {
+      spdlog::trace("handler handel next event");
+      const bool pass_on = co_await HandelTask({}, tpe, handler, value)
+          and (fused.empty() or co_await ApplyFused(tpe, fused, value));
+      if (pass_on) {
+        spdlog::trace("handler pass on next event");
+        to_pass_on.push_back(std::move(value));
+      }
+    }
+    batch.clear();
 
-    if (pass_on) {
-      spdlog::trace("handler pass on next event");
-      const bool could_push = co_await tar_chan->Push(tpe, std::move(value));
-//      tar_chan->PokeAwaiters();
-      throw_on(not could_push,
+    if (not to_pass_on.empty()) {
+      const size_t pushed = co_await tar_chan->PushBatch(tpe, to_pass_on);
+      throw_on(pushed != to_pass_on.size(),
                "unable to push next event to target channel",
                source_loc::current());
+      to_pass_on.clear();
     }
   }
 
@@ -140,23 +237,23 @@ inline concurrencpp::result<void> RunPipelineImpl<std::shared_ptr<Event>>(std::s
   throw_if_empty(tpe, TraceException::kResumeExecutorNull, source_loc::current());
   throw_if_empty(pipeline, TraceException::kPipelineNull, source_loc::current());
 
-  const size_t amount_channels = pipeline->handler_->size() + 1;
-  std::vector<std::shared_ptr<CoroBoundedChannel<std::shared_ptr<Event>>>> channels{amount_channels};
+  const std::vector<PipelineStage<std::shared_ptr<Event>>> stages = SplitIntoStages(*pipeline);
+  const size_t amount_channels = stages.size();
+  std::vector<std::shared_ptr<CoroChannel<std::shared_ptr<Event>>>> channels{amount_channels};
   std::vector<concurrencpp::result<void>> tasks{amount_channels + 1};
 
+  // NOTE: every internal edge has exactly one pushing and one popping task, hence the
+  // wait-free single producer single consumer channel can be used
   // start producer
-  channels[0] = create_shared<CoroBoundedChannel<std::shared_ptr<Event>>>(TraceException::kChannelIsNull);
+  channels[0] = create_shared<CoroSpscChannel<std::shared_ptr<Event>>>(TraceException::kChannelIsNull);
   throw_if_empty(pipeline->prod_, TraceException::kProducerIsNull, source_loc::current());
-  tasks[0] = Produce({}, tpe, pipeline->prod_, channels[0]);
+  tasks[0] = Produce({}, tpe, pipeline->prod_, channels[0], stages[0].fused_);
   // start handler
-  for (int index = 0; index < pipeline->handler_->size(); index++) {
-    auto &handl = *(pipeline->handler_);
-    auto &handler = handl[index];
-    throw_if_empty(handler, TraceException::kHandlerIsNull, source_loc::current());
-
-    channels[index + 1] = create_shared<CoroBoundedChannel<std::shared_ptr<Event>>>(TraceException::kChannelIsNull);
+  for (size_t index = 1; index < stages.size(); index++) {
+    channels[index] = create_shared<CoroSpscChannel<std::shared_ptr<Event>>>(TraceException::kChannelIsNull);
 
-    tasks[index + 1] = Handel({}, tpe, handler, channels[index], channels[index + 1]);
+    tasks[index] = Handel({}, tpe, stages[index].handler_, channels[index - 1], channels[index],
+                          stages[index].fused_);
   }
   // start consumer
   throw_if_empty(pipeline->cons_, TraceException::kConsumerIsNull, source_loc::current());
@@ -176,31 +273,61 @@ inline concurrencpp::result<void> RunPipelineImpl<std::shared_ptr<Event>>(std::s
 
 inline concurrencpp::result<void> RunPipelineImpl(std::shared_ptr<concurrencpp::executor> executor,
                                                   TraceEnvironment &trace_env,
-                                                  std::shared_ptr<Pipeline<std::shared_ptr<Event>>> pipeline) {
+                                                  std::shared_ptr<Pipeline<std::shared_ptr<Event>>> pipeline,
+                                                  std::string pipeline_name = "pipeline",
+                                                  std::shared_ptr<ChannelCapacityBudget> budget = nullptr) {
   throw_if_empty(pipeline, TraceException::kPipelineNull, source_loc::current());
+  const TraceEnvConfig config = trace_env.GetConfig();
+  // fusion is opt in, pipelines that did not choose a mode themselves follow the configuration
+  if (config.ShouldFuseCheapHandlers() and pipeline->fusion_ == PipelineFusion::kNone) {
+    pipeline = create_shared<Pipeline<std::shared_ptr<Event>>>(TraceException::kPipelineNull, pipeline->prod_,
+                                                               pipeline->handler_, pipeline->cons_,
+                                                               PipelineFusion::kAuto);
+  }
+  if (config.IsMetricsEnabled()) {
+    pipeline = MeterPipeline(trace_env, pipeline, pipeline_name);
+  }
 
-  const size_t amount_channels = pipeline->handler_->size() + 1;
-  std::vector<std::shared_ptr<CoroBoundedChannel<std::shared_ptr<Event>>>> channels{amount_channels};
+  const std::vector<PipelineStage<std::shared_ptr<Event>>> stages = SplitIntoStages(*pipeline);
+  const size_t amount_channels = stages.size();
+  std::vector<std::shared_ptr<CoroChannel<std::shared_ptr<Event>>>> channels{amount_channels};
   std::vector<concurrencpp::result<void>> tasks{amount_channels + 1};
+  // edge i is the output channel of stage i, stage 0 being the producer including its fused handlers
+  auto create_channel = [&](size_t edge) {
+    const std::string edge_name = pipeline_name + ".edge-" + std::to_string(edge);
+    const size_t capacity = config.GetChannelCapacity(edge_name, config.GetPipelineChannelCapacity());
+    // NOTE: every internal edge has exactly one pushing and one popping task, hence the
+    // wait-free single producer single consumer channel can be used unless the edge must
+    // be able to resize itself
+    if (budget) {
+      channels[edge] = create_shared<CoroBoundedChannel<std::shared_ptr<Event>>>(
+          TraceException::kChannelIsNull, capacity, budget);
+    } else {
+      channels[edge] = create_shared<CoroSpscChannel<std::shared_ptr<Event>>>(
+          TraceException::kChannelIsNull, capacity);
+    }
+    if (config.IsChannelMetricsEnabled()) {
+      channels[edge]->EnableMetrics(trace_env.GetChannelMetrics().Register(edge_name));
+    }
+  };
 
   // start producer
-  channels[0] = create_shared<CoroBoundedChannel<std::shared_ptr<Event>>>(TraceException::kChannelIsNull);
+  create_channel(0);
   throw_if_empty(pipeline->prod_, TraceException::kProducerIsNull, source_loc::current());
-  tasks[0] = Produce({}, trace_env.GetWorkerThreadExecutor(), pipeline->prod_, channels[0]);
+  tasks[0] = Produce({}, trace_env.GetStageExecutor(pipeline_name + ".producer"), pipeline->prod_,
+                     channels[0], stages[0].fused_);
   // start handler
-  for (int index = 0; index < pipeline->handler_->size(); index++) {
-    auto &handl = *(pipeline->handler_);
-    auto &handler = handl[index];
-    throw_if_empty(handler, TraceException::kHandlerIsNull, source_loc::current());
+  for (size_t index = 1; index < stages.size(); index++) {
+    create_channel(index);
 
-    channels[index + 1] = create_shared<CoroBoundedChannel<std::shared_ptr<Event>>>(TraceException::kChannelIsNull);
-
-    tasks[index + 1] = Handel({}, trace_env.GetWorkerThreadExecutor(), handler, channels[index], channels[index + 1]);
+    tasks[index] = Handel({}, trace_env.GetStageExecutor(pipeline_name + ".stage-" + std::to_string(index)),
+                          stages[index].handler_, channels[index - 1], channels[index], stages[index].fused_);
   }
   // start consumer
   throw_if_empty(pipeline->cons_, TraceException::kConsumerIsNull, source_loc::current());
   tasks[amount_channels] =
-      Consume({}, trace_env.GetWorkerThreadExecutor(), pipeline->cons_, channels[amount_channels - 1]);
+      Consume({}, trace_env.GetStageExecutor(pipeline_name + ".consumer"), pipeline->cons_,
+              channels[amount_channels - 1]);
 
   // wait for all tasks to finish
   // NOTE: DO NOT USE concurrencpp::when_all(...) here, is
@@ -233,8 +360,10 @@ inline concurrencpp::result<void> RunPipelineParallelImpl<std::shared_ptr<Event>
 inline concurrencpp::result<void> RunPipelineParallelImpl(concurrencpp::executor_tag,
                                                           std::shared_ptr<concurrencpp::executor> tpe,
                                                           std::shared_ptr<Pipeline<std::shared_ptr<Event>>> pipeline,
-                                                          TraceEnvironment &trace_env) {
-  co_await RunPipelineImpl(tpe, trace_env, pipeline);
+                                                          TraceEnvironment &trace_env,
+                                                          std::string pipeline_name,
+                                                          std::shared_ptr<ChannelCapacityBudget> budget) {
+  co_await RunPipelineImpl(tpe, trace_env, pipeline, std::move(pipeline_name), std::move(budget));
 }
 
 template<>
@@ -265,16 +394,25 @@ inline concurrencpp::result<void> RunPipelinesImpl(TraceEnvironment &trace_env,
                                                        Pipeline<std::shared_ptr<Event>>>>> pipelines) {
   throw_if_empty(pipelines, "vector is null", source_loc::current());
 
+  // all pipelines grow their channels from the same budget
+  std::shared_ptr<ChannelCapacityBudget> budget = nullptr;
+  const size_t budget_slots = trace_env.GetConfig().GetAdaptiveChannelBudget();
+  if (budget_slots > 0) {
+    budget = create_shared<ChannelCapacityBudget>("could not create channel budget", budget_slots);
+  }
+
   std::vector<concurrencpp::result<void>> tasks(pipelines->size());
   for (int index = 0; index < pipelines->size(); index++) {
     std::shared_ptr<Pipeline<std::shared_ptr<Event>>> pipeline = (*pipelines)[index];
     throw_if_empty(pipeline, TraceException::kPipelineNull, source_loc::current());
 
-    tasks[index] = RunPipelineParallelImpl({}, trace_env.GetWorkerThreadExecutor(), pipeline, trace_env);
+    const std::string pipeline_name = "pipeline-" + std::to_string(index);
+    tasks[index] = RunPipelineParallelImpl({}, trace_env.GetStageExecutor(pipeline_name + ".driver"), pipeline,
+                                           trace_env, pipeline_name, budget);
   }
 
   // wait for all tasks to finish
-  auto waiter_pool = trace_env.GetWorkerThreadExecutor();
+  auto waiter_pool = trace_env.GetStageExecutor("pipelines.waiter");
   auto all_done = co_await concurrencpp::when_all(waiter_pool, tasks.begin(), tasks.end());
   for (auto &done : all_done) {
     co_await done;
@@ -295,7 +433,51 @@ inline void RunPipelines(TraceEnvironment &trace_env,
                          std::shared_ptr<std::vector<std::shared_ptr<Pipeline<std::shared_ptr<
                              Event>>>>> pipelines) {
   spdlog::info("start a pipeline");
+  // reports periodically where events back up, the final report is logged on destruction
+  std::unique_ptr<ChannelMetricsReporter> reporter = nullptr;
+  const size_t metrics_interval = trace_env.GetConfig().GetChannelMetricsInterval();
+  if (metrics_interval > 0) {
+    reporter = create_unique<ChannelMetricsReporter>("could not create channel metrics reporter",
+                                                     trace_env.GetChannelMetrics(),
+                                                     std::chrono::seconds{metrics_interval});
+  }
+  // exposes the metrics while the pipelines run, the file receives a final snapshot on destruction
+  const TraceEnvConfig config = trace_env.GetConfig();
+  std::unique_ptr<MetricsHttpServer> metrics_server = nullptr;
+  if (config.GetMetricsPort() > 0) {
+    metrics_server = create_unique<MetricsHttpServer>("could not create metrics server",
+                                                      trace_env.GetMetrics(),
+                                                      config.GetMetricsPort());
+  }
+  std::unique_ptr<MetricsFileWriter> metrics_writer = nullptr;
+  if (not config.GetMetricsFile().empty()) {
+    metrics_writer = create_unique<MetricsFileWriter>("could not create metrics file writer",
+                                                      trace_env.GetMetrics(),
+                                                      config.GetMetricsFile(),
+                                                      std::chrono::seconds{config.GetMetricsInterval()});
+  }
+  // persists the progress of the run, the last checkpoint is written on destruction
+  std::unique_ptr<CheckpointWriter> checkpoint_writer = nullptr;
+  if (config.IsCheckpointingEnabled()) {
+    checkpoint_writer = create_unique<CheckpointWriter>("could not create checkpoint writer",
+                                                        [&trace_env]() { return trace_env.TakeCheckpoint(); },
+                                                        config.GetCheckpointFile(),
+                                                        std::chrono::seconds{config.GetCheckpointInterval()});
+  }
+  // reports spanners that wait for each other, which happens if the window is too small
+  std::unique_ptr<WeakTimerWatchdog> skew_watchdog = nullptr;
+  const std::shared_ptr<WeakTimer> skew_window = trace_env.GetSkewWindow();
+  if (skew_window) {
+    skew_watchdog = create_unique<WeakTimerWatchdog>("could not create skew window watchdog",
+                                                     *skew_window,
+                                                     kSkewWindowStallLimit);
+  }
   RunPipelinesImpl(trace_env, std::move(pipelines)).get();
+  skew_watchdog = nullptr;
+  checkpoint_writer = nullptr;
+  metrics_writer = nullptr;
+  metrics_server = nullptr;
+  reporter = nullptr;
   spdlog::info("finished a pipeline");
 }
 
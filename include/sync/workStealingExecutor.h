@@ -0,0 +1,237 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "concurrencpp/concurrencpp.h"
+
+#include "util/exception.h"
+
+#ifndef SIMBRICKS_TRACE_INCLUDE_SYNC_WORK_STEALING_EXECUTOR_H_
+#define SIMBRICKS_TRACE_INCLUDE_SYNC_WORK_STEALING_EXECUTOR_H_
+
+// Executor running tasks on a fixed amount of worker threads, each owning a deque of runnable
+// tasks. Tasks enqueued from a worker stay on its deque, idle workers steal from randomly
+// chosen victims and sleep once there is nothing left to steal.
+//
+// NOTE: a pipeline stage is a single coroutine and can therefore only be resumed once at a
+// time, its resumptions may run on any worker but never concurrently or out of order.
+class WorkStealingExecutor final : public concurrencpp::executor {
+  struct alignas(64) Worker {
+    std::mutex queue_mutex_;
+    std::deque<concurrencpp::task> queue_;
+    std::thread thread_;
+  };
+
+  const size_t amount_workers_;
+  std::unique_ptr<Worker[]> workers_;
+  std::atomic<size_t> next_worker_{0};
+
+  // amount of enqueued but not yet started tasks across all workers
+  std::atomic<size_t> pending_{0};
+  std::atomic<size_t> sleeping_{0};
+  std::atomic<bool> shutdown_{false};
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+
+  std::atomic<size_t> amount_executed_{0};
+  std::atomic<size_t> amount_stolen_{0};
+
+  inline static thread_local const WorkStealingExecutor *current_executor_ = nullptr;
+  inline static thread_local size_t current_worker_ = 0;
+
+  size_t SelectWorker() {
+    if (current_executor_ == this) {
+      return current_worker_;
+    }
+    return next_worker_.fetch_add(1, std::memory_order_relaxed) % amount_workers_;
+  }
+
+  void WakeWorker() {
+    // NOTE: pending_ is increased before reading sleeping_ while a worker increases sleeping_
+    // before reading pending_, hence at least one of both sees the others update
+    if (sleeping_.load() > 0) {
+      const std::lock_guard<std::mutex> guard{idle_mutex_};
+      idle_cv_.notify_one();
+    }
+  }
+
+  bool TryPopOwn(size_t index, concurrencpp::task &task) {
+    Worker &worker = workers_[index];
+    const std::lock_guard<std::mutex> guard{worker.queue_mutex_};
+    if (worker.queue_.empty()) {
+      return false;
+    }
+    task = std::move(worker.queue_.front());
+    worker.queue_.pop_front();
+    return true;
+  }
+
+  bool TrySteal(size_t index, std::minstd_rand &random, concurrencpp::task &task) {
+    const size_t start = random() % amount_workers_;
+    for (size_t offset = 0; offset < amount_workers_; offset++) {
+      const size_t victim = (start + offset) % amount_workers_;
+      if (victim == index) {
+        continue;
+      }
+      Worker &worker = workers_[victim];
+      const std::lock_guard<std::mutex> guard{worker.queue_mutex_};
+      if (worker.queue_.empty()) {
+        continue;
+      }
+      task = std::move(worker.queue_.back());
+      worker.queue_.pop_back();
+      amount_stolen_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  void Work(size_t index) {
+    current_executor_ = this;
+    current_worker_ = index;
+    std::minstd_rand random{static_cast<std::minstd_rand::result_type>(index + 1)};
+
+    concurrencpp::task task;
+    while (not shutdown_.load(std::memory_order_relaxed)) {
+      if (TryPopOwn(index, task) or TrySteal(index, random, task)) {
+        pending_.fetch_sub(1);
+        task();
+        task.clear();
+        amount_executed_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+
+      std::unique_lock lock{idle_mutex_};
+      sleeping_.fetch_add(1);
+      idle_cv_.wait(lock, [this] { return pending_.load() > 0 or shutdown_.load(); });
+      sleeping_.fetch_sub(1);
+    }
+
+    current_executor_ = nullptr;
+  }
+
+ public:
+  explicit WorkStealingExecutor(size_t amount_workers, std::string_view name = "work-stealing-executor")
+      : concurrencpp::executor(name),
+        amount_workers_(amount_workers),
+        workers_(std::make_unique<Worker[]>(amount_workers)) {
+    throw_on(amount_workers_ == 0, "WorkStealingExecutor: amount_workers is 0", source_loc::current());
+    for (size_t index = 0; index < amount_workers_; index++) {
+      workers_[index].thread_ = std::thread{&WorkStealingExecutor::Work, this, index};
+    }
+  }
+
+  WorkStealingExecutor(const WorkStealingExecutor &) = delete;
+
+  WorkStealingExecutor &operator=(const WorkStealingExecutor &) = delete;
+
+  ~WorkStealingExecutor() noexcept override {
+    shutdown();
+  }
+
+  void enqueue(concurrencpp::task task) override {
+    if (shutdown_requested()) {
+      throw concurrencpp::errors::runtime_shutdown(name + " - shutdown has been called on this executor");
+    }
+
+    Worker &worker = workers_[SelectWorker()];
+    {
+      const std::lock_guard<std::mutex> guard{worker.queue_mutex_};
+      worker.queue_.push_back(std::move(task));
+    }
+    pending_.fetch_add(1);
+    WakeWorker();
+  }
+
+  void enqueue(std::span<concurrencpp::task> tasks) override {
+    if (shutdown_requested()) {
+      throw concurrencpp::errors::runtime_shutdown(name + " - shutdown has been called on this executor");
+    }
+
+    // spread the tasks, a worker enqueueing keeps them and lets the others steal
+    for (concurrencpp::task &task : tasks) {
+      Worker &worker = workers_[SelectWorker()];
+      {
+        const std::lock_guard<std::mutex> guard{worker.queue_mutex_};
+        worker.queue_.push_back(std::move(task));
+      }
+      pending_.fetch_add(1);
+    }
+    if (sleeping_.load() > 0) {
+      const std::lock_guard<std::mutex> guard{idle_mutex_};
+      idle_cv_.notify_all();
+    }
+  }
+
+  int max_concurrency_level() const noexcept override {
+    return static_cast<int>(amount_workers_);
+  }
+
+  bool shutdown_requested() const override {
+    return shutdown_.load();
+  }
+
+  void shutdown() override {
+    if (shutdown_.exchange(true)) {
+      return;
+    }
+
+    {
+      const std::lock_guard<std::mutex> guard{idle_mutex_};
+      idle_cv_.notify_all();
+    }
+    for (size_t index = 0; index < amount_workers_; index++) {
+      Worker &worker = workers_[index];
+      if (worker.thread_.get_id() == std::this_thread::get_id()) {
+        // NOTE: shutdown was called from within a task, the worker leaves its loop on return
+        worker.thread_.detach();
+      } else if (worker.thread_.joinable()) {
+        worker.thread_.join();
+      }
+      const std::lock_guard<std::mutex> guard{worker.queue_mutex_};
+      worker.queue_.clear();
+    }
+  }
+
+  size_t GetAmountExecuted() const {
+    return amount_executed_.load(std::memory_order_relaxed);
+  }
+
+  size_t GetAmountStolen() const {
+    return amount_stolen_.load(std::memory_order_relaxed);
+  }
+};
+
+#endif // SIMBRICKS_TRACE_INCLUDE_SYNC_WORK_STEALING_EXECUTOR_H_
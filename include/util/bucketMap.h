@@ -0,0 +1,96 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#ifndef SIMBRICKS_TRACE_BUCKETMAP_H_
+#define SIMBRICKS_TRACE_BUCKETMAP_H_
+
+// Map from a key to a bucket of values that keeps the insertion order within each bucket. A
+// search only visits the values stored under one key instead of every value, which makes lookups
+// O(1) as long as few values share a key. Empty buckets are removed right away.
+//
+// NOTE: this class is not thread safe, the owner must synchronize accesses
+template<typename KeyType, typename ValueType>
+class BucketMap {
+  using BucketT = std::list<ValueType>;
+
+  std::unordered_map<KeyType, BucketT> buckets_;
+  size_t size_ = 0;
+
+ public:
+  void Insert(const KeyType &key, ValueType value) {
+    buckets_[key].push_back(std::move(value));
+    ++size_;
+  }
+
+  // returns the first value in insertion order stored under key for which the predicate holds,
+  // nullptr otherwise; the predicate may modify the values it is called on
+  template<typename PredicateType>
+  ValueType *FindIf(const KeyType &key, PredicateType &&predicate) {
+    auto iter = buckets_.find(key);
+    if (iter == buckets_.end()) {
+      return nullptr;
+    }
+    for (ValueType &value : iter->second) {
+      if (predicate(value)) {
+        return &value;
+      }
+    }
+    return nullptr;
+  }
+
+  // removes the first occurrence of value stored under key, returns false if there is none
+  bool Remove(const KeyType &key, const ValueType &value) {
+    auto iter = buckets_.find(key);
+    if (iter == buckets_.end()) {
+      return false;
+    }
+    BucketT &bucket = iter->second;
+    for (auto val_iter = bucket.begin(); val_iter != bucket.end(); ++val_iter) {
+      if (*val_iter == value) {
+        bucket.erase(val_iter);
+        if (bucket.empty()) {
+          buckets_.erase(iter);
+        }
+        --size_;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  [[nodiscard]] size_t Size() const {
+    return size_;
+  }
+
+  [[nodiscard]] bool Empty() const {
+    return size_ == 0;
+  }
+};
+
+#endif //SIMBRICKS_TRACE_BUCKETMAP_H_
@@ -38,6 +38,7 @@ concept ContextInterface = requires(Type con)
   { con.GetTraceId() } -> std::convertible_to<uint64_t>;
   { con.GetParentId() } -> std::convertible_to<uint64_t>;
   { con.GetParentStartingTs() } -> std::convertible_to<uint64_t>;
+  { con.GetParentReplayTs() } -> std::convertible_to<uint64_t>;
 };
 
 template<typename ToPrint>
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifndef SIMBRICKS_TRACE_HAZARD_POINTERS_H_
+#define SIMBRICKS_TRACE_HAZARD_POINTERS_H_
+
+inline constexpr size_t kHazardPointerSlots = 128;
+
+// Hazard pointers for lock-free structures linking nodes through plain pointers. A thread
+// announces the node it is about to dereference in a slot, a retired node is only deleted
+// once no slot announces it anymore. Nodes are retired through an intrusive list, hence
+// NodeType must provide a 'NodeType *retired_next_' member.
+//
+// NOTE: a guard must only be held within a function that does not suspend, slots are not
+// bound to threads and there must not be more concurrently held guards than slots
+template<typename NodeType, size_t Slots = kHazardPointerSlots>
+class HazardPointerDomain {
+
+  struct alignas(64) Slot {
+    std::atomic<bool> owned_{false};
+    std::atomic<NodeType *> hazard_{nullptr};
+  };
+
+  std::array<Slot, Slots> slots_;
+  std::atomic<NodeType *> retired_{nullptr};
+  std::atomic<size_t> retired_count_{0};
+  std::atomic<bool> reclaiming_{false};
+
+  void PushRetired(NodeType *node) {
+    NodeType *head = retired_.load(std::memory_order_relaxed);
+    do {
+      node->retired_next_ = head;
+    } while (not retired_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  Slot &AcquireSlot() {
+    // threads start looking at different slots such that they rarely compete for one
+    static thread_local const size_t kHint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    for (size_t index = kHint;; ++index) {
+      Slot &slot = slots_[index % Slots];
+      if (not slot.owned_.load(std::memory_order_relaxed)
+          and not slot.owned_.exchange(true, std::memory_order_acquire)) {
+        return slot;
+      }
+    }
+  }
+
+ public:
+  class Guard {
+    Slot &slot_;
+
+   public:
+    explicit Guard(HazardPointerDomain &domain) : slot_(domain.AcquireSlot()) {
+    }
+
+    Guard(const Guard &) = delete;
+
+    Guard &operator=(const Guard &) = delete;
+
+    ~Guard() {
+      slot_.hazard_.store(nullptr, std::memory_order_release);
+      slot_.owned_.store(false, std::memory_order_release);
+    }
+
+    // loads the pointer and announces it, the returned node stays valid until the next call
+    // or the guard is destroyed
+    // NOTE: a node may only be retired after it became unreachable from source
+    NodeType *Protect(const std::atomic<NodeType *> &source) {
+      NodeType *node = source.load(std::memory_order_acquire);
+      while (true) {
+        slot_.hazard_.store(node, std::memory_order_seq_cst);
+        NodeType *reloaded = source.load(std::memory_order_seq_cst);
+        if (reloaded == node) {
+          return node;
+        }
+        node = reloaded;
+      }
+    }
+  };
+
+  HazardPointerDomain() = default;
+
+  HazardPointerDomain(const HazardPointerDomain &) = delete;
+
+  HazardPointerDomain &operator=(const HazardPointerDomain &) = delete;
+
+  ~HazardPointerDomain() {
+    NodeType *node = retired_.exchange(nullptr);
+    while (node) {
+      NodeType *next = node->retired_next_;
+      delete node;
+      node = next;
+    }
+  }
+
+  // hands an unreachable node to the domain which deletes it once it is not protected anymore
+  void Retire(NodeType *node) {
+    PushRetired(node);
+    retired_count_.fetch_add(1, std::memory_order_relaxed);
+    Reclaim();
+  }
+
+  // deletes the retired nodes no slot announces; if another thread is reclaiming already,
+  // this call returns right away instead of waiting for it
+  void Reclaim() {
+    if (reclaiming_.exchange(true, std::memory_order_acquire)) {
+      return;
+    }
+
+    // the retired nodes are taken before the slots are scanned, a node retired in between might
+    // otherwise be announced after the scan and still be deleted
+    NodeType *node = retired_.exchange(nullptr, std::memory_order_seq_cst);
+    std::vector<NodeType *> hazards;
+    hazards.reserve(Slots);
+    for (const Slot &slot : slots_) {
+      NodeType *hazard = slot.hazard_.load(std::memory_order_seq_cst);
+      if (hazard) {
+        hazards.push_back(hazard);
+      }
+    }
+
+    size_t reclaimed = 0;
+    while (node) {
+      NodeType *next = node->retired_next_;
+      if (std::find(hazards.begin(), hazards.end(), node) == hazards.end()) {
+        delete node;
+        ++reclaimed;
+      } else {
+        PushRetired(node);
+      }
+      node = next;
+    }
+    retired_count_.fetch_sub(reclaimed, std::memory_order_relaxed);
+    reclaiming_.store(false, std::memory_order_release);
+  }
+
+  size_t GetRetiredCount() const {
+    return retired_count_.load(std::memory_order_relaxed);
+  }
+};
+
+#endif  // SIMBRICKS_TRACE_HAZARD_POINTERS_H_
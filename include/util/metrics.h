@@ -0,0 +1,476 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+#include "util/exception.h"
+#include "util/factory.h"
+
+#ifndef SIMBRICKS_TRACE_INCLUDE_UTIL_METRICS_H_
+#define SIMBRICKS_TRACE_INCLUDE_UTIL_METRICS_H_
+
+using MetricLabels = std::map<std::string, std::string>;
+
+// upper bounds in seconds of the buckets latency histograms use by default
+inline const std::vector<double> kMetricLatencyBuckets{
+    0.000'001, 0.000'01, 0.000'1, 0.001, 0.01, 0.1, 1.0, 10.0, 60.0};
+
+// writes the labels in prometheus text format, e.g. {pipeline="pipeline-0",le="0.1"}
+inline void WriteMetricLabels(std::ostream &out, const MetricLabels &labels,
+                              const std::string &extra_key = "", const std::string &extra_value = "") {
+  if (labels.empty() and extra_key.empty()) {
+    return;
+  }
+  auto write_label = [&out](const std::string &key, const std::string &value) {
+    out << key << "=\"";
+    for (const char chr : value) {
+      switch (chr) {
+        case '\\':out << "\\\\";
+          break;
+        case '"':out << "\\\"";
+          break;
+        case '\n':out << "\\n";
+          break;
+        default:out << chr;
+      }
+    }
+    out << '"';
+  };
+
+  out << '{';
+  const char *separator = "";
+  for (const auto &[key, value] : labels) {
+    out << separator;
+    write_label(key, value);
+    separator = ",";
+  }
+  if (not extra_key.empty()) {
+    out << separator;
+    write_label(extra_key, extra_value);
+  }
+  out << '}';
+}
+
+inline void WriteMetricHeader(std::ostream &out, const std::string &name, const std::string &help,
+                              const char *type) {
+  out << "# HELP " << name << ' ' << help << '\n';
+  out << "# TYPE " << name << ' ' << type << '\n';
+}
+
+template<typename ValueType>
+inline void WriteMetricSample(std::ostream &out, const std::string &name, const MetricLabels &labels,
+                              ValueType value) {
+  out << name;
+  WriteMetricLabels(out, labels);
+  out << ' ' << value << '\n';
+}
+
+// Monotonically increasing value, updated with relaxed atomics.
+class MetricCounter {
+  std::atomic<uint64_t> value_{0};
+
+ public:
+  inline void Increment(uint64_t amount = 1) {
+    value_.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  uint64_t GetValue() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+  void Write(std::ostream &out, const std::string &name, const MetricLabels &labels) const {
+    WriteMetricSample(out, name, labels, GetValue());
+  }
+
+  static constexpr const char *kType = "counter";
+};
+
+// Value that may go up and down, e.g. the amount of pending spans.
+class MetricGauge {
+  std::atomic<int64_t> value_{0};
+
+ public:
+  inline void Set(int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  inline void Add(int64_t amount) {
+    value_.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  int64_t GetValue() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+  void Write(std::ostream &out, const std::string &name, const MetricLabels &labels) const {
+    WriteMetricSample(out, name, labels, GetValue());
+  }
+
+  static constexpr const char *kType = "gauge";
+};
+
+// Histogram with fixed bucket upper bounds. As for the channel metrics, a snapshot taken while
+// observations are made is not necessarily consistent across buckets.
+class MetricHistogram {
+  const std::vector<double> bounds_;
+  // one bucket per bound plus the +Inf bucket, not cumulative
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<double> sum_{0.0};
+
+ public:
+  explicit MetricHistogram(std::vector<double> bounds)
+      : bounds_(std::move(bounds)), buckets_(std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1)) {
+    throw_on(not std::is_sorted(bounds_.begin(), bounds_.end()), "histogram bounds are not sorted",
+             source_loc::current());
+  }
+
+  inline void Observe(double value) {
+    const size_t bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  inline void Observe(std::chrono::nanoseconds duration) {
+    Observe(std::chrono::duration<double>(duration).count());
+  }
+
+  uint64_t GetCount() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  double GetSum() const {
+    return sum_.load(std::memory_order_relaxed);
+  }
+
+  void Write(std::ostream &out, const std::string &name, const MetricLabels &labels) const {
+    uint64_t cumulative = 0;
+    for (size_t bucket = 0; bucket < bounds_.size(); ++bucket) {
+      cumulative += buckets_[bucket].load(std::memory_order_relaxed);
+      std::stringstream bound;
+      bound << bounds_[bucket];
+      out << name << "_bucket";
+      WriteMetricLabels(out, labels, "le", bound.str());
+      out << ' ' << cumulative << '\n';
+    }
+    cumulative += buckets_[bounds_.size()].load(std::memory_order_relaxed);
+    out << name << "_bucket";
+    WriteMetricLabels(out, labels, "le", "+Inf");
+    out << ' ' << cumulative << '\n';
+    WriteMetricSample(out, name + "_sum", labels, GetSum());
+    WriteMetricSample(out, name + "_count", labels, GetCount());
+  }
+
+  static constexpr const char *kType = "histogram";
+};
+
+// Owns all metrics such that they outlive the components updating them. Metrics are created
+// once, usually when a component is constructed, and then updated without touching the
+// registry again.
+class MetricsRegistry {
+  template<typename MetricType>
+  struct Family {
+    std::string help_;
+    std::map<MetricLabels, std::shared_ptr<MetricType>> metrics_;
+  };
+
+  std::mutex registry_mutex_;
+  std::map<std::string, Family<MetricCounter>> counters_;
+  std::map<std::string, Family<MetricGauge>> gauges_;
+  std::map<std::string, Family<MetricHistogram>> histograms_;
+  // write metrics kept elsewhere, e.g. the channel metrics
+  std::vector<std::function<void(std::ostream &)>> collectors_;
+
+  // NOTE: the lock must be held when calling this method
+  bool IsNameTaken(const std::string &name) const {
+    return counters_.contains(name) or gauges_.contains(name) or histograms_.contains(name);
+  }
+
+  template<typename MetricType, typename ...Args>
+  std::shared_ptr<MetricType> GetOrCreate(std::map<std::string, Family<MetricType>> &families,
+                                          const std::string &name,
+                                          const std::string &help,
+                                          const MetricLabels &labels,
+                                          Args &&... args) {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    auto family_it = families.find(name);
+    if (family_it == families.end()) {
+      throw_on(IsNameTaken(name), "metric name is already used by another type", source_loc::current());
+      family_it = families.insert({name, Family<MetricType>{help, {}}}).first;
+    }
+    auto &metrics = family_it->second.metrics_;
+    auto metric_it = metrics.find(labels);
+    if (metric_it == metrics.end()) {
+      auto metric = create_shared<MetricType>("could not create metric", std::forward<Args>(args)...);
+      metric_it = metrics.insert({labels, std::move(metric)}).first;
+    }
+    return metric_it->second;
+  }
+
+  template<typename MetricType>
+  static void WriteFamilies(std::ostream &out, const std::map<std::string, Family<MetricType>> &families) {
+    for (const auto &[name, family] : families) {
+      WriteMetricHeader(out, name, family.help_, MetricType::kType);
+      for (const auto &[labels, metric] : family.metrics_) {
+        metric->Write(out, name, labels);
+      }
+    }
+  }
+
+ public:
+  // returns the counter with the given name and labels, creating it if necessary
+  std::shared_ptr<MetricCounter> GetCounter(const std::string &name, const std::string &help,
+                                            const MetricLabels &labels = {}) {
+    return GetOrCreate(counters_, name, help, labels);
+  }
+
+  std::shared_ptr<MetricGauge> GetGauge(const std::string &name, const std::string &help,
+                                        const MetricLabels &labels = {}) {
+    return GetOrCreate(gauges_, name, help, labels);
+  }
+
+  // NOTE: the bounds are only used when the histogram is created
+  std::shared_ptr<MetricHistogram> GetHistogram(const std::string &name, const std::string &help,
+                                                const MetricLabels &labels = {},
+                                                const std::vector<double> &bounds = kMetricLatencyBuckets) {
+    return GetOrCreate(histograms_, name, help, labels, bounds);
+  }
+
+  void AddCollector(std::function<void(std::ostream &)> collector) {
+    throw_on(not collector, "metrics collector is empty", source_loc::current());
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    collectors_.push_back(std::move(collector));
+  }
+
+  // writes all metrics in the prometheus text exposition format
+  void WritePrometheus(std::ostream &out) {
+    const std::lock_guard<std::mutex> guard{registry_mutex_};
+    WriteFamilies(out, counters_);
+    WriteFamilies(out, gauges_);
+    WriteFamilies(out, histograms_);
+    for (const auto &collector : collectors_) {
+      collector(out);
+    }
+  }
+
+  std::string ToPrometheus() {
+    std::stringstream out;
+    WritePrometheus(out);
+    return out.str();
+  }
+};
+
+// Serves the registry in prometheus text format via HTTP from a background thread. Only
+// GET /metrics is answered, every connection is closed after a single response.
+class MetricsHttpServer {
+  MetricsRegistry &registry_;
+  int listen_fd_ = -1;
+  uint16_t port_ = 0;
+  std::atomic<bool> stop_{false};
+  std::thread server_;
+
+  static constexpr int kPollTimeoutMs = 200;
+  static constexpr size_t kMaxRequestSize = 4096;
+
+  static void SendAll(int socket_fd, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+      const ssize_t res = send(socket_fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+      if (res <= 0) {
+        return;
+      }
+      sent += res;
+    }
+  }
+
+  void Answer(int client_fd) {
+    // the request line is all we care about, it arrives with the first segment
+    std::string request(kMaxRequestSize, '\0');
+    const ssize_t received = recv(client_fd, request.data(), request.size(), 0);
+    if (received <= 0) {
+      return;
+    }
+    request.resize(received);
+
+    std::string status = "404 Not Found";
+    std::string body = "not found\n";
+    if (request.starts_with("GET /metrics ") or request.starts_with("GET /metrics?")) {
+      status = "200 OK";
+      body = registry_.ToPrometheus();
+    }
+
+    std::stringstream response;
+    response << "HTTP/1.1 " << status << "\r\n";
+    response << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+    response << "Content-Length: " << body.size() << "\r\n";
+    response << "Connection: close\r\n\r\n";
+    response << body;
+    SendAll(client_fd, response.str());
+  }
+
+  void Serve() {
+    while (not stop_.load(std::memory_order_acquire)) {
+      pollfd listen_poll{listen_fd_, POLLIN, 0};
+      if (poll(&listen_poll, 1, kPollTimeoutMs) <= 0) {
+        continue;
+      }
+      const int client_fd = accept(listen_fd_, nullptr, nullptr);
+      if (client_fd < 0) {
+        continue;
+      }
+      // a stalled client must not keep the endpoint from shutting down
+      const timeval timeout{1, 0};
+      setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+      Answer(client_fd);
+      close(client_fd);
+    }
+  }
+
+ public:
+  // listens on the loopback interface, port 0 lets the kernel pick a free port
+  MetricsHttpServer(MetricsRegistry &registry, uint16_t port) : registry_(registry) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    throw_on(listen_fd_ < 0, "could not create metrics socket", source_loc::current());
+
+    const int enable = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+        or listen(listen_fd_, SOMAXCONN) != 0) {
+      close(listen_fd_);
+      throw_just(source_loc::current(), "could not listen for metrics on port ", port);
+    }
+
+    socklen_t address_len = sizeof(address);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&address), &address_len);
+    port_ = ntohs(address.sin_port);
+    spdlog::info("serving metrics on http://127.0.0.1:{}/metrics", port_);
+
+    server_ = std::thread{&MetricsHttpServer::Serve, this};
+  }
+
+  MetricsHttpServer(const MetricsHttpServer &) = delete;
+
+  MetricsHttpServer &operator=(const MetricsHttpServer &) = delete;
+
+  ~MetricsHttpServer() {
+    stop_.store(true, std::memory_order_release);
+    server_.join();
+    close(listen_fd_);
+  }
+
+  uint16_t GetPort() const {
+    return port_;
+  }
+};
+
+// Writes the registry periodically to a file from a background thread till it is destroyed,
+// at which point a final snapshot is written. The file is replaced atomically so that readers,
+// e.g. the node exporter textfile collector, never see a partial snapshot.
+class MetricsFileWriter {
+  MetricsRegistry &registry_;
+  const std::string path_;
+  const std::chrono::seconds interval_;
+  std::mutex writer_mutex_;
+  std::condition_variable writer_cv_;
+  bool stop_ = false;
+  std::thread writer_;
+
+  void WriteSnapshot() {
+    const std::string tmp_path = path_ + ".tmp";
+    {
+      std::ofstream out{tmp_path, std::ios::trunc};
+      if (not out.is_open()) {
+        spdlog::warn("could not open metrics file {}", tmp_path);
+        return;
+      }
+      registry_.WritePrometheus(out);
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp_path, path_, error);
+    if (error) {
+      spdlog::warn("could not replace metrics file {}: {}", path_, error.message());
+    }
+  }
+
+  void Write() {
+    std::unique_lock lock{writer_mutex_};
+    while (not writer_cv_.wait_for(lock, interval_, [this] { return stop_; })) {
+      lock.unlock();
+      WriteSnapshot();
+      lock.lock();
+    }
+  }
+
+ public:
+  MetricsFileWriter(MetricsRegistry &registry, std::string path, std::chrono::seconds interval)
+      : registry_(registry), path_(std::move(path)), interval_(interval) {
+    throw_on(path_.empty(), "metrics file path is empty", source_loc::current());
+    throw_on(interval_.count() == 0, "metrics interval is 0", source_loc::current());
+    writer_ = std::thread{&MetricsFileWriter::Write, this};
+  }
+
+  MetricsFileWriter(const MetricsFileWriter &) = delete;
+
+  MetricsFileWriter &operator=(const MetricsFileWriter &) = delete;
+
+  ~MetricsFileWriter() {
+    {
+      const std::lock_guard<std::mutex> guard{writer_mutex_};
+      stop_ = true;
+    }
+    writer_cv_.notify_all();
+    writer_.join();
+    WriteSnapshot();
+  }
+};
+
+#endif // SIMBRICKS_TRACE_INCLUDE_UTIL_METRICS_H_
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "util/concepts.h"
+
+#ifndef SIMBRICKS_TRACE_SEGMENTED_DEQUE_H_
+#define SIMBRICKS_TRACE_SEGMENTED_DEQUE_H_
+
+inline constexpr size_t kSegmentedDequeChunkSize = 256;
+inline constexpr size_t kSegmentedDequeMaxFreeChunks = 8;
+
+// FIFO container storing its values in fixed size chunks that are linked together. Chunks
+// that run empty are kept in a free list and reused, hence pushing and popping does not
+// allocate once the deque reached its steady state size. Iteration walks contiguous memory
+// chunk by chunk.
+//
+// NOTE: this class is not thread safe, the owner must synchronize accesses
+template<typename ValueType, size_t ChunkSize = kSegmentedDequeChunkSize> requires SizeLagerZero<ChunkSize>
+class SegmentedDeque {
+
+  struct Chunk {
+    alignas(ValueType) std::array<std::byte, sizeof(ValueType) * ChunkSize> storage_;
+    Chunk *next_ = nullptr;
+
+    ValueType *Slot(size_t index) {
+      assert(index < ChunkSize);
+      return std::launder(reinterpret_cast<ValueType *>(storage_.data() + index * sizeof(ValueType)));
+    }
+  };
+
+  Chunk *head_chunk_ = nullptr;
+  Chunk *tail_chunk_ = nullptr;
+  // index of the front value within head_chunk_
+  size_t head_index_ = 0;
+  // index of the next free slot within tail_chunk_
+  size_t tail_index_ = 0;
+  size_t size_ = 0;
+
+  Chunk *free_chunks_ = nullptr;
+  size_t free_chunk_count_ = 0;
+  const size_t max_free_chunks_;
+
+  Chunk *AcquireChunk() {
+    Chunk *chunk = free_chunks_;
+    if (chunk) {
+      free_chunks_ = chunk->next_;
+      --free_chunk_count_;
+    } else {
+      chunk = new Chunk;
+    }
+    chunk->next_ = nullptr;
+    return chunk;
+  }
+
+  void ReleaseChunk(Chunk *chunk) {
+    if (free_chunk_count_ >= max_free_chunks_) {
+      delete chunk;
+      return;
+    }
+    chunk->next_ = free_chunks_;
+    free_chunks_ = chunk;
+    ++free_chunk_count_;
+  }
+
+  template<typename... Args>
+  ValueType &EmplaceBack(Args &&... args) {
+    if (tail_chunk_ == nullptr) {
+      head_chunk_ = tail_chunk_ = AcquireChunk();
+      head_index_ = tail_index_ = 0;
+    } else if (tail_index_ == ChunkSize) {
+      Chunk *chunk = AcquireChunk();
+      tail_chunk_->next_ = chunk;
+      tail_chunk_ = chunk;
+      tail_index_ = 0;
+    }
+
+    ValueType *slot = std::construct_at(tail_chunk_->Slot(tail_index_), std::forward<Args>(args)...);
+    ++tail_index_;
+    ++size_;
+    return *slot;
+  }
+
+ public:
+  template<bool IsConst>
+  class Iterator {
+    friend class SegmentedDeque;
+
+    using ChunkPtr = std::conditional_t<IsConst, const Chunk *, Chunk *>;
+
+    ChunkPtr chunk_ = nullptr;
+    size_t index_ = 0;
+
+    Iterator(ChunkPtr chunk, size_t index) : chunk_(chunk), index_(index) {
+    }
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ValueType;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const ValueType *, ValueType *>;
+    using reference = std::conditional_t<IsConst, const ValueType &, ValueType &>;
+
+    Iterator() = default;
+
+    reference operator*() const {
+      return *const_cast<Chunk *>(chunk_)->Slot(index_);
+    }
+
+    pointer operator->() const {
+      return const_cast<Chunk *>(chunk_)->Slot(index_);
+    }
+
+    Iterator &operator++() {
+      ++index_;
+      // the end iterator of a full tail chunk stays at index ChunkSize
+      if (index_ == ChunkSize and chunk_->next_) {
+        chunk_ = chunk_->next_;
+        index_ = 0;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return chunk_ == other.chunk_ and index_ == other.index_;
+    }
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  explicit SegmentedDeque(size_t max_free_chunks = kSegmentedDequeMaxFreeChunks)
+      : max_free_chunks_(max_free_chunks) {
+  }
+
+  SegmentedDeque(const SegmentedDeque &) = delete;
+  SegmentedDeque &operator=(const SegmentedDeque &) = delete;
+
+  ~SegmentedDeque() {
+    Clear();
+    delete head_chunk_;
+    while (free_chunks_) {
+      Chunk *next = free_chunks_->next_;
+      delete free_chunks_;
+      free_chunks_ = next;
+    }
+  }
+
+  void PushBack(const ValueType &value) {
+    EmplaceBack(value);
+  }
+
+  void PushBack(ValueType &&value) {
+    EmplaceBack(std::move(value));
+  }
+
+  ValueType &Front() {
+    assert(size_ > 0);
+    return *head_chunk_->Slot(head_index_);
+  }
+
+  void PopFront() {
+    assert(size_ > 0);
+    std::destroy_at(head_chunk_->Slot(head_index_));
+    ++head_index_;
+    --size_;
+
+    if (size_ == 0) {
+      // head and tail are in the same chunk, rewind it instead of releasing it
+      assert(head_chunk_ == tail_chunk_);
+      head_index_ = tail_index_ = 0;
+    } else if (head_index_ == ChunkSize) {
+      Chunk *drained = head_chunk_;
+      head_chunk_ = drained->next_;
+      head_index_ = 0;
+      ReleaseChunk(drained);
+    }
+  }
+
+  void Clear() {
+    while (size_ > 0) {
+      PopFront();
+    }
+  }
+
+  bool Empty() const {
+    return size_ == 0;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  size_t GetFreeChunkCount() const {
+    return free_chunk_count_;
+  }
+
+  iterator begin() {
+    return iterator{head_chunk_, head_index_};
+  }
+
+  iterator end() {
+    return iterator{tail_chunk_, tail_index_};
+  }
+
+  const_iterator begin() const {
+    return const_iterator{head_chunk_, head_index_};
+  }
+
+  const_iterator end() const {
+    return const_iterator{tail_chunk_, tail_index_};
+  }
+};
+
+#endif //SIMBRICKS_TRACE_SEGMENTED_DEQUE_H_
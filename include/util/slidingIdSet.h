@@ -0,0 +1,196 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <map>
+
+#ifndef SIMBRICKS_TRACE_SLIDING_ID_SET_H_
+#define SIMBRICKS_TRACE_SLIDING_ID_SET_H_
+
+// Set of ids that are handed out by a monotonic counter. Ids are settled once they are inserted,
+// or once the owner gave up on them ever being inserted. All ids below a low watermark are
+// settled, ids above it are tracked in a bitmap of 64 bit words. Whenever the lowest word is
+// fully settled it is dropped and the watermark moves forward, hence memory is a few bits per id
+// between the oldest id not yet settled and the largest settled id. Insert and Contains are O(1).
+//
+// An id may be inserted flagged. Flags, and ids settled without being inserted, live on when
+// their word drops below the watermark: they are moved into a map, which therefore holds one
+// entry per word with at least one such id. An id given up on may still be inserted later.
+//
+// NOTE: this class is not thread safe, the owner must synchronize accesses
+class SlidingIdSet {
+  static constexpr uint64_t kWordBits = 64;
+  static constexpr uint64_t kFullWord = ~uint64_t{0};
+
+  struct Word {
+    uint64_t settled_ = 0;
+    uint64_t contained_ = 0;
+    uint64_t flagged_ = 0;
+  };
+
+  // the ids of a word below the watermark that are not contained or flagged
+  struct WordBelow {
+    uint64_t missing_ = 0;
+    uint64_t flagged_ = 0;
+  };
+
+  // id covered by the lowest bit of words_.front(), always a multiple of kWordBits
+  uint64_t base_ = 0;
+  std::deque<Word> words_;
+
+  // first id of a word below the watermark -> its missing and flagged ids
+  std::map<uint64_t, WordBelow> words_below_;
+
+  static uint64_t MaskOf(uint64_t ident) {
+    return uint64_t{1} << (ident % kWordBits);
+  }
+
+  // returns nullptr for ids below the watermark
+  Word *GetWord(uint64_t ident) {
+    if (ident < base_) {
+      return nullptr;
+    }
+    const uint64_t word_index = (ident - base_) / kWordBits;
+    if (word_index >= words_.size()) {
+      words_.resize(word_index + 1);
+    }
+    return &words_[word_index];
+  }
+
+  const WordBelow *FindWordBelow(uint64_t ident) const {
+    auto below_it = words_below_.find(ident - ident % kWordBits);
+    return below_it == words_below_.end() ? nullptr : &below_it->second;
+  }
+
+  void DropSettledWords() {
+    while (not words_.empty() and words_.front().settled_ == kFullWord) {
+      const Word &front = words_.front();
+      const WordBelow below{~front.contained_, front.flagged_};
+      if (below.missing_ != 0 or below.flagged_ != 0) {
+        words_below_.emplace(base_, below);
+      }
+      words_.pop_front();
+      base_ += kWordBits;
+    }
+  }
+
+ public:
+  // ids below first_id are never handed out and therefore count as contained
+  explicit SlidingIdSet(uint64_t first_id = 0) : base_(first_id - first_id % kWordBits) {
+    const uint64_t skipped = first_id - base_;
+    if (skipped > 0) {
+      const uint64_t mask = (uint64_t{1} << skipped) - 1;
+      words_.push_back({mask, mask, 0});
+    }
+  }
+
+  // returns false if the id was already contained
+  bool Insert(uint64_t ident, bool flagged = false) {
+    const uint64_t mask = MaskOf(ident);
+    Word *word = GetWord(ident);
+    if (word == nullptr) {
+      auto below_it = words_below_.find(ident - ident % kWordBits);
+      if (below_it == words_below_.end() or not (below_it->second.missing_ & mask)) {
+        return false;
+      }
+      below_it->second.missing_ &= ~mask;
+      if (flagged) {
+        below_it->second.flagged_ |= mask;
+      }
+      if (below_it->second.missing_ == 0 and below_it->second.flagged_ == 0) {
+        words_below_.erase(below_it);
+      }
+      return true;
+    }
+
+    if (word->contained_ & mask) {
+      return false;
+    }
+    word->contained_ |= mask;
+    word->settled_ |= mask;
+    if (flagged) {
+      word->flagged_ |= mask;
+    }
+    DropSettledWords();
+    return true;
+  }
+
+  // settles an id without inserting it, such that an id that is likely never inserted does not
+  // hold back the watermark; Contains stays false until the id is inserted
+  void Settle(uint64_t ident) {
+    Word *word = GetWord(ident);
+    if (word == nullptr) {
+      return;
+    }
+    word->settled_ |= MaskOf(ident);
+    DropSettledWords();
+  }
+
+  bool Contains(uint64_t ident) const {
+    if (ident < base_) {
+      const WordBelow *below = FindWordBelow(ident);
+      return below == nullptr or not (below->missing_ & MaskOf(ident));
+    }
+    const uint64_t word_index = (ident - base_) / kWordBits;
+    if (word_index >= words_.size()) {
+      return false;
+    }
+    return words_[word_index].contained_ & MaskOf(ident);
+  }
+
+  // whether the id was inserted flagged
+  bool IsFlagged(uint64_t ident) const {
+    if (ident < base_) {
+      const WordBelow *below = FindWordBelow(ident);
+      return below != nullptr and (below->flagged_ & MaskOf(ident));
+    }
+    const uint64_t word_index = (ident - base_) / kWordBits;
+    if (word_index >= words_.size()) {
+      return false;
+    }
+    return words_[word_index].flagged_ & MaskOf(ident);
+  }
+
+  // every id below the watermark is settled
+  uint64_t GetLowWatermark() const {
+    if (words_.empty()) {
+      return base_;
+    }
+    return base_ + std::countr_one(words_.front().settled_);
+  }
+
+  // amount of bitmap words kept for ids above the watermark
+  size_t GetTrackedWords() const {
+    return words_.size();
+  }
+
+  // amount of words below the watermark kept for their flagged or missing ids
+  size_t GetWordsBelow() const {
+    return words_below_.size();
+  }
+};
+
+#endif // SIMBRICKS_TRACE_SLIDING_ID_SET_H_
@@ -22,81 +22,112 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <optional>
 #include <unordered_map>
-#include <queue>
-#include <chrono>
-
-#include "util/concepts.h"
+#include <utility>
 
 #ifndef SIMBRICKS_TRACE_TTLMAP_H_
 #define SIMBRICKS_TRACE_TTLMAP_H_
 
-// TODO: make this an lru cache with ttl --> when something is accessed, its ttl will be re-calculated!!
-template<typename KeyType, typename ValueType, uint64_t TTLSeconds> requires SizeLagerZero<TTLSeconds>
-class LazyTtLMap {
-
-  const std::chrono::seconds kTTL_{TTLSeconds};
+// Map whose entries expire once they were not accessed for longer than the ttl. Time is whatever
+// the owner advances the map to, e.g. simulated timestamps or wall clock ticks. Timestamps that
+// lie behind the current time are ignored, hence the entries in least recently used order are
+// also ordered by their last access and expiry only ever looks at the front of that list. All
+// operations are O(1), expiry amortised O(1) per entry.
+//
+// NOTE: this class is not thread safe, the owner must synchronize accesses
+template<typename KeyType, typename ValueType>
+class TtlLruMap {
+  struct Entry {
+    KeyType key_;
+    ValueType value_;
+    uint64_t accessed_;
+  };
+  using EntryList = std::list<Entry>;
+
+  // 0 means entries never expire
+  uint64_t ttl_;
+  uint64_t now_ = 0;
+  // least recently used entry first
+  EntryList lru_;
+  std::unordered_map<KeyType, typename EntryList::iterator> index_;
+
+  void Touch(typename EntryList::iterator entry) {
+    entry->accessed_ = now_;
+    lru_.splice(lru_.end(), lru_, entry);
+  }
 
  public:
-  bool Insert(KeyType key, ValueType value) {
-    CollectGarbage();
+  explicit TtlLruMap(uint64_t ttl = 0) : ttl_(ttl) {
+  }
 
-    auto iter = map_storage_.insert({key, value});
-    if (not iter.second) {
+  void SetTtl(uint64_t ttl) {
+    ttl_ = ttl;
+  }
+
+  // returns false if the key is already contained
+  bool Insert(const KeyType &key, ValueType value) {
+    if (index_.contains(key)) {
       return false;
     }
-    const uint64_t now = GetNow();
-    timer_queue_.push({now, key});
+    lru_.push_back(Entry{key, std::move(value), now_});
+    index_.insert({key, std::prev(lru_.end())});
     return true;
   }
 
-  std::optional<ValueType> Find(KeyType key) {
-    CollectGarbage();
-
-    auto iter = map_storage_.find(key);
-    if (iter != map_storage_.end()) {
-      assert(map_expiration_times_.contains(key));
-      const uint64_t now = GetNow();
-      map_expiration_times_.find(key)->second = now;
-      return iter->second;
+  // a found entry counts as accessed and its ttl starts over
+  std::optional<ValueType> Find(const KeyType &key) {
+    auto iter = index_.find(key);
+    if (iter == index_.end()) {
+      return std::nullopt;
     }
-    return std::nullopt;
+    Touch(iter->second);
+    return iter->second->value_;
   }
 
-  void Remove(KeyType key) {
-    CollectGarbage();
-
-    map_storage_.erase(key);
+  bool Remove(const KeyType &key) {
+    auto iter = index_.find(key);
+    if (iter == index_.end()) {
+      return false;
+    }
+    lru_.erase(iter->second);
+    index_.erase(iter);
+    return true;
   }
 
-  void CollectGarbage() {
-    const uint64_t now = GetNow();
-    while (not timer_queue_.empty()) {
-      const auto &oldest = timer_queue_.front();
-      if (oldest.first + kTTL_.count() < now) {
-        break;
-      }
+  // moves the time forward and removes the entries not accessed within the ttl, returns the
+  // amount of removed entries
+  size_t AdvanceTo(uint64_t now) {
+    return AdvanceTo(now, [](const KeyType &, const ValueType &) {});
+  }
 
-      KeyType key = oldest.second;
-      timer_queue_.pop();
-      auto iter = map_expiration_times_.find(key);
-      if (iter != map_expiration_times_.end() and iter->second + kTTL_.count() < now) {
-        continue;
-      }
-      map_storage_.erase(key);
-      map_expiration_times_.erase(key);
+  // as above, every removed entry is handed to on_expired before it is removed
+  template<typename OnExpired>
+  size_t AdvanceTo(uint64_t now, OnExpired &&on_expired) {
+    now_ = std::max(now_, now);
+    if (ttl_ == 0) {
+      return 0;
+    }
+    size_t removed = 0;
+    while (not lru_.empty() and now_ - lru_.front().accessed_ > ttl_) {
+      on_expired(lru_.front().key_, lru_.front().value_);
+      index_.erase(lru_.front().key_);
+      lru_.pop_front();
+      ++removed;
     }
+    return removed;
   }
 
- private:
-  uint64_t GetNow() {
-    auto now = std::chrono::system_clock::now();
-    return now.time_since_epoch().count();
+  [[nodiscard]] size_t Size() const {
+    return index_.size();
   }
 
-  std::unordered_map<KeyType, ValueType> map_storage_;
-  std::unordered_map<KeyType, uint64_t> map_expiration_times_;
-  std::queue<std::pair<uint64_t, KeyType>> timer_queue_;
+  [[nodiscard]] bool Empty() const {
+    return index_.empty();
+  }
 };
 
 #endif //SIMBRICKS_TRACE_TTLMAP_H_
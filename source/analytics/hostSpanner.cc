@@ -127,8 +127,21 @@ concurrencpp::result<bool> HostSpanner::HandelMmio(
     std::shared_ptr<Event> &event_ptr) {
   assert(event_ptr and "event_ptr is null");
 
-  auto pending_mmio_span =
-      iterate_add_erase<HostMmioSpan>(pending_host_mmio_spans_, event_ptr);
+  // immediate responses of posted writes carry no id and are matched by the timestamp of the issue
+  std::shared_ptr<HostMmioSpan> pending_mmio_span;
+  if (IsType(event_ptr, EventType::kHostMmioImRespPoWT)) {
+    pending_mmio_span = iterate_add_erase<HostMmioSpan>(pending_host_posted_mmio_spans_, event_ptr->GetTs(),
+                                                        event_ptr);
+    if (pending_mmio_span and pending_mmio_span->IsComplete()) {
+      pending_host_mmio_spans_.Remove(pending_mmio_span->GetIssueId(), pending_mmio_span);
+    }
+  } else {
+    const uint64_t mmio_id = std::static_pointer_cast<HostIdOp>(event_ptr)->GetId();
+    pending_mmio_span = iterate_add_erase<HostMmioSpan>(pending_host_mmio_spans_, mmio_id, event_ptr);
+    if (pending_mmio_span and pending_mmio_span->IsComplete() and pending_mmio_span->IsPosted()) {
+      pending_host_posted_mmio_spans_.Remove(pending_mmio_span->GetStartingTs(), pending_mmio_span);
+    }
+  }
   if (pending_mmio_span) {
     if (pending_mmio_span->IsComplete()) {
       co_await tracer_.MarkSpanAsDone(resume_executor, pending_mmio_span);
@@ -162,8 +175,13 @@ concurrencpp::result<bool> HostSpanner::HandelMmio(
       pending_mmio_span->GetBarNumber()) and
       pending_mmio_span->IsComplete()) {
     co_await tracer_.MarkSpanAsDone(resume_executor, pending_mmio_span);
+    // a completed span never accepts further events, hence there is no need to keep it pending
+    co_return true;
+  }
+  pending_host_mmio_spans_.Insert(pending_mmio_span->GetIssueId(), pending_mmio_span);
+  if (not pending_mmio_span->IsRead() and pending_mmio_span->IsPosted()) {
+    pending_host_posted_mmio_spans_.Insert(pending_mmio_span->GetStartingTs(), pending_mmio_span);
   }
-  pending_host_mmio_spans_.push_back(pending_mmio_span);
   co_return true;
 }
 
@@ -218,8 +236,8 @@ concurrencpp::result<bool> HostSpanner::HandelDma(
     co_return true;
   }
 
-  auto pending_dma =
-      iterate_add_erase<HostDmaSpan>(pending_host_dma_spans_, event_ptr);
+  const uint64_t dma_id = std::static_pointer_cast<HostIdOp>(event_ptr)->GetId();
+  auto pending_dma = iterate_add_erase<HostDmaSpan>(pending_host_dma_spans_, dma_id, event_ptr);
   if (pending_dma) {
     if (pending_dma->IsComplete()) {
       co_await tracer_.MarkSpanAsDone(resume_executor, pending_dma);
@@ -250,7 +268,7 @@ concurrencpp::result<bool> HostSpanner::HandelDma(
   if (not pending_dma) {
     co_return false;
   }
-  pending_host_dma_spans_.push_back(pending_dma);
+  pending_host_dma_spans_.Insert(dma_id, pending_dma);
   co_return true;
 }
 
@@ -322,41 +340,29 @@ HostSpanner::HostSpanner(
   throw_if_empty(from_nic_queue_, TraceException::kQueueIsNull, source_loc::current());
   throw_if_empty(from_nic_receives_queue_, TraceException::kQueueIsNull, source_loc::current());
 
-  auto handel_call = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelCall(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kHostCallT, handel_call);
-
-  auto handel_mmio = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelMmio(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kHostMmioWT, handel_mmio);
-  RegisterHandler(EventType::kHostMmioRT, handel_mmio);
-  RegisterHandler(EventType::kHostMmioImRespPoWT, handel_mmio);
-  RegisterHandler(EventType::kHostMmioCWT, handel_mmio);
-  RegisterHandler(EventType::kHostMmioCRT, handel_mmio);
-
-  auto handel_pci = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelPci(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kHostPciRWT, handel_pci);
-  RegisterHandler(EventType::kHostConfT, handel_pci);
-
-  auto handel_dma = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelDma(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kHostDmaWT, handel_dma);
-  RegisterHandler(EventType::kHostDmaRT, handel_dma);
-  RegisterHandler(EventType::kHostDmaCT, handel_dma);
-
-  auto handel_misx = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelMsix(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kHostMsiXT, handel_misx);
-
-  auto handel_int = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelInt(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kHostPostIntT, handel_int);
-  RegisterHandler(EventType::kHostClearIntT, handel_int);
+  RegisterHandlers<HostSpanner, &HostSpanner::HandelCall,
+                   EventType::kHostCallT>();
+
+  RegisterHandlers<HostSpanner, &HostSpanner::HandelMmio,
+                   EventType::kHostMmioWT,
+                   EventType::kHostMmioRT,
+                   EventType::kHostMmioImRespPoWT,
+                   EventType::kHostMmioCWT,
+                   EventType::kHostMmioCRT>();
+
+  RegisterHandlers<HostSpanner, &HostSpanner::HandelPci,
+                   EventType::kHostPciRWT,
+                   EventType::kHostConfT>();
+
+  RegisterHandlers<HostSpanner, &HostSpanner::HandelDma,
+                   EventType::kHostDmaWT,
+                   EventType::kHostDmaRT,
+                   EventType::kHostDmaCT>();
+
+  RegisterHandlers<HostSpanner, &HostSpanner::HandelMsix,
+                   EventType::kHostMsiXT>();
+
+  RegisterHandlers<HostSpanner, &HostSpanner::HandelInt,
+                   EventType::kHostPostIntT,
+                   EventType::kHostClearIntT>();
 }
@@ -46,7 +46,11 @@ concurrencpp::result<bool> NetworkSpanner::HandelNetworkEvent(std::shared_ptr<co
     co_return true;
   }
 
-  auto current_device_span = iterate_add_erase(current_active_device_spans_, network_event);
+  const uint64_t device_key = PendingKey({network_event->GetPacketUid(),
+                                          static_cast<uint64_t>(network_event->GetNode()),
+                                          static_cast<uint64_t>(network_event->GetDevice())});
+  auto current_device_span = iterate_add_erase<NetDeviceSpan>(current_active_device_spans_, device_key,
+                                                              network_event);
   if (current_device_span) {
 
     throw_on_false(current_device_span->IsComplete(),
@@ -95,7 +99,7 @@ concurrencpp::result<bool> NetworkSpanner::HandelNetworkEvent(std::shared_ptr<co
                                                                            network_event->GetParserIdent(),
                                                                            name_);
       throw_if_empty(current_device_span, TraceException::kSpanIsNull, source_loc::current());
-      current_active_device_spans_.push_back(current_device_span);
+      current_active_device_spans_.Insert(device_key, current_device_span);
       co_return true;
     }
     spdlog::debug(
@@ -132,7 +136,7 @@ concurrencpp::result<bool> NetworkSpanner::HandelNetworkEvent(std::shared_ptr<co
                                                                      network_event->GetParserIdent(),
                                                                      name_);
   throw_if_empty(cur_device_span, TraceException::kSpanIsNull, source_loc::current());
-  current_active_device_spans_.push_back(cur_device_span);
+  current_active_device_spans_.Insert(device_key, cur_device_span);
   co_return true;
 }
 
@@ -147,13 +151,8 @@ NetworkSpanner::NetworkSpanner(TraceEnvironment &trace_environment,
       to_host_channels_(to_host_channels),
       node_device_filter_(node_device_filter) {
 
-  auto handel_net_ev = [this](
-      std::shared_ptr<concurrencpp::executor> resume_executor,
-      EventT &event_ptr) {
-    return HandelNetworkEvent(std::move(resume_executor), event_ptr);
-  };
-
-  RegisterHandler(EventType::kNetworkEnqueueT, handel_net_ev);
-  RegisterHandler(EventType::kNetworkDequeueT, handel_net_ev);
-  RegisterHandler(EventType::kNetworkDropT, handel_net_ev);
+  RegisterHandlers<NetworkSpanner, &NetworkSpanner::HandelNetworkEvent,
+                   EventType::kNetworkEnqueueT,
+                   EventType::kNetworkDequeueT,
+                   EventType::kNetworkDropT>();
 }
@@ -68,8 +68,9 @@ concurrencpp::result<bool> NicSpanner::HandelDma(
     std::shared_ptr<Event> &event_ptr) {
   assert(event_ptr and "event_ptr is null");
 
-  auto pending_dma =
-      iterate_add_erase<NicDmaSpan>(pending_nic_dma_spans_, event_ptr);
+  auto dma = std::static_pointer_cast<NicDma>(event_ptr);
+  const uint64_t dma_key = PendingKey({dma->GetId(), dma->GetAddr()});
+  auto pending_dma = iterate_add_erase<NicDmaSpan>(pending_nic_dma_spans_, dma_key, event_ptr);
   if (pending_dma) {
     if (pending_dma->IsComplete()) {
       co_await tracer_.MarkSpanAsDone(resume_executor, pending_dma);
@@ -100,7 +101,7 @@ concurrencpp::result<bool> NicSpanner::HandelDma(
     co_return false;
   }
 
-  pending_nic_dma_spans_.push_back(pending_dma);
+  pending_nic_dma_spans_.Insert(dma_key, pending_dma);
   co_return true;
 }
 
@@ -195,28 +196,20 @@ NicSpanner::NicSpanner(
   throw_if_empty(from_host_queue_, TraceException::kQueueIsNull, source_loc::current());
   throw_if_empty(to_host_receives_, TraceException::kQueueIsNull, source_loc::current());
 
-  auto handel_mmio = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelMmio(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kNicMmioWT, handel_mmio);
-  RegisterHandler(EventType::kNicMmioRT, handel_mmio);
-
-  auto handel_dma = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelDma(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kNicDmaIT, handel_dma);
-  RegisterHandler(EventType::kNicDmaExT, handel_dma);
-  RegisterHandler(EventType::kNicDmaCWT, handel_dma);
-  RegisterHandler(EventType::kNicDmaCRT, handel_dma);
-
-  auto handel_tx_rx = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelTxrx(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kNicTxT, handel_tx_rx);
-  RegisterHandler(EventType::kNicRxT, handel_tx_rx);
-
-  auto handel_msix = [this](ExecutorT resume_executor, EventT &event_ptr) {
-    return HandelMsix(std::move(resume_executor), event_ptr);
-  };
-  RegisterHandler(EventType::kNicMsixT, handel_msix);
+  RegisterHandlers<NicSpanner, &NicSpanner::HandelMmio,
+                   EventType::kNicMmioWT,
+                   EventType::kNicMmioRT>();
+
+  RegisterHandlers<NicSpanner, &NicSpanner::HandelDma,
+                   EventType::kNicDmaIT,
+                   EventType::kNicDmaExT,
+                   EventType::kNicDmaCWT,
+                   EventType::kNicDmaCRT>();
+
+  RegisterHandlers<NicSpanner, &NicSpanner::HandelTxrx,
+                   EventType::kNicTxT,
+                   EventType::kNicRxT>();
+
+  RegisterHandlers<NicSpanner, &NicSpanner::HandelMsix,
+                   EventType::kNicMsixT>();
 }
\ No newline at end of file
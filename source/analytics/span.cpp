@@ -146,6 +146,7 @@ bool HostCallSpan::AddToSpan(const std::shared_ptr<Event> &event_ptr) {
     return true;
   }
 
+  bool is_indicator = true;
   if (trace_environment_.IsKernelTx(event_ptr)) {
     kernel_transmit_ = true;
   } else if (trace_environment_.IsDriverTx(event_ptr)) {
@@ -154,12 +155,36 @@ bool HostCallSpan::AddToSpan(const std::shared_ptr<Event> &event_ptr) {
     kernel_receive_ = true;
   } else if (trace_environment_.IsDriverRx(event_ptr)) {
     driver_receive_ = true;
+  } else {
+    is_indicator = IsSummarised() and trace_environment_.is_pci_write(event_ptr);
   }
 
-  events_.push_back(event_ptr);
+  AddCall(event_ptr, is_indicator);
   return true;
 }
 
+void HostCallSpan::AddCall(const std::shared_ptr<Event> &event_ptr, bool is_indicator) {
+  if (not IsSummarised()) {
+    events_.push_back(event_ptr);
+    return;
+  }
+
+  auto call = std::static_pointer_cast<HostCall>(event_ptr);
+  CallSummary &summary = (*call_summaries_)[call->GetFunc()];
+  if (summary.count_ == 0) {
+    summary.first_ts_ = call->GetTs();
+  }
+  ++summary.count_;
+  summary.last_ts_ = call->GetTs();
+
+  // the latest call is kept such that the span still ends with its last event
+  if (last_is_summarised_) {
+    events_.pop_back();
+  }
+  last_is_summarised_ = not is_indicator and not events_.empty();
+  events_.push_back(event_ptr);
+}
+
 bool HostIntSpan::AddToSpan(const std::shared_ptr<Event> &event_ptr) {
 //  const std::lock_guard<std::recursive_mutex> guard(span_mutex_);
 
@@ -22,27 +22,76 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <chrono>
+
 #include "analytics/spanner.h"
 #include "util/exception.h"
 #include "events/printer.h"
 
+concurrencpp::result<void> Spanner::JoinSkewWindow(std::shared_ptr<concurrencpp::executor> executor) {
+  joined_skew_window_ = true;
+  skew_window_ = trace_environment_.GetSkewWindow();
+  if (not skew_window_) {
+    co_return;
+  }
+  skew_key_ = co_await skew_window_->Register(executor, name_);
+  co_return;
+}
+
 concurrencpp::result<void> Spanner::consume(std::shared_ptr<concurrencpp::executor> executor,
                                             std::shared_ptr<Event> value) {
   throw_if_empty(value, TraceException::kEventIsNull, source_loc::current());
+  if (progress_) {
+    progress_->OnEventHandling(value->GetTs());
+  }
+
+  if (not joined_skew_window_) {
+    co_await JoinSkewWindow(executor);
+  }
+  if (skew_window_) {
+    // wait until the slowest spanner is at most a window behind
+    co_await skew_window_->MoveForward(executor, skew_key_, value->GetTs());
+  }
 
   spdlog::debug("{} try handel: {}", name_, *value);
-  auto handler_it = handler_.find(value->GetType());
-  if (handler_it == handler_.end()) {
+  const auto start = consume_latency_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+  if (events_consumed_) {
+    events_consumed_->Increment();
+  }
+  const HandlerT handler = handler_[static_cast<size_t>(value->GetType())];
+  if (not handler) {
     spdlog::critical("Spanner: could not find handler for the following event: {}", *value);
+    if (events_not_added_) {
+      events_not_added_->Increment();
+    }
     co_return;
   }
 
-  auto handler = handler_it->second;
-  const bool added = co_await handler(executor, value);
+  const bool added = co_await handler(*this, executor, value);
   if (not added) {
     spdlog::debug("found event that could not be added to a pack: {}", *value);
+    if (events_not_added_) {
+      events_not_added_->Increment();
+    }
+  }
+  if (consume_latency_) {
+    consume_latency_->Observe(std::chrono::steady_clock::now() - start);
   }
 
   spdlog::debug("{} handled event {}", name_, *value);
   co_return;
 }
+
+concurrencpp::result<void> Spanner::finish(std::shared_ptr<concurrencpp::executor> executor) {
+  if (not joined_skew_window_) {
+    co_await JoinSkewWindow(executor);
+  }
+  // a spanner without further events must not hold back the others
+  if (skew_window_) {
+    co_await skew_window_->Done(executor, skew_key_);
+  }
+  if (progress_) {
+    progress_->OnDone();
+  }
+  co_return;
+}
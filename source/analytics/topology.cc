@@ -0,0 +1,199 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <utility>
+
+#include "analytics/topology.h"
+#include "events/event-filter.h"
+#include "parser/eventStreamParser.h"
+#include "parser/parser.h"
+#include "util/exception.h"
+#include "util/factory.h"
+
+namespace {
+
+constexpr size_t kTopologyLineBufferSizePages = 256;
+
+}  // namespace
+
+TopologyBuilder::TopologyBuilder(TraceEnvironment &trace_environment,
+                                 const TraceEnvConfig &trace_env_config,
+                                 Tracer &tracer,
+                                 std::vector<EventTimeBoundary> timestamp_bounds)
+    : trace_environment_(trace_environment),
+      trace_env_config_(trace_env_config),
+      tracer_(tracer),
+      timestamp_bounds_(std::move(timestamp_bounds)),
+      types_to_filter_(trace_env_config.BeginTypesToFilter(), trace_env_config.EndTypesToFilter()),
+      blacklist_functions_(trace_env_config.BeginBlacklistFuncIndicator(),
+                           trace_env_config.EndBlacklistFuncIndicator()) {
+  throw_on(not trace_env_config_.HasTopology(), "TopologyBuilder: the config has no topology",
+           source_loc::current());
+  sink_ = create_shared<CoroChannelSink<std::shared_ptr<Context>>>(TraceException::kChannelIsNull);
+  pipelines_ = create_shared<std::vector<std::shared_ptr<PipelineT>>>("vector is null");
+}
+
+TopologyBuilder::ContextQueueT TopologyBuilder::CreateContextQueue(const std::string &name) {
+  auto queue = create_shared<CoroMpmcChannel<std::shared_ptr<Context>>>(TraceException::kChannelIsNull);
+  if (trace_env_config_.IsChannelMetricsEnabled()) {
+    queue->EnableMetrics(trace_environment_.GetChannelMetrics().Register(name));
+  }
+  return queue;
+}
+
+std::shared_ptr<Producer<std::shared_ptr<Event>>> TopologyBuilder::CreateProvider(const std::string &name,
+                                                                                   const std::string &path,
+                                                                                   std::shared_ptr<LogParser> parser) {
+  return CreateBufferedEventProvider<kTopologyLineBufferSizePages>(trace_environment_, name, path, std::move(parser));
+}
+
+TopologyBuilder::HandlerT TopologyBuilder::CreateHandler(const TraceEnvConfig::LogSourceConf &source) {
+  auto handler = create_shared<std::vector<std::shared_ptr<Handler<std::shared_ptr<Event>>>>>("vector null");
+  if (source.IsEventStream()) {
+    // event streams were already filtered while being written
+    handler->emplace_back(create_shared<EventTimestampFilter>(TraceException::kActorIsNull,
+                                                              trace_environment_,
+                                                              timestamp_bounds_));
+  } else {
+    handler->emplace_back(create_shared<EventTypeFilter>(TraceException::kActorIsNull,
+                                                         trace_environment_,
+                                                         types_to_filter_,
+                                                         true));
+  }
+  return handler;
+}
+
+void TopologyBuilder::BuildHost(const TraceEnvConfig::HostTopologyConf &host) {
+  const std::string &name = host.GetName();
+
+  auto host_to_nic = CreateContextQueue(name + "-host-to-nic");
+  auto nic_to_host = CreateContextQueue(name + "-nic-to-host");
+  auto nic_to_host_receives = CreateContextQueue(name + "-nic-to-host-receive");
+  auto nic_to_network = CreateContextQueue(name + "-nic-to-network");
+  auto nic_from_network = CreateContextQueue(name + "-nic-from-network");
+
+  auto host_spanner = create_shared<HostSpanner>(TraceException::kSpannerIsNull,
+                                                 trace_environment_,
+                                                 name + "-Host",
+                                                 tracer_,
+                                                 host_to_nic,
+                                                 nic_to_host,
+                                                 nic_to_host_receives);
+  auto nic_spanner = create_shared<NicSpanner>(TraceException::kSpannerIsNull,
+                                               trace_environment_,
+                                               name + "-NIC",
+                                               tracer_,
+                                               nic_to_network,
+                                               nic_from_network,
+                                               nic_to_host,
+                                               host_to_nic,
+                                               nic_to_host_receives);
+
+  // attach the NIC to the network
+  const int node = host.GetNs3NodeId();
+  to_host_map_.AddMapping(node, host.GetNs3DeviceId(), nic_from_network);
+  from_host_map_.AddMapping(node, host.GetNs3DeviceId(), nic_to_network);
+  for (const int device : host.GetNs3SinkDeviceIds()) {
+    to_host_map_.AddMapping(node, device, sink_);
+    from_host_map_.AddMapping(node, device, sink_);
+  }
+  for (const int device : host.GetNs3FilterDeviceIds()) {
+    node_device_filter_.AddNodeDevice(node, device);
+  }
+
+  // HOST PIPELINE
+  const TraceEnvConfig::LogSourceConf &gem5 = host.GetGem5();
+  std::shared_ptr<LogParser> gem5_parser;
+  auto gem5_handler = CreateHandler(gem5);
+  if (gem5.IsEventStream()) {
+    gem5_parser = create_shared<EventStreamParser>("parser is null", trace_environment_, name + "-gem5-reader");
+  } else {
+    // NOTE: the filter references its identifier, hence the name stored within the config is used
+    auto &component_filter = component_filters_.emplace_back(
+        create_unique<ComponentFilter>("component filter is null", name));
+    gem5_parser = create_shared<Gem5Parser>("parser is null", trace_environment_, name + "-gem5-parser",
+                                            *component_filter);
+    gem5_handler->emplace_back(create_shared<HostCallFuncFilter>(TraceException::kActorIsNull,
+                                                                 trace_environment_,
+                                                                 blacklist_functions_,
+                                                                 true));
+  }
+  auto gem5_provider = CreateProvider(name + "-gem5-provider", gem5.GetPath(), std::move(gem5_parser));
+  pipelines_->emplace_back(create_shared<PipelineT>(TraceException::kPipelineNull, gem5_provider, gem5_handler,
+                                                    host_spanner));
+
+  // NIC PIPELINE
+  const TraceEnvConfig::LogSourceConf &nicbm = host.GetNicbm();
+  std::shared_ptr<LogParser> nicbm_parser;
+  if (nicbm.IsEventStream()) {
+    nicbm_parser = create_shared<EventStreamParser>("parser is null", trace_environment_, name + "-nicbm-reader");
+  } else {
+    nicbm_parser = create_shared<NicBmParser>("parser is null", trace_environment_, name + "-nicbm-parser");
+  }
+  auto nicbm_provider = CreateProvider(name + "-nicbm-provider", nicbm.GetPath(), std::move(nicbm_parser));
+  pipelines_->emplace_back(create_shared<PipelineT>(TraceException::kPipelineNull, nicbm_provider,
+                                                    CreateHandler(nicbm), nic_spanner));
+}
+
+void TopologyBuilder::BuildNetwork() {
+  auto network_spanner = create_shared<NetworkSpanner>(TraceException::kSpannerIsNull,
+                                                       trace_environment_,
+                                                       "NS3",
+                                                       tracer_,
+                                                       from_host_map_,
+                                                       to_host_map_,
+                                                       node_device_filter_);
+
+  const TraceEnvConfig::LogSourceConf &ns3 = trace_env_config_.GetTopologyNs3();
+  std::shared_ptr<LogParser> ns3_parser;
+  auto ns3_handler = CreateHandler(ns3);
+  if (ns3.IsEventStream()) {
+    ns3_parser = create_shared<EventStreamParser>("parser is null", trace_environment_, "ns3-reader");
+  } else {
+    ns3_parser = create_shared<NS3Parser>("parser is null", trace_environment_, "ns3-parser");
+    ns3_handler->emplace_back(create_shared<NS3EventFilter>(TraceException::kActorIsNull,
+                                                            trace_environment_,
+                                                            node_device_filter_));
+  }
+  auto ns3_provider = CreateProvider("ns3-provider", ns3.GetPath(), std::move(ns3_parser));
+  pipelines_->emplace_back(create_shared<PipelineT>(TraceException::kPipelineNull, ns3_provider, ns3_handler,
+                                                    network_spanner));
+}
+
+TopologyBuilder::PipelinesT TopologyBuilder::Build() {
+  throw_on(built_, "TopologyBuilder: topology was already built", source_loc::current());
+  built_ = true;
+
+  // the network must be built last, it maps the node devices to the NICs of all hosts
+  for (const TraceEnvConfig::HostTopologyConf &host : trace_env_config_.GetTopologyHosts()) {
+    BuildHost(host);
+  }
+  BuildNetwork();
+  // every pipeline ends in its own spanner
+  trace_environment_.CreateSkewWindow(pipelines_->size());
+
+  spdlog::info("built topology with {} hosts and {} pipelines",
+               trace_env_config_.GetTopologyHosts().size(), pipelines_->size());
+  return pipelines_;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "spdlog/spdlog.h"
+
+#include "env/checkpoint.h"
+
+namespace {
+
+constexpr std::array<char, 4> kCheckpointMagic{'C', 'L', 'B', 'C'};
+constexpr uint64_t kCheckpointVersion = 2;
+constexpr size_t kChecksumSize = sizeof(uint64_t);
+
+// 64 bit FNV-1a
+uint64_t Checksum(const std::string &data) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const char chr : data) {
+    hash ^= static_cast<unsigned char>(chr);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+void WriteVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(const std::string &data, size_t &pos, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (pos >= data.size()) {
+      return false;
+    }
+    const auto byte = static_cast<unsigned char>(data[pos++]);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+void Checkpoint::Serialize(std::ostream &out) const {
+  std::string data{kCheckpointMagic.begin(), kCheckpointMagic.end()};
+  WriteVarint(data, kCheckpointVersion);
+  WriteVarint(data, sequence_);
+  WriteVarint(data, next_span_id_);
+  WriteVarint(data, next_trace_id_);
+  WriteVarint(data, next_trace_context_id_);
+  WriteVarint(data, frontier_ts_);
+  WriteVarint(data, open_spans_);
+  WriteVarint(data, input_offsets_.size());
+  for (const auto &[name, offset] : input_offsets_) {
+    WriteVarint(data, name.size());
+    data.append(name);
+    WriteVarint(data, offset);
+  }
+
+  uint64_t checksum = Checksum(data);
+  for (size_t byte = 0; byte < kChecksumSize; ++byte) {
+    data.push_back(static_cast<char>(checksum & 0xff));
+    checksum >>= 8;
+  }
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+std::optional<Checkpoint> Checkpoint::Deserialize(std::istream &in) {
+  std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  if (data.size() < kCheckpointMagic.size() + kChecksumSize
+      or not std::equal(kCheckpointMagic.begin(), kCheckpointMagic.end(), data.begin())) {
+    spdlog::warn("Checkpoint::Deserialize data is no checkpoint");
+    return std::nullopt;
+  }
+
+  uint64_t stored_checksum = 0;
+  for (size_t byte = 0; byte < kChecksumSize; ++byte) {
+    stored_checksum |= static_cast<uint64_t>(static_cast<unsigned char>(data[data.size() - kChecksumSize + byte]))
+        << (8 * byte);
+  }
+  data.resize(data.size() - kChecksumSize);
+  if (stored_checksum != Checksum(data)) {
+    spdlog::warn("Checkpoint::Deserialize checksum mismatch");
+    return std::nullopt;
+  }
+
+  Checkpoint checkpoint;
+  size_t pos = kCheckpointMagic.size();
+  uint64_t version;
+  uint64_t amount_inputs;
+  if (not ReadVarint(data, pos, version) or version != kCheckpointVersion) {
+    spdlog::warn("Checkpoint::Deserialize unsupported version");
+    return std::nullopt;
+  }
+  if (not ReadVarint(data, pos, checkpoint.sequence_)
+      or not ReadVarint(data, pos, checkpoint.next_span_id_)
+      or not ReadVarint(data, pos, checkpoint.next_trace_id_)
+      or not ReadVarint(data, pos, checkpoint.next_trace_context_id_)
+      or not ReadVarint(data, pos, checkpoint.frontier_ts_)
+      or not ReadVarint(data, pos, checkpoint.open_spans_)
+      or not ReadVarint(data, pos, amount_inputs)) {
+    spdlog::warn("Checkpoint::Deserialize truncated header");
+    return std::nullopt;
+  }
+  for (uint64_t input = 0; input < amount_inputs; ++input) {
+    uint64_t name_size;
+    uint64_t offset;
+    if (not ReadVarint(data, pos, name_size) or name_size > data.size() - pos) {
+      spdlog::warn("Checkpoint::Deserialize truncated input");
+      return std::nullopt;
+    }
+    std::string name = data.substr(pos, name_size);
+    pos += name_size;
+    if (not ReadVarint(data, pos, offset)) {
+      spdlog::warn("Checkpoint::Deserialize truncated input");
+      return std::nullopt;
+    }
+    checkpoint.input_offsets_[std::move(name)] = offset;
+  }
+  return checkpoint;
+}
+
+bool Checkpoint::WriteToFile(const std::string &path) const {
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out{tmp_path, std::ios::binary | std::ios::trunc};
+    if (not out.is_open()) {
+      spdlog::warn("could not open checkpoint file {}", tmp_path);
+      return false;
+    }
+    Serialize(out);
+    out.flush();
+    if (not out.good()) {
+      spdlog::warn("could not write checkpoint file {}", tmp_path);
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tmp_path, path, error);
+  if (error) {
+    spdlog::warn("could not replace checkpoint file {}: {}", path, error.message());
+    return false;
+  }
+  return true;
+}
+
+std::optional<Checkpoint> Checkpoint::LoadFromFile(const std::string &path) {
+  std::ifstream in{path, std::ios::binary};
+  if (not in.is_open()) {
+    spdlog::warn("could not open checkpoint file {}", path);
+    return std::nullopt;
+  }
+  return Deserialize(in);
+}
+
+void CheckpointWriter::WriteCheckpoint() {
+  const Checkpoint checkpoint = take_checkpoint_();
+  if (checkpoint.input_offsets_ == last_written_) {
+    spdlog::debug("no input progressed since the last checkpoint");
+    return;
+  }
+  if (checkpoint.WriteToFile(path_)) {
+    spdlog::info("wrote checkpoint {} to {}", checkpoint.sequence_, path_);
+    last_written_ = checkpoint.input_offsets_;
+  }
+}
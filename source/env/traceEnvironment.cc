@@ -24,6 +24,8 @@
 
 #include "env/traceEnvironment.h"
 
+#include <algorithm>
+#include <optional>
 #include <utility>
 
 const std::string *TraceEnvironment::GetCallFunc(
@@ -58,10 +60,39 @@ bool TraceEnvironment::AddSymbolTableInternal(const std::string identifier,
   return true;
 }
 
+bool TraceEnvironment::ResumeFromCheckpoint() {
+  throw_on(not trace_env_config_.IsCheckpointingEnabled(), "no checkpoint file configured", source_loc::current());
+  std::optional<Checkpoint> checkpoint = Checkpoint::LoadFromFile(trace_env_config_.GetCheckpointFile());
+  if (not checkpoint) {
+    return false;
+  }
+
+  RaiseCounter(next_span_id_, checkpoint->next_span_id_);
+  RaiseCounter(next_trace_id_, checkpoint->next_trace_id_);
+  RaiseCounter(next_trace_context_id_, checkpoint->next_trace_context_id_);
+  spdlog::info("resume from checkpoint {} with {} inputs", checkpoint->sequence_, checkpoint->input_offsets_.size());
+  if (checkpoint->open_spans_ > 0) {
+    spdlog::warn("checkpoint {} was taken with {} spans or contexts still open, they are rebuilt by reading the "
+                 "inputs again from timestamp {} on; spans exported after that timestamp are exported again",
+                 checkpoint->sequence_, checkpoint->open_spans_, checkpoint->frontier_ts_);
+  }
+  checkpoints_.ResumeFrom(std::move(*checkpoint));
+  return true;
+}
+
 TraceEnvironment::TraceEnvironment(const TraceEnvConfig &trace_env_config)
     : trace_env_config_(trace_env_config),
       runtime_(trace_env_config_.GetRuntimeOptions()),
-      types_to_filter_(trace_env_config.BeginTypesToFilter(), trace_env_config.EndTypesToFilter()) {
+      types_to_filter_(trace_env_config.BeginTypesToFilter(), trace_env_config.EndTypesToFilter()),
+      worker_pool_([this]() { return runtime_.make_worker_thread_executor(); },
+                   trace_env_config_.GetWorkerThreads(),
+                   trace_env_config_.GetWorkerThreadAffinity()) {
+  if (trace_env_config_.IsWorkStealingEnabled()) {
+    work_stealing_executor_ = create_shared<WorkStealingExecutor>("could not create work stealing executor",
+                                                                  trace_env_config_.GetWorkStealingThreads());
+  }
+  metrics_.AddCollector([this](std::ostream &out) { channel_metrics_.WritePrometheus(out); });
+
   InternalizeStrings(trace_env_config_.BeginFuncIndicator(),
                      trace_env_config_.EndFuncIndicator(),
                      linux_net_func_indicator_);
@@ -0,0 +1,473 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "events/columnarStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kStoreMagic[8] = {'C', 'O', 'L', 'S', 'T', 'O', 'R', 'E'};
+constexpr uint64_t kStoreVersion = 1;
+
+struct StoreFileHeader {
+  char magic_[8];
+  uint64_t version_;
+  uint64_t chunk_count_;
+};
+
+// every chunk header is followed by the ts, parser id and field_count_ field columns,
+// each of them consisting of rows_ uint64_t values
+struct ChunkFileHeader {
+  uint64_t type_;
+  uint64_t rows_;
+  uint64_t min_ts_;
+  uint64_t max_ts_;
+  uint64_t field_count_;
+};
+
+static_assert(sizeof(StoreFileHeader) % sizeof(uint64_t) == 0);
+static_assert(sizeof(ChunkFileHeader) % sizeof(uint64_t) == 0);
+
+std::array<ColumnFieldNames, kEventTypeCount> BuildFieldNames() {
+  std::array<ColumnFieldNames, kEventTypeCount> names{};
+  auto set = [&names](std::initializer_list<EventType> types, ColumnFieldNames fields) {
+    for (const EventType type : types) {
+      names[static_cast<size_t>(type)] = fields;
+    }
+  };
+  set({kHostInstrT, kHostCallT}, {"pc"});
+  set({kHostIdOpT, kHostMmioCRT, kHostMmioCWT, kHostDmaCT}, {"id"});
+  set({kHostAddrSizeOpT, kHostDmaRT, kHostDmaWT}, {"id", "addr", "size"});
+  set({kHostMmioRT, kHostMmioWT}, {"id", "addr", "size", "bar", "offset"});
+  set({kHostMsiXT}, {"vec"});
+  set({kHostConfT}, {"dev", "func", "reg", "bytes", "data"});
+  set({kHostPciRWT}, {"offset", "size", "is_read"});
+  set({kNicMsixT}, {"vec", "is_x"});
+  set({kNicDmaT, kNicDmaIT, kNicDmaExT, kNicDmaEnT, kNicDmaCRT, kNicDmaCWT}, {"id", "addr", "len"});
+  set({kSetIXT}, {"intr"});
+  set({kNicMmioT, kNicMmioRT, kNicMmioWT}, {"off", "len", "val"});
+  set({kNicTrxT, kNicTxT}, {"len"});
+  set({kNicRxT}, {"len", "port"});
+  set({kNetworkEnqueueT, kNetworkDequeueT, kNetworkDropT},
+      {"node", "device", "packet_uid", "payload_size", "boundary_type"});
+  return names;
+}
+
+inline size_t SelectRange(const uint64_t *column, size_t base, size_t len,
+                          uint64_t lower, uint64_t upper, uint32_t *selection) {
+  // branch free: always write the candidate and only advance on a match, the unsigned
+  // subtraction folds both range checks into a single comparison
+  const uint64_t width = upper - lower;
+  size_t count = 0;
+  for (size_t index = 0; index < len; ++index) {
+    const size_t row = base + index;
+    selection[count] = static_cast<uint32_t>(row);
+    count += static_cast<size_t>(column[row] - lower <= width);
+  }
+  return count;
+}
+
+inline size_t RefineRange(const uint64_t *column, uint32_t *selection, size_t len,
+                          uint64_t lower, uint64_t upper) {
+  const uint64_t width = upper - lower;
+  size_t count = 0;
+  for (size_t index = 0; index < len; ++index) {
+    const uint32_t row = selection[index];
+    selection[count] = row;
+    count += static_cast<size_t>(column[row] - lower <= width);
+  }
+  return count;
+}
+
+void WriteColumn(std::ofstream &out, const uint64_t *column, size_t rows) {
+  out.write(reinterpret_cast<const char *>(column), static_cast<std::streamsize>(rows * sizeof(uint64_t)));
+}
+
+}  // namespace
+
+const ColumnFieldNames &GetColumnFieldNames(EventType type) {
+  static const std::array<ColumnFieldNames, kEventTypeCount> kFieldNames = BuildFieldNames();
+  const auto index = static_cast<size_t>(type);
+  throw_on(index >= kEventTypeCount, "GetColumnFieldNames unknown event type", source_loc::current());
+  return kFieldNames[index];
+}
+
+size_t GetColumnFieldCount(EventType type) {
+  const ColumnFieldNames &names = GetColumnFieldNames(type);
+  size_t count = 0;
+  while (count < kColumnFieldCount and not names[count].empty()) {
+    ++count;
+  }
+  return count;
+}
+
+int GetColumnFieldIndex(EventType type, std::string_view name) {
+  const ColumnFieldNames &names = GetColumnFieldNames(type);
+  for (size_t index = 0; index < kColumnFieldCount; ++index) {
+    if (not names[index].empty() and names[index] == name) {
+      return static_cast<int>(index);
+    }
+  }
+  return -1;
+}
+
+void ExtractColumnFields(const Event &event, std::array<uint64_t, kColumnFieldCount> &fields) {
+  fields.fill(0);
+  switch (event.GetType()) {
+    case kHostInstrT:
+    case kHostCallT: {
+      fields[0] = static_cast<const HostInstr &>(event).GetPc();
+      break;
+    }
+    case kHostIdOpT:
+    case kHostMmioCRT:
+    case kHostMmioCWT:
+    case kHostDmaCT: {
+      fields[0] = static_cast<const HostIdOp &>(event).GetId();
+      break;
+    }
+    case kHostMmioRT:
+    case kHostMmioWT: {
+      const auto &mmio = static_cast<const HostMmioOp &>(event);
+      fields[3] = static_cast<uint64_t>(mmio.GetBar());
+      fields[4] = mmio.GetOffset();
+      [[fallthrough]];
+    }
+    case kHostAddrSizeOpT:
+    case kHostDmaRT:
+    case kHostDmaWT: {
+      const auto &addr_size = static_cast<const HostAddrSizeOp &>(event);
+      fields[0] = addr_size.GetId();
+      fields[1] = addr_size.GetAddr();
+      fields[2] = addr_size.GetSize();
+      break;
+    }
+    case kHostMsiXT: {
+      fields[0] = static_cast<const HostMsiX &>(event).GetVec();
+      break;
+    }
+    case kHostConfT: {
+      const auto &conf = static_cast<const HostConf &>(event);
+      fields[0] = conf.GetDev();
+      fields[1] = conf.GetFunc();
+      fields[2] = conf.GetReg();
+      fields[3] = conf.GetBytes();
+      fields[4] = conf.GetData();
+      break;
+    }
+    case kHostPciRWT: {
+      const auto &pci = static_cast<const HostPciRW &>(event);
+      fields[0] = pci.GetOffset();
+      fields[1] = pci.GetSize();
+      fields[2] = pci.IsRead() ? 1 : 0;
+      break;
+    }
+    case kNicMsixT: {
+      const auto &msix = static_cast<const NicMsix &>(event);
+      fields[0] = msix.GetVec();
+      fields[1] = msix.IsX() ? 1 : 0;
+      break;
+    }
+    case kNicDmaT:
+    case kNicDmaIT:
+    case kNicDmaExT:
+    case kNicDmaEnT:
+    case kNicDmaCRT:
+    case kNicDmaCWT: {
+      const auto &dma = static_cast<const NicDma &>(event);
+      fields[0] = dma.GetId();
+      fields[1] = dma.GetAddr();
+      fields[2] = dma.GetLen();
+      break;
+    }
+    case kSetIXT: {
+      fields[0] = static_cast<const SetIX &>(event).GetIntr();
+      break;
+    }
+    case kNicMmioT:
+    case kNicMmioRT:
+    case kNicMmioWT: {
+      const auto &mmio = static_cast<const NicMmio &>(event);
+      fields[0] = mmio.GetOff();
+      fields[1] = mmio.GetLen();
+      fields[2] = mmio.GetVal();
+      break;
+    }
+    case kNicRxT: {
+      fields[1] = static_cast<uint64_t>(static_cast<const NicRx &>(event).GetPort());
+      [[fallthrough]];
+    }
+    case kNicTrxT:
+    case kNicTxT: {
+      fields[0] = static_cast<const NicTrx &>(event).GetLen();
+      break;
+    }
+    case kNetworkEnqueueT:
+    case kNetworkDequeueT:
+    case kNetworkDropT: {
+      const auto &net = static_cast<const NetworkEvent &>(event);
+      fields[0] = static_cast<uint64_t>(net.GetNode());
+      fields[1] = static_cast<uint64_t>(net.GetDevice());
+      fields[2] = net.GetPacketUid();
+      fields[3] = net.GetPayloadSize();
+      fields[4] = static_cast<uint64_t>(net.GetBoundaryType());
+      break;
+    }
+    default:break;
+  }
+}
+
+size_t ScanColumnChunks(const std::vector<ColumnChunkView> &chunks,
+                        const ColumnQuery &query,
+                        const ColumnSelectionCallback &callback) {
+  std::array<uint32_t, kColumnScanBatch> selection{};
+  const uint64_t ts_lower = query.GetTsLower();
+  const uint64_t ts_upper = query.GetTsUpper();
+  size_t matches = 0;
+
+  for (const ColumnChunkView &chunk : chunks) {
+    // zone map pruning
+    if (chunk.rows_ == 0 or chunk.max_ts_ < ts_lower or chunk.min_ts_ > ts_upper) {
+      continue;
+    }
+    const bool fully_covered = ts_lower <= chunk.min_ts_ and chunk.max_ts_ <= ts_upper;
+
+    for (size_t base = 0; base < chunk.rows_; base += kColumnScanBatch) {
+      const size_t len = std::min(kColumnScanBatch, chunk.rows_ - base);
+      size_t count;
+      if (fully_covered) {
+        for (size_t index = 0; index < len; ++index) {
+          selection[index] = static_cast<uint32_t>(base + index);
+        }
+        count = len;
+      } else {
+        count = SelectRange(chunk.ts_, base, len, ts_lower, ts_upper, selection.data());
+      }
+
+      for (const ColumnPredicate &predicate : query.GetPredicates()) {
+        if (count == 0) {
+          break;
+        }
+        const uint64_t *column = chunk.fields_[predicate.field_];
+        throw_if_empty(column, "ScanColumnChunks predicate on missing column", source_loc::current());
+        count = RefineRange(column, selection.data(), count, predicate.lower_, predicate.upper_);
+      }
+
+      if (count > 0) {
+        matches += count;
+        if (callback) {
+          callback(chunk, selection.data(), count);
+        }
+      }
+    }
+  }
+
+  return matches;
+}
+
+ColumnChunk::ColumnChunk(EventType type) : type_(type), field_count_(GetColumnFieldCount(type)) {
+  // reserve the full chunk upfront, views handed out stay valid while the chunk fills up
+  ts_.reserve(kColumnChunkRows);
+  parser_id_.reserve(kColumnChunkRows);
+  for (size_t field = 0; field < field_count_; ++field) {
+    fields_[field].reserve(kColumnChunkRows);
+  }
+}
+
+void ColumnChunk::Append(uint64_t timestamp,
+                         uint64_t parser_id,
+                         const std::array<uint64_t, kColumnFieldCount> &fields) {
+  throw_on(IsFull(), "ColumnChunk::Append chunk is full", source_loc::current());
+  ts_.push_back(timestamp);
+  parser_id_.push_back(parser_id);
+  for (size_t field = 0; field < field_count_; ++field) {
+    fields_[field].push_back(fields[field]);
+  }
+  min_ts_ = std::min(min_ts_, timestamp);
+  max_ts_ = std::max(max_ts_, timestamp);
+  ++rows_;
+}
+
+ColumnChunkView ColumnChunk::View() const {
+  ColumnChunkView view{type_, rows_, min_ts_, max_ts_, ts_.data(), parser_id_.data()};
+  for (size_t field = 0; field < field_count_; ++field) {
+    view.fields_[field] = fields_[field].data();
+  }
+  return view;
+}
+
+std::vector<ColumnChunkView> ColumnarEventStore::GetViews(EventType type) {
+  const auto &chunks = chunks_[static_cast<size_t>(type)];
+  std::vector<ColumnChunkView> views;
+  views.reserve(chunks.size());
+  for (const auto &chunk : chunks) {
+    views.push_back(chunk->View());
+  }
+  return views;
+}
+
+void ColumnarEventStore::Append(const std::shared_ptr<Event> &event) {
+  throw_if_empty(event, TraceException::kEventIsNull, source_loc::current());
+  const auto type = static_cast<size_t>(event->GetType());
+  throw_on(type >= kEventTypeCount, "ColumnarEventStore::Append unknown event type", source_loc::current());
+
+  std::array<uint64_t, kColumnFieldCount> fields{};
+  ExtractColumnFields(*event, fields);
+
+  const std::lock_guard<std::mutex> guard(store_mutex_);
+  auto &chunks = chunks_[type];
+  if (chunks.empty() or chunks.back()->IsFull()) {
+    chunks.push_back(create_unique<ColumnChunk>("ColumnChunk is null", event->GetType()));
+  }
+  chunks.back()->Append(event->GetTs(), event->GetParserIdent(), fields);
+  ++size_;
+}
+
+concurrencpp::result<void> ColumnarEventStore::consume(std::shared_ptr<concurrencpp::executor> executor,
+                                                       std::shared_ptr<Event> value) {
+  Append(value);
+  co_return;
+}
+
+size_t ColumnarEventStore::GetSize() {
+  const std::lock_guard<std::mutex> guard(store_mutex_);
+  return size_;
+}
+
+size_t ColumnarEventStore::Scan(const ColumnQuery &query, const ColumnSelectionCallback &callback) {
+  const std::lock_guard<std::mutex> guard(store_mutex_);
+  return ScanColumnChunks(GetViews(query.GetType()), query, callback);
+}
+
+void ColumnarEventStore::WriteToFile(const std::string &file_path) {
+  const std::lock_guard<std::mutex> guard(store_mutex_);
+
+  std::ofstream out{file_path, std::ios::binary | std::ios::trunc};
+  throw_on(not out.is_open(), "ColumnarEventStore::WriteToFile could not open file", source_loc::current());
+
+  StoreFileHeader file_header{};
+  std::memcpy(file_header.magic_, kStoreMagic, sizeof(kStoreMagic));
+  file_header.version_ = kStoreVersion;
+  file_header.chunk_count_ = 0;
+  for (const auto &chunks : chunks_) {
+    file_header.chunk_count_ += chunks.size();
+  }
+  out.write(reinterpret_cast<const char *>(&file_header), sizeof(file_header));
+
+  for (size_t type = 0; type < kEventTypeCount; ++type) {
+    const size_t field_count = GetColumnFieldCount(static_cast<EventType>(type));
+    for (const ColumnChunkView &view : GetViews(static_cast<EventType>(type))) {
+      const ChunkFileHeader chunk_header{type, view.rows_, view.min_ts_, view.max_ts_, field_count};
+      out.write(reinterpret_cast<const char *>(&chunk_header), sizeof(chunk_header));
+      WriteColumn(out, view.ts_, view.rows_);
+      WriteColumn(out, view.parser_id_, view.rows_);
+      for (size_t field = 0; field < field_count; ++field) {
+        WriteColumn(out, view.fields_[field], view.rows_);
+      }
+    }
+  }
+
+  out.flush();
+  throw_on(not out.good(), "ColumnarEventStore::WriteToFile error while writing", source_loc::current());
+}
+
+MappedColumnarStore::MappedColumnarStore(const std::string &file_path) {
+  const int file_descriptor = open(file_path.c_str(), O_RDONLY);
+  throw_on(file_descriptor == -1, "MappedColumnarStore could not open file", source_loc::current());
+
+  struct stat file_stat{};
+  const int stat_res = fstat(file_descriptor, &file_stat);
+  if (stat_res != 0 or static_cast<size_t>(file_stat.st_size) < sizeof(StoreFileHeader)) {
+    close(file_descriptor);
+    throw_just(source_loc::current(), "MappedColumnarStore invalid store file '", file_path, "'");
+  }
+  length_ = static_cast<size_t>(file_stat.st_size);
+
+  mapping_ = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+  close(file_descriptor);
+  throw_on(mapping_ == MAP_FAILED, "MappedColumnarStore could not mmap file", source_loc::current());
+
+  const auto *base = static_cast<const char *>(mapping_);
+  const auto *file_header = reinterpret_cast<const StoreFileHeader *>(base);
+  ThrowOnInvalid(std::memcmp(file_header->magic_, kStoreMagic, sizeof(kStoreMagic)) != 0
+                     or file_header->version_ != kStoreVersion,
+                 "MappedColumnarStore unsupported file format", source_loc::current());
+
+  size_t offset = sizeof(StoreFileHeader);
+  for (uint64_t chunk = 0; chunk < file_header->chunk_count_; ++chunk) {
+    ThrowOnInvalid(offset + sizeof(ChunkFileHeader) > length_, "MappedColumnarStore truncated chunk header",
+                   source_loc::current());
+    const auto *chunk_header = reinterpret_cast<const ChunkFileHeader *>(base + offset);
+    offset += sizeof(ChunkFileHeader);
+
+    ThrowOnInvalid(chunk_header->type_ >= kEventTypeCount or chunk_header->field_count_ > kColumnFieldCount
+                       or chunk_header->rows_ > UINT32_MAX,
+                   "MappedColumnarStore corrupt chunk header", source_loc::current());
+    const size_t column_bytes = chunk_header->rows_ * sizeof(uint64_t);
+    ThrowOnInvalid(offset + (2 + chunk_header->field_count_) * column_bytes > length_,
+                   "MappedColumnarStore truncated chunk", source_loc::current());
+
+    const auto *columns = reinterpret_cast<const uint64_t *>(base + offset);
+    ColumnChunkView view{static_cast<EventType>(chunk_header->type_), chunk_header->rows_,
+                         chunk_header->min_ts_, chunk_header->max_ts_,
+                         columns, columns + chunk_header->rows_};
+    for (size_t field = 0; field < chunk_header->field_count_; ++field) {
+      view.fields_[field] = columns + (2 + field) * chunk_header->rows_;
+    }
+    offset += (2 + chunk_header->field_count_) * column_bytes;
+
+    size_ += view.rows_;
+    chunks_[chunk_header->type_].push_back(view);
+  }
+}
+
+MappedColumnarStore::~MappedColumnarStore() {
+  Unmap();
+}
+
+void MappedColumnarStore::Unmap() {
+  if (mapping_ != nullptr and mapping_ != MAP_FAILED) {
+    munmap(mapping_, length_);
+  }
+  mapping_ = nullptr;
+}
+
+void MappedColumnarStore::ThrowOnInvalid(bool invalid, const char *message, const source_loc &location) {
+  if (invalid) {
+    // the destructor does not run for a store that failed to construct
+    Unmap();
+    throw_on(true, message, location);
+  }
+}
+
+size_t MappedColumnarStore::Scan(const ColumnQuery &query, const ColumnSelectionCallback &callback) const {
+  return ScanColumnChunks(chunks_[static_cast<size_t>(query.GetType())], query, callback);
+}
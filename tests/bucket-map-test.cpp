@@ -0,0 +1,72 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "util/bucketMap.h"
+
+TEST_CASE("Test BucketMap", "[BucketMap]") {
+  BucketMap<uint64_t, std::string> map;
+
+  SECTION("find only looks at the bucket of a key") {
+    map.Insert(1, "one");
+    map.Insert(2, "two");
+    REQUIRE(map.Size() == 2);
+
+    auto *found = map.FindIf(1, [](const std::string &) { return true; });
+    REQUIRE(found);
+    REQUIRE(*found == "one");
+    REQUIRE_FALSE(map.FindIf(3, [](const std::string &) { return true; }));
+    REQUIRE_FALSE(map.FindIf(2, [](const std::string &val) { return val == "one"; }));
+  }
+
+  SECTION("values sharing a key are visited in insertion order") {
+    map.Insert(1, "first");
+    map.Insert(1, "second");
+    map.Insert(1, "third");
+
+    std::vector<std::string> visited;
+    auto *found = map.FindIf(1, [&visited](const std::string &val) {
+      visited.push_back(val);
+      return val != "first";
+    });
+    REQUIRE(found);
+    REQUIRE(*found == "second");
+    REQUIRE(visited == std::vector<std::string>{"first", "second"});
+  }
+
+  SECTION("remove drops a single occurrence") {
+    map.Insert(1, "one");
+    map.Insert(1, "one");
+    REQUIRE(map.Remove(1, "one"));
+    REQUIRE(map.Size() == 1);
+    REQUIRE(map.Remove(1, "one"));
+    REQUIRE_FALSE(map.Remove(1, "one"));
+    REQUIRE_FALSE(map.Remove(2, "two"));
+    REQUIRE(map.Empty());
+  }
+}
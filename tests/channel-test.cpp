@@ -23,7 +23,10 @@
  */
 
 #include <catch2/catch_all.hpp>
+#include <chrono>
+#include <iostream>
 #include <memory>
+#include <thread>
 #include "sync/corobelt.h"
 
 TEST_CASE("Test BoundedChannel", "[BoundedChannel]") {
@@ -206,3 +209,448 @@ TEST_CASE("filling the channel", "[filling-chan]") {
   prod.get();
   REQUIRE(akkumulator == (bound * (bound + 1)) / 2);
 }
+
+TEST_CASE("Test SpscChannel", "[SpscChannel]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  const size_t capacity = 4;
+  CoroSpscChannel<int> channel_to_test{capacity};
+
+  SECTION("can push into channel till full") {
+    for (size_t i = 0; i < capacity; i++) {
+      REQUIRE(channel_to_test.Push(thread_pool_executor, i).run().get());
+    }
+    REQUIRE_FALSE(channel_to_test.TryPush(thread_pool_executor, 4).run().get());
+    REQUIRE(channel_to_test.GetSize(thread_pool_executor).get() == capacity);
+  }
+
+  SECTION("channel does not change order") {
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 1).run().get());
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 2).run().get());
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 3).run().get());
+
+    REQUIRE(channel_to_test.Pop(thread_pool_executor).run().get().value_or(-1) == 1);
+    REQUIRE(channel_to_test.Pop(thread_pool_executor).run().get().value_or(-1) == 2);
+    REQUIRE(channel_to_test.Pop(thread_pool_executor).run().get().value_or(-1) == 3);
+    REQUIRE(channel_to_test.Empty(thread_pool_executor).get());
+  }
+
+  SECTION("pop would only suspend on an empty and open channel") {
+    REQUIRE(channel_to_test.WouldPopSuspend());
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 1).run().get());
+    REQUIRE_FALSE(channel_to_test.WouldPopSuspend());
+    REQUIRE(channel_to_test.Pop(thread_pool_executor).run().get().value_or(-1) == 1);
+    REQUIRE(channel_to_test.WouldPopSuspend());
+
+    channel_to_test.CloseChannel(thread_pool_executor).get();
+    REQUIRE_FALSE(channel_to_test.WouldPopSuspend());
+  }
+
+  SECTION("pop on true only removes matching values") {
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 1).run().get());
+    std::function<bool(int &)> is_two = [](int &val) { return val == 2; };
+    std::function<bool(int &)> is_one = [](int &val) { return val == 1; };
+    REQUIRE_FALSE(channel_to_test.TryPopOnTrue(thread_pool_executor, is_two).run().get().has_value());
+    REQUIRE(channel_to_test.TryPopOnTrue(thread_pool_executor, is_one).run().get().value_or(-1) == 1);
+  }
+
+  SECTION("can read from and not write to closed channel") {
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 1).run().get());
+
+    channel_to_test.CloseChannel(thread_pool_executor).get();
+
+    REQUIRE(channel_to_test.Pop(thread_pool_executor).run().get().value_or(-1) == 1);
+    REQUIRE_FALSE(channel_to_test.Pop(thread_pool_executor).run().get().has_value());
+    REQUIRE_FALSE(channel_to_test.TryPush(thread_pool_executor, 2).run().get());
+  }
+
+  SECTION("cannot read from or write to poisened channel") {
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 1).run().get());
+    channel_to_test.PoisenChannel(thread_pool_executor).get();
+
+    REQUIRE_FALSE(channel_to_test.TryPop(thread_pool_executor).run().get().has_value());
+    REQUIRE_FALSE(channel_to_test.TryPush(thread_pool_executor, 2).run().get());
+  }
+}
+
+concurrencpp::result<void>
+spsc_fill_task(concurrencpp::executor_tag,
+               int bound,
+               std::shared_ptr<concurrencpp::executor> executor,
+               std::shared_ptr<CoroSpscChannel<int>> chan) {
+  for (int i = 0; i <= bound; i++) {
+    co_await chan->Push(executor, i);
+  }
+  co_await chan->CloseChannel(executor);
+  co_return;
+}
+
+concurrencpp::result<int64_t>
+spsc_drain_task(concurrencpp::executor_tag,
+                std::shared_ptr<concurrencpp::executor> executor,
+                std::shared_ptr<CoroSpscChannel<int>> chan) {
+  int64_t akkumulator = 0;
+  std::optional<int> opt;
+  for (opt = co_await chan->Pop(executor); opt.has_value(); opt = co_await chan->Pop(executor)) {
+    akkumulator += *opt;
+  }
+  co_return akkumulator;
+}
+
+TEST_CASE("filling the spsc channel", "[filling-spsc-chan]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 2;
+  concurren_options.max_cpu_threads = 2;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  // a tiny capacity forces both sides to suspend frequently
+  auto channel_to_test = std::make_shared<CoroSpscChannel<int>>(2);
+
+  const int bound = 100'000;
+
+  auto cons = spsc_drain_task({}, thread_pool_executor, channel_to_test);
+  auto prod = spsc_fill_task({}, bound, thread_pool_executor, channel_to_test);
+  prod.get();
+  const int64_t akkumulator = cons.get();
+  REQUIRE(akkumulator == (static_cast<int64_t>(bound) * (bound + 1)) / 2);
+}
+
+TEST_CASE("Test MpmcChannel", "[MpmcChannel]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  const size_t to_test_size{2'000};
+  CoroMpmcChannel<int> channel_to_test;
+
+  SECTION("channel does not change order across segments") {
+    for (size_t i = 0; i < to_test_size; i++) {
+      REQUIRE(channel_to_test.Push(thread_pool_executor, i).run().get());
+    }
+    REQUIRE(channel_to_test.GetSize(thread_pool_executor).get() == to_test_size);
+
+    for (size_t i = 0; i < to_test_size; i++) {
+      REQUIRE(channel_to_test.Pop(thread_pool_executor).run().get().value_or(to_test_size + 1) == i);
+    }
+    REQUIRE(channel_to_test.Empty(thread_pool_executor).get());
+  }
+
+  SECTION("pop on true keeps non matching values") {
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 1).run().get());
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 2).run().get());
+    std::function<bool(int &)> is_two = [](int &val) { return val == 2; };
+    std::function<bool(int &)> is_one = [](int &val) { return val == 1; };
+
+    REQUIRE_FALSE(channel_to_test.TryPopOnTrue(thread_pool_executor, is_two).run().get().has_value());
+    REQUIRE(channel_to_test.GetSize(thread_pool_executor).get() == 2);
+    REQUIRE(channel_to_test.TryPopOnTrue(thread_pool_executor, is_one).run().get().value_or(-1) == 1);
+    REQUIRE(channel_to_test.TryPopOnTrue(thread_pool_executor, is_two).run().get().value_or(-1) == 2);
+  }
+
+  SECTION("can read from and not write to closed channel") {
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 1).run().get());
+
+    channel_to_test.CloseChannel(thread_pool_executor).get();
+
+    REQUIRE(channel_to_test.Pop(thread_pool_executor).run().get().value_or(-1) == 1);
+    REQUIRE_FALSE(channel_to_test.Pop(thread_pool_executor).run().get().has_value());
+    REQUIRE_FALSE(channel_to_test.TryPush(thread_pool_executor, 2).run().get());
+  }
+
+  SECTION("cannot read from or write to poisened channel") {
+    channel_to_test.PoisenChannel(thread_pool_executor).get();
+
+    REQUIRE_FALSE(channel_to_test.TryPop(thread_pool_executor).run().get().has_value());
+    REQUIRE_FALSE(channel_to_test.TryPush(thread_pool_executor, 2).run().get());
+  }
+}
+
+concurrencpp::result<void>
+mpmc_fill_task(concurrencpp::executor_tag,
+               int bound,
+               std::shared_ptr<concurrencpp::executor> executor,
+               std::shared_ptr<CoroChannel<int>> chan) {
+  for (int i = 1; i <= bound; i++) {
+    co_await chan->Push(executor, i);
+  }
+  co_return;
+}
+
+concurrencpp::result<int64_t>
+mpmc_drain_task(concurrencpp::executor_tag,
+                std::shared_ptr<concurrencpp::executor> executor,
+                std::shared_ptr<CoroChannel<int>> chan) {
+  int64_t akkumulator = 0;
+  std::optional<int> opt;
+  for (opt = co_await chan->Pop(executor); opt.has_value(); opt = co_await chan->Pop(executor)) {
+    akkumulator += *opt;
+  }
+  co_return akkumulator;
+}
+
+// runs producers and consumers concurrently on the channel, checks that every value arrived
+// exactly once and returns the throughput in values per second
+double StressChannel(const std::shared_ptr<CoroChannel<int>> &channel_to_test,
+                     size_t producers, size_t consumers, int bound) {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = producers + consumers;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<concurrencpp::result<int64_t>> drains;
+  for (size_t index = 0; index < consumers; index++) {
+    drains.push_back(mpmc_drain_task({}, thread_pool_executor, channel_to_test));
+  }
+  std::vector<concurrencpp::result<void>> fills;
+  for (size_t index = 0; index < producers; index++) {
+    fills.push_back(mpmc_fill_task({}, bound, thread_pool_executor, channel_to_test));
+  }
+  for (auto &fill : fills) {
+    fill.get();
+  }
+  channel_to_test->CloseChannel(thread_pool_executor).get();
+
+  int64_t akkumulator = 0;
+  for (auto &drain : drains) {
+    akkumulator += drain.get();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  REQUIRE(akkumulator == static_cast<int64_t>(producers) * ((static_cast<int64_t>(bound) * (bound + 1)) / 2));
+  return static_cast<double>(producers * bound) / elapsed.count();
+}
+
+TEST_CASE("stress the mpmc channel", "[stress-mpmc-chan]") {
+  const size_t producers = 4;
+  const size_t consumers = 4;
+  const int bound = 250'000;
+
+  const double mpmc_throughput = StressChannel(std::make_shared<CoroMpmcChannel<int>>(), producers, consumers, bound);
+  const double locked_throughput =
+      StressChannel(std::make_shared<CoroUnBoundedChannel<int>>(), producers, consumers, bound);
+  std::cout << producers << " producers, " << consumers << " consumers: mpmc channel "
+            << static_cast<uint64_t>(mpmc_throughput) << " values/s, unbounded channel "
+            << static_cast<uint64_t>(locked_throughput) << " values/s" << '\n';
+}
+
+template<typename ChanT>
+void CheckBatchOperations(const std::shared_ptr<concurrencpp::executor> &exec, ChanT &channel_to_test) {
+  std::vector<int> to_push{1, 2, 3, 4, 5};
+  REQUIRE(channel_to_test.PushBatch(exec, to_push).run().get() == 5);
+  REQUIRE(channel_to_test.GetSize(exec).get() == 5);
+
+  std::vector<int> popped;
+  REQUIRE(channel_to_test.PopBatch(exec, popped, 3).run().get() == 3);
+  REQUIRE(popped == std::vector<int>{1, 2, 3});
+
+  REQUIRE(channel_to_test.TryPopBatch(exec, popped, 8).run().get() == 2);
+  REQUIRE(popped == std::vector<int>{1, 2, 3, 4, 5});
+  REQUIRE(channel_to_test.TryPopBatch(exec, popped, 8).run().get() == 0);
+
+  channel_to_test.CloseChannel(exec).get();
+  REQUIRE(channel_to_test.PushBatch(exec, to_push).run().get() == 0);
+  REQUIRE(channel_to_test.PopBatch(exec, popped, 8).run().get() == 0);
+}
+
+TEST_CASE("Test batch operations", "[BatchChannel]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  SECTION("bounded channel") {
+    CoroBoundedChannel<int> channel_to_test{8};
+    CheckBatchOperations(thread_pool_executor, channel_to_test);
+  }
+
+  SECTION("unbounded channel") {
+    CoroUnBoundedChannel<int> channel_to_test;
+    CheckBatchOperations(thread_pool_executor, channel_to_test);
+  }
+
+  SECTION("spsc channel") {
+    CoroSpscChannel<int> channel_to_test{8};
+    CheckBatchOperations(thread_pool_executor, channel_to_test);
+  }
+
+  SECTION("mpmc channel") {
+    CoroMpmcChannel<int> channel_to_test;
+    CheckBatchOperations(thread_pool_executor, channel_to_test);
+  }
+
+  SECTION("non coro buffered channel") {
+    NonCoroBufferedChannel<int> channel_to_test{8};
+    std::vector<int> to_push{1, 2, 3};
+    REQUIRE(channel_to_test.PushBatch(to_push) == 3);
+    std::vector<int> popped;
+    REQUIRE(channel_to_test.PopBatch(popped, 8) == 3);
+    REQUIRE(popped == to_push);
+    REQUIRE(channel_to_test.TryPopBatch(popped, 8) == 0);
+  }
+}
+
+TEST_CASE("non coro buffered channel wakeups", "[NonCoroBufferedChannel]") {
+  constexpr size_t kAmountThreads = 4;
+  constexpr uint64_t kValuesPerProducer = 10'000;
+
+  for (const auto strategy : {NonCoroWaitStrategy::kBlock, NonCoroWaitStrategy::kSpinThenBlock}) {
+    NonCoroBufferedChannel<uint64_t> channel_to_test{4};
+    channel_to_test.SetWaitStrategy(strategy);
+    auto metrics = std::make_shared<ChannelMetrics>("non-coro");
+    channel_to_test.EnableMetrics(metrics);
+
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+    std::vector<uint64_t> sums(kAmountThreads, 0);
+    for (size_t index = 0; index < kAmountThreads; index++) {
+      consumers.emplace_back([&channel_to_test, &sums, index]() {
+        for (auto value = channel_to_test.Pop(); value.has_value(); value = channel_to_test.Pop()) {
+          sums[index] += *value;
+        }
+      });
+      producers.emplace_back([&channel_to_test]() {
+        for (uint64_t value = 1; value <= kValuesPerProducer; value++) {
+          channel_to_test.Push(value);
+        }
+      });
+    }
+    for (auto &producer : producers) {
+      producer.join();
+    }
+    channel_to_test.CloseChannel();
+    for (auto &consumer : consumers) {
+      consumer.join();
+    }
+
+    uint64_t sum = 0;
+    for (const uint64_t partial : sums) {
+      sum += partial;
+    }
+    REQUIRE(sum == kAmountThreads * kValuesPerProducer * (kValuesPerProducer + 1) / 2);
+    REQUIRE(metrics->GetPushes() == kAmountThreads * kValuesPerProducer);
+    REQUIRE(metrics->GetPops() == kAmountThreads * kValuesPerProducer);
+    REQUIRE(metrics->GetFutileWakeups() <= metrics->GetWakeups());
+  }
+}
+
+TEST_CASE("Test channel metrics", "[ChannelMetrics]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  ChannelMetricsRegistry registry;
+
+  SECTION("occupancy bucket") {
+    REQUIRE(ChannelMetrics::GetOccupancyBucket(0) == 0);
+    REQUIRE(ChannelMetrics::GetOccupancyBucket(1) == 1);
+    REQUIRE(ChannelMetrics::GetOccupancyBucket(3) == 2);
+    REQUIRE(ChannelMetrics::GetOccupancyBucket(4) == 3);
+    REQUIRE(ChannelMetrics::GetOccupancyBucket(1ULL << 40) == kChannelOccupancyBuckets - 1);
+  }
+
+  SECTION("bounded channel counts pushes and pops") {
+    CoroBoundedChannel<int> channel_to_test{8};
+    channel_to_test.EnableMetrics(registry.Register("bounded"));
+    std::vector<int> to_push{1, 2, 3};
+    REQUIRE(channel_to_test.PushBatch(thread_pool_executor, to_push).run().get() == 3);
+    REQUIRE(channel_to_test.Pop(thread_pool_executor).run().get().value_or(-1) == 1);
+
+    const auto &metrics = channel_to_test.GetMetrics();
+    REQUIRE(metrics->GetName() == "bounded");
+    REQUIRE(metrics->GetPushes() == 3);
+    REQUIRE(metrics->GetPops() == 1);
+    REQUIRE(metrics->GetHighWaterMark() == 3);
+    REQUIRE(metrics->GetOccupancyCount(1) == 1);
+    REQUIRE(metrics->GetOccupancyCount(2) == 2);
+  }
+
+  SECTION("spsc and mpmc channel count pushes and pops") {
+    CoroSpscChannel<int> spsc_channel{8};
+    spsc_channel.EnableMetrics(registry.Register("spsc"));
+    CoroMpmcChannel<int> mpmc_channel;
+    mpmc_channel.EnableMetrics(registry.Register("mpmc"));
+    for (int index = 0; index < 4; ++index) {
+      REQUIRE(spsc_channel.Push(thread_pool_executor, index).run().get());
+      REQUIRE(mpmc_channel.Push(thread_pool_executor, index).run().get());
+    }
+    std::vector<int> popped;
+    REQUIRE(spsc_channel.PopBatch(thread_pool_executor, popped, 2).run().get() == 2);
+    REQUIRE(mpmc_channel.Pop(thread_pool_executor).run().get().value_or(-1) == 0);
+
+    REQUIRE(spsc_channel.GetMetrics()->GetPushes() == 4);
+    REQUIRE(spsc_channel.GetMetrics()->GetPops() == 2);
+    REQUIRE(spsc_channel.GetMetrics()->GetHighWaterMark() == 4);
+    REQUIRE(mpmc_channel.GetMetrics()->GetPushes() == 4);
+    REQUIRE(mpmc_channel.GetMetrics()->GetPops() == 1);
+    REQUIRE(mpmc_channel.GetMetrics()->GetHighWaterMark() == 4);
+
+    std::stringstream report;
+    registry.Display(report);
+    REQUIRE(report.str().find("spsc: pushes=4, pops=2, backlog=2") != std::string::npos);
+    REQUIRE(report.str().find("mpmc: pushes=4, pops=1, backlog=3") != std::string::npos);
+  }
+
+  SECTION("disabled metrics") {
+    CoroUnBoundedChannel<int> channel_to_test;
+    REQUIRE(channel_to_test.Push(thread_pool_executor, 1).run().get());
+    REQUIRE(channel_to_test.GetMetrics() == nullptr);
+    REQUIRE(registry.Empty());
+  }
+}
+
+TEST_CASE("adaptive bounded channel", "[adaptive-chan]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 2;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  auto budget = std::make_shared<ChannelCapacityBudget>(6);
+  auto channel_to_test = std::make_shared<CoroBoundedChannel<int>>(2, budget);
+
+  // the producer blocks on the third value till we pop one
+  auto prod = fill_task_parallel({}, 2, thread_pool_executor, channel_to_test);
+  while (channel_to_test->GetSize(thread_pool_executor).get() < 2) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  REQUIRE(channel_to_test->Pop(thread_pool_executor).run().get().value_or(-1) == 0);
+  prod.get();
+
+  SECTION("grows after the producer was blocked") {
+    REQUIRE(channel_to_test->Push(thread_pool_executor, 3).run().get());
+    REQUIRE(channel_to_test->GetCapacity(thread_pool_executor).get() == 4);
+    REQUIRE(budget->GetAvailable() == 4);
+    REQUIRE(channel_to_test->GetSize(thread_pool_executor).get() == 3);
+
+    for (int expected = 1; expected <= 3; ++expected) {
+      REQUIRE(channel_to_test->Pop(thread_pool_executor).run().get().value_or(-1) == expected);
+    }
+
+    // an unused channel shrinks back to its initial capacity
+    for (int index = 0; index < 40; ++index) {
+      REQUIRE(channel_to_test->Push(thread_pool_executor, index).run().get());
+      REQUIRE(channel_to_test->Pop(thread_pool_executor).run().get().value_or(-1) == index);
+    }
+    REQUIRE(channel_to_test->GetCapacity(thread_pool_executor).get() == 2);
+    REQUIRE(budget->GetAvailable() == 6);
+  }
+
+  SECTION("slots are returned on destruction") {
+    REQUIRE(channel_to_test->Push(thread_pool_executor, 3).run().get());
+    REQUIRE(budget->GetAvailable() == 4);
+    channel_to_test = nullptr;
+    REQUIRE(budget->GetAvailable() == 6);
+  }
+}
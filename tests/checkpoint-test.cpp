@@ -0,0 +1,236 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <sys/stat.h>
+
+#include "test-util.h"
+#include "env/checkpoint.h"
+#include "parser/eventStreamParser.h"
+#include "parser/parser.h"
+#include "reader/cReader.h"
+
+TEST_CASE("Test Checkpoint serialization", "[Checkpoint]") {
+  Checkpoint checkpoint;
+  checkpoint.sequence_ = 3;
+  checkpoint.next_span_id_ = 1'000'000;
+  checkpoint.next_trace_id_ = 42;
+  checkpoint.next_trace_context_id_ = 300;
+  checkpoint.frontier_ts_ = 1'905'164'778'000;
+  checkpoint.open_spans_ = 12;
+  checkpoint.input_offsets_ = {{"Gem5ServerEventProvider", 123'456'789'012}, {"NS3EventProvider", 0}};
+
+  std::stringstream serialized;
+  checkpoint.Serialize(serialized);
+  const std::string data = serialized.str();
+
+  SECTION("a checkpoint can be restored") {
+    std::stringstream in{data};
+    const std::optional<Checkpoint> restored = Checkpoint::Deserialize(in);
+    REQUIRE(restored.has_value());
+    REQUIRE(*restored == checkpoint);
+  }
+
+  SECTION("corrupted checkpoints are rejected") {
+    std::string corrupted = data;
+    corrupted[corrupted.size() / 2] ^= 0x1;
+    std::stringstream corrupted_in{corrupted};
+    REQUIRE_FALSE(Checkpoint::Deserialize(corrupted_in).has_value());
+
+    std::stringstream truncated_in{data.substr(0, data.size() - 1)};
+    REQUIRE_FALSE(Checkpoint::Deserialize(truncated_in).has_value());
+  }
+}
+
+TEST_CASE("Test InputProgress", "[Checkpoint]") {
+  InputProgress progress{"input", 10};
+  REQUIRE(progress.GetResumeOffset(kNoResumeTs) == 10);
+
+  progress.OnEventRead(kCheckpointSampleInterval, 1000, 100);
+  progress.OnEventRead(kCheckpointSampleInterval + 1, 1001, 101);
+  progress.OnEventRead(2 * kCheckpointSampleInterval, 2000, 200);
+
+  SECTION("the offset only advances once the pipeline took the sampled events") {
+    for (uint64_t event = 0; event < kCheckpointSampleInterval - 1; ++event) {
+      progress.OnEventConsumed();
+    }
+    REQUIRE(progress.GetResumeOffset(kNoResumeTs) == 10);
+    progress.OnEventConsumed();
+    REQUIRE(progress.GetResumeOffset(kNoResumeTs) == 100);
+    progress.OnEventConsumed();
+    REQUIRE(progress.GetResumeOffset(kNoResumeTs) == 100);
+  }
+
+  SECTION("the offset stays before the events of spans not exported yet") {
+    for (uint64_t event = 0; event < 2 * kCheckpointSampleInterval; ++event) {
+      progress.OnEventConsumed();
+    }
+    REQUIRE(progress.GetResumeOffset(1000) == 10);
+    REQUIRE(progress.GetResumeOffset(1500) == 100);
+    REQUIRE(progress.GetResumeOffset(2001) == 200);
+  }
+
+  SECTION("an exhausted input resumes at its end") {
+    progress.OnInputDone(2 * kCheckpointSampleInterval + 5, 250);
+    for (uint64_t event = 0; event < 2 * kCheckpointSampleInterval + 5; ++event) {
+      progress.OnEventConsumed();
+    }
+    REQUIRE(progress.GetResumeOffset(kNoResumeTs) == 250);
+  }
+}
+
+TEST_CASE("Test CheckpointRegistry", "[Checkpoint]") {
+  Checkpoint resume_from;
+  resume_from.sequence_ = 7;
+  resume_from.input_offsets_ = {{"reader-a", 64}, {"reader-b", 128}};
+
+  CheckpointRegistry registry;
+  registry.ResumeFrom(resume_from);
+  auto reader_a = registry.RegisterInput("reader-a");
+  auto reader_c = registry.RegisterInput("reader-c");
+  REQUIRE(reader_a->GetStartOffset() == 64);
+  REQUIRE(reader_c->GetStartOffset() == 0);
+
+  const Checkpoint snapshot = registry.Snapshot();
+  REQUIRE(snapshot.sequence_ == 8);
+  REQUIRE(snapshot.input_offsets_.size() == 3);
+  REQUIRE(snapshot.input_offsets_.at("reader-a") == 64);
+  REQUIRE(snapshot.input_offsets_.at("reader-b") == 128);
+  REQUIRE(snapshot.input_offsets_.at("reader-c") == 0);
+}
+
+TEST_CASE("Test ResumeFrontier", "[Checkpoint]") {
+  ResumeFrontier frontier;
+  REQUIRE(frontier.GetLowest() == kNoResumeTs);
+
+  ResumePin pin{frontier, 500};
+  {
+    ResumePin copy = pin;
+    REQUIRE(frontier.GetAmountPinned() == 2);
+    copy.Lower(600);
+    REQUIRE(copy.GetTs() == 500);
+    copy.Lower(50);
+    REQUIRE(frontier.GetLowest() == 50);
+
+    ResumePin moved = std::move(copy);
+    REQUIRE_FALSE(copy.IsPinned());
+    REQUIRE(moved.GetTs() == 50);
+    REQUIRE(frontier.GetAmountPinned() == 2);
+  }
+  REQUIRE(frontier.GetAmountPinned() == 1);
+  REQUIRE(frontier.GetLowest() == 500);
+
+  pin.Release();
+  REQUIRE(frontier.GetAmountPinned() == 0);
+  REQUIRE(frontier.GetLowest() == kNoResumeTs);
+}
+
+TEST_CASE("Test CheckpointRegistry resumes before open spans", "[Checkpoint]") {
+  CheckpointRegistry registry;
+  auto reader = registry.RegisterInput("reader");
+  auto consumer = registry.RegisterConsumer();
+  // the n-th event has timestamp n * 10 and ends at byte offset n
+  const uint64_t amount_events = 2 * kCheckpointSampleInterval;
+  for (uint64_t event = 1; event <= amount_events; ++event) {
+    reader->OnEventRead(event, event * 10, event);
+    reader->OnEventConsumed();
+  }
+  consumer->OnEventHandling(amount_events * 10);
+
+  // a span whose first event is read after the first sample
+  ResumePin open_span{registry.GetFrontier(), (kCheckpointSampleInterval + 100) * 10};
+  Checkpoint snapshot = registry.Snapshot();
+  REQUIRE(snapshot.open_spans_ == 1);
+  REQUIRE(snapshot.frontier_ts_ == (kCheckpointSampleInterval + 100) * 10);
+  REQUIRE(snapshot.input_offsets_.at("reader") == kCheckpointSampleInterval);
+
+  // the last event is still handled
+  open_span.Release();
+  snapshot = registry.Snapshot();
+  REQUIRE(snapshot.open_spans_ == 0);
+  REQUIRE(snapshot.frontier_ts_ == amount_events * 10);
+  REQUIRE(snapshot.input_offsets_.at("reader") == kCheckpointSampleInterval);
+
+  consumer->OnDone();
+  snapshot = registry.Snapshot();
+  REQUIRE(snapshot.frontier_ts_ == kNoResumeTs);
+  REQUIRE(snapshot.input_offsets_.at("reader") == amount_events);
+}
+
+TEST_CASE("Test ReaderBuffer resumes at consumed offset", "[Checkpoint]") {
+  const std::string path = "tests/line-reader-test-files/simple.txt";
+  uint64_t offset;
+  {
+    ReaderBuffer<4096> reader{"first-run"};
+    reader.OpenFile(path);
+    REQUIRE(reader.NextHandler().first);
+    REQUIRE(reader.NextHandler().first);
+    offset = reader.GetConsumedOffset();
+    REQUIRE(offset > 0);
+  }
+
+  ReaderBuffer<4096> reader{"resumed-run"};
+  reader.OpenFile(path, false, offset);
+  REQUIRE(reader.GetConsumedOffset() == offset);
+  auto bh_p = reader.NextHandler();
+  REQUIRE(bh_p.first);
+  REQUIRE(bh_p.second->ConsumeAndTrimString("wkfhkdhfkds"));
+}
+
+TEST_CASE("Test BufferedEventProvider resumes regular files only", "[Checkpoint]") {
+  const TraceEnvConfig trace_env_config = CreateTestConfig("CheckpointFile: tests/checkpoint-test.ckpt");
+  REQUIRE(trace_env_config.IsCheckpointingEnabled());
+  TraceEnvironment trace_environment{trace_env_config};
+  auto parser = create_shared<EventStreamParser>("parser is null", trace_environment, "reader");
+
+  SECTION("a regular file continues at the offset of the checkpoint") {
+    Checkpoint resume_from;
+    resume_from.input_offsets_ = {{"file-provider", 6}};
+    trace_environment.GetCheckpoints().ResumeFrom(resume_from);
+
+    auto provider = CreateBufferedEventProvider(trace_environment, "file-provider",
+                                                "tests/line-reader-test-files/simple.txt", parser);
+    REQUIRE(std::dynamic_pointer_cast<BufferedEventProvider<false>>(provider).get() != nullptr);
+    const Checkpoint snapshot = trace_environment.GetCheckpoints().Snapshot();
+    REQUIRE(snapshot.input_offsets_.at("file-provider") == 6);
+  }
+
+  SECTION("a named pipe is read as such and not checkpointed") {
+    const std::filesystem::path fifo = std::filesystem::temp_directory_path() / "checkpoint-test.fifo";
+    std::filesystem::remove(fifo);
+    REQUIRE(mkfifo(fifo.c_str(), 0600) == 0);
+
+    auto provider = CreateBufferedEventProvider(trace_environment, "pipe-provider", fifo.string(), parser);
+    REQUIRE(std::dynamic_pointer_cast<BufferedEventProvider<true>>(provider).get() != nullptr);
+    const Checkpoint snapshot = trace_environment.GetCheckpoints().Snapshot();
+    REQUIRE_FALSE(snapshot.input_offsets_.contains("pipe-provider"));
+
+    std::filesystem::remove(fifo);
+  }
+}
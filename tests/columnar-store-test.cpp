@@ -0,0 +1,88 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+#include <filesystem>
+#include <memory>
+
+#include "events/columnarStore.h"
+#include "events/events.h"
+
+TEST_CASE("Test ColumnarEventStore", "[ColumnarEventStore]") {
+
+  const size_t parser_ident = 1;
+  const std::string parser_name = "test";
+
+  ColumnarEventStore store;
+  const size_t amount = kColumnChunkRows * 2 + 17;
+  for (size_t index = 0; index < amount; index++) {
+    store.Append(std::make_shared<NicDmaI>(index * 10, parser_ident, parser_name, index, 0x1000 + index,
+                                           index % 3000));
+  }
+  store.Append(std::make_shared<NicTx>(5, parser_ident, parser_name, 1500));
+
+  SECTION("store counts all events") {
+    REQUIRE(store.GetSize() == amount + 1);
+    REQUIRE(store.Count(ColumnQuery{kNicDmaIT}) == amount);
+    REQUIRE(store.Count(ColumnQuery{kNicTxT}) == 1);
+    REQUIRE(store.Count(ColumnQuery{kNicRxT}) == 0);
+  }
+
+  SECTION("timestamp range and field predicates") {
+    ColumnQuery query{kNicDmaIT};
+    query.Between(10000, 19990).AtLeast("len", 1501);
+    size_t expected = 0;
+    for (size_t index = 1000; index <= 1999; index++) {
+      expected += index % 3000 >= 1501 ? 1 : 0;
+    }
+    REQUIRE(store.Count(query) == expected);
+
+    ColumnQuery point{kNicDmaIT};
+    point.Equals("id", 42);
+    size_t found = 0;
+    store.Scan(point, [&found](const ColumnChunkView &chunk, const uint32_t *selection, size_t count) {
+      for (size_t index = 0; index < count; index++) {
+        REQUIRE(chunk.ts_[selection[index]] == 420);
+        REQUIRE(chunk.fields_[1][selection[index]] == 0x1000 + 42);
+        ++found;
+      }
+    });
+    REQUIRE(found == 1);
+  }
+
+  SECTION("mapped store answers the same queries") {
+    const std::string file_path = (std::filesystem::temp_directory_path() / "columnar-store-test.bin").string();
+    store.WriteToFile(file_path);
+    {
+      const MappedColumnarStore mapped{file_path};
+      REQUIRE(mapped.GetSize() == store.GetSize());
+
+      ColumnQuery query{kNicDmaIT};
+      query.Between(100, kColumnChunkRows * 10 + 500).AtMost("len", 100);
+      REQUIRE(mapped.Count(query) == store.Count(query));
+      REQUIRE(mapped.Count(ColumnQuery{kNicTxT}.Equals("len", 1500)) == 1);
+    }
+    std::filesystem::remove(file_path);
+  }
+}
@@ -24,6 +24,7 @@
 
 #include <catch2/catch_all.hpp>
 
+#include "test-util.h"
 #include "config/config.h"
 #include "events/eventType.h"
 #include "env/symtable.h"
@@ -40,6 +41,27 @@ TEST_CASE("Test TraceEnvConfig", "[TraceEnvConfig]") {
   REQUIRE(jaeger_url == trace_env_config.GetJaegerUrl());
   REQUIRE(trace_env_config.GetLineBufferSize() == 1);
   REQUIRE(trace_env_config.GetEventBufferSize() == 60000000);
+  REQUIRE(trace_env_config.GetPipelineChannelCapacity() == 1000);
+  REQUIRE(trace_env_config.GetChannelCapacity("pipeline-0.edge-1", 512) == 512);
+  REQUIRE(trace_env_config.GetChannelCapacity("gem5-server-reader", 60000000) == 60000000);
+  REQUIRE(trace_env_config.GetAdaptiveChannelBudget() == 0);
+  REQUIRE_FALSE(trace_env_config.IsChannelMetricsEnabled());
+  REQUIRE(trace_env_config.GetWorkerThreads() == trace_env_config.GetMaxCpuThreads());
+  REQUIRE(trace_env_config.GetWorkerThreadAffinity().empty());
+  REQUIRE_FALSE(trace_env_config.IsWorkStealingEnabled());
+  REQUIRE_FALSE(trace_env_config.IsMetricsEnabled());
+  REQUIRE(trace_env_config.GetMetricsInterval() == 15);
+  REQUIRE_FALSE(trace_env_config.IsSkewWindowEnabled());
+  REQUIRE(trace_env_config.GetSkewWindowPs() == 0);
+  REQUIRE_FALSE(trace_env_config.IsOrphanSpanTimeoutEnabled());
+  REQUIRE(trace_env_config.GetOrphanSpanTimeoutPs() == 0);
+  REQUIRE(trace_env_config.GetOrphanSpanPolicy() == OrphanSpanPolicy::kExport);
+  REQUIRE(trace_env_config.GetTraceTtlPs() == 0);
+  REQUIRE(trace_env_config.GetExporterTtlPs() == 0);
+  REQUIRE_FALSE(trace_env_config.ShouldSummariseHostCalls());
+  REQUIRE_FALSE(trace_env_config.ShouldFuseCheapHandlers());
+
+  REQUIRE_FALSE(trace_env_config.HasTopology());
 
   const std::set<std::string> driver_func_indi{trace_env_config.BeginDriverFunc(), trace_env_config.EndDriverFunc()};
   REQUIRE(driver_func_indi.size() == 2);
@@ -99,3 +121,53 @@ TEST_CASE("Test TraceEnvConfig", "[TraceEnvConfig]") {
   REQUIRE(sym_b.GetAddressOffset() == 0xffffffffa0000000ULL);
   REQUIRE(sym_b.GetFilterType() == FilterType::kSyms);
 }
+
+TEST_CASE("Test TraceEnvConfig channel capacities", "[TraceEnvConfig]") {
+  const TraceEnvConfig trace_env_config = CreateTestConfig(R"(
+      PipelineChannelCapacity: 512
+      ChannelCapacities:
+        pipeline-0.edge-1: 4096
+        gem5-server-reader: 100000
+  )");
+  REQUIRE(trace_env_config.GetPipelineChannelCapacity() == 512);
+  REQUIRE(trace_env_config.GetChannelCapacity("pipeline-0.edge-1", 512) == 4096);
+  REQUIRE(trace_env_config.GetChannelCapacity("gem5-server-reader", 60000000) == 100000);
+  REQUIRE(trace_env_config.GetChannelCapacity("pipeline-0.edge-2", 512) == 512);
+}
+
+TEST_CASE("Test TraceEnvConfig worker pool", "[TraceEnvConfig]") {
+  const TraceEnvConfig trace_env_config = CreateTestConfig(R"(
+      WorkerThreads: 4
+      WorkerThreadAffinity: [0, 1]
+  )");
+  REQUIRE(trace_env_config.GetWorkerThreads() == 4);
+  REQUIRE(trace_env_config.GetWorkerThreadAffinity() == std::vector<int>{0, 1});
+}
+
+TEST_CASE("Test TraceEnvConfig skew window", "[TraceEnvConfig]") {
+  const TraceEnvConfig trace_env_config = CreateTestConfig("SkewWindowPs: 1000000000");
+  REQUIRE(trace_env_config.IsSkewWindowEnabled());
+  REQUIRE(trace_env_config.GetSkewWindowPs() == 1'000'000'000);
+}
+
+TEST_CASE("Test TraceEnvConfig orphan spans", "[TraceEnvConfig]") {
+  const TraceEnvConfig export_config = CreateTestConfig("{OrphanSpanTimeoutPs: 100000, OrphanSpanPolicy: Export}");
+  REQUIRE(export_config.IsOrphanSpanTimeoutEnabled());
+  REQUIRE(export_config.GetOrphanSpanTimeoutPs() == 100'000);
+  REQUIRE(export_config.GetOrphanSpanPolicy() == OrphanSpanPolicy::kExport);
+
+  const TraceEnvConfig drop_config = CreateTestConfig("{OrphanSpanTimeoutPs: 100000, OrphanSpanPolicy: Drop}");
+  REQUIRE(drop_config.IsOrphanSpanTimeoutEnabled());
+  REQUIRE(drop_config.GetOrphanSpanTimeoutPs() == 100'000);
+  REQUIRE(drop_config.GetOrphanSpanPolicy() == OrphanSpanPolicy::kDrop);
+}
+
+TEST_CASE("Test TraceEnvConfig trace ttl", "[TraceEnvConfig]") {
+  const TraceEnvConfig trace_env_config = CreateTestConfig("TraceTtlPs: 1000000");
+  REQUIRE(trace_env_config.GetTraceTtlPs() == 1'000'000);
+}
+
+TEST_CASE("Test TraceEnvConfig summarise host calls", "[TraceEnvConfig]") {
+  const TraceEnvConfig trace_env_config = CreateTestConfig("SummariseHostCalls: true");
+  REQUIRE(trace_env_config.ShouldSummariseHostCalls());
+}
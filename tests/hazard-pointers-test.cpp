@@ -0,0 +1,88 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+
+#include "util/hazardPointers.h"
+
+namespace {
+
+struct CountedNode {
+  static inline int alive_ = 0;
+  CountedNode *retired_next_ = nullptr;
+
+  CountedNode() {
+    ++alive_;
+  }
+
+  ~CountedNode() {
+    --alive_;
+  }
+};
+
+}  // namespace
+
+TEST_CASE("Test HazardPointerDomain", "[HazardPointerDomain]") {
+  CountedNode::alive_ = 0;
+
+  SECTION("unprotected nodes are deleted when retired") {
+    HazardPointerDomain<CountedNode, 4> domain;
+    domain.Retire(new CountedNode);
+    REQUIRE(CountedNode::alive_ == 0);
+    REQUIRE(domain.GetRetiredCount() == 0);
+  }
+
+  SECTION("protected nodes are kept till no guard announces them anymore") {
+    HazardPointerDomain<CountedNode, 4> domain;
+    auto *node = new CountedNode;
+    std::atomic<CountedNode *> source{node};
+    {
+      typename HazardPointerDomain<CountedNode, 4>::Guard guard{domain};
+      REQUIRE(guard.Protect(source) == node);
+
+      source.store(nullptr);
+      domain.Retire(node);
+      REQUIRE(CountedNode::alive_ == 1);
+      REQUIRE(domain.GetRetiredCount() == 1);
+    }
+    domain.Reclaim();
+    REQUIRE(CountedNode::alive_ == 0);
+    REQUIRE(domain.GetRetiredCount() == 0);
+  }
+
+  SECTION("the domain deletes the nodes still retired when it is destroyed") {
+    auto *node = new CountedNode;
+    std::atomic<CountedNode *> source{node};
+    {
+      HazardPointerDomain<CountedNode, 4> domain;
+      typename HazardPointerDomain<CountedNode, 4>::Guard guard{domain};
+      guard.Protect(source);
+      domain.Retire(node);
+      REQUIRE(CountedNode::alive_ == 1);
+    }
+    REQUIRE(CountedNode::alive_ == 0);
+  }
+}
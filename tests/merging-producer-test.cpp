@@ -0,0 +1,120 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "sync/corobelt.h"
+#include "sync/mergingProducer.h"
+#include "events/events.h"
+
+template<typename ValueType>
+class VectorProducer : public Producer<ValueType> {
+  std::vector<ValueType> values_;
+  size_t next_ = 0;
+
+ public:
+  explicit VectorProducer(std::vector<ValueType> values) : Producer<ValueType>(), values_(std::move(values)) {}
+
+  concurrencpp::result<std::optional<ValueType>> produce(std::shared_ptr<concurrencpp::executor> executor) override {
+    if (next_ >= values_.size()) {
+      co_return std::nullopt;
+    }
+    co_return values_[next_++];
+  }
+};
+
+template<typename ValueType, typename Less>
+std::vector<ValueType> Drain(std::shared_ptr<concurrencpp::executor> executor,
+                             MergingProducer<ValueType, Less> &merger) {
+  std::vector<ValueType> result;
+  std::optional<ValueType> value;
+  while ((value = merger.produce(executor).get()).has_value()) {
+    result.push_back(*value);
+  }
+  return result;
+}
+
+TEST_CASE("Test MergingProducer", "[MergingProducer]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  SECTION("merges ordered sources into one ordered stream") {
+    std::vector<std::shared_ptr<Producer<int>>> sources{
+        std::make_shared<VectorProducer<int>>(std::vector<int>{1, 4, 7, 10}),
+        std::make_shared<VectorProducer<int>>(std::vector<int>{2, 5, 8}),
+        std::make_shared<VectorProducer<int>>(std::vector<int>{0, 3, 6, 9, 11, 12})};
+    MergingProducer<int> merger{sources, 2};
+
+    const std::vector<int> expected{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    REQUIRE(Drain(thread_pool_executor, merger) == expected);
+    REQUIRE_FALSE(merger.produce(thread_pool_executor).get().has_value());
+  }
+
+  SECTION("empty sources are skipped") {
+    std::vector<std::shared_ptr<Producer<int>>> sources{
+        std::make_shared<VectorProducer<int>>(std::vector<int>{}),
+        std::make_shared<VectorProducer<int>>(std::vector<int>{3, 4}),
+        std::make_shared<VectorProducer<int>>(std::vector<int>{}),
+        std::make_shared<VectorProducer<int>>(std::vector<int>{1, 2, 5}),
+        std::make_shared<VectorProducer<int>>(std::vector<int>{})};
+    MergingProducer<int> merger{sources, 1};
+
+    const std::vector<int> expected{1, 2, 3, 4, 5};
+    REQUIRE(Drain(thread_pool_executor, merger) == expected);
+  }
+
+  SECTION("all sources empty") {
+    std::vector<std::shared_ptr<Producer<int>>> sources{
+        std::make_shared<VectorProducer<int>>(std::vector<int>{}),
+        std::make_shared<VectorProducer<int>>(std::vector<int>{})};
+    MergingProducer<int> merger{sources};
+
+    REQUIRE_FALSE(merger.produce(thread_pool_executor).get().has_value());
+  }
+
+  SECTION("events with equal timestamps keep the order of their sources") {
+    const std::string first_name{"first"};
+    const std::string second_name{"second"};
+    std::vector<std::shared_ptr<Event>> first{
+        std::make_shared<SimSendSync>(10, 0, first_name),
+        std::make_shared<SimSendSync>(20, 0, first_name)};
+    std::vector<std::shared_ptr<Event>> second{
+        std::make_shared<SimSendSync>(10, 1, second_name),
+        std::make_shared<SimSendSync>(15, 1, second_name),
+        std::make_shared<SimSendSync>(20, 1, second_name)};
+    std::vector<std::shared_ptr<Producer<std::shared_ptr<Event>>>> sources{
+        std::make_shared<VectorProducer<std::shared_ptr<Event>>>(second),
+        std::make_shared<VectorProducer<std::shared_ptr<Event>>>(first)};
+    EventMergingProducer merger{sources, 2};
+
+    const std::vector<std::shared_ptr<Event>> expected{second[0], first[0], second[1], second[2], first[1]};
+    REQUIRE(Drain(thread_pool_executor, merger) == expected);
+  }
+}
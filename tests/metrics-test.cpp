@@ -0,0 +1,137 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "util/metrics.h"
+
+namespace {
+
+std::string HttpGet(uint16_t port, const std::string &path) {
+  const int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+  REQUIRE(socket_fd >= 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  REQUIRE(connect(socket_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0);
+
+  const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  REQUIRE(send(socket_fd, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+
+  std::string response;
+  char buffer[1024];
+  ssize_t received;
+  while ((received = recv(socket_fd, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, received);
+  }
+  close(socket_fd);
+  return response;
+}
+
+}  // namespace
+
+TEST_CASE("Test MetricsRegistry", "[MetricsRegistry]") {
+  MetricsRegistry registry;
+
+  SECTION("metrics are shared by name and labels") {
+    auto first = registry.GetCounter("columbo_events_total", "Events.", {{"pipeline", "a"}});
+    auto second = registry.GetCounter("columbo_events_total", "Events.", {{"pipeline", "a"}});
+    auto other = registry.GetCounter("columbo_events_total", "Events.", {{"pipeline", "b"}});
+    REQUIRE(first.get() == second.get());
+    REQUIRE(first.get() != other.get());
+
+    first->Increment();
+    second->Increment(2);
+    REQUIRE(first->GetValue() == 3);
+    REQUIRE(other->GetValue() == 0);
+  }
+
+  SECTION("prometheus text format") {
+    registry.GetCounter("columbo_events_total", "Events.", {{"pipeline", "a\"b"}})->Increment(5);
+    registry.GetGauge("columbo_depth", "Depth.")->Set(-2);
+    auto histogram = registry.GetHistogram("columbo_latency_seconds", "Latency.", {}, {0.1, 1.0});
+    histogram->Observe(0.05);
+    histogram->Observe(0.5);
+    histogram->Observe(std::chrono::seconds{2});
+    registry.AddCollector([](std::ostream &out) { out << "collected 1\n"; });
+
+    const std::string expected =
+        "# HELP columbo_events_total Events.\n"
+        "# TYPE columbo_events_total counter\n"
+        "columbo_events_total{pipeline=\"a\\\"b\"} 5\n"
+        "# HELP columbo_depth Depth.\n"
+        "# TYPE columbo_depth gauge\n"
+        "columbo_depth -2\n"
+        "# HELP columbo_latency_seconds Latency.\n"
+        "# TYPE columbo_latency_seconds histogram\n"
+        "columbo_latency_seconds_bucket{le=\"0.1\"} 1\n"
+        "columbo_latency_seconds_bucket{le=\"1\"} 2\n"
+        "columbo_latency_seconds_bucket{le=\"+Inf\"} 3\n"
+        "columbo_latency_seconds_sum 2.55\n"
+        "columbo_latency_seconds_count 3\n"
+        "collected 1\n";
+    REQUIRE(registry.ToPrometheus() == expected);
+  }
+}
+
+TEST_CASE("Test metrics exposition", "[MetricsRegistry]") {
+  MetricsRegistry registry;
+  registry.GetCounter("columbo_spans_total", "Spans.")->Increment(7);
+
+  SECTION("metrics are served via http") {
+    MetricsHttpServer server{registry, 0};
+    REQUIRE(server.GetPort() != 0);
+
+    const std::string response = HttpGet(server.GetPort(), "/metrics");
+    REQUIRE(response.starts_with("HTTP/1.1 200 OK\r\n"));
+    REQUIRE(response.find("columbo_spans_total 7\n") != std::string::npos);
+
+    REQUIRE(HttpGet(server.GetPort(), "/").starts_with("HTTP/1.1 404 Not Found\r\n"));
+  }
+
+  SECTION("a final snapshot is written to the file") {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "columbo-metrics-test.prom";
+    std::filesystem::remove(path);
+    {
+      MetricsFileWriter writer{registry, path.string(), std::chrono::seconds{60}};
+    }
+    std::ifstream in{path};
+    std::stringstream content;
+    content << in.rdbuf();
+    REQUIRE(content.str() == registry.ToPrometheus());
+    std::filesystem::remove(path);
+  }
+}
@@ -26,10 +26,14 @@
 #include <iostream>
 #include <memory>
 #include <queue>
+#include <atomic>
 #include <charconv>
+#include <chrono>
+#include <thread>
 #include <sys/stat.h>
 
 #include "sync/corobelt.h"
+#include "sync/specializations.h"
 #include "util/exception.h"
 #include "reader/cReader.h"
 
@@ -100,6 +104,20 @@ class AdderInt : public Handler<int> {
   }
 };
 
+class CheapIncrementInt : public Handler<int> {
+ public:
+  explicit CheapIncrementInt() : Handler<int>() {}
+
+  concurrencpp::result<bool> handel(std::shared_ptr<concurrencpp::executor> executor, int &value) override {
+    value += 1;
+    co_return true;
+  }
+
+  bool IsCheap() const override {
+    return true;
+  }
+};
+
 class PrinterInt : public Consumer<int> {
   std::ostream &out_;
 
@@ -225,6 +243,127 @@ TEST_CASE("Test NEW pipeline wrapper construct", "[run_pipeline]") {
 //  }
 }
 
+TEST_CASE("Test fused handler chains", "[run_pipeline]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 5;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  auto handler = std::make_shared<std::vector<std::shared_ptr<Handler<int>>>>();
+  handler->push_back(std::make_shared<CheapIncrementInt>());
+  handler->push_back(std::make_shared<AdderInt>());
+  handler->push_back(std::make_shared<CheapIncrementInt>());
+  handler->push_back(std::make_shared<CheapIncrementInt>());
+
+  SECTION("split into stages") {
+    auto prod = std::make_shared<ProducerInt>(0, 3);
+    std::stringstream ss;
+    auto cons = std::make_shared<PrinterInt>(ss);
+
+    const Pipeline<int> none{prod, handler, cons, PipelineFusion::kNone};
+    const Pipeline<int> automatic{prod, handler, cons, PipelineFusion::kAuto};
+    const Pipeline<int> all{prod, handler, cons, PipelineFusion::kAll};
+
+    const auto none_stages = SplitIntoStages(none);
+    REQUIRE(none_stages.size() == 5);
+    for (const auto &stage : none_stages) {
+      REQUIRE(stage.fused_.empty());
+    }
+
+    const auto auto_stages = SplitIntoStages(automatic);
+    REQUIRE(auto_stages.size() == 2);
+    REQUIRE(auto_stages[0].fused_.size() == 1);
+    REQUIRE(auto_stages[1].handler_.get() == (*handler)[1].get());
+    REQUIRE(auto_stages[1].fused_.size() == 2);
+
+    const auto all_stages = SplitIntoStages(all);
+    REQUIRE(all_stages.size() == 1);
+    REQUIRE(all_stages[0].fused_.size() == 4);
+  }
+
+  SECTION("fused pipelines produce the same result") {
+    for (const PipelineFusion fusion : {PipelineFusion::kNone, PipelineFusion::kAuto, PipelineFusion::kAll}) {
+      std::stringstream ss;
+      auto pipeline = std::make_shared<Pipeline<int>>(std::make_shared<ProducerInt>(0, 3), handler,
+                                                      std::make_shared<PrinterInt>(ss), fusion);
+
+      REQUIRE_NOTHROW(RunPipeline<int>(thread_pool_executor, pipeline));
+
+      REQUIRE(ss.str() == CreateExpectation(4, 7));
+    }
+  }
+}
+
+// produces a few events and then waits for them to arrive at the consumer, like a simulator that
+// only writes further events once the ones it wrote were processed
+class LiveEventProducer : public Producer<std::shared_ptr<Event>> {
+  const std::string parser_name_{"live"};
+  const size_t amount_;
+  size_t produced_ = 0;
+  std::atomic<size_t> &consumed_;
+
+ public:
+  bool saw_all_consumed_ = false;
+
+  explicit LiveEventProducer(size_t amount, std::atomic<size_t> &consumed)
+      : Producer<std::shared_ptr<Event>>(), amount_(amount), consumed_(consumed) {
+  }
+
+  concurrencpp::result<std::optional<std::shared_ptr<Event>>>
+  produce(std::shared_ptr<concurrencpp::executor> executor) override {
+    if (produced_ < amount_) {
+      ++produced_;
+      co_return std::make_shared<HostMmioImRespPoW>(produced_, 0, parser_name_);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (consumed_.load() < amount_ and std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    saw_all_consumed_ = consumed_.load() == amount_;
+    co_return std::nullopt;
+  }
+
+  bool WouldBlock() override {
+    return produced_ >= amount_;
+  }
+};
+
+class CountingEventConsumer : public Consumer<std::shared_ptr<Event>> {
+  std::atomic<size_t> &consumed_;
+
+ public:
+  explicit CountingEventConsumer(std::atomic<size_t> &consumed)
+      : Consumer<std::shared_ptr<Event>>(), consumed_(consumed) {
+  }
+
+  concurrencpp::result<void> consume(std::shared_ptr<concurrencpp::executor> executor,
+                                     std::shared_ptr<Event> value) override {
+    consumed_.fetch_add(1);
+    co_return;
+  }
+};
+
+TEST_CASE("producer flushes partial batches when it would block", "[run_pipeline]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 5;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  std::atomic<size_t> consumed{0};
+  auto prod = std::make_shared<LiveEventProducer>(3, consumed);
+  auto handler = std::make_shared<std::vector<std::shared_ptr<Handler<std::shared_ptr<Event>>>>>();
+  auto cons = std::make_shared<CountingEventConsumer>(consumed);
+  auto pipeline = std::make_shared<Pipeline<std::shared_ptr<Event>>>(prod, handler, cons);
+
+  RunPipeline<std::shared_ptr<Event>>(thread_pool_executor, pipeline);
+
+  REQUIRE(prod->saw_all_consumed_);
+  REQUIRE(consumed.load() == 3);
+}
+
 TEST_CASE("test named pipe reading alongside pipeline", "[named-pipe]") {
   auto concurren_options = concurrencpp::runtime_options();
   concurren_options.max_background_threads = 0;
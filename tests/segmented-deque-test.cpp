@@ -0,0 +1,94 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "util/segmentedDeque.h"
+
+TEST_CASE("Test SegmentedDeque", "[SegmentedDeque]") {
+
+  SegmentedDeque<int, 4> deque;
+
+  SECTION("empty deque") {
+    REQUIRE(deque.Empty());
+    REQUIRE(deque.Size() == 0);
+    REQUIRE(deque.begin() == deque.end());
+  }
+
+  SECTION("deque does not change order across chunks") {
+    for (int index = 0; index < 10; ++index) {
+      deque.PushBack(index);
+    }
+    REQUIRE(deque.Size() == 10);
+
+    std::vector<int> iterated{deque.begin(), deque.end()};
+    REQUIRE(iterated == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+
+    for (int index = 0; index < 10; ++index) {
+      REQUIRE(deque.Front() == index);
+      deque.PopFront();
+    }
+    REQUIRE(deque.Empty());
+  }
+
+  SECTION("iterate full tail chunk") {
+    for (int index = 0; index < 8; ++index) {
+      deque.PushBack(index);
+    }
+    deque.PopFront();
+    REQUIRE(std::distance(deque.begin(), deque.end()) == 7);
+  }
+
+  SECTION("drained chunks are recycled") {
+    for (int round = 0; round < 3; ++round) {
+      for (int index = 0; index < 12; ++index) {
+        deque.PushBack(index);
+      }
+      // keep one value so that the chunks are not simply rewound
+      for (int index = 0; index < 11; ++index) {
+        REQUIRE(deque.Front() == index);
+        deque.PopFront();
+      }
+      REQUIRE(deque.GetFreeChunkCount() > 0);
+      deque.PopFront();
+    }
+    REQUIRE(deque.Empty());
+  }
+
+  SECTION("values are destroyed on pop and clear") {
+    SegmentedDeque<std::shared_ptr<int>, 4> ptr_deque;
+    auto value = std::make_shared<int>(42);
+    for (int index = 0; index < 6; ++index) {
+      ptr_deque.PushBack(value);
+    }
+    REQUIRE(value.use_count() == 7);
+    ptr_deque.PopFront();
+    REQUIRE(value.use_count() == 6);
+    ptr_deque.Clear();
+    REQUIRE(value.use_count() == 1);
+  }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include "util/slidingIdSet.h"
+
+TEST_CASE("Test SlidingIdSet", "[SlidingIdSet]") {
+  SlidingIdSet set{1};
+
+  SECTION("ids below the first id count as contained") {
+    REQUIRE(set.Contains(0));
+    REQUIRE_FALSE(set.Contains(1));
+    REQUIRE(set.GetLowWatermark() == 1);
+  }
+
+  SECTION("ids can only be inserted once") {
+    REQUIRE(set.Insert(5));
+    REQUIRE_FALSE(set.Insert(5));
+    REQUIRE(set.Contains(5));
+    REQUIRE_FALSE(set.Contains(4));
+    REQUIRE_FALSE(set.Contains(1'000));
+  }
+
+  SECTION("watermark follows the oldest missing id") {
+    for (uint64_t ident = 1; ident < 200; ident++) {
+      if (ident != 130) {
+        REQUIRE(set.Insert(ident));
+      }
+    }
+    REQUIRE(set.GetLowWatermark() == 130);
+    REQUIRE(set.GetTrackedWords() == 2);
+
+    REQUIRE(set.Insert(130));
+    REQUIRE(set.GetLowWatermark() == 200);
+    REQUIRE(set.GetTrackedWords() == 1);
+    REQUIRE(set.Contains(42));
+    REQUIRE_FALSE(set.Insert(42));
+  }
+
+  SECTION("flags live as long as their id is contained") {
+    REQUIRE(set.Insert(70, true));
+    REQUIRE(set.Insert(71));
+    REQUIRE(set.IsFlagged(70));
+    REQUIRE_FALSE(set.IsFlagged(71));
+    REQUIRE_FALSE(set.IsFlagged(72));
+
+    for (uint64_t ident = 1; ident < 1'000; ident++) {
+      set.Insert(ident);
+    }
+    REQUIRE(set.GetLowWatermark() == 1'000);
+    REQUIRE(set.GetTrackedWords() == 1);
+    REQUIRE(set.GetWordsBelow() == 1);
+    REQUIRE(set.IsFlagged(70));
+    REQUIRE_FALSE(set.IsFlagged(71));
+    REQUIRE_FALSE(set.IsFlagged(7));
+    REQUIRE_FALSE(set.Insert(70, false));
+    REQUIRE(set.IsFlagged(70));
+  }
+
+  SECTION("an id given up on does not hold back the watermark") {
+    REQUIRE(set.Insert(1));
+    set.Settle(2);
+    for (uint64_t ident = 3; ident < 100'000; ident++) {
+      REQUIRE(set.Insert(ident));
+    }
+    REQUIRE(set.GetLowWatermark() == 100'000);
+    REQUIRE(set.GetTrackedWords() <= 1);
+    REQUIRE(set.GetWordsBelow() == 1);
+    REQUIRE_FALSE(set.Contains(2));
+    REQUIRE(set.Contains(3));
+
+    // an id given up on may still be inserted later
+    REQUIRE(set.Insert(2));
+    REQUIRE_FALSE(set.Insert(2));
+    REQUIRE(set.Contains(2));
+    REQUIRE(set.GetWordsBelow() == 0);
+  }
+
+  SECTION("out of order inserts keep memory bounded") {
+    for (uint64_t ident = 100'000; ident > 0; ident--) {
+      set.Insert(ident);
+    }
+    REQUIRE(set.GetLowWatermark() == 100'001);
+    REQUIRE(set.GetTrackedWords() <= 1);
+  }
+}
@@ -463,3 +463,64 @@ TEST_CASE("Test network spans for correctness", "[NetworkSpan]") {
   }
   */
 }
+
+TEST_CASE("Test summarised HostCallSpan", "[HostCallSpan]") {
+  const uint64_t source_id = 1;
+  const size_t parser_ident = 1;
+  const std::string parser_name = "test";
+  std::string service_name = "test-service";
+
+  const TraceEnvConfig trace_env_config = CreateTestConfig("SummariseHostCalls: true");
+  REQUIRE(trace_env_config.ShouldSummariseHostCalls());
+  TraceEnvironment trace_environment{trace_env_config};
+  auto trace_context = std::make_shared<TraceContext>(0, 0);
+
+  const std::string *comp = trace_environment.InternalizeAdditional("vmlinux");
+  uint64_t timestamp = 0;
+  auto create_call = [&](const std::string &func) {
+    timestamp += 1000;
+    return std::make_shared<HostCall>(timestamp, parser_ident, parser_name, 0,
+                                      trace_environment.InternalizeAdditional(func), comp);
+  };
+
+  HostCallSpan span{trace_environment, trace_context, source_id, service_name, false};
+  REQUIRE(span.IsSummarised());
+
+  auto entry = create_call("entry_SYSCALL_64");
+  REQUIRE(span.AddToSpan(entry));
+  for (size_t index = 0; index < 1000; index++) {
+    REQUIRE(span.AddToSpan(create_call("__sys_sendto")));
+  }
+  auto kernel_tx = create_call("dev_queue_xmit");
+  REQUIRE(span.AddToSpan(kernel_tx));
+  std::shared_ptr<HostCall> last_call;
+  for (size_t index = 0; index < 1000; index++) {
+    last_call = create_call("sock_sendmsg");
+    REQUIRE(span.AddToSpan(last_call));
+  }
+  REQUIRE(span.DoesKernelTransmit());
+
+  // only the entry, the indicator and the latest call are stored as events
+  REQUIRE(span.GetAmountEvents() == 3);
+  REQUIRE(span.GetAt(0) == entry);
+  REQUIRE(span.GetAt(1) == kernel_tx);
+  REQUIRE(span.GetAt(2) == last_call);
+
+  auto summaries = span.GetCallSummaries();
+  REQUIRE(summaries->size() == 3);
+  const auto &sendto = summaries->at(trace_environment.InternalizeAdditional("__sys_sendto"));
+  REQUIRE(sendto.count_ == 1000);
+  REQUIRE(sendto.first_ts_ == 2000);
+  REQUIRE(sendto.last_ts_ == 1001000);
+  REQUIRE(summaries->at(kernel_tx->GetFunc()).count_ == 1);
+  REQUIRE(summaries->at(last_call->GetFunc()).count_ == 1000);
+
+  // the next syscall entry completes the span, it ends with the latest call
+  REQUIRE_FALSE(span.AddToSpan(create_call("entry_SYSCALL_64")));
+  REQUIRE(span.IsComplete());
+  REQUIRE(span.GetCompletionTs() == last_call->GetTs());
+
+  // copies share the summaries instead of duplicating them
+  const HostCallSpan copy{span};
+  REQUIRE(copy.GetCallSummaries().get() == summaries.get());
+}
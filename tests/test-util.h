@@ -23,7 +23,10 @@
  */
 
 #include <optional>
+#include <string>
+#include <yaml-cpp/yaml.h>
 
+#include "config/config.h"
 #include "events/events.h"
 
 #ifndef SIMBRICKS_TRACE_TESTS_UTIL_H_
@@ -90,4 +93,14 @@ inline std::optional<NetworkEvent::Ipv4Header> CreateIpHeader(size_t length,
   return header;
 }
 
+// the shared test configuration with the top level keys of the given yaml replaced, such that
+// tests of a single feature only state the keys they change
+inline TraceEnvConfig CreateTestConfig(const std::string &overrides = "") {
+  YAML::Node config_root = YAML::LoadFile("tests/trace-env-config.yaml");
+  for (const auto &entry : YAML::Load(overrides)) {
+    config_root[entry.first.as<std::string>()] = entry.second;
+  }
+  return TraceEnvConfig::CreateFromYaml(config_root);
+}
+
 #endif // SIMBRICKS_TRACE_TESTS_UTIL_H_
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analytics/timer.h"
+
+TEST_CASE("Test MinTournamentTree", "[MinTournamentTree]") {
+  MinTournamentTree tree{5};
+
+  SECTION("slots start at the initial value") {
+    REQUIRE(tree.GetMin() == 0);
+    REQUIRE(tree.Get(4) == 0);
+  }
+
+  SECTION("minimum follows the slowest slot") {
+    for (size_t slot = 0; slot < 5; slot++) {
+      tree.Update(slot, 10 + slot);
+    }
+    REQUIRE(tree.GetMin() == 10);
+    tree.Update(0, 20);
+    REQUIRE(tree.GetMin() == 11);
+    tree.Update(1, UINT64_MAX);
+    REQUIRE(tree.GetMin() == 12);
+  }
+
+  SECTION("slots never move backwards") {
+    tree.Update(2, 30);
+    tree.Update(2, 5);
+    REQUIRE(tree.Get(2) == 30);
+  }
+
+  SECTION("only slots at most the bound are visited") {
+    tree.Update(0, 7);
+    tree.Update(1, 3);
+    tree.Update(2, 3);
+    tree.Update(3, 9);
+    tree.Update(4, 1);
+    std::vector<size_t> visited;
+    tree.ForEachAtMost(3, [&visited](size_t slot) {
+      visited.push_back(slot);
+    });
+    REQUIRE(visited == std::vector<size_t>{1, 2, 4});
+  }
+}
+
+TEST_CASE("Test WeakTimer", "[WeakTimer]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 4;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  constexpr size_t kWaiters = 4;
+  constexpr uint64_t kSteps = 100;
+  auto timer = std::make_shared<WeakTimer>(kWaiters);
+  std::mutex passed_lock;
+  std::vector<uint64_t> passed;
+
+  auto waiter = [&](concurrencpp::executor_tag, std::shared_ptr<concurrencpp::executor> executor,
+                    uint64_t offset) -> concurrencpp::result<void> {
+    const size_t key = co_await timer->Register(executor);
+    for (uint64_t step = 1; step <= kSteps; step++) {
+      const uint64_t timestamp = step * kWaiters + offset;
+      co_await timer->MoveForward(executor, key, timestamp);
+      const std::lock_guard<std::mutex> guard(passed_lock);
+      passed.push_back(timestamp);
+    }
+    co_await timer->Done(executor, key);
+  };
+
+  std::vector<concurrencpp::result<void>> running;
+  for (uint64_t offset = 0; offset < kWaiters; offset++) {
+    running.push_back(waiter({}, thread_pool_executor, offset));
+  }
+  for (auto &result : running) {
+    result.get();
+  }
+
+  // a waiter only passes a timestamp once all others announced a larger one
+  REQUIRE(passed.size() == kWaiters * kSteps);
+  REQUIRE(std::is_sorted(passed.begin(), passed.end()));
+}
+
+TEST_CASE("Test WeakTimer with window", "[WeakTimer]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 2;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  constexpr uint64_t kWindow = 10;
+  auto timer = std::make_shared<WeakTimer>(2, kWindow);
+  std::atomic<uint64_t> slow_progress = 0;
+  std::atomic<bool> window_exceeded = false;
+
+  auto fast = [&](concurrencpp::executor_tag, std::shared_ptr<concurrencpp::executor> executor)
+      -> concurrencpp::result<void> {
+    const size_t key = co_await timer->Register(executor);
+    for (uint64_t timestamp = 1; timestamp <= 1'000; timestamp++) {
+      co_await timer->MoveForward(executor, key, timestamp);
+      if (timestamp > slow_progress.load() + kWindow) {
+        window_exceeded = true;
+      }
+    }
+    co_await timer->Done(executor, key);
+  };
+  auto slow = [&](concurrencpp::executor_tag, std::shared_ptr<concurrencpp::executor> executor)
+      -> concurrencpp::result<void> {
+    const size_t key = co_await timer->Register(executor);
+    for (uint64_t timestamp = 1; timestamp <= 100; timestamp++) {
+      slow_progress = timestamp;
+      co_await timer->MoveForward(executor, key, timestamp);
+    }
+    co_await timer->Done(executor, key);
+  };
+
+  auto fast_result = fast({}, thread_pool_executor);
+  auto slow_result = slow({}, thread_pool_executor);
+  slow_result.get();
+  fast_result.get();
+
+  // the fast waiter never runs more than a window ahead and finishes once the slow one is done
+  REQUIRE_FALSE(window_exceeded.load());
+}
+
+TEST_CASE("Test WeakTimer reports parked waiters", "[WeakTimer]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 2;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto thread_pool_executor = runtime.thread_pool_executor();
+
+  constexpr uint64_t kWindow = 10;
+  auto timer = std::make_shared<WeakTimer>(2, kWindow);
+  auto ahead = [&](concurrencpp::executor_tag, std::shared_ptr<concurrencpp::executor> executor)
+      -> concurrencpp::result<void> {
+    const size_t key = co_await timer->Register(executor, "ahead");
+    // the other waiter has not moved yet, hence this one is parked
+    co_await timer->MoveForward(executor, key, 100);
+    co_await timer->Done(executor, key);
+  };
+  auto ahead_result = ahead({}, thread_pool_executor);
+
+  std::vector<std::string> parked;
+  while (parked.empty()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    timer->ForEachParkedLongerThan(std::chrono::milliseconds{10},
+                                   [&parked](const std::string &name, std::chrono::nanoseconds parked_for,
+                                             uint64_t timestamp) {
+                                     REQUIRE(timestamp == 100);
+                                     parked.push_back(name);
+                                   });
+  }
+  REQUIRE(parked == std::vector<std::string>{"ahead"});
+  REQUIRE(timer->GetSlowest() == 0);
+
+  auto behind = [&](concurrencpp::executor_tag, std::shared_ptr<concurrencpp::executor> executor)
+      -> concurrencpp::result<void> {
+    const size_t key = co_await timer->Register(executor, "behind");
+    co_await timer->Done(executor, key);
+  };
+  behind({}, thread_pool_executor).get();
+  ahead_result.get();
+
+  parked.clear();
+  timer->ForEachParkedLongerThan(std::chrono::nanoseconds{0}, [&parked](const std::string &name,
+                                                                         std::chrono::nanoseconds parked_for,
+                                                                         uint64_t timestamp) {
+    parked.push_back(name);
+  });
+  REQUIRE(parked.empty());
+}
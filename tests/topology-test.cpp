@@ -0,0 +1,128 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+#include <memory>
+#include <vector>
+
+#include "analytics/topology.h"
+#include "events/event-filter.h"
+#include "exporter/exporter.h"
+
+namespace {
+
+template<typename ToT, typename FromT>
+bool IsA(const std::shared_ptr<FromT> &ptr) {
+  return std::dynamic_pointer_cast<ToT>(ptr) != nullptr;
+}
+
+}  // namespace
+
+TEST_CASE("Test TopologyBuilder parses the topology", "[TopologyBuilder]") {
+  const TraceEnvConfig trace_env_config = TraceEnvConfig::CreateFromYaml("tests/topology-config.yaml");
+
+  REQUIRE(trace_env_config.HasTopology());
+  REQUIRE_FALSE(trace_env_config.GetTopologyNs3().IsEventStream());
+  REQUIRE(trace_env_config.GetTopologyNs3().GetPath() == "tests/raw-logs/ns3-raw-log.txt");
+  const TraceEnvConfig::HostTopologyContainer &hosts = trace_env_config.GetTopologyHosts();
+  REQUIRE(hosts.size() == 2);
+  REQUIRE(hosts[0].GetName() == "server");
+  REQUIRE_FALSE(hosts[0].GetGem5().IsEventStream());
+  REQUIRE(hosts[0].GetNs3NodeId() == 0);
+  REQUIRE(hosts[0].GetNs3DeviceId() == 2);
+  REQUIRE(hosts[0].GetNs3SinkDeviceIds() == std::vector<int>{3});
+  // by default the link device and the device of the NIC are traced
+  REQUIRE(hosts[0].GetNs3FilterDeviceIds() == std::vector<int>{1, 2});
+  REQUIRE(hosts[1].GetName() == "client");
+  REQUIRE(hosts[1].GetGem5().IsEventStream());
+  REQUIRE(hosts[1].GetGem5().GetPath() == "tests/event-streams/gem5-client.stream");
+  REQUIRE(hosts[1].GetNs3SinkDeviceIds().empty());
+  // the device of the NIC is traced even if it is not configured
+  REQUIRE(hosts[1].GetNs3FilterDeviceIds() == std::vector<int>{1, 2});
+}
+
+TEST_CASE("Test TopologyBuilder builds the topology", "[TopologyBuilder]") {
+  const TraceEnvConfig trace_env_config = TraceEnvConfig::CreateFromYaml("tests/topology-config.yaml");
+  TraceEnvironment trace_environment{trace_env_config};
+  auto exporter = std::make_shared<simbricks::trace::NoOpExporter>(trace_environment);
+  Tracer tracer{trace_environment, exporter};
+  std::vector<EventTimeBoundary> timestamp_bounds{
+      EventTimeBoundary{EventTimeBoundary::kMinLowerBound, EventTimeBoundary::kMaxUpperBound}};
+
+  TopologyBuilder builder{trace_environment, trace_env_config, tracer, timestamp_bounds};
+  const TopologyBuilder::PipelinesT pipelines = builder.Build();
+
+  SECTION("every host has a gem5 and a nicbm pipeline, the network comes last") {
+    REQUIRE(pipelines->size() == 5);
+    for (size_t host = 0; host < 2; ++host) {
+      REQUIRE(IsA<HostSpanner>((*pipelines)[host * 2]->cons_));
+      REQUIRE(IsA<NicSpanner>((*pipelines)[host * 2 + 1]->cons_));
+    }
+    REQUIRE(IsA<NetworkSpanner>((*pipelines)[4]->cons_));
+  }
+
+  SECTION("raw logs are filtered by type, event streams by timestamp") {
+    const auto &server_gem5 = *(*pipelines)[0]->handler_;
+    REQUIRE(server_gem5.size() == 2);
+    REQUIRE(IsA<EventTypeFilter>(server_gem5[0]));
+    REQUIRE(IsA<HostCallFuncFilter>(server_gem5[1]));
+
+    const auto &client_gem5 = *(*pipelines)[2]->handler_;
+    REQUIRE(client_gem5.size() == 1);
+    REQUIRE(IsA<EventTimestampFilter>(client_gem5[0]));
+
+    const auto &ns3 = *(*pipelines)[4]->handler_;
+    REQUIRE(ns3.size() == 2);
+    REQUIRE(IsA<EventTypeFilter>(ns3[0]));
+    REQUIRE(IsA<NS3EventFilter>(ns3[1]));
+  }
+
+  SECTION("the NIC devices are wired to the NICs, sink devices to the sink") {
+    const NodeDeviceToChannelMap &to_host = builder.GetToHostMap();
+    const NodeDeviceToChannelMap &from_host = builder.GetFromHostMap();
+    REQUIRE(to_host.HasMapping(0, 2));
+    REQUIRE(to_host.HasMapping(1, 2));
+    REQUIRE(from_host.HasMapping(0, 2));
+    REQUIRE(from_host.HasMapping(1, 2));
+    REQUIRE(to_host.GetValidChannel(0, 2).get() != to_host.GetValidChannel(1, 2).get());
+    REQUIRE(to_host.GetValidChannel(0, 2).get() != builder.GetSink().get());
+    REQUIRE(from_host.GetValidChannel(0, 2).get() != to_host.GetValidChannel(0, 2).get());
+
+    REQUIRE(to_host.GetValidChannel(0, 3).get() == builder.GetSink().get());
+    REQUIRE(from_host.GetValidChannel(0, 3).get() == builder.GetSink().get());
+    REQUIRE_FALSE(to_host.HasMapping(1, 3));
+    REQUIRE_FALSE(to_host.HasMapping(0, 1));
+    REQUIRE_FALSE(to_host.HasMapping(1, 1));
+  }
+
+  SECTION("the link and NIC devices of every node are traced") {
+    const NodeDeviceFilter &filter = builder.GetNodeDeviceFilter();
+    REQUIRE(filter.IsInterestingNodeDevice(0, 1));
+    REQUIRE(filter.IsInterestingNodeDevice(0, 2));
+    REQUIRE(filter.IsInterestingNodeDevice(1, 1));
+    REQUIRE(filter.IsInterestingNodeDevice(1, 2));
+    REQUIRE_FALSE(filter.IsInterestingNodeDevice(0, 3));
+    REQUIRE_FALSE(filter.IsInterestingNodeDevice(2, 1));
+  }
+}
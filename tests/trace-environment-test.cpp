@@ -0,0 +1,171 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "env/traceEnvironment.h"
+
+namespace {
+
+// how ids were handed out before the counters became atomics: every id is taken under the writer
+// lock of the environment mutex, which readers such as GetConfig hold shared
+class MutexIdAllocator {
+  std::shared_mutex mutex_;
+  const TraceEnvConfig &config_;
+  uint64_t next_id_ = 1;
+
+ public:
+  explicit MutexIdAllocator(const TraceEnvConfig &config) : config_(config) {}
+
+  uint64_t GetNextSpanId() {
+    const std::unique_lock writer_lock(mutex_);
+    return next_id_++;
+  }
+
+  TraceEnvConfig GetConfig() {
+    const std::shared_lock reader_lock(mutex_);
+    return config_;
+  }
+};
+
+// takes ids from several threads while other threads keep reading the config, returns the
+// largest id handed out
+template<typename AllocatorT>
+uint64_t AllocateIdsWhileReading(AllocatorT &allocator, size_t allocators, size_t ids_per_allocator) {
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (size_t index = 0; index < 2; index++) {
+    readers.emplace_back([&allocator, &done]() {
+      while (not done.load()) {
+        allocator.GetConfig();
+      }
+    });
+  }
+
+  std::atomic<uint64_t> largest{0};
+  std::vector<std::thread> threads;
+  for (size_t index = 0; index < allocators; index++) {
+    threads.emplace_back([&allocator, &largest, ids_per_allocator]() {
+      uint64_t last = 0;
+      for (size_t count = 0; count < ids_per_allocator; count++) {
+        last = allocator.GetNextSpanId();
+      }
+      uint64_t current = largest.load();
+      while (current < last and not largest.compare_exchange_weak(current, last)) {
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  done.store(true);
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  return largest.load();
+}
+
+}  // namespace
+
+TEST_CASE("Test TraceEnvironment id allocation under contention", "[TraceEnvironment]") {
+  const TraceEnvConfig trace_env_config = TraceEnvConfig::CreateFromYaml("tests/trace-env-config.yaml");
+  TraceEnvironment trace_environment{trace_env_config};
+
+  constexpr size_t kAllocators = 4;
+  constexpr size_t kIdsPerAllocator = 20000;
+  const uint64_t first_id = trace_environment.PeekNextSpanId();
+
+  // symbol lookups and insertions keep the environment mutex busy while ids are handed out
+  std::atomic<bool> done{false};
+  std::vector<std::thread> lookups;
+  for (size_t index = 0; index < 2; index++) {
+    lookups.emplace_back([&trace_environment, &done, index]() {
+      uint64_t address = 0;
+      while (not done.load()) {
+        trace_environment.SymtableFilter(address++);
+        if (index == 0 and address % 64 == 0) {
+          trace_environment.InternalizeAdditional("symbol-" + std::to_string(address % 1024));
+        }
+      }
+    });
+  }
+
+  std::vector<std::vector<uint64_t>> ids(kAllocators);
+  std::vector<std::thread> allocators;
+  for (size_t index = 0; index < kAllocators; index++) {
+    allocators.emplace_back([&trace_environment, &ids, index]() {
+      ids[index].reserve(kIdsPerAllocator);
+      for (size_t count = 0; count < kIdsPerAllocator; count++) {
+        ids[index].push_back(trace_environment.GetNextSpanId());
+      }
+    });
+  }
+  for (auto &allocator : allocators) {
+    allocator.join();
+  }
+  done.store(true);
+  for (auto &lookup : lookups) {
+    lookup.join();
+  }
+
+  std::vector<uint64_t> all_ids;
+  for (const auto &allocator_ids : ids) {
+    REQUIRE(std::ranges::is_sorted(allocator_ids));
+    all_ids.insert(all_ids.end(), allocator_ids.begin(), allocator_ids.end());
+  }
+  std::ranges::sort(all_ids);
+
+  // every id is handed out exactly once and without gaps
+  REQUIRE(all_ids.size() == kAllocators * kIdsPerAllocator);
+  REQUIRE(std::adjacent_find(all_ids.begin(), all_ids.end()) == all_ids.end());
+  REQUIRE(all_ids.front() == first_id);
+  REQUIRE(all_ids.back() == first_id + kAllocators * kIdsPerAllocator - 1);
+  REQUIRE(trace_environment.PeekNextSpanId() == first_id + kAllocators * kIdsPerAllocator);
+}
+
+// hidden, run with: unit_tests "[benchmark]"
+TEST_CASE("Benchmark TraceEnvironment id allocation under contention", "[.][benchmark][TraceEnvironment]") {
+  const TraceEnvConfig trace_env_config = TraceEnvConfig::CreateFromYaml("tests/trace-env-config.yaml");
+  TraceEnvironment trace_environment{trace_env_config};
+  MutexIdAllocator mutex_allocator{trace_env_config};
+
+  constexpr size_t kAllocators = 4;
+  constexpr size_t kIdsPerAllocator = 20000;
+
+  BENCHMARK("writer locked counter") {
+    return AllocateIdsWhileReading(mutex_allocator, kAllocators, kIdsPerAllocator);
+  };
+
+  BENCHMARK("atomic counter") {
+    return AllocateIdsWhileReading(trace_environment, kAllocators, kIdsPerAllocator);
+  };
+}
@@ -0,0 +1,597 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "test-util.h"
+#include "analytics/tracer.h"
+#include "analytics/context.h"
+#include "events/events.h"
+
+class RecordingExporter : public simbricks::trace::SpanExporter {
+  std::set<uint64_t> exported_;
+
+ public:
+  std::vector<uint64_t> order_;
+  bool parent_exported_first_ = true;
+  std::atomic<int> exporting_{0};
+  std::atomic<bool> concurrent_exports_{false};
+
+  explicit RecordingExporter(TraceEnvironment &trace_environment) : SpanExporter(trace_environment) {}
+
+  void StartSpan(std::shared_ptr<EventSpan> to_start) override {
+  }
+
+  void EndSpan(std::shared_ptr<EventSpan> to_end) override {
+  }
+
+  void ExportSpan(std::shared_ptr<EventSpan> to_export) override {
+    if (exporting_.fetch_add(1) != 0) {
+      concurrent_exports_ = true;
+    }
+    if (to_export->HasParent() and not exported_.contains(to_export->GetParentId())) {
+      parent_exported_first_ = false;
+    }
+    exported_.insert(to_export->GetId());
+    order_.push_back(to_export->GetId());
+    exporting_.fetch_sub(1);
+  }
+
+  void ForceFlush() override {}
+};
+
+TEST_CASE("Test sharded Tracer", "[Tracer]") {
+  const uint64_t source_id = 1;
+  const size_t parser_ident = 1;
+  const std::string parser_name = "test";
+  std::string service_name = "test-service";
+
+  const TraceEnvConfig trace_env_config = TraceEnvConfig::CreateFromYaml("tests/trace-env-config.yaml");
+  TraceEnvironment trace_environment{trace_env_config};
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto executor = runtime.thread_pool_executor();
+
+  auto exporter = std::make_shared<RecordingExporter>(trace_environment);
+  Tracer tracer{trace_environment, exporter, 4};
+
+  uint64_t next_event_id = 1;
+  auto create_event = [&]() {
+    const uint64_t ident = next_event_id++;
+    return std::make_shared<HostMmioW>(ident * 1000, parser_ident, parser_name, ident, 108000, 4, 0, 0, true);
+  };
+
+  SECTION("children waiting for their parent are exported after it") {
+    auto parent = tracer.StartSpan<HostMmioSpan>(executor, create_event(), source_id, service_name, 0).get();
+    auto child = tracer.StartSpanByParent<HostMmioSpan>(executor, parent, create_event(), source_id,
+                                                        service_name, 0).get();
+    auto grand_child = tracer.StartSpanByParent<HostMmioSpan>(executor, child, create_event(), source_id,
+                                                              service_name, 0).get();
+
+    tracer.MarkSpanAsDone(executor, grand_child).get();
+    tracer.MarkSpanAsDone(executor, child).get();
+    REQUIRE(exporter->order_.empty());
+
+    tracer.MarkSpanAsDone(executor, parent).get();
+    REQUIRE(exporter->order_ == std::vector<uint64_t>{parent->GetId(), child->GetId(), grand_child->GetId()});
+    REQUIRE(exporter->parent_exported_first_);
+  }
+
+  SECTION("spans waiting for a re-parented span are exported after it") {
+    // consecutive trace ids end up in different shards
+    auto root = tracer.StartSpan<HostMmioSpan>(executor, create_event(), source_id, service_name, 0).get();
+    auto lazy = tracer.StartSpan<HostMmioSpan>(executor, create_event(), source_id, service_name, 0).get();
+    auto lazy_child = tracer.StartSpanByParent<HostMmioSpan>(executor, lazy, create_event(), source_id,
+                                                             service_name, 0).get();
+    REQUIRE(root->GetValidTraceId() != lazy->GetValidTraceId());
+
+    tracer.MarkSpanAsDone(executor, root).get();
+    tracer.MarkSpanAsDone(executor, lazy_child).get();
+    REQUIRE(exporter->order_ == std::vector<uint64_t>{root->GetId()});
+
+    auto root_context = Context::CreatePassOnContext<expectation::kRx>(root);
+    tracer.AddParentLazily(executor, lazy, root_context).get();
+    REQUIRE(lazy->GetValidTraceId() == root->GetValidTraceId());
+    REQUIRE(lazy_child->GetValidTraceId() == root->GetValidTraceId());
+
+    tracer.MarkSpanAsDone(executor, lazy).get();
+    REQUIRE(exporter->order_ == std::vector<uint64_t>{root->GetId(), lazy->GetId(), lazy_child->GetId()});
+    REQUIRE(exporter->parent_exported_first_);
+  }
+
+  SECTION("children started from a context of the trace before re-parenting are exported") {
+    auto root = tracer.StartSpan<HostMmioSpan>(executor, create_event(), source_id, service_name, 0).get();
+    auto lazy = tracer.StartSpan<HostMmioSpan>(executor, create_event(), source_id, service_name, 0).get();
+    auto stale_context = Context::CreatePassOnContext<expectation::kRx>(lazy);
+
+    auto root_context = Context::CreatePassOnContext<expectation::kRx>(root);
+    tracer.AddParentLazily(executor, lazy, root_context).get();
+    REQUIRE(lazy->GetValidTraceId() == root->GetValidTraceId());
+
+    // the child stays within the shard of the old trace while its parent moved on
+    auto child = tracer.StartSpanByParentPassOnContext<HostMmioSpan>(executor, stale_context, create_event(),
+                                                                     source_id, service_name, 0).get();
+    REQUIRE(child->GetValidTraceId() == stale_context->GetTraceId());
+    REQUIRE(child->GetValidTraceId() != lazy->GetValidTraceId());
+
+    tracer.MarkSpanAsDone(executor, child).get();
+    tracer.MarkSpanAsDone(executor, root).get();
+    REQUIRE(exporter->order_ == std::vector<uint64_t>{root->GetId()});
+
+    tracer.MarkSpanAsDone(executor, lazy).get();
+    REQUIRE(exporter->order_ == std::vector<uint64_t>{root->GetId(), lazy->GetId(), child->GetId()});
+    REQUIRE(exporter->parent_exported_first_);
+  }
+
+  SECTION("spans still waiting once all spanners finished are exported without their parent") {
+    auto parent = tracer.StartSpan<HostMmioSpan>(executor, create_event(), source_id, service_name, 0).get();
+    auto child = tracer.StartSpanByParent<HostMmioSpan>(executor, parent, create_event(), source_id,
+                                                        service_name, 0).get();
+    auto grand_child = tracer.StartSpanByParent<HostMmioSpan>(executor, child, create_event(), source_id,
+                                                              service_name, 0).get();
+    tracer.MarkSpanAsDone(executor, grand_child).get();
+    tracer.MarkSpanAsDone(executor, child).get();
+    REQUIRE(exporter->order_.empty());
+
+    // without an orphan timeout the waiting chain is only released when the parent can never be done anymore
+    tracer.FinishExport();
+    REQUIRE(exporter->order_ == std::vector<uint64_t>{child->GetId(), grand_child->GetId()});
+    REQUIRE_FALSE(child->HasParent());
+    REQUIRE(grand_child->GetParentId() == child->GetId());
+    REQUIRE(exporter->parent_exported_first_);
+  }
+}
+
+concurrencpp::result<void>
+done_chains_task(concurrencpp::executor_tag,
+                 std::shared_ptr<concurrencpp::executor> executor,
+                 Tracer &tracer,
+                 std::atomic<uint64_t> &next_event_id,
+                 size_t chains) {
+  const std::string parser_name = "test";
+  std::string service_name = "test-service";
+  auto create_event = [&]() {
+    const uint64_t ident = next_event_id.fetch_add(1);
+    return std::make_shared<HostMmioW>(ident * 1000, 1, parser_name, ident, 108000, 4, 0, 0, true);
+  };
+
+  for (size_t index = 0; index < chains; index++) {
+    auto parent = co_await tracer.StartSpan<HostMmioSpan>(executor, create_event(), 1, service_name, 0);
+    auto child = co_await tracer.StartSpanByParent<HostMmioSpan>(executor, parent, create_event(), 1,
+                                                                 service_name, 0);
+    // the child waits and is released by its parent
+    co_await tracer.MarkSpanAsDone(executor, child);
+    co_await tracer.MarkSpanAsDone(executor, parent);
+  }
+}
+
+TEST_CASE("Test Tracer exports from several shards concurrently", "[Tracer]") {
+  const TraceEnvConfig trace_env_config = CreateTestConfig();
+  TraceEnvironment trace_environment{trace_env_config};
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 4;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto executor = runtime.thread_pool_executor();
+
+  auto exporter = std::make_shared<RecordingExporter>(trace_environment);
+  Tracer tracer{trace_environment, exporter, 2};
+
+  const size_t spanners = 4;
+  const size_t chains = 2'000;
+  std::atomic<uint64_t> next_event_id{1};
+  std::vector<concurrencpp::result<void>> tasks;
+  for (size_t index = 0; index < spanners; index++) {
+    tasks.push_back(done_chains_task({}, executor, tracer, next_event_id, chains));
+  }
+  for (auto &task : tasks) {
+    task.get();
+  }
+  tracer.FinishExport();
+
+  REQUIRE(exporter->order_.size() == spanners * chains * 2);
+  REQUIRE(exporter->parent_exported_first_);
+  REQUIRE_FALSE(exporter->concurrent_exports_);
+  REQUIRE(tracer.GetExportedLowWatermark() == trace_environment.PeekNextSpanId());
+}
+
+TEST_CASE("Test Tracer exports orphans", "[Tracer]") {
+  const uint64_t source_id = 1;
+  const size_t parser_ident = 1;
+  const std::string parser_name = "test";
+  std::string service_name = "test-service";
+
+  const TraceEnvConfig trace_env_config = CreateTestConfig("{OrphanSpanTimeoutPs: 100000, OrphanSpanPolicy: Export}");
+  REQUIRE(trace_env_config.GetOrphanSpanPolicy() == OrphanSpanPolicy::kExport);
+  TraceEnvironment trace_environment{trace_env_config};
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto executor = runtime.thread_pool_executor();
+
+  auto exporter = std::make_shared<RecordingExporter>(trace_environment);
+  Tracer tracer{trace_environment, exporter, 4};
+
+  uint64_t next_event_id = 1;
+  auto create_event = [&]() {
+    const uint64_t ident = next_event_id++;
+    return std::make_shared<HostMmioW>(ident * 1000, parser_ident, parser_name, ident, 108000, 4, 0, 0, true);
+  };
+
+  auto parent = tracer.StartSpan<HostMmioSpan>(executor, create_event(), source_id, service_name, 0).get();
+  auto child = tracer.StartSpanByParent<HostMmioSpan>(executor, parent, create_event(), source_id,
+                                                      service_name, 0).get();
+  auto grand_child = tracer.StartSpanByParent<HostMmioSpan>(executor, child, create_event(), source_id,
+                                                            service_name, 0).get();
+  tracer.MarkSpanAsDone(executor, grand_child).get();
+  tracer.MarkSpanAsDone(executor, child).get();
+  REQUIRE(exporter->order_.empty());
+
+  // the parent is never done, a span starting after the timeout releases the waiting chain
+  auto late_event = std::make_shared<HostMmioW>(1'000'000, parser_ident, parser_name, next_event_id++,
+                                                108000, 4, 0, 0, true);
+  auto late = tracer.StartSpanByParent<HostMmioSpan>(executor, parent, late_event, source_id,
+                                                     service_name, 0).get();
+  tracer.MarkSpanAsDone(executor, late).get();
+  REQUIRE(exporter->order_ == std::vector<uint64_t>{child->GetId(), grand_child->GetId()});
+  REQUIRE_FALSE(child->HasParent());
+  REQUIRE(grand_child->GetParentId() == child->GetId());
+  REQUIRE(exporter->parent_exported_first_);
+
+  // once all spanners finished nothing can be exported anymore, remaining waiters are released
+  tracer.FinishExport();
+  REQUIRE(exporter->order_ == std::vector<uint64_t>{child->GetId(), grand_child->GetId(), late->GetId()});
+  REQUIRE(exporter->parent_exported_first_);
+
+  // the parent that never showed up does not hold back the exported spans
+  REQUIRE(tracer.GetExportedLowWatermark() == trace_environment.PeekNextSpanId());
+}
+
+TEST_CASE("Test Tracer drops orphans", "[Tracer]") {
+  const uint64_t source_id = 1;
+  const size_t parser_ident = 1;
+  const std::string parser_name = "test";
+  std::string service_name = "test-service";
+
+  const TraceEnvConfig trace_env_config = CreateTestConfig("{OrphanSpanTimeoutPs: 100000, OrphanSpanPolicy: Drop}");
+  REQUIRE(trace_env_config.GetOrphanSpanPolicy() == OrphanSpanPolicy::kDrop);
+  TraceEnvironment trace_environment{trace_env_config};
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto executor = runtime.thread_pool_executor();
+
+  auto exporter = std::make_shared<RecordingExporter>(trace_environment);
+  Tracer tracer{trace_environment, exporter, 4};
+
+  uint64_t next_event_id = 1;
+  auto create_event = [&](uint64_t timestamp) {
+    return std::make_shared<HostMmioW>(timestamp, parser_ident, parser_name, next_event_id++, 108000, 4, 0, 0, true);
+  };
+
+  // the parent is never done, hence its child times out and is dropped
+  auto parent = tracer.StartSpan<HostMmioSpan>(executor, create_event(1'000), source_id, service_name, 0).get();
+  auto child = tracer.StartSpanByParent<HostMmioSpan>(executor, parent, create_event(2'000), source_id,
+                                                      service_name, 0).get();
+  auto early_grand_child = tracer.StartSpanByParent<HostMmioSpan>(executor, child, create_event(3'000), source_id,
+                                                                  service_name, 0).get();
+  auto late_grand_child = tracer.StartSpanByParent<HostMmioSpan>(executor, child, create_event(4'000), source_id,
+                                                                 service_name, 0).get();
+  tracer.MarkSpanAsDone(executor, child).get();
+
+  auto unrelated = tracer.StartSpan<HostMmioSpan>(executor, create_event(1'000'000), source_id, service_name, 0).get();
+  tracer.MarkSpanAsDone(executor, unrelated).get();
+  REQUIRE(exporter->order_ == std::vector<uint64_t>{unrelated->GetId()});
+
+  SECTION("children done after their parent was dropped are dropped as well") {
+    tracer.MarkSpanAsDone(executor, early_grand_child).get();
+    REQUIRE(exporter->order_ == std::vector<uint64_t>{unrelated->GetId()});
+  }
+
+  SECTION("children done long after the orphan timeout are dropped as well") {
+    auto later = tracer.StartSpan<HostMmioSpan>(executor, create_event(2'000'000), source_id, service_name, 0).get();
+    tracer.MarkSpanAsDone(executor, later).get();
+    tracer.MarkSpanAsDone(executor, parent).get();
+    tracer.MarkSpanAsDone(executor, early_grand_child).get();
+    tracer.MarkSpanAsDone(executor, late_grand_child).get();
+    REQUIRE(exporter->order_ == std::vector<uint64_t>{unrelated->GetId(), later->GetId(), parent->GetId()});
+    REQUIRE(exporter->parent_exported_first_);
+  }
+}
+
+TEST_CASE("Test Tracer expires traces", "[Tracer]") {
+  const uint64_t source_id = 1;
+  const size_t parser_ident = 1;
+  const std::string parser_name = "test";
+  std::string service_name = "test-service";
+
+  const TraceEnvConfig trace_env_config = CreateTestConfig("TraceTtlPs: 1000000");
+  REQUIRE(trace_env_config.GetTraceTtlPs() == 1'000'000);
+  TraceEnvironment trace_environment{trace_env_config};
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto executor = runtime.thread_pool_executor();
+
+  auto exporter = std::make_shared<RecordingExporter>(trace_environment);
+  Tracer tracer{trace_environment, exporter, 2};
+
+  uint64_t next_event_id = 1;
+  auto create_event = [&](uint64_t timestamp) {
+    return std::make_shared<HostMmioW>(timestamp, parser_ident, parser_name, next_event_id++, 108000, 4, 0, 0, true);
+  };
+
+  SECTION("a trace created in a shard whose clock lags behind does not expire right away") {
+    // only the shard of the first trace sees a span being done
+    auto ahead = tracer.StartSpan<HostMmioSpan>(executor, create_event(10'000'000), source_id, service_name, 0).get();
+    tracer.MarkSpanAsDone(executor, ahead).get();
+
+    auto lagging = tracer.StartSpan<HostMmioSpan>(executor, create_event(10'000'000), source_id, service_name, 0).get();
+    auto child = tracer.StartSpanByParent<HostMmioSpan>(executor, lagging, create_event(10'001'000), source_id,
+                                                        service_name, 0).get();
+    REQUIRE(ahead->GetValidTraceId() % 2 != lagging->GetValidTraceId() % 2);
+    tracer.MarkSpanAsDone(executor, child).get();
+
+    // the children of a trace that still exists move along with its root
+    auto ahead_context = Context::CreatePassOnContext<expectation::kRx>(ahead);
+    tracer.AddParentLazily(executor, lagging, ahead_context).get();
+    REQUIRE(child->GetValidTraceId() == ahead->GetValidTraceId());
+  }
+
+  SECTION("a span pending forever does not hold back the exported spans once its trace is forgotten") {
+    auto pending = tracer.StartSpan<HostMmioSpan>(executor, create_event(1'000), source_id, service_name, 0).get();
+    for (uint64_t timestamp = 10'000; timestamp < 10'000'000; timestamp += 10'000) {
+      auto span = tracer.StartSpan<HostMmioSpan>(executor, create_event(timestamp), source_id, service_name, 0).get();
+      tracer.MarkSpanAsDone(executor, span).get();
+    }
+    REQUIRE(exporter->order_.size() == 999);
+    REQUIRE(tracer.GetExportedLowWatermark() > pending->GetId() + 900);
+
+    // a span given up on can still be exported
+    tracer.MarkSpanAsDone(executor, pending).get();
+    REQUIRE(exporter->order_.back() == pending->GetId());
+  }
+
+  SECTION("a trace not accessed within the ttl is forgotten") {
+    auto old = tracer.StartSpan<HostMmioSpan>(executor, create_event(1'000), source_id, service_name, 0).get();
+    auto child = tracer.StartSpanByParent<HostMmioSpan>(executor, old, create_event(2'000), source_id,
+                                                        service_name, 0).get();
+    tracer.MarkSpanAsDone(executor, child).get();
+
+    auto later = tracer.StartSpan<HostMmioSpan>(executor, create_event(10'000'000), source_id, service_name, 0).get();
+    tracer.MarkSpanAsDone(executor, later).get();
+    auto other_child = tracer.StartSpanByParent<HostMmioSpan>(executor, old, create_event(10'001'000), source_id,
+                                                              service_name, 0).get();
+    tracer.MarkSpanAsDone(executor, other_child).get();
+
+    auto later_context = Context::CreatePassOnContext<expectation::kRx>(later);
+    tracer.AddParentLazily(executor, old, later_context).get();
+    REQUIRE(old->GetValidTraceId() == later->GetValidTraceId());
+    REQUIRE(child->GetValidTraceId() != later->GetValidTraceId());
+  }
+}
+
+// Records what was exported without holding on to the spans, a span pins the events it was built
+// from for as long as it lives.
+class ResumeRecordingExporter : public simbricks::trace::SpanExporter {
+ public:
+  struct Exported {
+    uint64_t id_;
+    uint64_t parent_id_;
+    uint64_t starting_ts_;
+    uint64_t parent_starting_ts_;
+  };
+  std::vector<Exported> exported_;
+
+  explicit ResumeRecordingExporter(TraceEnvironment &trace_environment) : SpanExporter(trace_environment) {}
+
+  void StartSpan(std::shared_ptr<EventSpan> to_start) override {
+  }
+
+  void EndSpan(std::shared_ptr<EventSpan> to_end) override {
+  }
+
+  void ExportSpan(std::shared_ptr<EventSpan> to_export) override {
+    const bool has_parent = to_export->HasParent();
+    exported_.push_back({to_export->GetId(),
+                         has_parent ? to_export->GetParentId() : 0,
+                         to_export->GetStartingTs(),
+                         has_parent ? to_export->GetContext()->GetParentStartingTs() : 0});
+  }
+
+  void ForceFlush() override {}
+};
+
+// Acts as the spanner of an input whose n-th event has timestamp n * 1000 and ends at byte offset
+// n. Every five events make up a trace: a root span, a context passed on from it, a child started
+// from the context, and the child and the root being done. Events that find nothing to belong to
+// are skipped, as happens when resuming in the middle of a trace.
+class ResumeTraceBuilder {
+  Tracer &tracer_;
+  std::shared_ptr<concurrencpp::executor> executor_;
+  std::string &service_name_;
+  const std::string parser_name_ = "resume-test";
+  std::shared_ptr<InputProgress> input_;
+  std::shared_ptr<ConsumerProgress> consumer_;
+  uint64_t events_read_ = 0;
+  uint64_t next_event_;
+
+  std::shared_ptr<HostMmioSpan> root_ = nullptr;
+  std::shared_ptr<Context> context_ = nullptr;
+  std::shared_ptr<HostMmioSpan> child_ = nullptr;
+
+ public:
+  ResumeTraceBuilder(TraceEnvironment &trace_environment,
+                     Tracer &tracer,
+                     std::shared_ptr<concurrencpp::executor> executor,
+                     std::string &service_name)
+      : tracer_(tracer),
+        executor_(std::move(executor)),
+        service_name_(service_name),
+        input_(trace_environment.GetCheckpoints().RegisterInput("resume-input")),
+        consumer_(trace_environment.GetCheckpoints().RegisterConsumer()),
+        next_event_(input_->GetStartOffset() + 1) {
+  }
+
+  uint64_t GetStartEvent() const {
+    return input_->GetStartOffset() + 1;
+  }
+
+  void RunUntil(uint64_t last_event) {
+    const uint64_t source_id = 1;
+    for (; next_event_ <= last_event; ++next_event_) {
+      const uint64_t timestamp = next_event_ * 1000;
+      auto event = std::make_shared<HostMmioW>(timestamp, 1, parser_name_, next_event_, 108000, 4, 0, 0, true);
+      input_->OnEventRead(++events_read_, timestamp, next_event_);
+      input_->OnEventConsumed();
+      consumer_->OnEventHandling(timestamp);
+
+      switch (next_event_ % 5) {
+        case 0:
+          root_ = tracer_.StartSpan<HostMmioSpan>(executor_, event, source_id, service_name_, 0).get();
+          break;
+        case 1:
+          if (root_) {
+            context_ = Context::CreatePassOnContext<expectation::kMmio>(root_);
+          }
+          break;
+        case 2:
+          if (context_) {
+            child_ = tracer_.StartSpanByParentPassOnContext<HostMmioSpan>(executor_, context_, event, source_id,
+                                                                          service_name_, 0).get();
+            context_ = nullptr;
+          }
+          break;
+        case 3:
+          if (child_) {
+            tracer_.MarkSpanAsDone(executor_, child_).get();
+            child_ = nullptr;
+          }
+          break;
+        default:
+          if (root_) {
+            tracer_.MarkSpanAsDone(executor_, root_).get();
+            root_ = nullptr;
+          }
+          break;
+      }
+    }
+  }
+};
+
+TEST_CASE("Test Tracer resumes mid-trace from a checkpoint", "[Tracer]") {
+  const std::string checkpoint_file = "tests/tracer-resume-test.ckpt";
+  const TraceEnvConfig trace_env_config = CreateTestConfig("CheckpointFile: " + checkpoint_file);
+  std::string service_name = "test-service";
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  const concurrencpp::runtime runtime{concurren_options};
+  const auto executor = runtime.thread_pool_executor();
+
+  using Exported = ResumeRecordingExporter::Exported;
+  const auto to_keys = [](const std::vector<Exported> &exported) {
+    std::set<std::pair<uint64_t, uint64_t>> keys;
+    for (const Exported &span : exported) {
+      keys.emplace(span.starting_ts_, span.parent_starting_ts_);
+    }
+    return keys;
+  };
+  const uint64_t last_event = 2 * kCheckpointSampleInterval + 51;
+  const uint64_t crash_after = 2 * kCheckpointSampleInterval;
+
+  std::vector<Exported> uninterrupted;
+  {
+    TraceEnvironment trace_environment{trace_env_config};
+    auto exporter = std::make_shared<ResumeRecordingExporter>(trace_environment);
+    Tracer tracer{trace_environment, exporter, 4};
+    ResumeTraceBuilder builder{trace_environment, tracer, executor, service_name};
+    builder.RunUntil(last_event);
+    tracer.FinishExport();
+    uninterrupted = exporter->exported_;
+  }
+
+  // crash while the root and the child of the trace started at event 2045 are still open
+  std::vector<Exported> before_crash;
+  uint64_t next_span_id_at_crash;
+  {
+    TraceEnvironment trace_environment{trace_env_config};
+    auto exporter = std::make_shared<ResumeRecordingExporter>(trace_environment);
+    Tracer tracer{trace_environment, exporter, 4};
+    ResumeTraceBuilder builder{trace_environment, tracer, executor, service_name};
+    builder.RunUntil(crash_after);
+
+    const Checkpoint checkpoint = trace_environment.TakeCheckpoint();
+    REQUIRE(checkpoint.open_spans_ == 2);
+    REQUIRE(checkpoint.frontier_ts_ == 2045 * 1000);
+    REQUIRE(checkpoint.input_offsets_.at("resume-input") == kCheckpointSampleInterval);
+    REQUIRE(checkpoint.WriteToFile(checkpoint_file));
+    before_crash = exporter->exported_;
+    next_span_id_at_crash = checkpoint.next_span_id_;
+  }
+
+  std::vector<Exported> resumed;
+  {
+    TraceEnvironment trace_environment{trace_env_config};
+    REQUIRE(trace_environment.ResumeFromCheckpoint());
+    auto exporter = std::make_shared<ResumeRecordingExporter>(trace_environment);
+    Tracer tracer{trace_environment, exporter, 4};
+    ResumeTraceBuilder builder{trace_environment, tracer, executor, service_name};
+    REQUIRE(builder.GetStartEvent() == kCheckpointSampleInterval + 1);
+    builder.RunUntil(last_event);
+    tracer.FinishExport();
+    resumed = exporter->exported_;
+  }
+  std::filesystem::remove(checkpoint_file);
+
+  // spans exported before the crash and read again are exported twice, but none is missing
+  std::set<std::pair<uint64_t, uint64_t>> combined = to_keys(before_crash);
+  combined.merge(to_keys(resumed));
+  REQUIRE(combined == to_keys(uninterrupted));
+  REQUIRE_FALSE(to_keys(before_crash).contains({2045 * 1000, 0}));
+  REQUIRE(to_keys(resumed).contains({2047 * 1000, 2045 * 1000}));
+
+  // the resumed spans reference parents exported after resuming, with ids not handed out before
+  std::set<uint64_t> resumed_ids;
+  for (const Exported &span : resumed) {
+    REQUIRE(span.id_ >= next_span_id_at_crash);
+    resumed_ids.insert(span.id_);
+  }
+  for (const Exported &span : resumed) {
+    REQUIRE((span.parent_id_ == 0 or resumed_ids.contains(span.parent_id_)));
+  }
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/ttlMap.h"
+
+TEST_CASE("Test TtlLruMap", "[TtlLruMap]") {
+  TtlLruMap<uint64_t, std::string> map{100};
+
+  SECTION("insert, find and remove") {
+    REQUIRE(map.Insert(1, "one"));
+    REQUIRE_FALSE(map.Insert(1, "uno"));
+    REQUIRE(map.Find(1) == "one");
+    REQUIRE_FALSE(map.Find(2));
+    REQUIRE(map.Remove(1));
+    REQUIRE_FALSE(map.Remove(1));
+    REQUIRE(map.Empty());
+  }
+
+  SECTION("entries not accessed within the ttl expire") {
+    REQUIRE(map.Insert(1, "one"));
+    REQUIRE(map.AdvanceTo(50) == 0);
+    REQUIRE(map.Insert(2, "two"));
+    REQUIRE(map.AdvanceTo(100) == 0);
+    REQUIRE(map.AdvanceTo(101) == 1);
+    REQUIRE_FALSE(map.Find(1));
+    REQUIRE(map.Find(2) == "two");
+    REQUIRE(map.AdvanceTo(201) == 0);
+    REQUIRE(map.AdvanceTo(202) == 1);
+    REQUIRE(map.Empty());
+  }
+
+  SECTION("expired entries are handed out before they are removed") {
+    REQUIRE(map.Insert(1, "one"));
+    REQUIRE(map.Insert(2, "two"));
+    std::vector<std::pair<uint64_t, std::string>> expired;
+    REQUIRE(map.AdvanceTo(101, [&](const uint64_t &key, const std::string &value) {
+      expired.emplace_back(key, value);
+    }) == 2);
+    REQUIRE(expired == std::vector<std::pair<uint64_t, std::string>>{{1, "one"}, {2, "two"}});
+    REQUIRE(map.Empty());
+  }
+
+  SECTION("accessing an entry restarts its ttl") {
+    REQUIRE(map.Insert(1, "one"));
+    REQUIRE(map.Insert(2, "two"));
+    REQUIRE(map.AdvanceTo(80) == 0);
+    REQUIRE(map.Find(1) == "one");
+    REQUIRE(map.AdvanceTo(150) == 1);
+    REQUIRE(map.Find(1) == "one");
+    REQUIRE_FALSE(map.Find(2));
+    REQUIRE(map.Size() == 1);
+  }
+
+  SECTION("time never moves backwards") {
+    REQUIRE(map.AdvanceTo(1000) == 0);
+    REQUIRE(map.Insert(1, "one"));
+    REQUIRE(map.AdvanceTo(10) == 0);
+    REQUIRE(map.AdvanceTo(1100) == 0);
+    REQUIRE(map.AdvanceTo(1101) == 1);
+  }
+
+  SECTION("a ttl of 0 never expires entries") {
+    map.SetTtl(0);
+    REQUIRE(map.Insert(1, "one"));
+    REQUIRE(map.AdvanceTo(UINT64_MAX) == 0);
+    REQUIRE(map.Find(1) == "one");
+  }
+}
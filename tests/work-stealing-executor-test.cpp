@@ -0,0 +1,86 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include "sync/workStealingExecutor.h"
+
+TEST_CASE("Test WorkStealingExecutor", "[WorkStealingExecutor]") {
+  constexpr int kAmountTasks = 10'000;
+  auto executor = std::make_shared<WorkStealingExecutor>(4);
+  REQUIRE(executor->max_concurrency_level() == 4);
+
+  SECTION("run tasks enqueued from outside") {
+    std::atomic<int> counter{0};
+    std::latch done{kAmountTasks};
+    for (int index = 0; index < kAmountTasks; index++) {
+      executor->post([&counter, &done]() {
+        counter.fetch_add(1);
+        done.count_down();
+      });
+    }
+    done.wait();
+    REQUIRE(counter.load() == kAmountTasks);
+    REQUIRE(executor->GetAmountExecuted() >= kAmountTasks);
+  }
+
+  SECTION("idle workers steal tasks enqueued from a worker") {
+    std::atomic<int> counter{0};
+    std::latch done{kAmountTasks};
+    executor->post([&executor, &counter, &done]() {
+      // all tasks land on the deque of the posting worker
+      for (int index = 0; index < kAmountTasks; index++) {
+        executor->post([&counter, &done]() {
+          std::this_thread::yield();
+          counter.fetch_add(1);
+          done.count_down();
+        });
+      }
+    });
+    done.wait();
+    REQUIRE(counter.load() == kAmountTasks);
+    REQUIRE(executor->GetAmountStolen() > 0);
+  }
+
+  SECTION("submit returns results") {
+    std::vector<concurrencpp::result<int>> results;
+    for (int index = 0; index < 100; index++) {
+      results.push_back(executor->submit([index]() { return index * 2; }));
+    }
+    for (int index = 0; index < 100; index++) {
+      REQUIRE(results[index].get() == index * 2);
+    }
+  }
+
+  SECTION("no tasks are accepted after shutdown") {
+    executor->shutdown();
+    REQUIRE(executor->shutdown_requested());
+    REQUIRE_THROWS_AS(executor->post([]() {}), concurrencpp::errors::runtime_shutdown);
+  }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_all.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "env/workerPool.h"
+
+TEST_CASE("Test WorkerThreadPool", "[WorkerThreadPool]") {
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = 1;
+  concurrencpp::runtime runtime{concurren_options};
+
+  size_t created = 0;
+  WorkerThreadPool pool{[&runtime, &created]() {
+    ++created;
+    return runtime.make_worker_thread_executor();
+  }, 2};
+
+  SECTION("stages share a bounded amount of workers") {
+    auto first = pool.Acquire("pipeline-0.producer");
+    auto second = pool.Acquire("pipeline-0.stage-1");
+    auto third = pool.Acquire("pipeline-0.consumer");
+    auto fourth = pool.Acquire("pipeline-1.producer");
+
+    REQUIRE(created == 2);
+    REQUIRE(pool.GetAmountWorkers() == 2);
+    REQUIRE(first != second);
+    REQUIRE(third == first);
+    REQUIRE(fourth == second);
+  }
+
+  SECTION("dedicated workers are not shared and not bounded") {
+    auto shared = pool.Acquire("pipeline-0.producer");
+    auto dedicated_a = pool.AcquireDedicated("reader-a.fill");
+    auto dedicated_b = pool.AcquireDedicated("reader-b.fill");
+    auto other = pool.Acquire("pipeline-0.consumer");
+    auto last = pool.Acquire("pipeline-1.producer");
+
+    REQUIRE(created == 4);
+    REQUIRE(pool.GetAmountSharedWorkers() == 2);
+    REQUIRE(dedicated_a != dedicated_b);
+    REQUIRE(other != dedicated_a);
+    REQUIRE(other != dedicated_b);
+    REQUIRE(last != dedicated_a);
+    REQUIRE(last != dedicated_b);
+  }
+
+  SECTION("acquired workers execute tasks") {
+    auto worker = pool.Acquire("pipeline-0.producer");
+    REQUIRE(worker->submit([]() { return 42; }).get() == 42);
+  }
+
+  SECTION("display the stage mapping") {
+    pool.Acquire("pipeline-0.producer");
+    pool.Acquire("pipeline-0.consumer");
+    pool.AcquireDedicated("reader.fill");
+
+    std::stringstream ss;
+    pool.Display(ss);
+    REQUIRE(ss.str() == "worker-0: pipeline-0.producer\n"
+                        "worker-1: pipeline-0.consumer\n"
+                        "worker-2 (dedicated): reader.fill\n");
+  }
+}
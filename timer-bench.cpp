@@ -0,0 +1,125 @@
+/*
+ * Copyright 2022 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "analytics/timer.h"
+#include "sync/corobelt.h"
+#include "util/cxxopts.hpp"
+
+struct TimerBenchResult {
+  double seconds_ = 0;
+  uint64_t steps_ = 0;
+  uint64_t wakeups_ = 0;
+};
+
+concurrencpp::result<void> RunWaiter(concurrencpp::executor_tag,
+                                     std::shared_ptr<concurrencpp::executor> executor,
+                                     std::shared_ptr<WeakTimer> timer,
+                                     size_t steps,
+                                     uint64_t seed) {
+  const size_t key = co_await timer->Register(executor);
+  uint64_t timestamp = 0;
+  uint64_t state = seed;
+  for (size_t step = 0; step < steps; step++) {
+    // cheap deterministic pseudo random increments so that waiters interleave
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    timestamp += 1 + (state >> 60);
+    co_await timer->MoveForward(executor, key, timestamp);
+  }
+  co_await timer->Done(executor, key);
+}
+
+TimerBenchResult RunTimerBench(std::shared_ptr<concurrencpp::executor> executor, size_t waiters, size_t steps) {
+  auto timer = std::make_shared<WeakTimer>(waiters);
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<concurrencpp::result<void>> running;
+  running.reserve(waiters);
+  for (size_t index = 0; index < waiters; index++) {
+    running.push_back(RunWaiter({}, executor, timer, steps, index + 1));
+  }
+  for (auto &waiter : running) {
+    waiter.get();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  TimerBenchResult result;
+  result.seconds_ = std::chrono::duration<double>(end - start).count();
+  result.steps_ = waiters * steps;
+  result.wakeups_ = timer->GetWakeups();
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  cxxopts::Options options("timer-bench",
+                           "Microbenchmark measuring how the weak timer scales with the amount of waiters");
+
+  options.add_options()("h,help", "Print usage")
+      ("min-waiters", "Smallest amount of waiters", cxxopts::value<size_t>()->default_value("2"))
+      ("max-waiters", "Largest amount of waiters", cxxopts::value<size_t>()->default_value("64"))
+      ("threads", "Amount of worker threads", cxxopts::value<size_t>()->default_value("4"))
+      ("steps", "Timestamps every waiter moves forward to", cxxopts::value<size_t>()->default_value("10000"));
+
+  cxxopts::ParseResult result;
+  try {
+    result = options.parse(argc, argv);
+  } catch (cxxopts::exceptions::exception &e) {
+    std::cerr << "Could not parse cli options: " << e.what() << '\n';
+    exit(EXIT_FAILURE);
+  }
+
+  if (result.count("help")) {
+    std::cout << options.help() << '\n';
+    exit(EXIT_SUCCESS);
+  }
+
+  const auto min_waiters = result["min-waiters"].as<size_t>();
+  const auto max_waiters = result["max-waiters"].as<size_t>();
+  const auto threads = result["threads"].as<size_t>();
+  const auto steps = result["steps"].as<size_t>();
+  if (min_waiters < 2 or max_waiters < min_waiters or threads == 0) {
+    std::cerr << "need 2 <= min-waiters <= max-waiters and at least one thread" << '\n';
+    exit(EXIT_FAILURE);
+  }
+
+  auto concurren_options = concurrencpp::runtime_options();
+  concurren_options.max_background_threads = 0;
+  concurren_options.max_cpu_threads = threads;
+  const concurrencpp::runtime runtime{concurren_options};
+
+  for (size_t waiters = min_waiters; waiters <= max_waiters; waiters *= 2) {
+    const TimerBenchResult bench = RunTimerBench(runtime.thread_pool_executor(), waiters, steps);
+    std::cout << "waiters=" << waiters
+              << ", steps=" << bench.steps_
+              << ", seconds=" << bench.seconds_
+              << ", steps_per_second=" << static_cast<double>(bench.steps_) / bench.seconds_
+              << ", wakeups_per_step=" << static_cast<double>(bench.wakeups_) / bench.steps_ << '\n';
+  }
+
+  exit(EXIT_SUCCESS);
+}
@@ -45,6 +45,7 @@
 #include "exporter/exporter.h"
 #include "events/printer.h"
 #include "analytics/helper.h"
+#include "analytics/topology.h"
 
 std::shared_ptr<EventPrinter> createPrinter(std::ofstream &out,
                                             cxxopts::ParseResult &result,
@@ -66,6 +67,32 @@ std::shared_ptr<EventPrinter> createPrinter(std::ofstream &out,
   return printer;
 }
 
+// a named pipe cannot be read again from an offset, a run reading one can therefore not be resumed
+bool ReadsNamedPipe(const cxxopts::ParseResult &result, const TraceEnvConfig &trace_env_config) {
+  const std::vector<std::string> input_options{"gem5-log-server", "gem5-log-client", "nicbm-log-server",
+                                               "nicbm-log-client", "ns3-log", "gem5-server-event-stream",
+                                               "gem5-client-event-stream", "nicbm-server-event-stream",
+                                               "nicbm-client-event-stream", "ns3-event-stream"};
+  for (const std::string &option : input_options) {
+    if (result.count(option) != 0 and std::filesystem::is_fifo(result[option].as<std::string>())) {
+      return true;
+    }
+  }
+
+  if (not trace_env_config.HasTopology()) {
+    return false;
+  }
+  if (std::filesystem::is_fifo(trace_env_config.GetTopologyNs3().GetPath())) {
+    return true;
+  }
+  for (const TraceEnvConfig::HostTopologyConf &host : trace_env_config.GetTopologyHosts()) {
+    if (std::filesystem::is_fifo(host.GetGem5().GetPath()) or std::filesystem::is_fifo(host.GetNicbm().GetPath())) {
+      return true;
+    }
+  }
+  return false;
+}
+
 int main(int argc, char *argv[]) {
 
   // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -94,7 +121,8 @@ int main(int argc, char *argv[]) {
       ("gem5-client-event-stream", "create trace by using the event stream", cxxopts::value<std::string>())
       ("nicbm-server-event-stream", "create trace by using the event stream", cxxopts::value<std::string>())
       ("nicbm-client-event-stream", "create trace by using the event stream", cxxopts::value<std::string>())
-      ("ns3-event-stream", "create trace by using the event stream", cxxopts::value<std::string>());
+      ("ns3-event-stream", "create trace by using the event stream", cxxopts::value<std::string>())
+      ("resume", "continue from the checkpoint file given in the trace environment config");
 
   cxxopts::ParseResult result;
   try {
@@ -136,6 +164,20 @@ int main(int argc, char *argv[]) {
 
   spdlog::set_level(trace_env_config.GetLogLevel());
 
+  if (result.count("resume")) {
+    if (not trace_env_config.IsCheckpointingEnabled()) {
+      std::cerr << "resuming requires a CheckpointFile in the trace environment config" << '\n';
+      exit(EXIT_FAILURE);
+    }
+    if (ReadsNamedPipe(result, trace_env_config)) {
+      std::cerr << "cannot resume a run that reads from named pipes" << '\n';
+      exit(EXIT_FAILURE);
+    }
+    if (not trace_environment.ResumeFromCheckpoint()) {
+      spdlog::warn("found no valid checkpoint, start tracing from the beginning");
+    }
+  }
+
 //  auto exporter = create_shared<simbricks::trace::OtlpSpanExporter>(
 //      TraceException::kSpanExporterNull,
 //      trace_environment,
@@ -148,13 +190,28 @@ int main(int argc, char *argv[]) {
   Tracer tracer{trace_environment, std::move(exporter)};
 
   constexpr size_t kLineBufferSizePages = 256;
-  constexpr bool kNamedPipes = true;
   const size_t event_buffer_size = trace_env_config.GetEventBufferSize();
   const std::set<std::string> blacklist_functions{trace_env_config.BeginBlacklistFuncIndicator(),
                                                   trace_env_config.EndBlacklistFuncIndicator()};
 
+  if (trace_env_config.HasTopology()) {
+    try {
+      std::vector<EventTimeBoundary> timestamp_bounds{EventTimeBoundary{lower_bound, upper_bound}};
+      TopologyBuilder topology_builder{trace_environment, trace_env_config, tracer, std::move(timestamp_bounds)};
+      auto pipelines = topology_builder.Build();
+      spdlog::info("START TRACING PIPELINE FROM CONFIGURED TOPOLOGY");
+      RunPipelines(trace_environment, pipelines);
+      tracer.FinishExport();
+      spdlog::info("FINISHED PIPELINE");
+    } catch (TraceException &err) {
+      std::cerr << err.what() << '\n';
+      exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
+  }
+
   try {
-    using QueueT = CoroUnBoundedChannel<std::shared_ptr<Context>>;
+    using QueueT = CoroMpmcChannel<std::shared_ptr<Context>>;
     auto server_hn = create_shared<QueueT>(TraceException::kChannelIsNull);
     auto server_nh = create_shared<QueueT>(TraceException::kChannelIsNull);
     auto client_hn = create_shared<QueueT>(TraceException::kChannelIsNull);
@@ -168,6 +225,20 @@ int main(int argc, char *argv[]) {
     using SinkT = CoroChannelSink<std::shared_ptr<Context>>;
     auto sink_chan = create_shared<SinkT>(TraceException::kChannelIsNull);
 
+    if (trace_env_config.IsChannelMetricsEnabled()) {
+      auto &channel_metrics = trace_environment.GetChannelMetrics();
+      server_hn->EnableMetrics(channel_metrics.Register("server-host-to-nic"));
+      server_nh->EnableMetrics(channel_metrics.Register("server-nic-to-host"));
+      client_hn->EnableMetrics(channel_metrics.Register("client-host-to-nic"));
+      client_nh->EnableMetrics(channel_metrics.Register("client-nic-to-host"));
+      nic_c_to_network->EnableMetrics(channel_metrics.Register("client-nic-to-network"));
+      nic_s_to_network->EnableMetrics(channel_metrics.Register("server-nic-to-network"));
+      nic_s_from_network->EnableMetrics(channel_metrics.Register("server-nic-from-network"));
+      nic_c_from_network->EnableMetrics(channel_metrics.Register("client-nic-from-network"));
+      server_n_h_receive->EnableMetrics(channel_metrics.Register("server-nic-to-host-receive"));
+      client_n_h_receive->EnableMetrics(channel_metrics.Register("client-nic-to-host-receive"));
+    }
+
     std::vector<EventTimeBoundary> timestamp_bounds{EventTimeBoundary{lower_bound, upper_bound}};
 
     auto spanner_h_s = create_shared<HostSpanner>(TraceException::kSpannerIsNull,
@@ -236,8 +307,7 @@ int main(int argc, char *argv[]) {
         and result.count("ns3-event-stream")) {
 
       auto parser_h_s = create_shared<EventStreamParser>("parser is null", trace_environment, "gem5-server-reader");
-      auto event_pro_h_s = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-          TraceException::kBufferedEventProviderIsNull,
+      auto event_pro_h_s = CreateBufferedEventProvider<kLineBufferSizePages>(
           trace_environment,
           "BufferedEventProviderHostServer",
           result["gem5-server-event-stream"].as<std::string>(),
@@ -253,8 +323,7 @@ int main(int argc, char *argv[]) {
           TraceException::kPipelineNull, event_pro_h_s, handler_h_s, spanner_h_s);
 
       auto parser_h_c = create_shared<EventStreamParser>("parser is null", trace_environment, "gem5-client-reader");
-      auto event_pro_h_c = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-          TraceException::kBufferedEventProviderIsNull,
+      auto event_pro_h_c = CreateBufferedEventProvider<kLineBufferSizePages>(
           trace_environment,
           "BufferedEventProviderHostClient",
           result["gem5-client-event-stream"].as<std::string>(),
@@ -269,8 +338,7 @@ int main(int argc, char *argv[]) {
           TraceException::kPipelineNull, event_pro_h_c, handler_h_c, spanner_h_c);
 
       auto parser_n_s = create_shared<EventStreamParser>("parser is null", trace_environment, "nicbm-server-reader");
-      auto event_pro_n_s = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-          TraceException::kBufferedEventProviderIsNull,
+      auto event_pro_n_s = CreateBufferedEventProvider<kLineBufferSizePages>(
           trace_environment,
           "BufferedEventProviderNicServer",
           result["nicbm-server-event-stream"].as<std::string>(),
@@ -286,8 +354,7 @@ int main(int argc, char *argv[]) {
           TraceException::kPipelineNull, event_pro_n_s, handler_n_s, spanner_n_s);
 
       auto parser_n_c = create_shared<EventStreamParser>("parser is null", trace_environment, "nicbm-client-reader");
-      auto event_pro_n_c = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-          TraceException::kBufferedEventProviderIsNull,
+      auto event_pro_n_c = CreateBufferedEventProvider<kLineBufferSizePages>(
           trace_environment,
           "BufferedEventProviderNicClient",
           result["nicbm-client-event-stream"].as<std::string>(),
@@ -303,8 +370,7 @@ int main(int argc, char *argv[]) {
           TraceException::kPipelineNull, event_pro_n_c, handler_n_c, spanner_n_c);
 
       auto parser_ns3 = create_shared<EventStreamParser>("parser is null", trace_environment, "ns3-event-parser");
-      auto event_pro_ns3 = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-          TraceException::kBufferedEventProviderIsNull,
+      auto event_pro_ns3 = CreateBufferedEventProvider<kLineBufferSizePages>(
           trace_environment,
           "BufferedEventProviderNs3",
           result["ns3-event-stream"].as<std::string>(),
@@ -329,10 +395,13 @@ int main(int argc, char *argv[]) {
       pipelines->emplace_back(pl_h_s);
       pipelines->emplace_back(pl_n_s);
       pipelines->emplace_back(pipeline_def_ns3);
+      // every pipeline ends in its own spanner
+      trace_environment.CreateSkewWindow(pipelines->size());
       spdlog::info("START TRACING PIPELINE FROM PREPROCESSED EVENT STREAM");
 //      RunPipelines<std::shared_ptr<Event>>(trace_environment.GetPoolExecutor(), pipelines);
       RunPipelines(trace_environment, pipelines);
 //      RunPipelines<std::shared_ptr<Event>>(trace_environment.GetThreadExecutor(), pipelines);
+      tracer.FinishExport();
       spdlog::info("FINISHED PIPELINE");
       exit(EXIT_SUCCESS);
     }
@@ -362,8 +431,7 @@ int main(int argc, char *argv[]) {
     auto gem5_server_par = create_shared<Gem5Parser>("parser is null", trace_environment,
                                                      "Gem5ServerParser",
                                                      comp_filter_server);
-    auto gem5_ser_buf_pro = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-        TraceException::kBufferedEventProviderIsNull,
+    auto gem5_ser_buf_pro = CreateBufferedEventProvider<kLineBufferSizePages>(
         trace_environment,
         "Gem5ServerEventProvider",
         result["gem5-log-server"].as<std::string>(),
@@ -404,8 +472,7 @@ int main(int argc, char *argv[]) {
     auto gem5_client_par = create_shared<Gem5Parser>("parser null", trace_environment,
                                                      "Gem5ClientParser",
                                                      comp_filter_client);
-    auto gem5_client_buf_pro = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-        TraceException::kBufferedEventProviderIsNull,
+    auto gem5_client_buf_pro = CreateBufferedEventProvider<kLineBufferSizePages>(
         trace_environment,
         "Gem5ClientEventProvider",
         result["gem5-log-client"].as<std::string>(),
@@ -445,8 +512,7 @@ int main(int argc, char *argv[]) {
                                                                     timestamp_bounds);
     auto nicbm_ser_par = create_shared<NicBmParser>("parser null", trace_environment,
                                                     "NicbmServerParser");
-    auto nicbm_ser_buf_pro = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-        TraceException::kBufferedEventProviderIsNull,
+    auto nicbm_ser_buf_pro = CreateBufferedEventProvider<kLineBufferSizePages>(
         trace_environment,
         "NicbmServerEventProvider",
         result["nicbm-log-server"].as<std::string>(),
@@ -478,8 +544,7 @@ int main(int argc, char *argv[]) {
                                                                     timestamp_bounds);
     auto nicbm_client_par = create_shared<NicBmParser>("parser null", trace_environment,
                                                        "NicbmClientParser");
-    auto nicbm_client_buf_pro = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-        TraceException::kBufferedEventProviderIsNull,
+    auto nicbm_client_buf_pro = CreateBufferedEventProvider<kLineBufferSizePages>(
         trace_environment,
         "NicbmClientEventProvider",
         result["nicbm-log-client"].as<std::string>(),
@@ -511,8 +576,7 @@ int main(int argc, char *argv[]) {
                                                                     trace_environment,
                                                                     timestamp_bounds);
     auto ns3_parser = create_shared<NS3Parser>("parser null", trace_environment, "NS3Parser");
-    auto ns3_buf_pro = create_shared<BufferedEventProvider<kNamedPipes, kLineBufferSizePages>>(
-        TraceException::kBufferedEventProviderIsNull,
+    auto ns3_buf_pro = CreateBufferedEventProvider<kLineBufferSizePages>(
         trace_environment,
         "Ns3EventProvider",
         result["ns3-log"].as<std::string>(),
@@ -545,6 +609,8 @@ int main(int argc, char *argv[]) {
     pipelines->emplace_back(client_nic_pipeline);
     pipelines->emplace_back(server_nic_pipeline);
     pipelines->emplace_back(ns3_pipeline);
+    // every pipeline ends in its own spanner
+    trace_environment.CreateSkewWindow(pipelines->size());
     spdlog::info("START TRACING PIPELINE FROM RAW SIMULATOR OUTPUT");
     // RunPipelines<std::shared_ptr<Event>>(trace_environment.GetPoolExecutor(), pipelines);
     RunPipelines(trace_environment, pipelines);